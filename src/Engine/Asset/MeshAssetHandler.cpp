@@ -2,6 +2,10 @@
 #include "MeshAssetHandler.h"
 
 #include <Engine/Core/Application.h>
+#include <Engine/Core/JobSystem.h>
+#include <Engine/Core/MeshletBuilder.h>
+#include <Engine/Core/MeshOptimizer.h>
+#include <Engine/Core/MeshSimplifier.h>
 #include <Engine/Pipeline/CommandList.h>
 #include <Engine/Pipeline/CommandQueue.h>
 #include <Engine/Buffers/Texture.h>
@@ -21,7 +25,7 @@
 
 Logger MeshAssetHandler::m_Logger;
 
-inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::path& path, u8 flags)
+inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::path& path, u8 flags, ImportedHierarchy* hierarchy)
 {
     auto device = Application::Get().GetDevice();
 
@@ -34,7 +38,8 @@ inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::
         fastgltf::Options::DontRequireValidAssetMember |
         fastgltf::Options::AllowDouble |
         fastgltf::Options::LoadGLBBuffers |
-        fastgltf::Options::LoadExternalBuffers;
+        fastgltf::Options::LoadExternalBuffers |
+        fastgltf::Options::DecomposeNodeMatrices;
 
     auto gltf = parser.loadGLTF(&data, path.parent_path(), gltfOptions);
     if (parser.getError() != fastgltf::Error::None) {
@@ -268,8 +273,8 @@ inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::
                 break;
             }
 
-            primitive.m_VertexBuffer = commandList->CopyVertexBuffer(vertices);
             primitive.m_VertexContainer = std::move(vertices);
+            primitive.ComputeBounds(primitive.m_VertexContainer);
             u32 indexCount = static_cast<u32>(indexAccessor.count);
             auto& indexView = asset->bufferViews[indexAccessor.bufferViewIndex.value()];
             size_t indexOffset = indexView.byteOffset + indexAccessor.byteOffset;
@@ -281,7 +286,6 @@ inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::
                 u16* index = reinterpret_cast<u16*>(buffers[indexView.bufferIndex].bytes->data() + indexOffset + (i * indexStride));
                 indices[i] = *index;
             }
-            primitive.m_IndexBuffer = commandList->CopyIndexBuffer(indices);
             primitive.m_IndexContainer = std::move(indices);
 
         }
@@ -289,14 +293,147 @@ inline std::vector<RefPtr<Mesh>> MeshAssetHandler::LoadImplStaticMesh(const fs::
         {
             result.reset();
         }
+
+        // Keep the position of the failed meshes, the nodes refer to the meshes by index.
+        meshes.push_back(result);
+    }
+
+    // Simplify the primitives into their levels of detail, split the levels into clusters and optimize their order
+    // on the job system, then upload the buffers (the steps reorder the indices and vertices).
+    std::vector<MeshPrimitive*> primitives;
+    for (auto& mesh : meshes)
+    {
+        if (mesh)
+        {
+            for (auto& primitive : mesh->m_Primitives)
+            {
+                // Primitives without the attributes we need were skipped.
+                if (!primitive.m_VertexContainer.empty())
+                {
+                    primitives.push_back(&primitive);
+                }
+            }
+        }
+    }
+
+    // The vertex cache statistics of LOD 0 of every primitive, as imported and as drawn.
+    std::vector<MeshOptimizer::CacheStatistics> importedCache(primitives.size());
+    std::vector<MeshOptimizer::CacheStatistics> optimizedCache(primitives.size());
+
+    const bool compactVertices = (flags & ML_COMPACT_VERTICES) != 0;
+    std::vector<std::vector<VertexCompact>> compactContainers(compactVertices ? primitives.size() : 0);
+
+    Application::Get().GetJobSystem().ParallelFor(0, static_cast<u32>(primitives.size()), 1, [&](u32 begin, u32 end)
+    {
+        MeshSimplifier simplifier;
+        MeshletBuilder builder;
+        MeshOptimizer optimizer;
+        for (u32 i = begin; i < end; ++i)
+        {
+            MeshPrimitive& primitive = *primitives[i];
+            importedCache[i] = MeshOptimizer::AnalyzeVertexCache(primitive.m_IndexContainer, primitive.m_VertexContainer.size());
+
+            primitive.GenerateLods(simplifier);
+            primitive.GenerateClusters(builder);
+            primitive.Optimize(optimizer);
+
+            optimizedCache[i] = MeshOptimizer::AnalyzeVertexCache(primitive.m_IndexContainer, primitive.m_VertexContainer.size());
+
+            if (compactVertices)
+            {
+                primitive.EncodeCompactVertices(compactContainers[i]);
+            }
+        }
+    });
+
+    size_t numLods = 0;
+    size_t numClusters = 0;
+    size_t numVertices = 0;
+    size_t vertexBufferBytes = 0;
+    MeshOptimizer::CacheStatistics imported;
+    MeshOptimizer::CacheStatistics optimized;
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        MeshPrimitive* primitive = primitives[i];
+        imported += importedCache[i];
+        optimized += optimizedCache[i];
+
+        if (compactVertices)
+        {
+            primitive->m_VertexBuffer = commandList->CopyVertexBuffer(compactContainers[i]);
+        }
         else
         {
-            meshes.push_back(result);
+            primitive->m_VertexBuffer = commandList->CopyVertexBuffer(primitive->m_VertexContainer);
+        }
+        numVertices += primitive->m_VertexContainer.size();
+        vertexBufferBytes += primitive->m_VertexContainer.size() * primitive->GetVertexStride();
+
+        primitive->m_IndexBuffer = commandList->CopyIndexBuffer(primitive->m_IndexContainer);
+        numClusters += primitive->m_Clusters.size();
+        for (auto& lod : primitive->m_Lods)
+        {
+            lod.m_IndexBuffer = commandList->CopyIndexBuffer(lod.m_IndexContainer);
+            ++numLods;
         }
     }
+    m_Logger->info("Generated {} levels of detail and {} clusters for {} primitives of {}", numLods, numClusters, primitives.size(), path.string());
+    m_Logger->info("Vertex cache of {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", path.string(),
+        imported.GetAcmr(), optimized.GetAcmr(), imported.GetAtvr(), optimized.GetAtvr());
+    const size_t fullVertexBufferBytes = numVertices * sizeof(VertexPositionNormalTangentBitangentTexture);
+    m_Logger->info("Vertex buffers of {}: {:.1f} KiB in the {} format, {:.1f} KiB saved", path.string(),
+        vertexBufferBytes / 1024.0, compactVertices ? "compact" : "full", (fullVertexBufferBytes - vertexBufferBytes) / 1024.0);
 
     commandQueue.ExecuteCommandList(commandList);
 
+    if (hierarchy)
+    {
+        hierarchy->Nodes.resize(asset->nodes.size());
+        for (size_t nodeIndex = 0; nodeIndex < asset->nodes.size(); ++nodeIndex)
+        {
+            auto& node = asset->nodes[nodeIndex];
+            auto& outNode = hierarchy->Nodes[nodeIndex];
+
+            outNode.Name = node.name;
+            if (node.meshIndex.has_value())
+            {
+                outNode.MeshIndex = static_cast<u32>(node.meshIndex.value());
+            }
+            for (size_t child : node.children)
+            {
+                outNode.Children.push_back(static_cast<u32>(child));
+            }
+
+            std::visit(fastgltf::visitor{
+                [&](fastgltf::Node::TRS& trs) {
+                    outNode.Position = Vector3(trs.translation.data());
+                    outNode.Rotation = Quaternion(trs.rotation[0], trs.rotation[1], trs.rotation[2], trs.rotation[3]);
+                    outNode.Scale = Vector3(trs.scale.data());
+                },
+                [&](fastgltf::Node::TransformMatrix& matrix) {
+                    // Column-major with column vectors is the same layout as row-major with row vectors.
+                    Matrix(matrix.data()).Decompose(outNode.Scale, outNode.Rotation, outNode.Position);
+                },
+                }, node.transform);
+        }
+
+        if (asset->defaultScene.has_value() || !asset->scenes.empty())
+        {
+            size_t sceneIndex = asset->defaultScene.value_or(0);
+            if (sceneIndex >= asset->scenes.size())
+            {
+                m_Logger->error("The default scene {} of {} does not exist, it has {} scenes", sceneIndex, path.string(), asset->scenes.size());
+                return {};
+            }
+
+            auto& scene = asset->scenes[sceneIndex];
+            for (size_t nodeIndex : scene.nodeIndices)
+            {
+                hierarchy->RootNodes.push_back(static_cast<u32>(nodeIndex));
+            }
+        }
+    }
+
     return meshes;
 }
 
@@ -330,28 +467,78 @@ RefPtr<Mesh> MeshAssetHandler::GetOrLoad(u64 hash, const fs::path& path, u8 flag
             //LoadImpl3DTexture(path, flags & TL_SRGB_SPACE);
             return nullptr;
         }
-        auto mesh = LoadImplStaticMesh(path, flags);
-        if (mesh.empty())
+        auto meshes = LoadImplStaticMesh(path, flags);
+        auto mesh = std::find_if(meshes.begin(), meshes.end(), [](const RefPtr<Mesh>& mesh) { return mesh != nullptr; });
+        if (mesh == meshes.end())
         {
             m_Logger->critical("GetOrLoad: Failed to load mesh {} with flags {}", path.string(), flags);
+            return nullptr;
         }
-        return mesh.front();
+        return *mesh;
     });
 }
 
 RefPtr<Scene> MeshAssetHandler::LoadScene(const fs::path& path, u8 flags)
 {
-    auto meshes = LoadImplStaticMesh(path, flags);
+    auto scene = MakeRef<Scene>();
+    LoadScene(path, *scene, {}, flags);
+    return scene;
+}
+
+bool MeshAssetHandler::LoadScene(const fs::path& path, Scene& scene, TransformHandle parent, u8 flags)
+{
+    ImportedHierarchy hierarchy;
+    auto meshes = LoadImplStaticMesh(path, flags, &hierarchy);
     if (meshes.empty())
     {
-        m_Logger->critical("GetOrLoad: Failed to load mesh {} with flags {}", path.string(), flags);
+        m_Logger->critical("LoadScene: Failed to load mesh {} with flags {}", path.string(), flags);
+        return false;
     }
 
-    auto scene = MakeRef<Scene>();
+    const size_t numModels = scene.GetModels().size();
+    const size_t numTransforms = scene.GetTransforms().GetSize();
 
- /*   for (auto& mesh : meshes)
+    // Add the nodes parents first, so the parent transform exists when a child is added.
+    std::vector<std::pair<u32, TransformHandle>> stack;
+    for (auto it = hierarchy.RootNodes.rbegin(); it != hierarchy.RootNodes.rend(); ++it)
     {
-    }*/
+        stack.push_back({ *it, parent });
+    }
 
-    return scene;
+    std::vector<bool> visited(hierarchy.Nodes.size(), false);
+    while (!stack.empty())
+    {
+        auto [nodeIndex, nodeParent] = stack.back();
+        stack.pop_back();
+
+        if (nodeIndex >= hierarchy.Nodes.size() || visited[nodeIndex])
+        {
+            m_Logger->warn("LoadScene: Skipping invalid or repeated node {} in {}", nodeIndex, path.string());
+            continue;
+        }
+        visited[nodeIndex] = true;
+
+        const auto& node = hierarchy.Nodes[nodeIndex];
+
+        TransformHandle transform;
+        if (node.MeshIndex < meshes.size() && meshes[node.MeshIndex])
+        {
+            auto model = scene.AddModel(MakeRef<Model>(meshes[node.MeshIndex]), node.Position, node.Rotation, node.Scale, nodeParent);
+            transform = model->GetTransformHandle();
+        }
+        else
+        {
+            transform = scene.AddNode(node.Position, node.Rotation, node.Scale, nodeParent);
+        }
+
+        for (auto it = node.Children.rbegin(); it != node.Children.rend(); ++it)
+        {
+            stack.push_back({ *it, transform });
+        }
+    }
+
+    m_Logger->info("Loaded scene {} with {} nodes and {} models", path.string(), scene.GetTransforms().GetSize() - numTransforms,
+        scene.GetModels().size() - numModels);
+
+    return true;
 }
@@ -12,7 +12,9 @@ namespace fs = std::filesystem;
 
 enum MeshLoadFlags : u8
 {
-	ML_SKINNED = 1 << 1
+	ML_SKINNED = 1 << 1,
+	// Upload the vertex buffers in the compact format (VertexCompact) instead of at full precision.
+	ML_COMPACT_VERTICES = 1 << 2
 };
 
 class MeshAssetHandler : public AssetHandler<Mesh>
@@ -26,12 +28,47 @@ public:
 	RefPtr<Mesh> GetOrLoad(u64 hash, const fs::path& path, u8 flags = 0u);
 
 	RefPtr<Scene> LoadScene(const fs::path& path, u8 flags = 0u);
+	/**
+	 * Add the node hierarchy of the default scene of a glTF file to an existing scene.
+	 *
+	 * @param parent (Optional) the node or model that the root nodes of the file are added below.
+	 * @returns false if the file could not be loaded.
+	 */
+	bool LoadScene(const fs::path& path, Scene& scene, TransformHandle parent = {}, u8 flags = 0u);
 
 private:
 	friend class Application;
 	static UniquePtr<MeshAssetHandler> m_sMeshAssetHandlerSingleton;
 
-	static inline std::vector<RefPtr<Mesh>> LoadImplStaticMesh(const fs::path& path, u8 flags);
+	/**
+	 * A glTF node, with the transform relative to its parent.
+	 */
+	struct ImportedNode
+	{
+		std::string Name;
+		// Index into the meshes returned by LoadImplStaticMesh, or ~0u for a node without a mesh.
+		u32 MeshIndex = ~0u;
+		std::vector<u32> Children;
+
+		Vector3 Position;
+		Quaternion Rotation;
+		Vector3 Scale;
+	};
+
+	struct ImportedHierarchy
+	{
+		std::vector<ImportedNode> Nodes;
+		// The root nodes of the default scene.
+		std::vector<u32> RootNodes;
+	};
+
+	/**
+	 * Load the meshes of a glTF file. The returned meshes are in the order of the file, with nullptr for the
+	 * meshes that failed to import, so the node mesh indices can be used to look them up.
+	 *
+	 * @param [out] hierarchy (Optional) the node hierarchy of the default scene.
+	 */
+	static inline std::vector<RefPtr<Mesh>> LoadImplStaticMesh(const fs::path& path, u8 flags, ImportedHierarchy* hierarchy = nullptr);
 	static inline RefPtr<Mesh> LoadImplSkinnedMesh(const fs::path& path, u8 flags);
 
 	static Logger m_Logger;
@@ -109,6 +109,15 @@ void Texture::CreateViews()
 
         CD3DX12_RESOURCE_DESC desc( m_d3d12Resource->GetDesc() );
 
+        // A typeless depth texture gets its DSV and SRV with the matching typed formats.
+        DXGI_FORMAT depthFormat = DXGI_FORMAT_UNKNOWN;
+        if ( ( desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL ) != 0 &&
+             desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D && desc.DepthOrArraySize == 1 &&
+             desc.SampleDesc.Count == 1 )
+        {
+            depthFormat = GetDepthStencilViewFormat( desc.Format );
+        }
+
         // Create RTV
         if ( ( desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET ) != 0 && CheckRTVSupport() )
         {
@@ -117,18 +126,32 @@ void Texture::CreateViews()
                                                  m_RenderTargetView.GetDescriptorHandle() );
         }
         // Create DSV
-        if ( ( desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL ) != 0 && CheckDSVSupport() )
+        if ( ( desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL ) != 0 &&
+             ( CheckDSVSupport() || depthFormat != DXGI_FORMAT_UNKNOWN ) )
         {
+            D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+            dsvDesc.Format                        = depthFormat;
+            dsvDesc.ViewDimension                 = D3D12_DSV_DIMENSION_TEXTURE2D;
+
             m_DepthStencilView = m_Device.AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE_DSV );
-            d3d12Device->CreateDepthStencilView( m_d3d12Resource.Get(), nullptr,
+            d3d12Device->CreateDepthStencilView( m_d3d12Resource.Get(),
+                                                 depthFormat != DXGI_FORMAT_UNKNOWN ? &dsvDesc : nullptr,
                                                  m_DepthStencilView.GetDescriptorHandle() );
         }
         // Create SRV
         bool srv = CheckSRVSupport();
-        if ( ( desc.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE ) == 0 && srv )
+        if ( ( desc.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE ) == 0 &&
+             ( srv || depthFormat != DXGI_FORMAT_UNKNOWN ) )
         {
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Format                          = GetDepthShaderResourceViewFormat( desc.Format );
+            srvDesc.ViewDimension                   = D3D12_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            srvDesc.Texture2D.MipLevels             = desc.MipLevels;
+
             m_ShaderResourceView = m_Device.AllocateDescriptors( D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV );
-            d3d12Device->CreateShaderResourceView( m_d3d12Resource.Get(), nullptr,
+            d3d12Device->CreateShaderResourceView( m_d3d12Resource.Get(),
+                                                   depthFormat != DXGI_FORMAT_UNKNOWN ? &srvDesc : nullptr,
                                                    m_ShaderResourceView.GetDescriptorHandle() );
         }
         // Create UAV for each mip (only supported for 1D and 2D textures).
@@ -305,6 +328,40 @@ bool Texture::IsDepthFormat( DXGI_FORMAT format )
     }
 }
 
+DXGI_FORMAT Texture::GetDepthStencilViewFormat( DXGI_FORMAT typelessFormat )
+{
+    switch ( typelessFormat )
+    {
+    case DXGI_FORMAT_R32G8X24_TYPELESS:
+        return DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
+    case DXGI_FORMAT_R32_TYPELESS:
+        return DXGI_FORMAT_D32_FLOAT;
+    case DXGI_FORMAT_R24G8_TYPELESS:
+        return DXGI_FORMAT_D24_UNORM_S8_UINT;
+    case DXGI_FORMAT_R16_TYPELESS:
+        return DXGI_FORMAT_D16_UNORM;
+    default:
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+DXGI_FORMAT Texture::GetDepthShaderResourceViewFormat( DXGI_FORMAT typelessFormat )
+{
+    switch ( typelessFormat )
+    {
+    case DXGI_FORMAT_R32G8X24_TYPELESS:
+        return DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+    case DXGI_FORMAT_R32_TYPELESS:
+        return DXGI_FORMAT_R32_FLOAT;
+    case DXGI_FORMAT_R24G8_TYPELESS:
+        return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+    case DXGI_FORMAT_R16_TYPELESS:
+        return DXGI_FORMAT_R16_UNORM;
+    default:
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
 DXGI_FORMAT Texture::GetTypelessFormat( DXGI_FORMAT format )
 {
     DXGI_FORMAT typelessFormat = format;
@@ -76,6 +76,13 @@ public:
 
     // Return a typeless format from the given format.
     static DXGI_FORMAT GetTypelessFormat( DXGI_FORMAT format );
+    /**
+     * Depth textures that are also read in shaders have a typeless format, because
+     * the DSV and the SRV need different formats. Return the DSV (or SRV) format
+     * for such a typeless format, or DXGI_FORMAT_UNKNOWN if it has no depth format.
+     */
+    static DXGI_FORMAT GetDepthStencilViewFormat( DXGI_FORMAT typelessFormat );
+    static DXGI_FORMAT GetDepthShaderResourceViewFormat( DXGI_FORMAT typelessFormat );
     // Return an sRGB format in the same format family.
     static DXGI_FORMAT GetSRGBFormat( DXGI_FORMAT format );
     static DXGI_FORMAT GetUAVCompatableFormat( DXGI_FORMAT format );
@@ -4,6 +4,9 @@
 #include "..\resource.h"
 
 #include <Pipeline/CommandQueue.h>
+#include <Pipeline/PipelineStateCache.h>
+#include <Pipeline/ShaderManager.h>
+#include <JobSystem.h>
 #include <Memory/Descriptors/DescriptorAllocator.h>
 #include <Game.h>
 #include <Window.h>
@@ -152,7 +155,19 @@ Application::Application(HINSTANCE hInst)
         MessageBoxA(NULL, "Unable to register the window class.", "Error", MB_OK | MB_ICONERROR);
     }
 
+    m_JobSystem = MakeUnique<JobSystem>();
+    spdlog::info("Job system started with {} workers.", m_JobSystem->GetNumWorkers());
+
+    // The engine modules that are created from here on access the application through Get().
+    gs_pSingelton = this;
     m_Device = Device::Create();
+
+    // The build writes the compiled shaders to the working directory. The sources are only
+    // found when running from the repository, which enables hot reloading.
+    m_ShaderManager = MakeUnique<ShaderManager>("Shaders", "../src/Shaders");
+    m_ShaderManager->BytecodeRetired += [this](ShaderBytecodeEventArgs& e) {
+        m_Device->GetPipelineStateCache().EvictShader(e.Bytecode);
+    };
      m_TearingSupported = CheckTearingSupport();
 }
 
@@ -163,7 +178,7 @@ Logger Application::CreateLogger(const std::string& name)
     Logger logger = spdlog::get(name);
     if (!logger)
     {
-        logger = m_Logger->clone(name);
+        logger = (gs_pSingelton ? gs_pSingelton->m_Logger : spdlog::default_logger())->clone(name);
         spdlog::register_logger(logger);
     }
 
@@ -320,6 +335,16 @@ RefPtr<Device> Application::GetDevice() const
     return m_Device;
 }
 
+JobSystem& Application::GetJobSystem() const
+{
+    return *m_JobSystem;
+}
+
+ShaderManager& Application::GetShaderManager() const
+{
+    return *m_ShaderManager;
+}
+
 // Convert the message ID into a MouseButton ID
 static MouseButton DecodeMouseButton(UINT messageID)
 {
@@ -411,6 +436,9 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
         break;
         case WM_PAINT:
         {
+            // Swap in the shaders that were recompiled since the last frame.
+            Application::Get().GetShaderManager().Update();
+
             // Delta and total time will be filled in by the Window.
             UpdateEventArgs updateEventArgs(0.0, 0.0);
             pWindow->OnUpdate(updateEventArgs);
@@ -16,6 +16,8 @@ using Logger = RefPtr<spdlog::logger>;
 class CommandQueue;
 class DescriptorAllocator;
 class Game;
+class JobSystem;
+class ShaderManager;
 class Window;
 
 class TextureAssetHandler;
@@ -94,15 +96,27 @@ public:
 
     /**
     * Create a named logger or get a previously created logger with the same
-    * name.
+    * name. Without an application (in the tests), the logger uses the sinks of
+    * spdlog's default logger.
     */
-    Logger CreateLogger(const std::string& name);
+    static Logger CreateLogger(const std::string& name);
 
     /**
     * Get the wrapped device
     */
     RefPtr<Device> GetDevice() const;
 
+    /**
+    * Get the job system that is shared by the engine (asset loading, culling,
+    * command list recording).
+    */
+    JobSystem& GetJobSystem() const;
+
+    /**
+    * Get the shader manager that loads (and hot reloads) the compiled shaders.
+    */
+    ShaderManager& GetShaderManager() const;
+
     /**
      * Invoked when a message is sent to a window.
      */
@@ -141,6 +155,11 @@ private:
     RefPtr<Device> m_Device;
     Logger m_Logger;
 
+    // Destroyed before the device, so no job can use it afterwards.
+    UniquePtr<JobSystem> m_JobSystem;
+
+    UniquePtr<ShaderManager> m_ShaderManager;
+
     bool m_TearingSupported;
 
     // Set to true while the application is running.
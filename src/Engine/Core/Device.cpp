@@ -10,9 +10,11 @@
 #include "Device.h" // if builds move up
 #include <GUI.h> // LEAVE THIS FOR LAST: IMGUI
 #include <Buffers/IndexBuffer.h>
+#include <Pipeline/PipelineStateCache.h>
 #include <Pipeline/PipelineStateObject.h>
 #include <Pipeline/ResourceStateTracker.h>
 #include <Pipeline/RootSignature.h>
+#include <Pipeline/RootSignatureCache.h>
 #include <Buffers/ShaderResourceView.h>
 #include <Buffers/StructuredBuffer.h>
 #include <SwapChain.h>
@@ -38,9 +40,9 @@ void Device::ReportLiveObjects()
     dxgiDebug->Release();
 }
 
-RefPtr<Device> Device::Create(RefPtr<Adapter> adapter)
+RefPtr<Device> Device::Create(RefPtr<Adapter> adapter, const fs::path& cacheDirectory)
 {
-    return MakeRef<Device>(adapter);
+    return MakeRef<Device>(adapter, cacheDirectory);
 }
 
 std::wstring Device::GetDescription() const
@@ -48,7 +50,7 @@ std::wstring Device::GetDescription() const
     return m_Adapter->GetDescription();
 }
 
-Device::Device(RefPtr<Adapter> adapter)
+Device::Device(RefPtr<Adapter> adapter, const fs::path& cacheDirectory)
     : m_Adapter(adapter)
 {
     if (!m_Adapter)
@@ -119,6 +121,9 @@ Device::Device(RefPtr<Adapter> adapter)
         }
         m_HighestRootSignatureVersion = featureData.HighestVersion;
     }
+
+    m_RootSignatureCache = MakeUnique<RootSignatureCache>(*this, cacheDirectory / "RootSignatureCache.bin");
+    m_PipelineStateCache = MakeUnique<PipelineStateCache>(*this, cacheDirectory / "PipelineStateCache.bin");
 }
 
 Device::~Device() {}
@@ -156,11 +161,11 @@ DescriptorAllocation Device::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type
     return m_DescriptorAllocators[type]->Allocate(numDescriptors);
 }
 
-void Device::ReleaseStaleDescriptors()
+void Device::ReleaseStaleDescriptors(u64 completedFrame)
 {
     for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
     {
-        m_DescriptorAllocators[i]->ReleaseStaleDescriptors();
+        m_DescriptorAllocators[i]->ReleaseStaleDescriptors(completedFrame);
     }
 }
 
@@ -270,18 +275,13 @@ std::shared_ptr<Texture> Device::CreateTexture(Microsoft::WRL::ComPtr<ID3D12Reso
 
 std::shared_ptr<RootSignature> Device::CreateRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
 {
-    std::shared_ptr<RootSignature> rootSignature = MakeRef<RootSignature>(*this, rootSignatureDesc);
-
-    return rootSignature;
+    return m_RootSignatureCache->GetOrCreate(rootSignatureDesc);
 }
 
 std::shared_ptr<PipelineStateObject> Device::DoCreatePipelineStateObject(
     const D3D12_PIPELINE_STATE_STREAM_DESC& pipelineStateStreamDesc)
 {
-    std::shared_ptr<PipelineStateObject> pipelineStateObject =
-        MakeRef<PipelineStateObject>(*this, pipelineStateStreamDesc);
-
-    return pipelineStateObject;
+    return m_PipelineStateCache->GetOrCreate(pipelineStateStreamDesc);
 }
 
 std::shared_ptr<ConstantBufferView>
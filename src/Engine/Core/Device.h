@@ -49,10 +49,12 @@ class ConstantBufferView;
 class DescriptorAllocator;
 class GUI;
 class IndexBuffer;
+class PipelineStateCache;
 class PipelineStateObject;
 class RenderTarget;
 class Resource;
 class RootSignature;
+class RootSignatureCache;
 class Scene;
 class ShaderResourceView;
 class StructuredBuffer;
@@ -75,8 +77,10 @@ public:
     /**
         * Create a new DX12 device using the provided adapter.
         * If no adapter is specified, then the highest performance adapter will be  chosen.
+        * The root signature and pipeline state caches are stored in cacheDirectory.
         */
-    static std::shared_ptr<Device> Create(std::shared_ptr<Adapter> adapter = nullptr);
+    static std::shared_ptr<Device> Create(std::shared_ptr<Adapter> adapter = nullptr,
+                                          const fs::path& cacheDirectory = "cache");
 
     /**
         * Get a description of the adapter that was used to create the device.
@@ -149,8 +153,16 @@ public:
     std::shared_ptr<VertexBuffer> CreateVertexBuffer(Microsoft::WRL::ComPtr<ID3D12Resource> resource,
         size_t numVertices, size_t vertexStride);
 
+    /**
+        * Create (or get a shared) root signature. Identical descriptions return the same
+        * root signature, see RootSignatureCache.
+        */
     std::shared_ptr<RootSignature> CreateRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
 
+    /**
+        * Create (or get a cached) pipeline state object. Pipelines are cached in memory and
+        * on disk, see PipelineStateCache.
+        */
     template<class PipelineStateStream>
     std::shared_ptr<PipelineStateObject> CreatePipelineStateObject(PipelineStateStream& pipelineStateStream)
     {
@@ -180,7 +192,7 @@ public:
     /**
         * Release stale descriptors. This should only be called with a completed frame counter.
         */
-    void ReleaseStaleDescriptors();
+    void ReleaseStaleDescriptors(u64 completedFrame);
 
     /**
         * Get the adapter that was used to create this device.
@@ -204,6 +216,16 @@ public:
         return m_d3d12Device;
     }
 
+    PipelineStateCache& GetPipelineStateCache()
+    {
+        return *m_PipelineStateCache;
+    }
+
+    RootSignatureCache& GetRootSignatureCache()
+    {
+        return *m_RootSignatureCache;
+    }
+
     D3D_ROOT_SIGNATURE_VERSION GetHighestRootSignatureVersion() const
     {
         return m_HighestRootSignatureVersion;
@@ -216,7 +238,7 @@ public:
         DXGI_FORMAT format, UINT numSamples = D3D12_MAX_MULTISAMPLE_SAMPLE_COUNT,
         D3D12_MULTISAMPLE_QUALITY_LEVEL_FLAGS flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE) const;
 
-    explicit Device(std::shared_ptr<Adapter> adapter);
+    Device(std::shared_ptr<Adapter> adapter, const fs::path& cacheDirectory);
     virtual ~Device();
 
     std::shared_ptr<PipelineStateObject>
@@ -237,4 +259,7 @@ private:
     std::unique_ptr<DescriptorAllocator> m_DescriptorAllocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
     D3D_ROOT_SIGNATURE_VERSION m_HighestRootSignatureVersion;
+
+    std::unique_ptr<RootSignatureCache> m_RootSignatureCache;
+    std::unique_ptr<PipelineStateCache> m_PipelineStateCache;
 };
@@ -0,0 +1,79 @@
+#include "enginepch.h"
+
+#include "FileWatcher.h"
+
+static bool GetLastWriteTime(const fs::path& path, fs::file_time_type& lastWriteTime)
+{
+    std::error_code error;
+    lastWriteTime = fs::last_write_time(path, error);
+    return !error;
+}
+
+fs::path FileWatcher::NormalizePath(const fs::path& path)
+{
+    std::error_code error;
+    fs::path absolutePath = fs::absolute(path, error);
+    return (error ? path : absolutePath).lexically_normal();
+}
+
+void FileWatcher::AddFile(const fs::path& path)
+{
+    fs::path normalizedPath = NormalizePath(path);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Files.find(normalizedPath) != m_Files.end())
+    {
+        return;
+    }
+
+    WatchedFile file;
+    file.Exists = GetLastWriteTime(normalizedPath, file.LastWriteTime);
+    m_Files.emplace(normalizedPath, file);
+}
+
+void FileWatcher::RemoveFile(const fs::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Files.erase(NormalizePath(path));
+}
+
+bool FileWatcher::IsWatching(const fs::path& path) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Files.find(NormalizePath(path)) != m_Files.end();
+}
+
+void FileWatcher::Poll()
+{
+    std::vector<FileChangedEventArgs> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto& [path, file] : m_Files)
+        {
+            fs::file_time_type lastWriteTime;
+            bool               exists = GetLastWriteTime(path, lastWriteTime);
+
+            if (exists && !file.Exists)
+            {
+                changes.emplace_back(FileAction::Added, path.wstring());
+            }
+            else if (!exists && file.Exists)
+            {
+                changes.emplace_back(FileAction::Removed, path.wstring());
+            }
+            else if (exists && lastWriteTime != file.LastWriteTime)
+            {
+                changes.emplace_back(FileAction::Modified, path.wstring());
+            }
+
+            file.Exists = exists;
+            file.LastWriteTime = lastWriteTime;
+        }
+    }
+
+    // Invoked without holding the lock, so the handlers can add files.
+    for (auto& change : changes)
+    {
+        FileChanged(change);
+    }
+}
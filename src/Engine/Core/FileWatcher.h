@@ -0,0 +1,53 @@
+/**
+ * Watches a set of files for changes.
+ *
+ * The watcher polls the last write time of the files instead of using
+ * ReadDirectoryChangesW, so it only depends on std::filesystem and changes are
+ * reported on the thread that calls Poll. Several writes between two polls (as
+ * some editors do when saving) are reported as a single change.
+ */
+#pragma once
+
+#include <Engine/Core/Events.h>
+
+#include <map>
+#include <mutex>
+
+class FileWatcher
+{
+public:
+    /**
+     * Start watching a file. The file does not have to exist yet, in which case
+     * an Added change is reported once it is created.
+     */
+    void AddFile(const fs::path& path);
+
+    void RemoveFile(const fs::path& path);
+
+    bool IsWatching(const fs::path& path) const;
+
+    /**
+     * Check the watched files and invoke FileChanged for every file that was
+     * added, removed or modified since the previous poll. Thread safe, but the
+     * events are invoked on the calling thread.
+     */
+    void Poll();
+
+    /**
+     * Invoked by Poll for every changed file. The path is the normalized absolute path.
+     */
+    FileChangeEvent FileChanged;
+
+    // Paths are compared after normalization.
+    static fs::path NormalizePath(const fs::path& path);
+
+private:
+    struct WatchedFile
+    {
+        bool                Exists = false;
+        fs::file_time_type  LastWriteTime;
+    };
+
+    mutable std::mutex              m_Mutex;
+    std::map<fs::path, WatchedFile> m_Files;
+};
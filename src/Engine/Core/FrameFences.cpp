@@ -0,0 +1,28 @@
+#include "enginepch.h"
+
+#include "FrameFences.h"
+
+#include <Pipeline/CommandQueue.h>
+
+FrameFences::FrameFences(CommandQueue& directQueue, CommandQueue& computeQueue)
+    : m_DirectQueue(directQueue)
+    , m_ComputeQueue(computeQueue)
+    , m_FrameFenceValues{ 0 }
+    , m_FrameComputeFenceValues{ 0 }
+{
+}
+
+u64 FrameFences::EndFrame(u64 frame)
+{
+    u64 fenceValue = m_DirectQueue.Signal();
+    m_FrameFenceValues[frame % g_NumFrames] = fenceValue;
+    m_FrameComputeFenceValues[frame % g_NumFrames] = m_ComputeQueue.GetLastSignaledFenceValue();
+
+    return fenceValue;
+}
+
+void FrameFences::BeginFrame(u64 frame)
+{
+    m_DirectQueue.WaitForFenceValue(m_FrameFenceValues[frame % g_NumFrames]);
+    m_ComputeQueue.WaitForFenceValue(m_FrameComputeFenceValues[frame % g_NumFrames]);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+class CommandQueue;
+
+/**
+ * The fence values of the frames in flight. Keeps the CPU at most g_NumFrames
+ * frames ahead of the GPU: a frame reuses the slot of the frame g_NumFrames
+ * before it, which has to finish on both the direct and the compute queue first.
+ */
+class FrameFences
+{
+public:
+    FrameFences(CommandQueue& directQueue, CommandQueue& computeQueue);
+
+    /**
+     * Signal the end of a frame on the direct queue and remember the last fence value of the
+     * compute queue. The compute stages of the frame are already submitted, but with async
+     * compute the direct queue doesn't wait for them before its frame fence (the next frame's
+     * debug stage does).
+     *
+     * @returns The direct queue fence value of the frame.
+     */
+    u64 EndFrame(u64 frame);
+
+    /**
+     * Wait until the slot of a frame is free, that is until the frame g_NumFrames before it has
+     * finished on both queues. The frame's compute stages may still read its descriptors after
+     * its direct queue fence. The compute wait rarely blocks, since the later frames' debug
+     * stages already waited for it on the GPU.
+     */
+    void BeginFrame(u64 frame);
+
+private:
+    CommandQueue& m_DirectQueue;
+    CommandQueue& m_ComputeQueue;
+
+    // The fence values of the frames in flight, indexed by frame number % g_NumFrames.
+    u64 m_FrameFenceValues[g_NumFrames];
+    u64 m_FrameComputeFenceValues[g_NumFrames];
+};
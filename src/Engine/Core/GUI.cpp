@@ -6,7 +6,9 @@
 #include <Pipeline/CommandQueue.h>
 #include <Device.h>
 #include <RenderTarget.h>
+#include <Application.h>
 #include <Pipeline/RootSignature.h>
+#include <Pipeline/ShaderManager.h>
 #include <Buffers/ShaderResourceView.h>
 #include <Buffers/Texture.h>
 
@@ -160,16 +162,10 @@ GUI::GUI( Device& device, HWND hWnd, const RenderTarget& renderTarget )
     pipelineStateStream.InputLayout           = { inputLayout, 3 };
     pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 
-    // Load the vertex shader.
-    ComPtr<ID3DBlob> vertexShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders/ImGuiVS.cso", &vertexShaderBlob));
-
-    // Load the pixel shader.
-    ComPtr<ID3DBlob> pixelShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders/ImGuiPS.cso", &pixelShaderBlob));
-
-    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
+    // Load the shaders.
+    ShaderManager& shaderManager = Application::Get().GetShaderManager();
+    pipelineStateStream.VS = shaderManager.Load("ImGuiVS")->GetBytecode();
+    pipelineStateStream.PS = shaderManager.Load("ImGuiPS")->GetBytecode();
     
     pipelineStateStream.RTVFormats            = renderTarget.GetRenderTargetFormats();
     pipelineStateStream.SampleDesc            = renderTarget.GetSampleDesc();
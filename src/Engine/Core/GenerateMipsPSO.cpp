@@ -2,7 +2,9 @@
 
 #include <Device.h>
 #include "GenerateMipsPSO.h"
+#include <Application.h>
 #include <Pipeline/RootSignature.h>
+#include <Pipeline/ShaderManager.h>
 
 GenerateMipsPSO::GenerateMipsPSO( Device& device )
 {
@@ -37,9 +39,7 @@ GenerateMipsPSO::GenerateMipsPSO( Device& device )
     pipelineStateStream.pRootSignature = m_RootSignature->GetD3D12RootSignature().Get();
 
     // load g_PanoToCubemap_CS from disk
-    ComPtr<ID3DBlob> computeShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders/GenerateMipsCS.cso", &computeShaderBlob));
-    pipelineStateStream.CS             = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
+    pipelineStateStream.CS             = Application::Get().GetShaderManager().Load("GenerateMipsCS")->GetBytecode();
 
     m_PipelineState = device.CreatePipelineStateObject( pipelineStateStream );
 
@@ -53,6 +53,20 @@ constexpr u64 operator "" _hs(const char* str, size_t) {
     return fast_string_hash(str);
 }
 
+// FNV-1a hash of a block of memory. Pass the previous result as seed to hash several blocks.
+inline u64 HashBytes(const void* data, size_t size, u64 seed = 0xcbf29ce484222325ULL)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    u64 hashVal = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hashVal ^= bytes[i];
+        hashVal *= 0x100000001b3ULL;
+    }
+
+    return hashVal;
+}
+
 // Set the name of an std::thread.
 // Useful for debugging.
 const DWORD MS_VC_EXCEPTION = 0x406D1388;
@@ -0,0 +1,197 @@
+#include "enginepch.h"
+
+#include "JobSystem.h"
+
+// The job system and worker index of the calling thread (if it is a worker).
+static thread_local JobSystem* t_JobSystem = nullptr;
+static thread_local u32        t_WorkerIndex = 0;
+
+JobSystem::JobSystem(u32 numWorkers)
+    : m_NumQueuedJobs(0)
+    , m_NextWorker(0)
+    , m_Running(true)
+{
+    if (numWorkers == 0)
+    {
+        u32 numThreads = std::thread::hardware_concurrency();
+        numWorkers = numThreads > 1 ? numThreads - 1 : 1;
+    }
+
+    m_Workers.reserve(numWorkers);
+    for (u32 i = 0; i < numWorkers; ++i)
+    {
+        m_Workers.push_back(MakeUnique<Worker>());
+    }
+
+    // Start the threads after all deques exist, since workers steal from each other.
+    for (u32 i = 0; i < numWorkers; ++i)
+    {
+        auto& worker = *m_Workers[i];
+        worker.Thread = std::thread(&JobSystem::WorkerThread, this, i);
+
+        char threadName[32];
+        sprintf_s(threadName, "Job Worker %u", i);
+        SetThreadName(worker.Thread, threadName);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Running = false;
+    }
+    m_SleepCV.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker->Thread.join();
+    }
+}
+
+void JobSystem::Schedule(Job job, JobCounter* counter, JobCounter* dependency)
+{
+    if (counter)
+    {
+        counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+        job = [this, job = std::move(job), counter] {
+            job();
+            Signal(*counter);
+        };
+    }
+
+    if (dependency)
+    {
+        std::lock_guard<std::mutex> lock(dependency->m_ContinuationsMutex);
+        if (!dependency->IsDone())
+        {
+            dependency->m_Continuations.push_back(std::move(job));
+            return;
+        }
+    }
+
+    Push(std::move(job));
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    Job job;
+    while (!counter.IsDone())
+    {
+        if (TryPop(job))
+        {
+            job();
+            job = nullptr;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Signal holds the mutex while it decrements the count. Make sure it is done
+    // with the counter before the caller is allowed to destroy it.
+    std::lock_guard<std::mutex> lock(counter.m_ContinuationsMutex);
+}
+
+void JobSystem::Push(Job job)
+{
+    // Workers push to their own deque, other threads distribute the jobs.
+    u32 workerIndex = t_JobSystem == this
+                          ? t_WorkerIndex
+                          : m_NextWorker.fetch_add(1, std::memory_order_relaxed) % GetNumWorkers();
+
+    // Count the job before it can be popped, so the count never drops below zero.
+    m_NumQueuedJobs.fetch_add(1, std::memory_order_release);
+
+    auto& worker = *m_Workers[workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        worker.Jobs.push_back(std::move(job));
+    }
+
+    // Taking the sleep mutex makes sure a worker that is about to sleep sees the new job.
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+    }
+    m_SleepCV.notify_one();
+}
+
+bool JobSystem::TryPop(Job& job)
+{
+    const u32 numWorkers = GetNumWorkers();
+    const bool isWorker = t_JobSystem == this;
+
+    // Newest job from our own deque first.
+    if (isWorker)
+    {
+        auto& worker = *m_Workers[t_WorkerIndex];
+
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        if (!worker.Jobs.empty())
+        {
+            job = std::move(worker.Jobs.back());
+            worker.Jobs.pop_back();
+            m_NumQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Steal the oldest job of another worker.
+    const u32 first = isWorker ? t_WorkerIndex + 1 : 0;
+    const u32 numVictims = isWorker ? numWorkers - 1 : numWorkers;
+    for (u32 i = 0; i < numVictims; ++i)
+    {
+        auto& victim = *m_Workers[(first + i) % numWorkers];
+
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if (!victim.Jobs.empty())
+        {
+            job = std::move(victim.Jobs.front());
+            victim.Jobs.pop_front();
+            m_NumQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::Signal(JobCounter& counter)
+{
+    std::vector<Job> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_ContinuationsMutex);
+        if (counter.m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::swap(continuations, counter.m_Continuations);
+        }
+    }
+
+    for (auto& continuation : continuations)
+    {
+        Push(std::move(continuation));
+    }
+}
+
+void JobSystem::WorkerThread(u32 workerIndex)
+{
+    t_JobSystem = this;
+    t_WorkerIndex = workerIndex;
+
+    Job job;
+    while (m_Running)
+    {
+        if (TryPop(job))
+        {
+            job();
+            job = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_SleepCV.wait(lock, [this] {
+            return !m_Running || m_NumQueuedJobs.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * Work-stealing job system.
+ *
+ * Every worker owns a deque of jobs. Workers push and pop jobs at the back of
+ * their own deque (LIFO, cache friendly) and steal from the front of the
+ * deques of other workers (FIFO, oldest and usually largest work first) when
+ * they run out of work. Jobs scheduled from threads that are not workers are
+ * distributed over the worker deques round-robin.
+ *
+ * Completion is tracked with JobCounters: a counter is incremented when a job
+ * is scheduled and decremented when the job has run. Jobs can depend on a
+ * counter, in which case they are scheduled once the counter reaches zero.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/**
+ * Counts the jobs that are still pending. A counter must outlive the jobs that
+ * signal it.
+ */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    /**
+     * Returns true if all jobs that signal this counter have finished.
+     */
+    bool IsDone() const
+    {
+        return m_Count.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<u32> m_Count{ 0 };
+
+    // Jobs that are scheduled once the counter reaches zero. The mutex is also held
+    // while the count is decremented, see JobSystem::Wait.
+    mutable std::mutex                 m_ContinuationsMutex;
+    std::vector<std::function<void()>> m_Continuations;
+};
+
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    /**
+     * @param numWorkers The number of worker threads. 0 uses one worker per
+     * hardware thread, minus one for the calling (main) thread.
+     */
+    explicit JobSystem(u32 numWorkers = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * Schedule a job. Jobs must not throw.
+     *
+     * @param job The job to run.
+     * @param counter (Optional) counter that is signaled when the job has run.
+     * @param dependency (Optional) the job is not started before this counter reaches zero.
+     */
+    void Schedule(Job job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    /**
+     * Wait until the counter reaches zero. The calling thread runs pending jobs
+     * while it waits, so this can be called from within a job.
+     */
+    void Wait(const JobCounter& counter);
+
+    /**
+     * Invoke func(rangeBegin, rangeEnd) over [begin, end) split into ranges of at
+     * least grainSize elements, and wait for all ranges to finish. The first range
+     * runs on the calling thread.
+     */
+    template<typename Func>
+    void ParallelFor(u32 begin, u32 end, u32 grainSize, Func&& func);
+
+    /**
+     * Get the number of worker threads (not counting threads that help in Wait).
+     */
+    u32 GetNumWorkers() const
+    {
+        return static_cast<u32>(m_Workers.size());
+    }
+
+private:
+    struct Worker
+    {
+        std::thread     Thread;
+        std::mutex      Mutex;
+        std::deque<Job> Jobs;
+    };
+
+    // Push a job whose dependencies are met.
+    void Push(Job job);
+
+    // Pop a job from the calling worker's own deque or steal one from another worker.
+    bool TryPop(Job& job);
+
+    // Signal a counter and schedule its continuations if it reaches zero.
+    void Signal(JobCounter& counter);
+
+    void WorkerThread(u32 workerIndex);
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+
+    // Number of jobs in the deques. Idle workers sleep while it's zero.
+    std::atomic<u32>        m_NumQueuedJobs;
+    std::mutex              m_SleepMutex;
+    std::condition_variable m_SleepCV;
+
+    // Round robin index for jobs that are pushed from non-worker threads.
+    std::atomic<u32> m_NextWorker;
+    std::atomic_bool m_Running;
+};
+
+template<typename Func>
+void JobSystem::ParallelFor(u32 begin, u32 end, u32 grainSize, Func&& func)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const u32 count = end - begin;
+    const u32 maxRanges = GetNumWorkers() + 1;
+    const u32 numRanges = std::max(1u, std::min(maxRanges, count / std::max(1u, grainSize)));
+
+    JobCounter counter;
+    for (u32 i = 1; i < numRanges; ++i)
+    {
+        u32 rangeBegin = begin + static_cast<u32>(static_cast<u64>(count) * i / numRanges);
+        u32 rangeEnd = begin + static_cast<u32>(static_cast<u64>(count) * (i + 1) / numRanges);
+        Schedule([&func, rangeBegin, rangeEnd] { func(rangeBegin, rangeEnd); }, &counter);
+    }
+
+    func(begin, begin + static_cast<u32>(count / numRanges));
+
+    Wait(counter);
+}
@@ -5,9 +5,14 @@
 #include <Buffers/VertexBuffer.h>
 #include "Mesh.h"
 #include "Material.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 #include <Engine/Asset/MaterialAssetHandler.h>
 
+#include <numeric>
+
 Mesh::Mesh()
 : m_PrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST )
 {}
@@ -35,6 +40,177 @@ std::shared_ptr<VertexBuffer> MeshPrimitive::GetVertexBuffer() const
     return m_VertexBuffer;
 }
 
+void MeshPrimitive::ComputeBounds(const std::vector<VertexPositionNormalTangentBitangentTexture>& vertices)
+{
+    if (vertices.empty())
+    {
+        m_BoundingBox = DirectX::BoundingBox({ 0, 0, 0 }, { 0, 0, 0 });
+        m_BoundingSphere = DirectX::BoundingSphere({ 0, 0, 0 }, 0);
+        return;
+    }
+
+    const size_t stride = sizeof(VertexPositionNormalTangentBitangentTexture);
+    DirectX::BoundingBox::CreateFromPoints(m_BoundingBox, vertices.size(), &vertices[0].Position, stride);
+    DirectX::BoundingSphere::CreateFromPoints(m_BoundingSphere, vertices.size(), &vertices[0].Position, stride);
+}
+
+void MeshPrimitive::GenerateLods(MeshSimplifier& simplifier)
+{
+    // Primitives this small are not worth simplifying, and a level that removes less than a fifth of the
+    // triangles of the one before (because the rest is locked borders, for example) is not worth drawing.
+    constexpr size_t MinLodTriangles = 128;
+    constexpr float  MaxLodReduction = 0.8f;
+    // The largest error of a level, relative to the size of the primitive.
+    constexpr float  MaxRelativeError = 0.25f;
+
+    m_Lods.clear();
+    m_Lods.reserve(MaxLods - 1);
+
+    float error = 0.0f;
+    while (GetNumLods() < MaxLods)
+    {
+        const std::vector<u32>& indices = GetIndices(GetNumLods() - 1);
+        if (indices.size() / 3 < MinLodTriangles)
+        {
+            break;
+        }
+
+        MeshLod lod;
+        float lodError = simplifier.Simplify(m_VertexContainer, indices, indices.size() / 6 * 3,
+            MaxRelativeError * m_BoundingSphere.Radius, lod.m_IndexContainer);
+        if (lod.m_IndexContainer.size() > indices.size() * MaxLodReduction)
+        {
+            break;
+        }
+
+        // Every level is simplified from the level before, so their errors add up.
+        error += lodError;
+        lod.m_Error = error;
+        m_Lods.push_back(std::move(lod));
+    }
+}
+
+void MeshPrimitive::GenerateClusters(MeshletBuilder& builder)
+{
+    for (u32 lod = 0; lod < GetNumLods(); ++lod)
+    {
+        std::vector<u32>& indices = lod == 0 ? m_IndexContainer : m_Lods[lod - 1].m_IndexContainer;
+        std::vector<MeshCluster>& clusters = lod == 0 ? m_Clusters : m_Lods[lod - 1].m_Clusters;
+
+        u32 numMeshlets = builder.Build(m_VertexContainer, indices);
+        builder.GetIndices(indices);
+
+        clusters.resize(numMeshlets);
+        for (u32 i = 0; i < numMeshlets; ++i)
+        {
+            const MeshletBuilder::Meshlet& meshlet = builder.GetMeshlets()[i];
+            const MeshletBuilder::Bounds& bounds = builder.GetBounds()[i];
+
+            MeshCluster& cluster = clusters[i];
+            cluster.m_FirstIndex = meshlet.TriangleOffset * 3;
+            cluster.m_NumIndices = meshlet.TriangleCount * 3;
+            cluster.m_BoundingSphere = DirectX::BoundingSphere(bounds.Center, bounds.Radius);
+            cluster.m_ConeApex = bounds.ConeApex;
+            cluster.m_ConeAxis = bounds.ConeAxis;
+            cluster.m_ConeCutoff = bounds.ConeCutoff;
+        }
+    }
+}
+
+void MeshPrimitive::Optimize(MeshOptimizer& optimizer)
+{
+    // The clusters are ordered by how much they face away from the center of the primitive, so the outer clusters,
+    // which tend to hide the inner ones, are drawn first (Sander et al.). The order is only this coarse because
+    // the clusters in a bucket stay in their spatial order, which keeps the visible clusters in few draws.
+    constexpr float OverdrawBuckets = 4.0f;
+
+    std::vector<u32> order;
+    std::vector<int> buckets;
+    std::vector<u32> reordered;
+    std::vector<MeshCluster> reorderedClusters;
+
+    for (u32 lod = 0; lod < GetNumLods(); ++lod)
+    {
+        std::vector<u32>& indices = lod == 0 ? m_IndexContainer : m_Lods[lod - 1].m_IndexContainer;
+        std::vector<MeshCluster>& clusters = lod == 0 ? m_Clusters : m_Lods[lod - 1].m_Clusters;
+
+        if (clusters.empty())
+        {
+            optimizer.OptimizeVertexCache(indices.data(), indices.size());
+            continue;
+        }
+
+        buckets.resize(clusters.size());
+        for (size_t i = 0; i < clusters.size(); ++i)
+        {
+            MeshCluster& cluster = clusters[i];
+            optimizer.OptimizeVertexCache(indices.data() + cluster.m_FirstIndex, cluster.m_NumIndices);
+
+            const DirectX::XMFLOAT3& center = cluster.m_BoundingSphere.Center;
+            const DirectX::XMFLOAT3& axis = cluster.m_ConeAxis;
+            float outwards = (center.x - m_BoundingSphere.Center.x) * axis.x + (center.y - m_BoundingSphere.Center.y) * axis.y +
+                (center.z - m_BoundingSphere.Center.z) * axis.z;
+            buckets[i] = static_cast<int>(std::floor(outwards / std::max(m_BoundingSphere.Radius, FLT_MIN) * OverdrawBuckets));
+        }
+
+        order.resize(clusters.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&buckets](u32 a, u32 b) { return buckets[a] > buckets[b]; });
+
+        reordered.clear();
+        reorderedClusters.clear();
+        for (u32 i : order)
+        {
+            MeshCluster cluster = clusters[i];
+            reordered.insert(reordered.end(), indices.begin() + cluster.m_FirstIndex, indices.begin() + cluster.m_FirstIndex + cluster.m_NumIndices);
+            cluster.m_FirstIndex = static_cast<u32>(reordered.size()) - cluster.m_NumIndices;
+            reorderedClusters.push_back(cluster);
+        }
+        indices.swap(reordered);
+        clusters.swap(reorderedClusters);
+    }
+
+    std::vector<std::vector<u32>*> indexLists = { &m_IndexContainer };
+    for (MeshLod& lod : m_Lods)
+    {
+        indexLists.push_back(&lod.m_IndexContainer);
+    }
+    optimizer.OptimizeVertexFetch(m_VertexContainer, indexLists);
+}
+
+void MeshPrimitive::EncodeCompactVertices(std::vector<VertexCompact>& vertices)
+{
+    const DirectX::XMFLOAT3& center = m_BoundingBox.Center;
+    const DirectX::XMFLOAT3& extents = m_BoundingBox.Extents;
+
+    m_VertexFormat = VertexFormat::Compact;
+    m_PositionScale = { extents.x * 2.0f, extents.y * 2.0f, extents.z * 2.0f };
+    m_PositionOffset = { center.x - extents.x, center.y - extents.y, center.z - extents.z };
+
+    vertices.clear();
+    vertices.reserve(m_VertexContainer.size());
+    for (const auto& vertex : m_VertexContainer)
+    {
+        vertices.emplace_back(vertex, m_PositionScale, m_PositionOffset);
+    }
+}
+
+void MeshPrimitive::AppendDecodedVertices(std::vector<VertexPositionTexture>& vertices) const
+{
+    vertices.reserve(vertices.size() + m_VertexContainer.size());
+    for (const auto& vertex : m_VertexContainer)
+    {
+        if (m_VertexFormat == VertexFormat::Compact)
+        {
+            vertices.emplace_back(VertexCompact(vertex, m_PositionScale, m_PositionOffset).Decode(m_PositionScale, m_PositionOffset));
+        }
+        else
+        {
+            vertices.emplace_back(vertex);
+        }
+    }
+}
+
 void MeshPrimitive::SetIndexBuffer( const std::shared_ptr<IndexBuffer>& indexBuffer )
 {
     m_IndexBuffer = indexBuffer;
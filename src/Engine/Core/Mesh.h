@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>       // For XMFLOAT3, XMFLOAT2
+#include <DirectXCollision.h>  // For BoundingBox, BoundingSphere
 
 #include <d3d12.h>  // For D3D12_INPUT_LAYOUT_DESC, D3D12_INPUT_ELEMENT_DESC
 
@@ -12,11 +13,60 @@
 class CommandList;
 class IndexBuffer;
 class Material;
+class MeshletBuilder;
+class MeshOptimizer;
+class MeshSimplifier;
 class VertexBuffer;
 class Visitor;
 
+/**
+ * A cluster of the triangles of a primitive (a meshlet, see MeshletBuilder) that
+ * is culled on its own. Its triangles are a range of the index container.
+ */
+struct MeshCluster
+{
+    u32 m_FirstIndex;
+    u32 m_NumIndices;
+
+    DirectX::BoundingSphere m_BoundingSphere;
+
+    // All the triangles face away from a camera at eye if dot(normalize(apex - eye), axis) >= cutoff.
+    DirectX::XMFLOAT3 m_ConeApex;
+    DirectX::XMFLOAT3 m_ConeAxis;
+    float m_ConeCutoff;
+};
+
+/**
+ * A simplified version of a mesh primitive. It is drawn with the vertex buffer
+ * of the primitive and its own, smaller, index buffer.
+ */
+struct MeshLod
+{
+    RefPtr<IndexBuffer> m_IndexBuffer;
+    std::vector<u32> m_IndexContainer;
+    std::vector<MeshCluster> m_Clusters;
+
+    // Roughly the largest distance of the simplified surface from the primitive, in object space.
+    float m_Error = 0.0f;
+};
+
+/**
+ * The format of the vertex buffer of a primitive. The vertex container always
+ * holds VertexPositionNormalTangentBitangentTexture.
+ */
+enum class VertexFormat : u8
+{
+    // VertexPositionNormalTangentBitangentTexture.
+    Full,
+    // VertexCompact, with the positions quantized to the bounding box of the primitive.
+    Compact,
+};
+
 struct MeshPrimitive
 {
+    // The most levels of detail of a primitive, including the primitive itself (LOD 0).
+    static constexpr u32 MaxLods = 4;
+
     RefPtr<VertexBuffer> m_VertexBuffer;
     RefPtr<IndexBuffer> m_IndexBuffer;
 
@@ -25,6 +75,21 @@ struct MeshPrimitive
 
     u32 m_MaterialIndex;
 
+    // Object space bounds of the vertices.
+    DirectX::BoundingBox    m_BoundingBox;
+    DirectX::BoundingSphere m_BoundingSphere;
+
+    // The simplified levels of detail after LOD 0, from fine to coarse. Empty if none were generated.
+    std::vector<MeshLod> m_Lods;
+
+    // The clusters of LOD 0. Empty if none were generated.
+    std::vector<MeshCluster> m_Clusters;
+
+    VertexFormat m_VertexFormat = VertexFormat::Full;
+    // Decode the positions of a compact vertex buffer: position = quantized * scale + offset.
+    DirectX::XMFLOAT3 m_PositionScale = { 1.0f, 1.0f, 1.0f };
+    DirectX::XMFLOAT3 m_PositionOffset = { 0.0f, 0.0f, 0.0f };
+
     MeshPrimitive() = default;
 
     MeshPrimitive(const RefPtr<VertexBuffer>& vertexBuffer, const RefPtr<IndexBuffer>& indexBuffer, u32 materialIndex)
@@ -38,6 +103,79 @@ struct MeshPrimitive
 
     void                         SetIndexBuffer(const std::shared_ptr<IndexBuffer>& indexBuffer);
     std::shared_ptr<IndexBuffer> GetIndexBuffer();
+
+    /**
+     * Compute the bounding box and sphere of the primitive's vertices.
+     */
+    void ComputeBounds(const std::vector<VertexPositionNormalTangentBitangentTexture>& vertices);
+
+    /**
+     * Generate the levels of detail from the vertex and index containers. Every
+     * level has about half the triangles of the level before. The index buffers
+     * of the levels are not created.
+     */
+    void GenerateLods(MeshSimplifier& simplifier);
+
+    /**
+     * Split every level of detail into clusters, and reorder its index container
+     * so the triangles of every cluster are consecutive. Call after GenerateLods
+     * and before the index buffers are created.
+     */
+    void GenerateClusters(MeshletBuilder& builder);
+
+    /**
+     * Reorder the triangles of every cluster for the post-transform vertex cache,
+     * the clusters for less overdraw, and the vertices for vertex fetch. Call
+     * after GenerateClusters and before the vertex and index buffers are created.
+     */
+    void Optimize(MeshOptimizer& optimizer);
+
+    /**
+     * Encode the vertex container in the compact format, and set the vertex
+     * format and the position quantization of the primitive to match. Create
+     * the vertex buffer from the result. Call after ComputeBounds and Optimize.
+     */
+    void EncodeCompactVertices(std::vector<VertexCompact>& vertices);
+
+    /**
+     * Append the positions and texture coordinates of the vertices as the
+     * vertex buffer holds them, that is, decoded if it is compact.
+     */
+    void AppendDecodedVertices(std::vector<VertexPositionTexture>& vertices) const;
+
+    size_t GetVertexStride() const
+    {
+        return m_VertexFormat == VertexFormat::Compact ? sizeof(VertexCompact) : sizeof(VertexPositionNormalTangentBitangentTexture);
+    }
+
+    u32 GetNumLods() const
+    {
+        return 1 + static_cast<u32>(m_Lods.size());
+    }
+
+    const std::vector<u32>& GetIndices(u32 lod) const
+    {
+        assert(lod < GetNumLods());
+        return lod == 0 ? m_IndexContainer : m_Lods[lod - 1].m_IndexContainer;
+    }
+
+    const RefPtr<IndexBuffer>& GetIndexBuffer(u32 lod) const
+    {
+        assert(lod < GetNumLods());
+        return lod == 0 ? m_IndexBuffer : m_Lods[lod - 1].m_IndexBuffer;
+    }
+
+    const std::vector<MeshCluster>& GetClusters(u32 lod) const
+    {
+        assert(lod < GetNumLods());
+        return lod == 0 ? m_Clusters : m_Lods[lod - 1].m_Clusters;
+    }
+
+    float GetLodError(u32 lod) const
+    {
+        assert(lod < GetNumLods());
+        return lod == 0 ? 0.0f : m_Lods[lod - 1].m_Error;
+    }
 };
 
 class Mesh
@@ -0,0 +1,214 @@
+#include <enginepch.h>
+#include "MeshOptimizer.h"
+
+#include <numeric>
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<u32>& indices, size_t numVertices, u32 cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+
+    CacheStatistics statistics;
+    statistics.NumTriangles = indices.size() / 3;
+
+    // A vertex is in the FIFO if fewer than cacheSize vertices were added after it.
+    std::vector<u64> cacheTimes(numVertices, 0);
+    std::vector<u8> used(numVertices, 0);
+    u64 timestamp = cacheSize + 1;
+    for (u32 index : indices)
+    {
+        if (timestamp - cacheTimes[index] > cacheSize)
+        {
+            cacheTimes[index] = timestamp++;
+            ++statistics.NumTransformed;
+        }
+
+        statistics.NumVertices += used[index] == 0;
+        used[index] = 1;
+    }
+
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(u32* indices, size_t numIndices, u32 cacheSize)
+{
+    assert(numIndices % 3 == 0);
+
+    const u32 numTriangles = static_cast<u32>(numIndices / 3);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Work on the vertices the range uses only, so a small range of a large mesh is cheap.
+    m_GlobalVertices.clear();
+    m_LocalIndices.resize(numIndices);
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        u32 index = indices[i];
+        if (index >= m_LocalVertices.size())
+        {
+            m_LocalVertices.resize(static_cast<size_t>(index) + 1, ~0u);
+        }
+        if (m_LocalVertices[index] == ~0u)
+        {
+            m_LocalVertices[index] = static_cast<u32>(m_GlobalVertices.size());
+            m_GlobalVertices.push_back(index);
+        }
+        m_LocalIndices[i] = m_LocalVertices[index];
+    }
+    for (u32 index : m_GlobalVertices)
+    {
+        m_LocalVertices[index] = ~0u;
+    }
+
+    const u32 numVertices = static_cast<u32>(m_GlobalVertices.size());
+
+    m_LiveTriangles.assign(numVertices, 0);
+    for (u32 index : m_LocalIndices)
+    {
+        ++m_LiveTriangles[index];
+    }
+
+    m_AdjacencyOffsets.resize(numVertices + 1);
+    m_AdjacencyOffsets[0] = 0;
+    std::inclusive_scan(m_LiveTriangles.begin(), m_LiveTriangles.end(), m_AdjacencyOffsets.begin() + 1);
+
+    m_AdjacentTriangles.resize(numIndices);
+    {
+        std::vector<u32> fill(m_AdjacencyOffsets.begin(), m_AdjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            m_AdjacentTriangles[fill[m_LocalIndices[i]]++] = static_cast<u32>(i / 3);
+        }
+    }
+
+    m_CacheTimes.assign(numVertices, 0);
+    m_Emitted.assign(numTriangles, 0);
+    m_DeadEnds.clear();
+    m_NextVertex = 0;
+
+    std::vector<u32> result;
+    result.reserve(numIndices);
+
+    u32 timestamp = cacheSize + 1;
+    u32 fanVertex = 0;
+    while (fanVertex != ~0u)
+    {
+        // Emit every remaining triangle around the fan vertex.
+        m_Candidates.clear();
+        for (u32 i = m_AdjacencyOffsets[fanVertex]; i < m_AdjacencyOffsets[fanVertex + 1]; ++i)
+        {
+            u32 triangle = m_AdjacentTriangles[i];
+            if (m_Emitted[triangle])
+            {
+                continue;
+            }
+
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                u32 vertex = m_LocalIndices[triangle * 3 + corner];
+                result.push_back(vertex);
+                m_DeadEnds.push_back(vertex);
+                m_Candidates.push_back(vertex);
+                --m_LiveTriangles[vertex];
+
+                if (timestamp - m_CacheTimes[vertex] > cacheSize)
+                {
+                    m_CacheTimes[vertex] = timestamp++;
+                }
+            }
+            m_Emitted[triangle] = 1;
+        }
+
+        fanVertex = GetNextVertex(timestamp, cacheSize);
+    }
+
+    assert(result.size() == numIndices);
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        indices[i] = m_GlobalVertices[result[i]];
+    }
+}
+
+u32 MeshOptimizer::GetNextVertex(u32 timestamp, u32 cacheSize)
+{
+    // Prefer the candidate that entered the cache first, if it will still be in the cache after its remaining
+    // triangles have been emitted (every triangle adds at most two new vertices).
+    u32 best = ~0u;
+    u32 bestPriority = 0;
+    for (u32 vertex : m_Candidates)
+    {
+        if (m_LiveTriangles[vertex] == 0)
+        {
+            continue;
+        }
+
+        u32 priority = 1;
+        u32 age = timestamp - m_CacheTimes[vertex];
+        if (age + 2 * m_LiveTriangles[vertex] <= cacheSize)
+        {
+            priority = age + 1;
+        }
+
+        if (priority > bestPriority)
+        {
+            best = vertex;
+            bestPriority = priority;
+        }
+    }
+
+    return best != ~0u ? best : SkipDeadEnd();
+}
+
+u32 MeshOptimizer::SkipDeadEnd()
+{
+    // Continue with a recently used vertex that still has triangles, or else with the next vertex in index order.
+    while (!m_DeadEnds.empty())
+    {
+        u32 vertex = m_DeadEnds.back();
+        m_DeadEnds.pop_back();
+        if (m_LiveTriangles[vertex] > 0)
+        {
+            return vertex;
+        }
+    }
+
+    for (; m_NextVertex < m_LiveTriangles.size(); ++m_NextVertex)
+    {
+        if (m_LiveTriangles[m_NextVertex] > 0)
+        {
+            return m_NextVertex;
+        }
+    }
+
+    return ~0u;
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, const std::vector<std::vector<u32>*>& indexLists)
+{
+    std::vector<u32> remap(vertices.size(), ~0u);
+    u32 numVertices = 0;
+    for (std::vector<u32>* indices : indexLists)
+    {
+        for (u32& index : *indices)
+        {
+            if (remap[index] == ~0u)
+            {
+                remap[index] = numVertices++;
+            }
+            index = remap[index];
+        }
+    }
+
+    std::vector<Vertex> reordered(numVertices);
+    for (size_t vertex = 0; vertex < vertices.size(); ++vertex)
+    {
+        if (remap[vertex] != ~0u)
+        {
+            reordered[remap[vertex]] = vertices[vertex];
+        }
+    }
+    vertices = std::move(reordered);
+
+    return numVertices;
+}
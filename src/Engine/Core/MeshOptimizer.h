@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+#include <Engine/Core/VertexTypes.h>
+
+/**
+ * Reorders the triangles and vertices of indexed triangle lists so the GPU
+ * transforms and fetches fewer vertices.
+ *
+ * The triangle order is optimized for a post-transform vertex cache with
+ * Tipsify (Sander, Nehab and Barczak), which fans around one vertex at a time
+ * and picks the next vertex that will still be in the cache. The vertices are
+ * then reordered in the order the triangles first use them, so the vertex
+ * fetches walk through memory.
+ *
+ * The cache is modelled as a FIFO of CacheSize vertices, both when optimizing
+ * and in AnalyzeVertexCache.
+ */
+class MeshOptimizer
+{
+public:
+    using Vertex = VertexPositionNormalTangentBitangentTexture;
+
+    static constexpr u32 CacheSize = 16;
+
+    struct CacheStatistics
+    {
+        u64 NumTriangles = 0;
+        // The number of different vertices the triangles use.
+        u64 NumVertices = 0;
+        // The number of vertices transformed, that is, missed in the cache.
+        u64 NumTransformed = 0;
+
+        // The average cache miss ratio: vertices transformed per triangle (0.5 at best for large meshes, 3 at worst).
+        float GetAcmr() const
+        {
+            return NumTriangles == 0 ? 0.0f : static_cast<float>(NumTransformed) / NumTriangles;
+        }
+
+        // The average transform to vertex ratio: how many times every vertex is transformed (1 at best).
+        float GetAtvr() const
+        {
+            return NumVertices == 0 ? 0.0f : static_cast<float>(NumTransformed) / NumVertices;
+        }
+
+        CacheStatistics& operator+=(const CacheStatistics& other)
+        {
+            NumTriangles += other.NumTriangles;
+            NumVertices += other.NumVertices;
+            NumTransformed += other.NumTransformed;
+            return *this;
+        }
+    };
+
+    /**
+     * Simulate drawing a triangle list with a FIFO post-transform cache.
+     */
+    static CacheStatistics AnalyzeVertexCache(const std::vector<u32>& indices, size_t numVertices, u32 cacheSize = CacheSize);
+
+    /**
+     * Reorder the triangles of a triangle list (or a range of one) for the
+     * post-transform vertex cache. The winding of the triangles is kept.
+     */
+    void OptimizeVertexCache(u32* indices, size_t numIndices, u32 cacheSize = CacheSize);
+
+    /**
+     * Reorder the vertices in the order the index lists first use them, and
+     * update the index lists. Vertices that no list uses are removed.
+     *
+     * @returns The number of vertices left.
+     */
+    size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, const std::vector<std::vector<u32>*>& indexLists);
+
+private:
+    // The next vertex to fan around, or ~0u if every triangle has been emitted.
+    u32 GetNextVertex(u32 timestamp, u32 cacheSize);
+    u32 SkipDeadEnd();
+
+    // Maps the indices of a range to local vertices 0, 1, ... (~0u for vertices the range does not use).
+    std::vector<u32> m_LocalVertices;
+    std::vector<u32> m_GlobalVertices;
+    std::vector<u32> m_LocalIndices;
+
+    // The triangles around every local vertex (offsets into m_AdjacentTriangles), and how many are left to emit.
+    std::vector<u32> m_AdjacencyOffsets;
+    std::vector<u32> m_AdjacentTriangles;
+    std::vector<u32> m_LiveTriangles;
+
+    // The time every vertex entered the cache, the vertices of the emitted triangles that may have triangles
+    // left (a stack), and the vertices of the triangles of the last fan.
+    std::vector<u32> m_CacheTimes;
+    std::vector<u32> m_DeadEnds;
+    std::vector<u32> m_Candidates;
+    std::vector<u8> m_Emitted;
+    // The next vertex to try when the dead end stack is empty.
+    u32 m_NextVertex = 0;
+};
@@ -0,0 +1,552 @@
+#include <enginepch.h>
+#include "MeshSimplifier.h"
+
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
+
+using namespace DirectX;
+
+namespace
+{
+// Border and seam edges are held in place by planes through the edge, perpendicular to the triangle.
+constexpr float BorderWeight = 10.0f;
+// A collapse is rejected if it turns the normal of a remaining triangle by more than about 75 degrees.
+constexpr float MaxFlipCosine = 0.25f;
+
+XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+u64 EdgeKey(u32 a, u32 b)
+{
+    return (static_cast<u64>(a) << 32) | b;
+}
+}
+
+void MeshSimplifier::Quadric::AddPlane(const XMFLOAT3& normal, float distance, float weight)
+{
+    A00 += weight * normal.x * normal.x;
+    A11 += weight * normal.y * normal.y;
+    A22 += weight * normal.z * normal.z;
+    A10 += weight * normal.y * normal.x;
+    A20 += weight * normal.z * normal.x;
+    A21 += weight * normal.z * normal.y;
+    B0 += weight * normal.x * distance;
+    B1 += weight * normal.y * distance;
+    B2 += weight * normal.z * distance;
+    C += weight * distance * distance;
+    Weight += weight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+    A00 += other.A00;
+    A11 += other.A11;
+    A22 += other.A22;
+    A10 += other.A10;
+    A20 += other.A20;
+    A21 += other.A21;
+    B0 += other.B0;
+    B1 += other.B1;
+    B2 += other.B2;
+    C += other.C;
+    Weight += other.Weight;
+}
+
+float MeshSimplifier::Quadric::Evaluate(const XMFLOAT3& p) const
+{
+    float rx = A00 * p.x + A10 * p.y + A20 * p.z;
+    float ry = A10 * p.x + A11 * p.y + A21 * p.z;
+    float rz = A20 * p.x + A21 * p.y + A22 * p.z;
+
+    float error = rx * p.x + ry * p.y + rz * p.z + 2.0f * (B0 * p.x + B1 * p.y + B2 * p.z) + C;
+
+    // Rounding can make the (non-negative) error slightly negative.
+    return std::abs(error);
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<u32>& indices, size_t targetIndexCount,
+    float maxError, std::vector<u32>& result)
+{
+    assert(indices.size() % 3 == 0);
+
+    result = indices;
+
+    const u32 numVertices = static_cast<u32>(vertices.size());
+    if (result.size() <= targetIndexCount || numVertices == 0)
+    {
+        return 0.0f;
+    }
+
+    // Work in the unit cube, so the errors do not depend on the size of the mesh.
+    XMFLOAT3 minimum = vertices[0].Position;
+    XMFLOAT3 maximum = vertices[0].Position;
+    for (const Vertex& vertex : vertices)
+    {
+        minimum = { std::min(minimum.x, vertex.Position.x), std::min(minimum.y, vertex.Position.y), std::min(minimum.z, vertex.Position.z) };
+        maximum = { std::max(maximum.x, vertex.Position.x), std::max(maximum.y, vertex.Position.y), std::max(maximum.z, vertex.Position.z) };
+    }
+
+    const float scale = std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+    if (scale <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    m_Vertices = &vertices;
+    m_Positions.resize(numVertices);
+    for (u32 i = 0; i < numVertices; ++i)
+    {
+        XMFLOAT3 position = Subtract(vertices[i].Position, minimum);
+        m_Positions[i] = { position.x / scale, position.y / scale, position.z / scale };
+    }
+
+    // Find the vertices that share a position: sort them by position and link the runs of equal positions.
+    m_PositionRemap.resize(numVertices);
+    m_Wedges.resize(numVertices);
+    std::iota(m_PositionRemap.begin(), m_PositionRemap.end(), 0);
+    std::sort(m_PositionRemap.begin(), m_PositionRemap.end(), [&vertices](u32 a, u32 b)
+    {
+        return std::memcmp(&vertices[a].Position, &vertices[b].Position, sizeof(XMFLOAT3)) < 0;
+    });
+
+    for (u32 begin = 0; begin < numVertices;)
+    {
+        const u32 first = m_PositionRemap[begin];
+        u32 end = begin + 1;
+        while (end < numVertices && std::memcmp(&vertices[m_PositionRemap[end]].Position, &vertices[first].Position, sizeof(XMFLOAT3)) == 0)
+        {
+            ++end;
+        }
+
+        for (u32 i = begin; i < end; ++i)
+        {
+            m_Wedges[m_PositionRemap[i]] = m_PositionRemap[i + 1 < end ? i + 1 : begin];
+        }
+        begin = end;
+    }
+
+    // The sort is no longer needed, turn it into the remap to the first vertex at each position.
+    for (u32 i = 0; i < numVertices; ++i)
+    {
+        m_PositionRemap[i] = i;
+    }
+    for (u32 i = 0; i < numVertices; ++i)
+    {
+        for (u32 wedge = m_Wedges[i]; wedge != i; wedge = m_Wedges[wedge])
+        {
+            m_PositionRemap[i] = std::min(m_PositionRemap[i], wedge);
+        }
+    }
+
+    ClassifyVertices(result);
+    ComputeQuadrics(result);
+
+    m_CollapseRemap.resize(numVertices);
+    std::iota(m_CollapseRemap.begin(), m_CollapseRemap.end(), 0);
+
+    const float maxCost = (maxError / scale) * (maxError / scale);
+    float resultCost = 0.0f;
+
+    std::vector<u32> bestTargets;
+    std::vector<float> bestCosts;
+
+    // Every pass collapses the cheapest edges whose vertices are not touched by a cheaper collapse in the
+    // same pass, then removes the degenerate triangles.
+    while (result.size() > targetIndexCount)
+    {
+        BuildAdjacency(result);
+
+        bestTargets.assign(numVertices, ~0u);
+        bestCosts.assign(numVertices, FLT_MAX);
+        auto consider = [&](u32 vertex, u32 target)
+        {
+            if (!CanCollapse(vertex, target))
+            {
+                return;
+            }
+
+            float cost = GetCollapseCost(vertex, target);
+            if (cost < bestCosts[vertex])
+            {
+                bestCosts[vertex] = cost;
+                bestTargets[vertex] = target;
+            }
+        };
+
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (u32 e = 0; e < 3; ++e)
+            {
+                u32 a = result[i + e];
+                u32 b = result[i + (e + 1) % 3];
+                consider(a, b);
+                consider(b, a);
+            }
+        }
+
+        m_Collapses.clear();
+        for (u32 vertex = 0; vertex < numVertices; ++vertex)
+        {
+            if (bestTargets[vertex] != ~0u && bestCosts[vertex] <= maxCost)
+            {
+                m_Collapses.push_back({ vertex, bestTargets[vertex], bestCosts[vertex] });
+            }
+        }
+
+        std::sort(m_Collapses.begin(), m_Collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+        m_CollapseLocked.assign(numVertices, 0);
+        size_t numTriangles = result.size() / 3;
+        const size_t targetTriangles = targetIndexCount / 3;
+        u32 numCollapses = 0;
+
+        for (const Collapse& collapse : m_Collapses)
+        {
+            if (numTriangles <= targetTriangles)
+            {
+                break;
+            }
+
+            const u32 vertex = collapse.Vertex;
+            const u32 target = collapse.Target;
+            const bool seam = m_Kinds[vertex] == VertexKind::Seam;
+            const u32 wedge = seam ? m_Wedges[vertex] : vertex;
+            const u32 wedgeTarget = seam ? GetWedgeTarget(vertex, target) : target;
+
+            if (m_CollapseLocked[vertex] || m_CollapseLocked[target] || m_CollapseLocked[wedge] || m_CollapseLocked[wedgeTarget])
+            {
+                continue;
+            }
+
+            if (HasTriangleFlips(result, vertex, target) || (seam && HasTriangleFlips(result, wedge, wedgeTarget)))
+            {
+                continue;
+            }
+
+            // Count the triangles that become degenerate.
+            for (u32 side = 0; side < (seam ? 2u : 1u); ++side)
+            {
+                const u32 from = side == 0 ? vertex : wedge;
+                const u32 to = side == 0 ? target : wedgeTarget;
+                for (u32 j = m_AdjacencyOffsets[from]; j < m_AdjacencyOffsets[from + 1]; ++j)
+                {
+                    const u32* triangle = &result[m_AdjacentTriangles[j] * 3];
+                    if (m_CollapseRemap[triangle[0]] == to || m_CollapseRemap[triangle[1]] == to || m_CollapseRemap[triangle[2]] == to)
+                    {
+                        --numTriangles;
+                    }
+                }
+
+                m_CollapseRemap[from] = to;
+                m_Quadrics[to].Add(m_Quadrics[from]);
+                m_CollapseLocked[from] = 1;
+                m_CollapseLocked[to] = 1;
+
+                // The border (or seam) continues from the neighbour of the removed vertex to the target.
+                if (m_Kinds[from] != VertexKind::Manifold)
+                {
+                    if (to == m_OpenOut[from])
+                    {
+                        m_OpenIn[to] = m_OpenIn[from];
+                        m_OpenOut[m_OpenIn[from]] = to;
+                    }
+                    else if (to == m_OpenIn[from])
+                    {
+                        m_OpenOut[to] = m_OpenOut[from];
+                        m_OpenIn[m_OpenOut[from]] = to;
+                    }
+                }
+            }
+
+            resultCost = std::max(resultCost, collapse.Cost);
+            ++numCollapses;
+        }
+
+        if (numCollapses == 0)
+        {
+            break;
+        }
+
+        size_t numIndices = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            u32 a = m_CollapseRemap[result[i + 0]];
+            u32 b = m_CollapseRemap[result[i + 1]];
+            u32 c = m_CollapseRemap[result[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                result[numIndices++] = a;
+                result[numIndices++] = b;
+                result[numIndices++] = c;
+            }
+        }
+        result.resize(numIndices);
+    }
+
+    m_Vertices = nullptr;
+
+    return std::sqrt(resultCost) * scale;
+}
+
+void MeshSimplifier::ClassifyVertices(const std::vector<u32>& indices)
+{
+    const u32 numVertices = static_cast<u32>(m_Positions.size());
+
+    std::unordered_set<u64> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (u32 e = 0; e < 3; ++e)
+        {
+            edges.insert(EdgeKey(indices[i + e], indices[i + (e + 1) % 3]));
+        }
+    }
+
+    // An edge is open if no triangle uses it in the other direction. A vertex with more than one
+    // open edge in the same direction points the edge at itself, which marks it as locked.
+    m_OpenOut.assign(numVertices, ~0u);
+    m_OpenIn.assign(numVertices, ~0u);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (u32 e = 0; e < 3; ++e)
+        {
+            u32 a = indices[i + e];
+            u32 b = indices[i + (e + 1) % 3];
+            if (edges.count(EdgeKey(b, a)) == 0)
+            {
+                m_OpenOut[a] = m_OpenOut[a] == ~0u ? b : a;
+                m_OpenIn[b] = m_OpenIn[b] == ~0u ? a : b;
+            }
+        }
+    }
+
+    auto hasSingleOpenEdges = [this](u32 vertex)
+    {
+        return m_OpenOut[vertex] != ~0u && m_OpenOut[vertex] != vertex && m_OpenIn[vertex] != ~0u && m_OpenIn[vertex] != vertex;
+    };
+
+    m_Kinds.resize(numVertices);
+    for (u32 vertex = 0; vertex < numVertices; ++vertex)
+    {
+        const u32 wedge = m_Wedges[vertex];
+        const bool open = m_OpenOut[vertex] != ~0u || m_OpenIn[vertex] != ~0u;
+
+        if (!open)
+        {
+            m_Kinds[vertex] = VertexKind::Manifold;
+        }
+        else if (wedge == vertex)
+        {
+            m_Kinds[vertex] = hasSingleOpenEdges(vertex) ? VertexKind::Border : VertexKind::Locked;
+        }
+        else if (m_Wedges[wedge] == vertex && hasSingleOpenEdges(vertex) && hasSingleOpenEdges(wedge) &&
+            m_PositionRemap[m_OpenOut[vertex]] == m_PositionRemap[m_OpenIn[wedge]] &&
+            m_PositionRemap[m_OpenIn[vertex]] == m_PositionRemap[m_OpenOut[wedge]])
+        {
+            // The two sides of the seam run along the same positions in opposite directions.
+            m_Kinds[vertex] = VertexKind::Seam;
+        }
+        else
+        {
+            m_Kinds[vertex] = VertexKind::Locked;
+        }
+    }
+}
+
+void MeshSimplifier::ComputeQuadrics(const std::vector<u32>& indices)
+{
+    m_Quadrics.assign(m_Positions.size(), Quadric{});
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const u32 corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+        const XMFLOAT3& p0 = m_Positions[corners[0]];
+
+        XMFLOAT3 normal = Cross(Subtract(m_Positions[corners[1]], p0), Subtract(m_Positions[corners[2]], p0));
+        float length = std::sqrt(Dot(normal, normal));
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal = { normal.x / length, normal.y / length, normal.z / length };
+
+        // Weighted by the area of the triangle.
+        const float distance = -Dot(normal, p0);
+        for (u32 corner : corners)
+        {
+            m_Quadrics[corner].AddPlane(normal, distance, length * 0.5f);
+        }
+
+        for (u32 e = 0; e < 3; ++e)
+        {
+            const u32 a = corners[e];
+            const u32 b = corners[(e + 1) % 3];
+            if (m_OpenOut[a] != b)
+            {
+                continue;
+            }
+
+            XMFLOAT3 edge = Subtract(m_Positions[b], m_Positions[a]);
+            XMFLOAT3 edgeNormal = Cross(edge, normal);
+            float edgeLength = std::sqrt(Dot(edgeNormal, edgeNormal));
+            if (edgeLength == 0.0f)
+            {
+                continue;
+            }
+            edgeNormal = { edgeNormal.x / edgeLength, edgeNormal.y / edgeLength, edgeNormal.z / edgeLength };
+
+            const float edgeDistance = -Dot(edgeNormal, m_Positions[a]);
+            const float weight = Dot(edge, edge) * BorderWeight;
+            m_Quadrics[a].AddPlane(edgeNormal, edgeDistance, weight);
+            m_Quadrics[b].AddPlane(edgeNormal, edgeDistance, weight);
+        }
+    }
+}
+
+void MeshSimplifier::BuildAdjacency(const std::vector<u32>& indices)
+{
+    const u32 numVertices = static_cast<u32>(m_Positions.size());
+
+    m_AdjacencyOffsets.assign(numVertices + 1, 0);
+    for (u32 index : indices)
+    {
+        ++m_AdjacencyOffsets[index + 1];
+    }
+    for (u32 i = 0; i < numVertices; ++i)
+    {
+        m_AdjacencyOffsets[i + 1] += m_AdjacencyOffsets[i];
+    }
+
+    m_AdjacentTriangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        m_AdjacentTriangles[m_AdjacencyOffsets[indices[i]]++] = static_cast<u32>(i / 3);
+    }
+
+    // The fill advanced every offset to the start of the next vertex.
+    for (u32 i = numVertices; i > 0; --i)
+    {
+        m_AdjacencyOffsets[i] = m_AdjacencyOffsets[i - 1];
+    }
+    m_AdjacencyOffsets[0] = 0;
+}
+
+u32 MeshSimplifier::GetWedgeTarget(u32 vertex, u32 target) const
+{
+    const u32 wedge = m_Wedges[vertex];
+
+    u32 wedgeTarget = ~0u;
+    if (target == m_OpenOut[vertex])
+    {
+        wedgeTarget = m_OpenIn[wedge];
+    }
+    else if (target == m_OpenIn[vertex])
+    {
+        wedgeTarget = m_OpenOut[wedge];
+    }
+
+    if (wedgeTarget == ~0u || wedgeTarget == wedge || m_PositionRemap[wedgeTarget] != m_PositionRemap[target])
+    {
+        return ~0u;
+    }
+
+    return wedgeTarget;
+}
+
+bool MeshSimplifier::CanCollapse(u32 vertex, u32 target) const
+{
+    if (m_PositionRemap[vertex] == m_PositionRemap[target])
+    {
+        return false;
+    }
+
+    switch (m_Kinds[vertex])
+    {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        return target == m_OpenOut[vertex] || target == m_OpenIn[vertex];
+    case VertexKind::Seam:
+        return GetWedgeTarget(vertex, target) != ~0u;
+    default:
+        return false;
+    }
+}
+
+float MeshSimplifier::GetCollapseCost(u32 vertex, u32 target) const
+{
+    auto attributeCost = [this](u32 from, u32 to)
+    {
+        const Vertex& a = (*m_Vertices)[from];
+        const Vertex& b = (*m_Vertices)[to];
+
+        XMFLOAT3 normal = Subtract(a.Normal, b.Normal);
+        float u = a.TexCoord.x - b.TexCoord.x;
+        float v = a.TexCoord.y - b.TexCoord.y;
+
+        // The attribute change, scaled by the distance over which it happens.
+        XMFLOAT3 edge = Subtract(m_Positions[from], m_Positions[to]);
+        return (m_NormalWeight * m_NormalWeight * Dot(normal, normal) + m_TexCoordWeight * m_TexCoordWeight * (u * u + v * v)) * Dot(edge, edge);
+    };
+
+    float error = m_Quadrics[vertex].Evaluate(m_Positions[target]);
+    float weight = m_Quadrics[vertex].Weight;
+    float cost = attributeCost(vertex, target);
+
+    if (m_Kinds[vertex] == VertexKind::Seam)
+    {
+        const u32 wedge = m_Wedges[vertex];
+        const u32 wedgeTarget = GetWedgeTarget(vertex, target);
+
+        error += m_Quadrics[wedge].Evaluate(m_Positions[wedgeTarget]);
+        weight += m_Quadrics[wedge].Weight;
+        cost = std::max(cost, attributeCost(wedge, wedgeTarget));
+    }
+
+    return (weight > 0.0f ? error / weight : 0.0f) + cost;
+}
+
+bool MeshSimplifier::HasTriangleFlips(const std::vector<u32>& indices, u32 vertex, u32 target) const
+{
+    const XMFLOAT3& targetPosition = m_Positions[target];
+
+    for (u32 j = m_AdjacencyOffsets[vertex]; j < m_AdjacencyOffsets[vertex + 1]; ++j)
+    {
+        const u32* triangle = &indices[m_AdjacentTriangles[j] * 3];
+        const u32 corners[3] = { m_CollapseRemap[triangle[0]], m_CollapseRemap[triangle[1]], m_CollapseRemap[triangle[2]] };
+
+        // The triangles on the collapsed edge are removed.
+        if (corners[0] == target || corners[1] == target || corners[2] == target)
+        {
+            continue;
+        }
+
+        // Rotate the triangle so the vertex is the first corner.
+        const u32 k = corners[0] == vertex ? 0 : corners[1] == vertex ? 1 : 2;
+        const XMFLOAT3& b = m_Positions[corners[(k + 1) % 3]];
+        const XMFLOAT3& c = m_Positions[corners[(k + 2) % 3]];
+
+        XMFLOAT3 before = Cross(Subtract(b, m_Positions[vertex]), Subtract(c, m_Positions[vertex]));
+        XMFLOAT3 after = Cross(Subtract(b, targetPosition), Subtract(c, targetPosition));
+
+        if (Dot(before, after) < MaxFlipCosine * std::sqrt(Dot(before, before) * Dot(after, after)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
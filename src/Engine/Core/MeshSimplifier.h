@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+
+#include <Engine/Core/VertexTypes.h>
+
+/**
+ * Reduces the triangles of an indexed triangle list by edge collapses, ordered
+ * by a quadric error metric (Garland and Heckbert). The simplified triangles
+ * reference the original vertices (a vertex is collapsed onto a neighbour), so
+ * levels of detail can share the vertex buffer of the mesh.
+ *
+ * Attributes are preserved in two ways. Vertices that share a position but not
+ * their attributes (UV or normal seams) are collapsed together, only along the
+ * seam, so the seam does not tear. And the cost of a collapse includes how much
+ * the normal and texture coordinates of the removed vertex change.
+ *
+ * Open borders are kept in place by collapsing border vertices only along the
+ * border, and non-manifold vertices are never collapsed.
+ */
+class MeshSimplifier
+{
+public:
+    using Vertex = VertexPositionNormalTangentBitangentTexture;
+
+    /**
+     * Simplify a triangle list until it has targetIndexCount indices or fewer,
+     * or until a collapse would cause more than maxError.
+     *
+     * @param maxError The largest error, in the units of the vertex positions.
+     * @param [out] result The indices of the simplified triangles.
+     * @returns The error of the simplified mesh: roughly the largest distance of
+     *          the simplified surface from the original, in the units of the positions.
+     */
+    float Simplify(const std::vector<Vertex>& vertices, const std::vector<u32>& indices, size_t targetIndexCount,
+        float maxError, std::vector<u32>& result);
+
+    /**
+     * Set how much a change of the normal or the texture coordinates costs,
+     * relative to moving the vertex by the length of the collapsed edge.
+     */
+    void SetAttributeWeights(float normalWeight, float texCoordWeight)
+    {
+        m_NormalWeight = normalWeight;
+        m_TexCoordWeight = texCoordWeight;
+    }
+
+private:
+    struct Quadric
+    {
+        // The symmetric matrix A, the vector b and the constant c of p'Ap + 2b'p + c.
+        float A00, A11, A22, A10, A20, A21;
+        float B0, B1, B2;
+        float C;
+        // The sum of the weights of the planes, to average the squared distances.
+        float Weight;
+
+        // Add the squared distance to the plane dot(normal, p) + distance = 0.
+        void AddPlane(const DirectX::XMFLOAT3& normal, float distance, float weight);
+        void Add(const Quadric& other);
+        // The weighted sum of the squared distances of p to the planes.
+        float Evaluate(const DirectX::XMFLOAT3& p) const;
+    };
+
+    enum class VertexKind : u8
+    {
+        Manifold,
+        // On an open border (exactly one outgoing and one incoming border edge).
+        Border,
+        // On a seam between exactly two vertices with the same position.
+        Seam,
+        Locked,
+    };
+
+    struct Collapse
+    {
+        u32 Vertex;
+        u32 Target;
+        float Cost;
+    };
+
+    void ClassifyVertices(const std::vector<u32>& indices);
+    void ComputeQuadrics(const std::vector<u32>& indices);
+    void BuildAdjacency(const std::vector<u32>& indices);
+
+    // The target of a seam vertex's wedge when the vertex collapses onto target, or ~0u if there is none.
+    u32 GetWedgeTarget(u32 vertex, u32 target) const;
+    bool CanCollapse(u32 vertex, u32 target) const;
+    float GetCollapseCost(u32 vertex, u32 target) const;
+    // Whether moving vertex onto target turns over any of the triangles around the vertex.
+    bool HasTriangleFlips(const std::vector<u32>& indices, u32 vertex, u32 target) const;
+
+    float m_NormalWeight = 0.5f;
+    float m_TexCoordWeight = 0.5f;
+
+    // The vertex positions, scaled into the unit cube, and the attributes.
+    std::vector<DirectX::XMFLOAT3> m_Positions;
+    const std::vector<Vertex>* m_Vertices = nullptr;
+
+    // The first vertex with the same position, and the next vertex with the same position (a circular list).
+    std::vector<u32> m_PositionRemap;
+    std::vector<u32> m_Wedges;
+    std::vector<VertexKind> m_Kinds;
+    // The target of the open edge that leaves a vertex and the source of the one that enters it (~0u if none).
+    std::vector<u32> m_OpenOut;
+    std::vector<u32> m_OpenIn;
+
+    std::vector<Quadric> m_Quadrics;
+
+    // The triangles around every vertex (offsets into m_AdjacentTriangles).
+    std::vector<u32> m_AdjacencyOffsets;
+    std::vector<u32> m_AdjacentTriangles;
+
+    std::vector<Collapse> m_Collapses;
+    // The vertex every vertex has been collapsed onto (itself if it is still in use).
+    std::vector<u32> m_CollapseRemap;
+    std::vector<u8> m_CollapseLocked;
+};
@@ -0,0 +1,354 @@
+#include <enginepch.h>
+#include "MeshletBuilder.h"
+
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+// Meshlets whose normals spread by more than about 84 degrees from the axis get no cone (the cone would hardly ever cull).
+constexpr float MinConeCosine = 0.1f;
+
+XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+XMFLOAT3 Normalize(const XMFLOAT3& v)
+{
+    float length = std::sqrt(Dot(v, v));
+    return length > 0.0f ? XMFLOAT3{ v.x / length, v.y / length, v.z / length } : XMFLOAT3{ 0.0f, 0.0f, 0.0f };
+}
+
+// Spread the lowest 10 bits of x to every third bit.
+u32 SpreadBits(u32 x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+}
+
+u32 MeshletBuilder::Build(const std::vector<Vertex>& vertices, const std::vector<u32>& indices)
+{
+    assert(indices.size() % 3 == 0);
+
+    m_Meshlets.clear();
+    m_Bounds.clear();
+    m_Vertices.clear();
+    m_Triangles.clear();
+
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return 0;
+    }
+
+    BuildAdjacency(indices, vertices.size());
+    SortTriangles(vertices, indices);
+
+    m_Emitted.assign(numTriangles, 0);
+    m_LocalIndices.assign(vertices.size(), 0xff);
+
+    Meshlet meshlet = { 0, 0, 0, 0 };
+    m_CenterSum = { 0.0f, 0.0f, 0.0f };
+    m_NormalSum = { 0.0f, 0.0f, 0.0f };
+
+    // The first triangle in Morton order that may not be in a meshlet yet.
+    size_t next = 0;
+    while (true)
+    {
+        if (meshlet.TriangleCount == MaxTriangles)
+        {
+            FinishMeshlet(vertices, meshlet);
+        }
+
+        u32 triangle = meshlet.TriangleCount > 0 ? FindNeighbourTriangle(indices, meshlet) : ~0u;
+        if (triangle == ~0u)
+        {
+            // Nothing touches the meshlet, so continue with the nearby triangles in Morton order. The meshlet
+            // is finished first if the triangle does not fit.
+            while (next < numTriangles && m_Emitted[m_SortedTriangles[next]])
+            {
+                ++next;
+            }
+            if (next == numTriangles)
+            {
+                break;
+            }
+            triangle = m_SortedTriangles[next];
+
+            u32 newVertices = 0;
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                newVertices += m_LocalIndices[indices[triangle * 3 + corner]] == 0xff;
+            }
+            if (meshlet.VertexCount + newVertices > MaxVertices)
+            {
+                FinishMeshlet(vertices, meshlet);
+            }
+        }
+
+        AddTriangle(indices, triangle, meshlet);
+    }
+
+    if (meshlet.TriangleCount > 0)
+    {
+        FinishMeshlet(vertices, meshlet);
+    }
+
+    return static_cast<u32>(m_Meshlets.size());
+}
+
+void MeshletBuilder::GetIndices(std::vector<u32>& indices) const
+{
+    indices.resize(m_Triangles.size());
+    for (const Meshlet& meshlet : m_Meshlets)
+    {
+        for (u32 i = meshlet.TriangleOffset * 3; i < (meshlet.TriangleOffset + meshlet.TriangleCount) * 3; ++i)
+        {
+            indices[i] = m_Vertices[meshlet.VertexOffset + m_Triangles[i]];
+        }
+    }
+}
+
+void MeshletBuilder::BuildAdjacency(const std::vector<u32>& indices, size_t numVertices)
+{
+    m_LiveTriangles.assign(numVertices, 0);
+    for (u32 index : indices)
+    {
+        ++m_LiveTriangles[index];
+    }
+
+    m_AdjacencyOffsets.resize(numVertices + 1);
+    m_AdjacencyOffsets[0] = 0;
+    std::inclusive_scan(m_LiveTriangles.begin(), m_LiveTriangles.end(), m_AdjacencyOffsets.begin() + 1);
+
+    m_AdjacentTriangles.resize(indices.size());
+    std::vector<u32> fill(m_AdjacencyOffsets.begin(), m_AdjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        m_AdjacentTriangles[fill[indices[i]]++] = static_cast<u32>(i / 3);
+    }
+}
+
+void MeshletBuilder::SortTriangles(const std::vector<Vertex>& vertices, const std::vector<u32>& indices)
+{
+    const size_t numTriangles = indices.size() / 3;
+
+    m_Centers.resize(numTriangles);
+    m_Normals.resize(numTriangles);
+
+    XMFLOAT3 minimum = { FLT_MAX, FLT_MAX, FLT_MAX };
+    XMFLOAT3 maximum = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+    {
+        const XMFLOAT3& a = vertices[indices[triangle * 3 + 0]].Position;
+        const XMFLOAT3& b = vertices[indices[triangle * 3 + 1]].Position;
+        const XMFLOAT3& c = vertices[indices[triangle * 3 + 2]].Position;
+
+        XMFLOAT3& center = m_Centers[triangle];
+        center = { (a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f };
+        m_Normals[triangle] = Normalize(Cross(Subtract(b, a), Subtract(c, a)));
+
+        minimum = { std::min(minimum.x, center.x), std::min(minimum.y, center.y), std::min(minimum.z, center.z) };
+        maximum = { std::max(maximum.x, center.x), std::max(maximum.y, center.y), std::max(maximum.z, center.z) };
+    }
+
+    // Quantize the centers to 10 bits in the largest dimension of their bounds.
+    float extent = std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+    float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+
+    std::vector<u32> keys(numTriangles);
+    for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+    {
+        const XMFLOAT3& center = m_Centers[triangle];
+        keys[triangle] = SpreadBits(static_cast<u32>((center.x - minimum.x) * scale + 0.5f)) |
+            (SpreadBits(static_cast<u32>((center.y - minimum.y) * scale + 0.5f)) << 1) |
+            (SpreadBits(static_cast<u32>((center.z - minimum.z) * scale + 0.5f)) << 2);
+    }
+
+    m_SortedTriangles.resize(numTriangles);
+    std::iota(m_SortedTriangles.begin(), m_SortedTriangles.end(), 0);
+    std::stable_sort(m_SortedTriangles.begin(), m_SortedTriangles.end(), [&keys](u32 a, u32 b) { return keys[a] < keys[b]; });
+}
+
+u32 MeshletBuilder::FindNeighbourTriangle(const std::vector<u32>& indices, const Meshlet& meshlet) const
+{
+    const float inverseCount = 1.0f / meshlet.TriangleCount;
+    const XMFLOAT3 center = { m_CenterSum.x * inverseCount, m_CenterSum.y * inverseCount, m_CenterSum.z * inverseCount };
+    const XMFLOAT3 axis = Normalize(m_NormalSum);
+
+    u32 best = ~0u;
+    u32 bestNewVertices = ~0u;
+    float bestScore = FLT_MAX;
+
+    for (u32 i = 0; i < meshlet.VertexCount; ++i)
+    {
+        u32 vertex = m_Vertices[meshlet.VertexOffset + i];
+        if (m_LiveTriangles[vertex] == 0)
+        {
+            continue;
+        }
+
+        for (u32 j = m_AdjacencyOffsets[vertex]; j < m_AdjacencyOffsets[vertex + 1]; ++j)
+        {
+            u32 triangle = m_AdjacentTriangles[j];
+            if (m_Emitted[triangle])
+            {
+                continue;
+            }
+
+            u32 newVertices = 0;
+            for (u32 corner = 0; corner < 3; ++corner)
+            {
+                newVertices += m_LocalIndices[indices[triangle * 3 + corner]] == 0xff;
+            }
+            if (meshlet.VertexCount + newVertices > MaxVertices || newVertices > bestNewVertices)
+            {
+                continue;
+            }
+
+            // Triangles that face away from the meshlet count as further away.
+            XMFLOAT3 offset = Subtract(m_Centers[triangle], center);
+            float spread = 1.0f - Dot(m_Normals[triangle], axis);
+            float score = std::sqrt(Dot(offset, offset)) * (1.0f + m_ConeWeight * spread);
+
+            if (newVertices < bestNewVertices || score < bestScore)
+            {
+                best = triangle;
+                bestNewVertices = newVertices;
+                bestScore = score;
+            }
+        }
+
+        // A triangle that adds no vertices costs nothing, wherever it is.
+        if (bestNewVertices == 0)
+        {
+            break;
+        }
+    }
+
+    return best;
+}
+
+void MeshletBuilder::AddTriangle(const std::vector<u32>& indices, u32 triangle, Meshlet& meshlet)
+{
+    for (u32 corner = 0; corner < 3; ++corner)
+    {
+        u32 vertex = indices[triangle * 3 + corner];
+        u8& localIndex = m_LocalIndices[vertex];
+        if (localIndex == 0xff)
+        {
+            localIndex = static_cast<u8>(meshlet.VertexCount++);
+            m_Vertices.push_back(vertex);
+        }
+
+        m_Triangles.push_back(localIndex);
+        --m_LiveTriangles[vertex];
+    }
+
+    m_Emitted[triangle] = 1;
+    ++meshlet.TriangleCount;
+
+    const XMFLOAT3& center = m_Centers[triangle];
+    const XMFLOAT3& normal = m_Normals[triangle];
+    m_CenterSum = { m_CenterSum.x + center.x, m_CenterSum.y + center.y, m_CenterSum.z + center.z };
+    m_NormalSum = { m_NormalSum.x + normal.x, m_NormalSum.y + normal.y, m_NormalSum.z + normal.z };
+}
+
+void MeshletBuilder::FinishMeshlet(const std::vector<Vertex>& vertices, Meshlet& meshlet)
+{
+    // The sphere around the center of the bounding box of the vertices.
+    XMFLOAT3 minimum = { FLT_MAX, FLT_MAX, FLT_MAX };
+    XMFLOAT3 maximum = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (u32 i = 0; i < meshlet.VertexCount; ++i)
+    {
+        const XMFLOAT3& position = vertices[m_Vertices[meshlet.VertexOffset + i]].Position;
+        minimum = { std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z) };
+        maximum = { std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z) };
+    }
+
+    Bounds bounds;
+    bounds.Center = { (minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f };
+
+    float radiusSquared = 0.0f;
+    for (u32 i = 0; i < meshlet.VertexCount; ++i)
+    {
+        XMFLOAT3 offset = Subtract(vertices[m_Vertices[meshlet.VertexOffset + i]].Position, bounds.Center);
+        radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+    }
+    bounds.Radius = std::sqrt(radiusSquared);
+
+    // The cone axis is the average normal, and its angle is the largest angle between the axis and a normal.
+    // Degenerate triangles (with a zero normal) are never drawn, so they don't limit the cone.
+    const u32 firstIndex = meshlet.TriangleOffset * 3;
+    const u32 endIndex = (meshlet.TriangleOffset + meshlet.TriangleCount) * 3;
+
+    auto position = [&](u32 i) -> const XMFLOAT3& { return vertices[m_Vertices[meshlet.VertexOffset + m_Triangles[i]]].Position; };
+
+    XMFLOAT3 axis = Normalize(m_NormalSum);
+    float minimumCosine = 1.0f;
+    for (u32 i = firstIndex; i < endIndex; i += 3)
+    {
+        XMFLOAT3 normal = Normalize(Cross(Subtract(position(i + 1), position(i)), Subtract(position(i + 2), position(i))));
+        if (Dot(normal, normal) > 0.0f)
+        {
+            minimumCosine = std::min(minimumCosine, Dot(normal, axis));
+        }
+    }
+
+    if (Dot(axis, axis) == 0.0f || minimumCosine < MinConeCosine)
+    {
+        bounds.ConeApex = bounds.Center;
+        bounds.ConeAxis = { 0.0f, 0.0f, 0.0f };
+        bounds.ConeCutoff = 1.0f;
+    }
+    else
+    {
+        // Move the apex back along the axis until it is behind the planes of all the triangles, so every
+        // triangle faces away from a camera inside the cone behind the apex.
+        float apexDistance = 0.0f;
+        for (u32 i = firstIndex; i < endIndex; i += 3)
+        {
+            XMFLOAT3 normal = Normalize(Cross(Subtract(position(i + 1), position(i)), Subtract(position(i + 2), position(i))));
+            float alignment = Dot(normal, axis);
+            if (alignment > 0.0f)
+            {
+                apexDistance = std::max(apexDistance, Dot(Subtract(bounds.Center, position(i)), normal) / alignment);
+            }
+        }
+
+        bounds.ConeApex = { bounds.Center.x - axis.x * apexDistance, bounds.Center.y - axis.y * apexDistance,
+            bounds.Center.z - axis.z * apexDistance };
+        bounds.ConeAxis = axis;
+        // The sine of the angle: the camera has to be within 90 degrees minus the angle of the axis.
+        bounds.ConeCutoff = std::sqrt(1.0f - minimumCosine * minimumCosine);
+    }
+
+    for (u32 i = 0; i < meshlet.VertexCount; ++i)
+    {
+        m_LocalIndices[m_Vertices[meshlet.VertexOffset + i]] = 0xff;
+    }
+
+    m_Meshlets.push_back(meshlet);
+    m_Bounds.push_back(bounds);
+
+    meshlet = { static_cast<u32>(m_Vertices.size()), static_cast<u32>(m_Triangles.size() / 3), 0, 0 };
+    m_CenterSum = { 0.0f, 0.0f, 0.0f };
+    m_NormalSum = { 0.0f, 0.0f, 0.0f };
+}
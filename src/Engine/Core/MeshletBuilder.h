@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+
+#include <Engine/Core/VertexTypes.h>
+
+/**
+ * Splits an indexed triangle list into meshlets: clusters of at most
+ * MaxVertices vertices and MaxTriangles triangles that are small enough to be
+ * culled on their own, and that fit a mesh shader thread group.
+ *
+ * Triangles are added to the current meshlet greedily. The builder prefers
+ * triangles that add the fewest new vertices, then the ones nearest to the
+ * center of the meshlet that face the same way, so meshlets are compact and
+ * their bounds are tight. When no remaining triangle touches the meshlet, the
+ * next one is taken in Morton order of the triangle centers.
+ *
+ * Every meshlet gets a bounding sphere and, if its triangles face roughly the
+ * same way, a cone around their normals, to cull meshlets that only have back
+ * faces towards the camera.
+ */
+class MeshletBuilder
+{
+public:
+    using Vertex = VertexPositionNormalTangentBitangentTexture;
+
+    static constexpr u32 MaxVertices = 64;
+    static constexpr u32 MaxTriangles = 124;
+
+    struct Meshlet
+    {
+        // The first vertex in GetVertices and the first triangle in GetTriangles.
+        u32 VertexOffset;
+        u32 TriangleOffset;
+        u32 VertexCount;
+        u32 TriangleCount;
+    };
+
+    struct Bounds
+    {
+        DirectX::XMFLOAT3 Center;
+        float Radius;
+
+        // All the triangles face away from a camera at eye if dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff.
+        // The cutoff is 1 (and the axis is 0) when the triangles face too many ways to be culled together.
+        DirectX::XMFLOAT3 ConeApex;
+        DirectX::XMFLOAT3 ConeAxis;
+        float ConeCutoff;
+    };
+
+    /**
+     * Build the meshlets of a triangle list. The results replace the ones of
+     * the last Build.
+     *
+     * @returns The number of meshlets.
+     */
+    u32 Build(const std::vector<Vertex>& vertices, const std::vector<u32>& indices);
+
+    const std::vector<Meshlet>& GetMeshlets() const
+    {
+        return m_Meshlets;
+    }
+
+    const std::vector<Bounds>& GetBounds() const
+    {
+        return m_Bounds;
+    }
+
+    // The vertices of the meshlets, as indices into the vertices given to Build.
+    const std::vector<u32>& GetVertices() const
+    {
+        return m_Vertices;
+    }
+
+    // The triangles of the meshlets, as three indices into the vertices of their meshlet each.
+    const std::vector<u8>& GetTriangles() const
+    {
+        return m_Triangles;
+    }
+
+    /**
+     * Get the triangles of all meshlets as one triangle list, in the order of
+     * the meshlets. The triangles of a meshlet start at index TriangleOffset * 3.
+     */
+    void GetIndices(std::vector<u32>& indices) const;
+
+    /**
+     * Set how much the builder prefers triangles that face the same way as the
+     * meshlet. A larger weight gives narrower cones, but meshlets that are less
+     * compact.
+     */
+    void SetConeWeight(float coneWeight)
+    {
+        m_ConeWeight = coneWeight;
+    }
+
+private:
+    void BuildAdjacency(const std::vector<u32>& indices, size_t numVertices);
+    void SortTriangles(const std::vector<Vertex>& vertices, const std::vector<u32>& indices);
+
+    // The remaining triangle that fits the current meshlet best, or ~0u if none touches it.
+    u32 FindNeighbourTriangle(const std::vector<u32>& indices, const Meshlet& meshlet) const;
+    void AddTriangle(const std::vector<u32>& indices, u32 triangle, Meshlet& meshlet);
+    void FinishMeshlet(const std::vector<Vertex>& vertices, Meshlet& meshlet);
+
+    float m_ConeWeight = 0.25f;
+
+    std::vector<Meshlet> m_Meshlets;
+    std::vector<Bounds> m_Bounds;
+    std::vector<u32> m_Vertices;
+    std::vector<u8> m_Triangles;
+
+    // The triangles around every vertex (offsets into m_AdjacentTriangles), and how many of them are not in a meshlet yet.
+    std::vector<u32> m_AdjacencyOffsets;
+    std::vector<u32> m_AdjacentTriangles;
+    std::vector<u32> m_LiveTriangles;
+
+    // The centers and unit normals of the triangles, and the triangles in Morton order of their centers.
+    std::vector<DirectX::XMFLOAT3> m_Centers;
+    std::vector<DirectX::XMFLOAT3> m_Normals;
+    std::vector<u32> m_SortedTriangles;
+
+    std::vector<u8> m_Emitted;
+    // The index of every vertex in the current meshlet (0xff if it is not in it).
+    std::vector<u8> m_LocalIndices;
+
+    // The sums of the centers and normals of the triangles in the current meshlet.
+    DirectX::XMFLOAT3 m_CenterSum;
+    DirectX::XMFLOAT3 m_NormalSum;
+};
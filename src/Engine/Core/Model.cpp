@@ -4,49 +4,78 @@
 #include <Engine/Core/Mesh.h>
 #include <Engine/Asset/MeshAssetHandler.h>
 
-Model::Model(const fs::path& path, const Matrix& transform)
-	: Model(fast_string_hash(path.string().c_str()), path, transform)
+Model::Model(const fs::path& path)
+	: Model(fast_string_hash(path.string().c_str()), path)
 {}
 
-Model::Model(u64 hash, const fs::path& path, const Matrix& transform)
+Model::Model(u64 hash, const fs::path& path)
 	: m_Mesh(MeshAssetHandler::Get().GetOrLoad(hash, path))
-	, m_Transform(transform)
 {}
 
-Model::Model(u64 hash, const Matrix& transform)
+Model::Model(u64 hash)
 	: m_Mesh(MeshAssetHandler::Get().TryGet(hash))
-	, m_Transform(transform)
 {
 	if (!m_Mesh)
 	{ 
-		spdlog::critical("Model::Model(u64 hash, transform) m_Mesh was nullptr after constructing");
+		spdlog::critical("Model::Model(u64 hash) m_Mesh was nullptr after constructing");
 	}
 	assert(m_Mesh);
 }
 
+Model::Model(RefPtr<Mesh> mesh)
+	: m_Mesh(std::move(mesh))
+{}
+
+void Model::SetPosition(const Vector3& position)
+{
+	assert(m_Transforms);
+	m_Transforms->SetPosition(m_TransformHandle, position);
+}
+
+const Vector3& Model::GetPosition() const
+{
+	assert(m_Transforms);
+	return m_Transforms->GetPosition(m_TransformHandle);
+}
+
 void Model::SetScale(float scalar)
 {
-	m_Scale = Matrix::CreateScale(scalar);
+	SetScale(Vector3(scalar));
 }
 
 void Model::SetScale(const Vector3& scale)
 {
-	m_Scale = Matrix::CreateScale(scale);
+	assert(m_Transforms);
+	m_Transforms->SetScale(m_TransformHandle, scale);
 }
 
-void Model::SetScale(const Matrix& scale)
+const Vector3& Model::GetScale() const
 {
-	m_Scale = scale;
+	assert(m_Transforms);
+	return m_Transforms->GetScale(m_TransformHandle);
 }
 
 void Model::Rotate(const Quaternion& quat)
 {
-	m_Rotation = Matrix::Transform(m_Rotation, quat);
+	SetRotation(GetRotation() * quat);
 }
 
 void Model::SetRotation(const Quaternion& quat)
 {
-	m_Rotation = Matrix::Transform(m_Transform, quat);
+	assert(m_Transforms);
+	m_Transforms->SetRotation(m_TransformHandle, quat);
+}
+
+const Quaternion& Model::GetRotation() const
+{
+	assert(m_Transforms);
+	return m_Transforms->GetRotation(m_TransformHandle);
+}
+
+const Matrix& Model::GetWorldMatrix() const
+{
+	assert(m_Transforms);
+	return m_Transforms->GetWorldMatrix(m_TransformHandle);
 }
 
 void Model::SetMesh(const fs::path& path)
@@ -3,26 +3,35 @@
 #include <filesystem>
 namespace fs = std::filesystem;
 
+#include <Engine/Core/TransformStorage.h>
+
 class Mesh;
 
 class Model
 {
 public:
-	Model(const fs::path& path, const Matrix& transform = {});
-	Model(u64 hash, const fs::path& path, const Matrix& transform = {});
-	Model(u64 hash, const Matrix& transform = {});
+	Model(const fs::path& path);
+	Model(u64 hash, const fs::path& path);
+	Model(u64 hash);
+	explicit Model(RefPtr<Mesh> mesh);
 
-	const Matrix& GetTransform() const { return m_Transform; }
-	void SetTransform(const Matrix& transform) { m_Transform = transform; }
+	// The transform is stored in the scene, so these can only be used after the model was added to a scene.
+	// The position, rotation and scale are relative to the model's parent in the scene.
+	void SetPosition(const Vector3& position);
+	const Vector3& GetPosition() const;
 
 	void SetScale(float scalar);
 	void SetScale(const Vector3& scale);
-	void SetScale(const Matrix& scale);
-	const Matrix& GetScale() const { return m_Scale; }
+	const Vector3& GetScale() const;
 
 	void Rotate(const Quaternion& quat);
 	void SetRotation(const Quaternion& quat);
-	const Matrix& GetRotation() const { return m_Rotation; }
+	const Quaternion& GetRotation() const;
+
+	// The world matrix (scale * rotation * translation * parent world). Updated by Scene::Update.
+	const Matrix& GetWorldMatrix() const;
+
+	TransformHandle GetTransformHandle() const { return m_TransformHandle; }
 
 	virtual void SetMesh(const fs::path& path);
 	void TrySetMesh(u64 hash);
@@ -30,8 +39,11 @@ public:
 	RefPtr<Mesh> GetMesh() const { return m_Mesh; }
 
 private:
+	friend class Scene;
+
 	RefPtr<Mesh> m_Mesh;
-	Matrix m_Transform;
-	Matrix m_Rotation;
-	Matrix m_Scale;
-};
\ No newline at end of file
+
+	// Set by the scene that the model was added to.
+	TransformStorage* m_Transforms = nullptr;
+	TransformHandle m_TransformHandle;
+};
@@ -2,7 +2,9 @@
 
 #include <Device.h>
 #include "PanoToCubemapPSO.h"
+#include <Application.h>
 #include <Pipeline/RootSignature.h>
+#include <Pipeline/ShaderManager.h>
 
 PanoToCubemapPSO::PanoToCubemapPSO( Device& device )
 {
@@ -38,9 +40,7 @@ PanoToCubemapPSO::PanoToCubemapPSO( Device& device )
     pipelineStateStream.pRootSignature = m_RootSignature->GetD3D12RootSignature().Get();
 
     // load g_PanoToCubemap_CS from disk
-    ComPtr<ID3DBlob> computeShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"Shaders/PanoToCubemapCS.cso", &computeShaderBlob));
-    pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
+    pipelineStateStream.CS = Application::Get().GetShaderManager().Load("PanoToCubemapCS")->GetBytecode();
 
     m_PipelineState = device.CreatePipelineStateObject( pipelineStateStream );
 
@@ -8,9 +8,194 @@
 #include <Mesh.h>
 #include <Buffers/Texture.h>
 #include <VertexTypes.h>
+#include <Application.h>
+#include <JobSystem.h>
 
-RefPtr<Model> Scene::AddModel(RefPtr<Model> model)
+// When more models than 1 / FullRefitRatio moved, all boxes are recomputed in parallel instead of
+// refitting the moved items one by one.
+constexpr size_t FullRefitRatio = 8;
+// Rebuild the BVH when refitting made it this much more expensive than after the build.
+constexpr float RebuildSAHCostRatio = 1.5f;
+
+Scene::~Scene()
 {
+	// Models that outlive the scene can't refer to its transforms anymore.
+	for (auto& model : m_Models)
+	{
+		model->m_Transforms = nullptr;
+		model->m_TransformHandle = {};
+	}
+}
+
+RefPtr<Model> Scene::AddModel(RefPtr<Model> model, const Vector3& position, const Quaternion& rotation, const Vector3& scale,
+	TransformHandle parent)
+{
+	assert(!model->m_Transforms && "The model was already added to a scene.");
+
+	model->m_Transforms = &m_Transforms;
+	model->m_TransformHandle = m_Transforms.Create(position, rotation, scale, parent);
+
 	m_Models.push_back(model);
+	m_BVHDirty = true;
 	return model;
 }
+
+TransformHandle Scene::AddNode(const Vector3& position, const Quaternion& rotation, const Vector3& scale, TransformHandle parent)
+{
+	return m_Transforms.Create(position, rotation, scale, parent);
+}
+
+void Scene::Update()
+{
+	auto& jobSystem = Application::Get().GetJobSystem();
+	u32   numUpdated = m_Transforms.Update(&jobSystem);
+
+	if (m_BVHDirty)
+	{
+		RebuildBVH(jobSystem);
+	}
+	else if (numUpdated > 0)
+	{
+		RefitBVH(jobSystem);
+	}
+}
+
+void Scene::RebuildBVH(JobSystem& jobSystem)
+{
+	m_Primitives.clear();
+	m_FirstPrimitives.resize(m_Models.size());
+	m_TransformModels.clear();
+
+	for (u32 modelIndex = 0; modelIndex < m_Models.size(); ++modelIndex)
+	{
+		const auto& model = m_Models[modelIndex];
+		m_FirstPrimitives[modelIndex] = static_cast<u32>(m_Primitives.size());
+
+		u32 slot = model->GetTransformHandle().Index;
+		if (slot >= m_TransformModels.size())
+		{
+			m_TransformModels.resize(slot + 1, ~0u);
+		}
+		m_TransformModels[slot] = modelIndex;
+
+		if (auto mesh = model->GetMesh())
+		{
+			for (u32 primitiveIndex = 0; primitiveIndex < mesh->GetPrimitives().size(); ++primitiveIndex)
+			{
+				m_Primitives.push_back({ modelIndex, primitiveIndex });
+			}
+		}
+	}
+
+	m_PrimitiveBounds.resize(m_Primitives.size());
+	for (u32 i = 0; i < m_Primitives.size(); ++i)
+	{
+		const auto& model = m_Models[m_Primitives[i].m_ModelIndex];
+		const auto& primitive = model->GetMesh()->GetPrimitives()[m_Primitives[i].m_PrimitiveIndex];
+		primitive.m_BoundingBox.Transform(m_PrimitiveBounds[i], model->GetWorldMatrix());
+	}
+
+	m_BVH.Build(m_PrimitiveBounds, &jobSystem);
+	m_BuildSAHCost = m_BVH.GetSAHCost();
+	m_BVHDirty = false;
+}
+
+void Scene::RefitBVH(JobSystem& jobSystem)
+{
+	auto updateModelBounds = [this](u32 modelIndex, bool updateBVH)
+	{
+		const auto& model = m_Models[modelIndex];
+		if (!model->GetMesh())
+		{
+			return;
+		}
+
+		const auto& primitives = model->GetMesh()->GetPrimitives();
+		for (u32 primitiveIndex = 0; primitiveIndex < primitives.size(); ++primitiveIndex)
+		{
+			u32 item = m_FirstPrimitives[modelIndex] + primitiveIndex;
+			primitives[primitiveIndex].m_BoundingBox.Transform(m_PrimitiveBounds[item], model->GetWorldMatrix());
+			if (updateBVH)
+			{
+				m_BVH.UpdateItem(item, m_PrimitiveBounds[item]);
+			}
+		}
+	};
+
+	m_Transforms.GetUpdated(m_UpdatedTransforms);
+	if (m_UpdatedTransforms.size() * FullRefitRatio < m_Models.size())
+	{
+		for (const auto& handle : m_UpdatedTransforms)
+		{
+			if (handle.Index < m_TransformModels.size() && m_TransformModels[handle.Index] != ~0u)
+			{
+				updateModelBounds(m_TransformModels[handle.Index], true);
+			}
+		}
+		return;
+	}
+
+	jobSystem.ParallelFor(0, static_cast<u32>(m_Models.size()), 256, [&](u32 begin, u32 end)
+		{
+			for (u32 modelIndex = begin; modelIndex < end; ++modelIndex)
+			{
+				updateModelBounds(modelIndex, false);
+			}
+		});
+	m_BVH.Refit(m_PrimitiveBounds, &jobSystem);
+
+	if (m_BVH.GetSAHCost() > m_BuildSAHCost * RebuildSAHCostRatio)
+	{
+		m_BVH.Build(m_PrimitiveBounds, &jobSystem);
+		m_BuildSAHCost = m_BVH.GetSAHCost();
+	}
+}
+
+bool Scene::Raycast(const Vector3& origin, const Vector3& direction, PickResult& result) const
+{
+	// Test the triangles in object space, the ray is transformed instead of the vertices.
+	auto testPrimitive = [&](u32 item, float boxDistance) -> float
+	{
+		const auto& model = m_Models[m_Primitives[item].m_ModelIndex];
+		const auto& primitive = model->GetMesh()->GetPrimitives()[m_Primitives[item].m_PrimitiveIndex];
+
+		const auto& vertices = primitive.m_VertexContainer;
+		const auto& indices = primitive.m_IndexContainer;
+		if (vertices.empty() || indices.empty())
+		{
+			return boxDistance;
+		}
+
+		XMMATRIX inverseWorld = XMMatrixInverse(nullptr, model->GetWorldMatrix());
+		XMVECTOR objectOrigin = XMVector3TransformCoord(origin, inverseWorld);
+		XMVECTOR objectDirection = XMVector3TransformNormal(direction, inverseWorld);
+
+		// The object space distance is scaled by the length of the transformed direction.
+		float scale = XMVectorGetX(XMVector3Length(objectDirection));
+		objectDirection = XMVectorScale(objectDirection, 1.0f / scale);
+
+		float closest = FLT_MAX;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			float distance;
+			if (TriangleTests::Intersects(objectOrigin, objectDirection, XMLoadFloat3(&vertices[indices[i]].Position),
+				XMLoadFloat3(&vertices[indices[i + 1]].Position), XMLoadFloat3(&vertices[indices[i + 2]].Position), distance))
+			{
+				closest = std::min(closest, distance);
+			}
+		}
+
+		return closest == FLT_MAX ? -1.0f : closest / scale;
+	};
+
+	auto hit = m_BVH.Raycast(origin, direction, FLT_MAX, testPrimitive);
+	if (!hit.IsHit())
+	{
+		return false;
+	}
+
+	result.m_Model = m_Models[m_Primitives[hit.Item].m_ModelIndex];
+	result.m_PrimitiveIndex = m_Primitives[hit.Item].m_PrimitiveIndex;
+	result.m_Distance = hit.Distance;
+	return true;
+}
@@ -5,6 +5,7 @@
 
 #include <Engine/Core/Model.h>
 #include <Engine/Core/Camera.h>
+#include <Engine/Renderer/BoundingVolumeHierarchy.h>
 
 class CommandList;
 class Device;
@@ -15,22 +16,101 @@ class Visitor;
 class Scene
 {
 public:
+    /**
+     * A mesh primitive of a model in the scene. These are the items of the scene's BVH.
+     */
+    struct ScenePrimitive
+    {
+        u32 m_ModelIndex;
+        u32 m_PrimitiveIndex;
+    };
+
+    struct PickResult
+    {
+        RefPtr<Model> m_Model;
+        u32           m_PrimitiveIndex = ~0u;
+        float         m_Distance = FLT_MAX;
+    };
+
     Scene() = default;
-    ~Scene() = default;
+    ~Scene();
+
+    // The models refer to the scene's transform storage.
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
     
     const std::vector<RefPtr<Model>>& GetModels() const { return m_Models; }
 
+    TransformStorage& GetTransforms() { return m_Transforms; }
+    const TransformStorage& GetTransforms() const { return m_Transforms; }
+
     Camera& GetCameraRef() { return m_Camera; }
     const Camera& GetCameraRef() const { return m_Camera; }
 
-    RefPtr<Model> AddModel(RefPtr<Model> model);
+    /**
+     * Add a model to the scene. The model's transform is created in the scene's
+     * transform storage. A model can only be added to one scene.
+     *
+     * @param parent (Optional) the transform of the parent node or model. The
+     * position, rotation and scale are relative to it.
+     */
+    RefPtr<Model> AddModel(RefPtr<Model> model, const Vector3& position = Vector3::Zero,
+        const Quaternion& rotation = Quaternion::Identity, const Vector3& scale = Vector3::One,
+        TransformHandle parent = {});
+
+    /**
+     * Add a node without a model, to group the models below it.
+     */
+    TransformHandle AddNode(const Vector3& position = Vector3::Zero, const Quaternion& rotation = Quaternion::Identity,
+        const Vector3& scale = Vector3::One, TransformHandle parent = {});
+
+    /**
+     * Recompute the world matrices of the models and nodes that moved since the
+     * last update, and of everything below them, and update the BVH. Call this
+     * once per frame, before the scene is rendered.
+     */
+    void Update();
+
+    /**
+     * The BVH over the world space boxes of the primitives. The item indices are
+     * indices into GetPrimitives. Up to date after Update.
+     */
+    const BoundingVolumeHierarchy& GetBVH() const { return m_BVH; }
+    const std::vector<ScenePrimitive>& GetPrimitives() const { return m_Primitives; }
+
+    /**
+     * Find the closest triangle hit by a ray, for picking.
+     *
+     * @param direction Normalized ray direction.
+     * @returns false if nothing was hit.
+     */
+    bool Raycast(const Vector3& origin, const Vector3& direction, PickResult& result) const;
 
 protected:
     friend class CommandList;
     friend class SceneRenderer;
 
 private:
+    // Rebuild the BVH and the primitive list after models were added.
+    void RebuildBVH(JobSystem& jobSystem);
+    // Refit the BVH to the primitives of the models that moved in the last transform update.
+    void RefitBVH(JobSystem& jobSystem);
+
     Camera m_Camera;
 
+    TransformStorage m_Transforms;
+
     std::vector<RefPtr<Model>> m_Models;
+
+    BoundingVolumeHierarchy           m_BVH;
+    std::vector<ScenePrimitive>       m_Primitives;
+    std::vector<DirectX::BoundingBox> m_PrimitiveBounds;
+    // The first primitive of each model.
+    std::vector<u32> m_FirstPrimitives;
+    // The model of each transform slot (TransformHandle::Index), ~0u for nodes without a model.
+    std::vector<u32> m_TransformModels;
+    std::vector<TransformHandle> m_UpdatedTransforms;
+    // The SAH cost after the last build. The BVH is rebuilt when refitting degrades it too much.
+    float m_BuildSAHCost = 0.0f;
+    bool  m_BVHDirty = false;
 };
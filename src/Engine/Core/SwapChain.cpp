@@ -10,12 +10,14 @@
 #include <Buffers/Texture.h>
 #include <Pipeline/CommandQueue.h>
 #include <Adapter.h>
+#include <Application.h>
 
 SwapChain::SwapChain( Device& device, HWND hWnd, DXGI_FORMAT renderTargetFormat )
 : m_Device( device )
 , m_CommandQueue( device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ) )
+, m_FrameFences( device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ),
+                  device.GetCommandQueue( D3D12_COMMAND_LIST_TYPE_COMPUTE ) )
 , m_hWnd( hWnd )
-, m_FenceValues { 0 }
 , m_Width( 0u )
 , m_Height( 0u )
 , m_RenderTargetFormat( renderTargetFormat )
@@ -149,7 +151,7 @@ const RenderTarget& SwapChain::GetRenderTarget() const
     return m_RenderTarget;
 }
 
-UINT SwapChain::Present( const std::shared_ptr<Texture>& texture )
+u64 SwapChain::Present( const std::shared_ptr<Texture>& texture )
 {
     auto commandList = m_CommandQueue.GetCommandList();
 
@@ -174,16 +176,25 @@ UINT SwapChain::Present( const std::shared_ptr<Texture>& texture )
     UINT presentFlags = m_TearingSupported && !m_Fullscreen && !m_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
     ThrowIfFailed( m_dxgiSwapChain->Present( syncInterval, presentFlags ) );
 
-    m_FenceValues[m_CurrentBackBufferIndex] = m_CommandQueue.Signal();
+    u64 frame      = Application::GetFrameCount();
+    u64 fenceValue = m_FrameFences.EndFrame( frame );
 
     m_CurrentBackBufferIndex = m_dxgiSwapChain->GetCurrentBackBufferIndex();
 
-    auto fenceValue = m_FenceValues[m_CurrentBackBufferIndex];
-    m_CommandQueue.WaitForFenceValue( fenceValue );
+    // Present marks the end of the frame for the barrier statistics.
+    ResourceStateTracker::EndFrame();
 
-    m_Device.ReleaseStaleDescriptors();
+    // Start the next frame. Its slot is still used by the frame that was presented
+    // g_NumFrames frames ago, which has to finish before the slot can be reused.
+    Application::ms_FrameCount = ++frame;
+    m_FrameFences.BeginFrame( frame );
 
-    return m_CurrentBackBufferIndex;
+    if ( frame >= g_NumFrames )
+    {
+        m_Device.ReleaseStaleDescriptors( frame - g_NumFrames );
+    }
+
+    return fenceValue;
 }
 
 void SwapChain::UpdateRenderTargetViews()
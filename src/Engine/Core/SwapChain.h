@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Engine/Core/Device.h>
+#include <Engine/Core/FrameFences.h>
 #include <Engine/Core/RenderTarget.h>
 
 #include <dxgi1_5.h>     // For IDXGISwapChain4
@@ -14,8 +15,8 @@ class Texture;
 class SwapChain
 {
 public:
-    // Number of swapchain back buffers.
-    static const UINT BufferCount = 3;
+    // Number of swapchain back buffers. One per frame in flight.
+    static const UINT BufferCount = static_cast<UINT>(g_NumFrames);
 
     /**
      * Check to see if the swap chain is in full-screen exclusive mode.
@@ -89,9 +90,22 @@ public:
      * will be performed. Use the SwapChain::GetRenderTarget method to get a render
      * target for the window's color buffer.
      *
-     * @returns The current backbuffer index after the present.
+     * Present marks the end of the frame. It does not wait for the GPU to finish
+     * the frame, only for the frame that was presented g_NumFrames frames ago, so
+     * the CPU can record the next frames while the GPU is still rendering this one.
+     *
+     * @returns The fence value (on the direct command queue) that is signaled
+     * when the GPU has finished the presented frame.
+     */
+    u64 Present( const std::shared_ptr<Texture>& texture = nullptr );
+
+    /**
+     * Get the index of the current back buffer.
      */
-    UINT Present( const std::shared_ptr<Texture>& texture = nullptr );
+    UINT GetCurrentBackBufferIndex() const
+    {
+        return m_CurrentBackBufferIndex;
+    }
 
     /**
      * Get the format that is used to create the backbuffer.
@@ -127,8 +141,9 @@ private:
     mutable RenderTarget                    m_RenderTarget;
 
     // The current backbuffer index of the swap chain.
-    UINT   m_CurrentBackBufferIndex;
-    UINT64 m_FenceValues[BufferCount];  // The fence values to wait for before leaving the Present method.
+    UINT m_CurrentBackBufferIndex;
+    // Frame N + g_NumFrames waits for frame N to finish before it is recorded.
+    FrameFences m_FrameFences;
 
     // A handle to a waitable object. Used to wait for the swapchain before presenting.
     HANDLE m_hFrameLatencyWaitableObject;
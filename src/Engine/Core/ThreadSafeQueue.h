@@ -28,85 +28,262 @@
   *  @author Jeremiah
   *
   *  @brief Thread safe queue.
+  *
+  *  Bounded, lock-free multi-producer/multi-consumer ring buffer. Every cell
+  *  carries a sequence number that tells producers and consumers whether the
+  *  cell is free or holds a value for the current lap, so Push and TryPop only
+  *  need a single compare-and-swap on the enqueue or dequeue position.
   */
 
-#include <queue>
-#include <mutex>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <utility>
 
 template<typename T>
 class ThreadSafeQueue
 {
 public:
-    ThreadSafeQueue();
-    ThreadSafeQueue(const ThreadSafeQueue& copy);
+    /**
+     * @param capacity The maximum number of items in the queue. Rounded up to a power of two.
+     */
+    explicit ThreadSafeQueue(size_t capacity = 1024);
+    ~ThreadSafeQueue();
+
+    ThreadSafeQueue(const ThreadSafeQueue&) = delete;
+    ThreadSafeQueue& operator=(const ThreadSafeQueue&) = delete;
 
     /**
      * Push a value into the back of the queue.
+     * If the queue is full, this waits until a consumer makes room.
      */
     void Push(T value);
 
+    /**
+     * Try to push a value into the back of the queue.
+     * @returns false if the queue is full (value is left untouched).
+     */
+    bool TryPush(T&& value);
+
     /**
      * Try to pop a value from the front of the queue.
      * @returns false if the queue is empty.
      */
     bool TryPop(T& value);
 
+    /**
+     * Pop up to maxCount values from the front of the queue with a single
+     * update of the dequeue position.
+     * @returns The number of values written to values.
+     */
+    size_t TryPopMany(T* values, size_t maxCount);
+
     /**
      * Check to see if there are any items in the queue.
+     * Only a snapshot if other threads are pushing or popping.
      */
     bool Empty() const;
 
     /**
      * Retrieve the number of items in the queue.
+     * Only a snapshot if other threads are pushing or popping.
      */
     size_t Size() const;
 
+    size_t Capacity() const
+    {
+        return m_Mask + 1;
+    }
+
 private:
-    std::queue<T> m_Queue;
-    mutable std::mutex m_Mutex;
+    // Avoid false sharing between the producer and consumer positions.
+    static constexpr size_t CacheLineSize = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> Sequence;
+        alignas(T) unsigned char Storage[sizeof(T)];
+
+        T* Value()
+        {
+            return std::launder(reinterpret_cast<T*>(Storage));
+        }
+    };
+
+    Cell*        m_Cells;
+    const size_t m_Mask;
+
+    alignas(CacheLineSize) std::atomic<size_t> m_EnqueuePos;
+    alignas(CacheLineSize) std::atomic<size_t> m_DequeuePos;
 };
 
+namespace ThreadSafeQueueDetail
+{
+inline size_t RoundUpPow2(size_t v)
+{
+    size_t pow2 = 2;
+    while (pow2 < v)
+    {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+}  // namespace ThreadSafeQueueDetail
+
 template<typename T>
-ThreadSafeQueue<T>::ThreadSafeQueue()
-{}
+ThreadSafeQueue<T>::ThreadSafeQueue(size_t capacity)
+    : m_Cells(new Cell[ThreadSafeQueueDetail::RoundUpPow2(capacity)])
+    , m_Mask(ThreadSafeQueueDetail::RoundUpPow2(capacity) - 1)
+    , m_EnqueuePos(0)
+    , m_DequeuePos(0)
+{
+    for (size_t i = 0; i <= m_Mask; ++i)
+    {
+        m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+}
 
 template<typename T>
-ThreadSafeQueue<T>::ThreadSafeQueue(const ThreadSafeQueue<T>& copy)
+ThreadSafeQueue<T>::~ThreadSafeQueue()
 {
-    std::lock_guard<std::mutex> lock(copy.m_Mutex);
-    m_Queue = copy.m_Queue;
+    // Destroy the values that are still in the queue.
+    size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+    size_t end = m_EnqueuePos.load(std::memory_order_relaxed);
+    for (; pos != end; ++pos)
+    {
+        m_Cells[pos & m_Mask].Value()->~T();
+    }
+
+    delete[] m_Cells;
 }
 
 template<typename T>
 void ThreadSafeQueue<T>::Push(T value)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-    m_Queue.push(std::move(value));
+    while (!TryPush(std::move(value)))
+    {
+        std::this_thread::yield();
+    }
 }
 
 template<typename T>
-bool ThreadSafeQueue<T>::TryPop(T& value)
+bool ThreadSafeQueue<T>::TryPush(T&& value)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-    if (m_Queue.empty())
-        return false;
+    Cell*  cell;
+    size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &m_Cells[pos & m_Mask];
+        size_t    sequence = cell->Sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            // The cell is free for this lap; claim it.
+            if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The cell still holds a value from the previous lap: the queue is full.
+            return false;
+        }
+        else
+        {
+            // Another producer claimed the cell.
+            pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
 
-    value = m_Queue.front();
-    m_Queue.pop();
+    new (cell->Storage) T(std::move(value));
+    cell->Sequence.store(pos + 1, std::memory_order_release);
 
     return true;
 }
 
+template<typename T>
+bool ThreadSafeQueue<T>::TryPop(T& value)
+{
+    return TryPopMany(&value, 1) == 1;
+}
+
+template<typename T>
+size_t ThreadSafeQueue<T>::TryPopMany(T* values, size_t maxCount)
+{
+    if (maxCount == 0)
+    {
+        return 0;
+    }
+
+    size_t pos = m_DequeuePos.load(std::memory_order_relaxed);
+    size_t count;
+    for (;;)
+    {
+        // Count the consecutive cells that hold a value for their lap.
+        count = 0;
+        bool stale = false;
+        while (count < maxCount)
+        {
+            size_t    sequence = m_Cells[(pos + count) & m_Mask].Sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos + count + 1);
+            if (diff != 0)
+            {
+                // diff > 0: another consumer already took this cell.
+                stale = diff > 0;
+                break;
+            }
+            ++count;
+        }
+
+        if (count == 0 && !stale)
+        {
+            // The queue is empty.
+            return 0;
+        }
+
+        // Claim all ready cells at once. Ready cells can't be taken by another consumer
+        // without moving the dequeue position first, so a successful exchange owns them.
+        if (count > 0 && m_DequeuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        if (stale)
+        {
+            pos = m_DequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Cell* cell = &m_Cells[(pos + i) & m_Mask];
+        T*    cellValue = cell->Value();
+
+        values[i] = std::move(*cellValue);
+        cellValue->~T();
+
+        // Free the cell for the next lap.
+        cell->Sequence.store(pos + i + m_Mask + 1, std::memory_order_release);
+    }
+
+    return count;
+}
+
 template<typename T>
 bool ThreadSafeQueue<T>::Empty() const
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-    return m_Queue.empty();
+    return Size() == 0;
 }
 
 template<typename T>
 size_t ThreadSafeQueue<T>::Size() const
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-    return m_Queue.size();
-}
\ No newline at end of file
+    size_t dequeuePos = m_DequeuePos.load(std::memory_order_acquire);
+    size_t enqueuePos = m_EnqueuePos.load(std::memory_order_acquire);
+
+    // Consumers can briefly be ahead of the snapshot of the producers.
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
@@ -0,0 +1,378 @@
+#include "enginepch.h"
+
+#include "TransformStorage.h"
+
+#include <JobSystem.h>
+
+// The minimum number of world matrices computed by a single job in Update.
+constexpr u32 UpdateGrainSize = 4096;
+
+// Values of m_Dirty.
+enum DirtyState : u8
+{
+    Clean,
+    // Changed since the last update. The slot is in m_DirtySlots.
+    Dirty,
+    // Scheduled for recomputation by the current update.
+    Queued,
+};
+
+TransformHandle TransformStorage::Create(const Vector3& position, const Quaternion& rotation, const Vector3& scale,
+    TransformHandle parent)
+{
+    u32 slotIndex;
+    if (!m_FreeSlots.empty())
+    {
+        slotIndex = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+    else
+    {
+        slotIndex = static_cast<u32>(m_Slots.size());
+        m_Slots.push_back({ InvalidIndex, 0 });
+    }
+
+    u32 parentSlot = InvalidIndex;
+    u32 depth = 0;
+    if (parent.IsValid())
+    {
+        u32 parentIndex = GetDenseIndex(parent);
+        parentSlot = parent.Index;
+        depth = m_Depths[parentIndex] + 1;
+    }
+
+    u32 denseIndex = static_cast<u32>(m_Positions.size());
+    m_Positions.push_back(position);
+    m_Rotations.push_back(rotation);
+    m_Scales.push_back(scale);
+    m_WorldMatrices.push_back(Matrix::Identity);
+    m_ParentSlots.push_back(parentSlot);
+    m_Depths.push_back(depth);
+    m_Dirty.push_back(Clean);
+    m_DenseToSlot.push_back(slotIndex);
+
+    Slot& slot = m_Slots[slotIndex];
+    slot.DenseIndex = denseIndex;
+
+    if (parentSlot != InvalidIndex)
+    {
+        AddChild(parentSlot, slotIndex);
+    }
+
+    MarkDirty(denseIndex);
+
+    return { slotIndex, slot.Generation };
+}
+
+void TransformStorage::Destroy(TransformHandle handle)
+{
+    u32 denseIndex = GetDenseIndex(handle);
+
+    // The children become roots.
+    std::vector<u32> children = std::move(m_Slots[handle.Index].Children);
+    m_Slots[handle.Index].Children.clear();
+    for (u32 childSlot : children)
+    {
+        u32 childIndex = m_Slots[childSlot].DenseIndex;
+        m_ParentSlots[childIndex] = InvalidIndex;
+        SetDepth(childSlot, 0);
+        MarkDirty(childIndex);
+    }
+
+    if (m_ParentSlots[denseIndex] != InvalidIndex)
+    {
+        RemoveChild(m_ParentSlots[denseIndex], handle.Index);
+    }
+
+    if (m_Dirty[denseIndex] == Dirty)
+    {
+        --m_NumDirty;
+    }
+
+    // Keep the arrays dense: move the last transform into the hole.
+    m_UpdateIndices.clear();
+    u32 lastIndex = static_cast<u32>(m_Positions.size()) - 1;
+    if (denseIndex != lastIndex)
+    {
+        m_Positions[denseIndex] = m_Positions[lastIndex];
+        m_Rotations[denseIndex] = m_Rotations[lastIndex];
+        m_Scales[denseIndex] = m_Scales[lastIndex];
+        m_WorldMatrices[denseIndex] = m_WorldMatrices[lastIndex];
+        m_ParentSlots[denseIndex] = m_ParentSlots[lastIndex];
+        m_Depths[denseIndex] = m_Depths[lastIndex];
+        m_Dirty[denseIndex] = m_Dirty[lastIndex];
+        m_DenseToSlot[denseIndex] = m_DenseToSlot[lastIndex];
+        m_Slots[m_DenseToSlot[denseIndex]].DenseIndex = denseIndex;
+    }
+
+    m_Positions.pop_back();
+    m_Rotations.pop_back();
+    m_Scales.pop_back();
+    m_WorldMatrices.pop_back();
+    m_ParentSlots.pop_back();
+    m_Depths.pop_back();
+    m_Dirty.pop_back();
+    m_DenseToSlot.pop_back();
+
+    // Invalidate the handles to the slot before it's reused.
+    Slot& slot = m_Slots[handle.Index];
+    slot.DenseIndex = InvalidIndex;
+    ++slot.Generation;
+    m_FreeSlots.push_back(handle.Index);
+}
+
+bool TransformStorage::IsAlive(TransformHandle handle) const
+{
+    return handle.Index < m_Slots.size() && m_Slots[handle.Index].Generation == handle.Generation &&
+           m_Slots[handle.Index].DenseIndex != InvalidIndex;
+}
+
+u32 TransformStorage::GetDenseIndex(TransformHandle handle) const
+{
+    assert(IsAlive(handle));
+    return m_Slots[handle.Index].DenseIndex;
+}
+
+void TransformStorage::MarkDirty(u32 denseIndex)
+{
+    if (m_Dirty[denseIndex] == Clean)
+    {
+        m_Dirty[denseIndex] = Dirty;
+        m_DirtySlots.push_back(m_DenseToSlot[denseIndex]);
+        ++m_NumDirty;
+    }
+}
+
+void TransformStorage::AddChild(u32 parentSlot, u32 childSlot)
+{
+    m_Slots[parentSlot].Children.push_back(childSlot);
+}
+
+void TransformStorage::RemoveChild(u32 parentSlot, u32 childSlot)
+{
+    auto& children = m_Slots[parentSlot].Children;
+    children.erase(std::find(children.begin(), children.end(), childSlot));
+}
+
+void TransformStorage::SetDepth(u32 slotIndex, u32 depth)
+{
+    std::vector<std::pair<u32, u32>> stack = { { slotIndex, depth } };
+    while (!stack.empty())
+    {
+        auto [slot, slotDepth] = stack.back();
+        stack.pop_back();
+
+        m_Depths[m_Slots[slot].DenseIndex] = slotDepth;
+        for (u32 childSlot : m_Slots[slot].Children)
+        {
+            stack.push_back({ childSlot, slotDepth + 1 });
+        }
+    }
+}
+
+void TransformStorage::SetParent(TransformHandle handle, TransformHandle parent)
+{
+    u32 denseIndex = GetDenseIndex(handle);
+    u32 parentSlot = parent.IsValid() ? parent.Index : InvalidIndex;
+
+    if (parentSlot == m_ParentSlots[denseIndex])
+    {
+        return;
+    }
+
+    u32 depth = 0;
+    if (parentSlot != InvalidIndex)
+    {
+        // A transform can't become a descendant of itself.
+        for (u32 ancestor = parentSlot; ancestor != InvalidIndex;
+             ancestor = m_ParentSlots[m_Slots[ancestor].DenseIndex])
+        {
+            assert(ancestor != handle.Index && "SetParent would create a cycle.");
+        }
+        depth = m_Depths[GetDenseIndex(parent)] + 1;
+    }
+
+    if (m_ParentSlots[denseIndex] != InvalidIndex)
+    {
+        RemoveChild(m_ParentSlots[denseIndex], handle.Index);
+    }
+
+    m_ParentSlots[denseIndex] = parentSlot;
+    if (parentSlot != InvalidIndex)
+    {
+        AddChild(parentSlot, handle.Index);
+    }
+
+    SetDepth(handle.Index, depth);
+    MarkDirty(denseIndex);
+}
+
+TransformHandle TransformStorage::GetParent(TransformHandle handle) const
+{
+    u32 parentSlot = m_ParentSlots[GetDenseIndex(handle)];
+    if (parentSlot == InvalidIndex)
+    {
+        return {};
+    }
+
+    return { parentSlot, m_Slots[parentSlot].Generation };
+}
+
+u32 TransformStorage::GetDepth(TransformHandle handle) const
+{
+    return m_Depths[GetDenseIndex(handle)];
+}
+
+void TransformStorage::SetPosition(TransformHandle handle, const Vector3& position)
+{
+    u32 denseIndex = GetDenseIndex(handle);
+    m_Positions[denseIndex] = position;
+    MarkDirty(denseIndex);
+}
+
+const Vector3& TransformStorage::GetPosition(TransformHandle handle) const
+{
+    return m_Positions[GetDenseIndex(handle)];
+}
+
+void TransformStorage::SetRotation(TransformHandle handle, const Quaternion& rotation)
+{
+    u32 denseIndex = GetDenseIndex(handle);
+    m_Rotations[denseIndex] = rotation;
+    MarkDirty(denseIndex);
+}
+
+const Quaternion& TransformStorage::GetRotation(TransformHandle handle) const
+{
+    return m_Rotations[GetDenseIndex(handle)];
+}
+
+void TransformStorage::SetScale(TransformHandle handle, const Vector3& scale)
+{
+    u32 denseIndex = GetDenseIndex(handle);
+    m_Scales[denseIndex] = scale;
+    MarkDirty(denseIndex);
+}
+
+const Vector3& TransformStorage::GetScale(TransformHandle handle) const
+{
+    return m_Scales[GetDenseIndex(handle)];
+}
+
+const Matrix& TransformStorage::GetWorldMatrix(TransformHandle handle) const
+{
+    return m_WorldMatrices[GetDenseIndex(handle)];
+}
+
+void TransformStorage::GetUpdated(std::vector<TransformHandle>& handles) const
+{
+    handles.clear();
+    for (u32 denseIndex : m_UpdateIndices)
+    {
+        u32 slotIndex = m_DenseToSlot[denseIndex];
+        handles.push_back({ slotIndex, m_Slots[slotIndex].Generation });
+    }
+}
+
+u32 TransformStorage::Update(JobSystem* jobSystem)
+{
+    // Resolve the dirty slots to dense indices. A destroyed transform's slot may be in the list
+    // (and reused), so only the transforms that are still flagged are queued, once.
+    m_DirtyIndices.clear();
+    for (u32 slotIndex : m_DirtySlots)
+    {
+        u32 denseIndex = m_Slots[slotIndex].DenseIndex;
+        if (denseIndex != InvalidIndex && m_Dirty[denseIndex] == Dirty)
+        {
+            m_Dirty[denseIndex] = Queued;
+            m_DirtyIndices.push_back(denseIndex);
+        }
+    }
+    m_DirtySlots.clear();
+    m_NumDirty = 0;
+
+    // Queue the descendants of the dirty transforms. The list grows while it's walked.
+    for (size_t i = 0; i < m_DirtyIndices.size(); ++i)
+    {
+        for (u32 childSlot : m_Slots[m_DenseToSlot[m_DirtyIndices[i]]].Children)
+        {
+            u32 childIndex = m_Slots[childSlot].DenseIndex;
+            if (m_Dirty[childIndex] != Queued)
+            {
+                m_Dirty[childIndex] = Queued;
+                m_DirtyIndices.push_back(childIndex);
+            }
+        }
+    }
+
+    const u32 numUpdates = static_cast<u32>(m_DirtyIndices.size());
+    if (numUpdates == 0)
+    {
+        m_UpdateIndices.clear();
+        return 0;
+    }
+
+    // Sort the queued transforms by depth (counting sort). Level d is
+    // m_UpdateIndices[m_LevelOffsets[d], m_LevelOffsets[d + 1]).
+    u32 maxDepth = 0;
+    for (u32 denseIndex : m_DirtyIndices)
+    {
+        maxDepth = std::max(maxDepth, m_Depths[denseIndex]);
+    }
+
+    m_LevelOffsets.assign(maxDepth + 2, 0);
+    for (u32 denseIndex : m_DirtyIndices)
+    {
+        ++m_LevelOffsets[m_Depths[denseIndex] + 1];
+    }
+    for (u32 depth = 1; depth < m_LevelOffsets.size(); ++depth)
+    {
+        m_LevelOffsets[depth] += m_LevelOffsets[depth - 1];
+    }
+
+    m_UpdateIndices.resize(numUpdates);
+    {
+        std::vector<u32> offsets(m_LevelOffsets.begin(), m_LevelOffsets.end() - 1);
+        for (u32 denseIndex : m_DirtyIndices)
+        {
+            m_UpdateIndices[offsets[m_Depths[denseIndex]]++] = denseIndex;
+        }
+    }
+
+    // The parents of a level are either clean or on a previous level, so their world matrices are final.
+    auto updateRange = [this](u32 begin, u32 end)
+    {
+        for (u32 i = begin; i < end; ++i)
+        {
+            u32 denseIndex = m_UpdateIndices[i];
+            XMMATRIX world = XMMatrixAffineTransformation(m_Scales[denseIndex], g_XMZero, m_Rotations[denseIndex],
+                m_Positions[denseIndex]);
+
+            u32 parentSlot = m_ParentSlots[denseIndex];
+            if (parentSlot != InvalidIndex)
+            {
+                world = XMMatrixMultiply(world, m_WorldMatrices[m_Slots[parentSlot].DenseIndex]);
+            }
+
+            m_WorldMatrices[denseIndex] = world;
+            m_Dirty[denseIndex] = Clean;
+        }
+    };
+
+    for (u32 depth = 0; depth <= maxDepth; ++depth)
+    {
+        u32 levelBegin = m_LevelOffsets[depth];
+        u32 levelEnd = m_LevelOffsets[depth + 1];
+
+        if (jobSystem && levelEnd - levelBegin > UpdateGrainSize)
+        {
+            jobSystem->ParallelFor(levelBegin, levelEnd, UpdateGrainSize, updateRange);
+        }
+        else
+        {
+            updateRange(levelBegin, levelEnd);
+        }
+    }
+
+    return numUpdates;
+}
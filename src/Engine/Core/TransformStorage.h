@@ -0,0 +1,154 @@
+/**
+ * Storage for the transforms of scene objects.
+ *
+ * Positions, rotations, scales and world matrices are stored in separate
+ * contiguous arrays (structure of arrays) rather than in the objects. The world
+ * matrices are cached: setting a component marks the transform dirty, and
+ * Update only recomputes the world matrices of the dirty transforms.
+ *
+ * Transforms form a hierarchy: the position, rotation and scale are relative to
+ * the parent, and world = local * parent world. When a transform is dirty, its
+ * whole subtree is recomputed. Update processes the dirty transforms level by
+ * level (by depth in the hierarchy), so the transforms of a level only read the
+ * world matrices of the previous levels and can be computed in parallel.
+ *
+ * Objects refer to their transform with a TransformHandle. Handles stay valid
+ * when other transforms are created or destroyed (the arrays are kept dense by
+ * moving the last transform into the hole), and a handle of a destroyed
+ * transform is detected by its generation.
+ */
+#pragma once
+
+#include <vector>
+
+class JobSystem;
+
+struct TransformHandle
+{
+    u32 Index = ~0u;
+    u32 Generation = 0;
+
+    bool IsValid() const
+    {
+        return Index != ~0u;
+    }
+
+    bool operator==(const TransformHandle& other) const = default;
+};
+
+class TransformStorage
+{
+public:
+    /**
+     * Create a transform.
+     *
+     * @param parent (Optional) the parent transform. The position, rotation and
+     * scale are relative to it.
+     */
+    TransformHandle Create(const Vector3& position = Vector3::Zero, const Quaternion& rotation = Quaternion::Identity,
+        const Vector3& scale = Vector3::One, TransformHandle parent = {});
+
+    /**
+     * Destroy a transform. Its children become roots (keeping their local transform).
+     */
+    void Destroy(TransformHandle handle);
+
+    // Returns true if the handle refers to a transform that was not destroyed.
+    bool IsAlive(TransformHandle handle) const;
+
+    /**
+     * Change the parent of a transform (an invalid handle makes it a root). The
+     * local transform is kept, so the world transform changes.
+     */
+    void            SetParent(TransformHandle handle, TransformHandle parent);
+    TransformHandle GetParent(TransformHandle handle) const;
+
+    // The depth in the hierarchy. Roots have depth 0.
+    u32 GetDepth(TransformHandle handle) const;
+
+    void           SetPosition(TransformHandle handle, const Vector3& position);
+    const Vector3& GetPosition(TransformHandle handle) const;
+
+    void              SetRotation(TransformHandle handle, const Quaternion& rotation);
+    const Quaternion& GetRotation(TransformHandle handle) const;
+
+    void           SetScale(TransformHandle handle, const Vector3& scale);
+    const Vector3& GetScale(TransformHandle handle) const;
+
+    /**
+     * The world matrix (scale * rotation * translation * parent world) as of the
+     * last Update.
+     */
+    const Matrix& GetWorldMatrix(TransformHandle handle) const;
+
+    /**
+     * Recompute the world matrices of the transforms that changed since the last
+     * update, and of their descendants. Not thread safe with the other functions.
+     *
+     * @param jobSystem (Optional) split the work of each level over the job system.
+     * @returns The number of world matrices that were recomputed.
+     */
+    u32 Update(JobSystem* jobSystem = nullptr);
+
+    size_t GetSize() const
+    {
+        return m_Positions.size();
+    }
+
+    /**
+     * Get the transforms whose world matrix was recomputed by the last Update.
+     * Destroying a transform clears the list (the dense indices change).
+     */
+    void GetUpdated(std::vector<TransformHandle>& handles) const;
+
+    // The number of transforms that changed since the last update (not counting their descendants).
+    size_t GetNumDirty() const
+    {
+        return m_NumDirty;
+    }
+
+private:
+    static constexpr u32 InvalidIndex = ~0u;
+
+    // Get the index in the dense arrays. Asserts that the handle is alive.
+    u32 GetDenseIndex(TransformHandle handle) const;
+    void MarkDirty(u32 denseIndex);
+
+    void AddChild(u32 parentSlot, u32 childSlot);
+    void RemoveChild(u32 parentSlot, u32 childSlot);
+    // Set the depth of a transform and its descendants.
+    void SetDepth(u32 slotIndex, u32 depth);
+
+    // Dense arrays, indexed by the dense index.
+    std::vector<Vector3>    m_Positions;
+    std::vector<Quaternion> m_Rotations;
+    std::vector<Vector3>    m_Scales;
+    std::vector<Matrix>     m_WorldMatrices;
+    std::vector<u32>        m_ParentSlots;
+    std::vector<u32>        m_Depths;
+    std::vector<u8>         m_Dirty;
+    std::vector<u32>        m_DenseToSlot;
+
+    // Indexed by TransformHandle::Index.
+    struct Slot
+    {
+        u32 DenseIndex;
+        u32 Generation;
+        // The slots of the children.
+        std::vector<u32> Children;
+    };
+    std::vector<Slot> m_Slots;
+    std::vector<u32>  m_FreeSlots;
+
+    // The slots of the transforms that were marked dirty since the last update. Slots
+    // (rather than dense indices) are stored, because Destroy moves transforms.
+    std::vector<u32> m_DirtySlots;
+    // The number of transforms that are marked dirty. m_DirtySlots can't be counted, since it
+    // keeps the slots of destroyed transforms, and a reused slot can be in it twice.
+    size_t m_NumDirty = 0;
+    // The dense indices to recompute in Update, sorted by depth.
+    std::vector<u32> m_UpdateIndices;
+    // Scratch space for Update.
+    std::vector<u32> m_DirtyIndices;
+    std::vector<u32> m_LevelOffsets;
+};
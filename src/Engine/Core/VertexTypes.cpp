@@ -2,6 +2,8 @@
 
 #include "VertexTypes.h"
 
+#include <cmath>
+
 // clang-format off
 const D3D12_INPUT_ELEMENT_DESC VertexPosition::InputElements[] = { 
     { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } 
@@ -23,15 +25,118 @@ const D3D12_INPUT_LAYOUT_DESC VertexPositionColor::InputLayout = {
 };
 
 const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentBitangentTexture::InputElements[] = {
-    { "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "NORMAL",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "TANGENT",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    { "TEXCOORD",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    VERTEX_POSITION_NORMAL_TANGENT_BITANGENT_TEXTURE(VERTEX_INPUT_ELEMENT)
 };
 
 const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentBitangentTexture::InputLayout = { 
     VertexPositionNormalTangentBitangentTexture::InputElements,
     VertexPositionNormalTangentBitangentTexture::InputElementCount
 };
-// clang-format on
\ No newline at end of file
+
+const D3D12_INPUT_ELEMENT_DESC VertexCompact::InputElements[] = {
+    VERTEX_COMPACT(VERTEX_INPUT_ELEMENT)
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexCompact::InputLayout = {
+    VertexCompact::InputElements,
+    VertexCompact::InputElementCount
+};
+
+const D3D12_INPUT_ELEMENT_DESC VertexPositionTexture::InputElements[] = {
+    VERTEX_POSITION_TEXTURE(VERTEX_INPUT_ELEMENT)
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionTexture::InputLayout = {
+    VertexPositionTexture::InputElements,
+    VertexPositionTexture::InputElementCount
+};
+// clang-format on
+
+// The input layouts and the structured buffers of the shaders assume the elements are tightly packed.
+static_assert(sizeof(VertexPositionNormalTangentBitangentTexture) == 60);
+static_assert(sizeof(VertexCompact) == 20);
+static_assert(sizeof(VertexPositionTexture) == 20);
+
+namespace
+{
+    // Map a unit vector to the square [-1, 1]^2: project it to the octahedron |x| + |y| + |z| = 1 and fold the
+    // lower half over the diagonals.
+    DirectX::XMFLOAT2 EncodeOctahedral(DirectX::FXMVECTOR vector)
+    {
+        DirectX::XMFLOAT3 v;
+        DirectX::XMStoreFloat3(&v, vector);
+
+        float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (length == 0.0f)
+        {
+            return { 0.0f, 0.0f };
+        }
+
+        float x = v.x / length;
+        float y = v.y / length;
+        if (v.z < 0.0f)
+        {
+            float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        return { x, y };
+    }
+
+    DirectX::XMVECTOR DecodeOctahedral(const DirectX::XMFLOAT2& encoded)
+    {
+        float x = encoded.x;
+        float y = encoded.y;
+        float z = 1.0f - std::abs(x) - std::abs(y);
+        float t = std::clamp(-z, 0.0f, 1.0f);
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+        return DirectX::XMVector3Normalize(DirectX::XMVectorSet(x, y, z, 0.0f));
+    }
+}
+
+VertexCompact::VertexCompact(const VertexPositionNormalTangentBitangentTexture& vertex,
+                             const DirectX::XMFLOAT3& positionScale,
+                             const DirectX::XMFLOAT3& positionOffset)
+{
+    using namespace DirectX;
+
+    // An axis the box is flat along quantizes to 0.
+    XMVECTOR scale = XMLoadFloat3(&positionScale);
+    XMVECTOR inverseScale = XMVectorSelect(XMVectorReciprocal(scale), XMVectorZero(), XMVectorEqual(scale, XMVectorZero()));
+    XMVECTOR position = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertex.Position), XMLoadFloat3(&positionOffset)), inverseScale);
+
+    XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+    XMVECTOR tangent = XMLoadFloat3(&vertex.Tangent);
+    float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), XMLoadFloat3(&vertex.Bitangent))) < 0.0f ? 0.0f : 1.0f;
+
+    PackedVector::XMStoreUShortN4(&Position, XMVectorSetW(position, handedness));
+
+    XMFLOAT2 encoded = EncodeOctahedral(normal);
+    PackedVector::XMStoreShortN2(&Normal, XMLoadFloat2(&encoded));
+    encoded = EncodeOctahedral(tangent);
+    PackedVector::XMStoreShortN2(&Tangent, XMLoadFloat2(&encoded));
+
+    PackedVector::XMStoreHalf2(&TexCoord, XMVectorSet(vertex.TexCoord.x, vertex.TexCoord.y, 0.0f, 0.0f));
+}
+
+VertexPositionNormalTangentBitangentTexture VertexCompact::Decode(const DirectX::XMFLOAT3& positionScale,
+                                                                  const DirectX::XMFLOAT3& positionOffset) const
+{
+    using namespace DirectX;
+
+    XMVECTOR quantized = PackedVector::XMLoadUShortN4(&Position);
+    XMVECTOR position = XMVectorMultiplyAdd(quantized, XMLoadFloat3(&positionScale), XMLoadFloat3(&positionOffset));
+
+    XMFLOAT2 encoded;
+    XMStoreFloat2(&encoded, PackedVector::XMLoadShortN2(&Normal));
+    XMVECTOR normal = DecodeOctahedral(encoded);
+    XMStoreFloat2(&encoded, PackedVector::XMLoadShortN2(&Tangent));
+    XMVECTOR tangent = DecodeOctahedral(encoded);
+    XMVECTOR bitangent = XMVectorScale(XMVector3Cross(normal, tangent), XMVectorGetW(quantized) * 2.0f - 1.0f);
+
+    XMVECTOR texCoord = XMVectorSetZ(PackedVector::XMLoadHalf2(&TexCoord), 0.0f);
+
+    return VertexPositionNormalTangentBitangentTexture(position, normal, texCoord, tangent, bitangent);
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <DirectXPackedVector.h>  // For XMUSHORTN4, XMSHORTN2, XMHALF2
+
+#include <Shaders/VertexFormats.hlsli>
+
 struct VertexPosition
 {
     VertexPosition() = default;
@@ -74,14 +78,58 @@ struct VertexPositionNormalTangentBitangentTexture
         DirectX::XMStoreFloat3( &( this->TexCoord ), texCoord );
     }
 
-    DirectX::XMFLOAT3 Position;
-    DirectX::XMFLOAT3 Normal;
-    DirectX::XMFLOAT3 Tangent;
-    DirectX::XMFLOAT3 Bitangent;
-    DirectX::XMFLOAT3 TexCoord;
+    VERTEX_POSITION_NORMAL_TANGENT_BITANGENT_TEXTURE(VERTEX_CPP_MEMBER)
+
+    static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+private:
+    static const int                      InputElementCount = 0 VERTEX_POSITION_NORMAL_TANGENT_BITANGENT_TEXTURE(VERTEX_ELEMENT_COUNT);
+    static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
+/**
+ * A third of the size of VertexPositionNormalTangentBitangentTexture, see VERTEX_COMPACT. The position is
+ * quantized to a box, from offset to offset + scale, that is usually the bounding box of the primitive.
+ */
+struct VertexCompact
+{
+    VertexCompact() = default;
+
+    explicit VertexCompact( const VertexPositionNormalTangentBitangentTexture& vertex,
+                            const DirectX::XMFLOAT3& positionScale,
+                            const DirectX::XMFLOAT3& positionOffset );
+
+    /**
+     * Decode the vertex the way CompactMeshVS does.
+     */
+    VertexPositionNormalTangentBitangentTexture Decode( const DirectX::XMFLOAT3& positionScale,
+                                                        const DirectX::XMFLOAT3& positionOffset ) const;
+
+    VERTEX_COMPACT(VERTEX_CPP_MEMBER)
+
+    static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+private:
+    static const int                      InputElementCount = 0 VERTEX_COMPACT(VERTEX_ELEMENT_COUNT);
+    static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
+struct VertexPositionTexture
+{
+    VertexPositionTexture() = default;
+
+    explicit VertexPositionTexture( const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT2& texCoord )
+    : Position( position )
+    , TexCoord( texCoord )
+    {}
+
+    explicit VertexPositionTexture( const VertexPositionNormalTangentBitangentTexture& vertex )
+    : Position( vertex.Position )
+    , TexCoord( vertex.TexCoord.x, vertex.TexCoord.y )
+    {}
+
+    VERTEX_POSITION_TEXTURE(VERTEX_CPP_MEMBER)
 
     static const D3D12_INPUT_LAYOUT_DESC InputLayout;
 private:
-    static const int                      InputElementCount = 5;
+    static const int                      InputElementCount = 0 VERTEX_POSITION_TEXTURE(VERTEX_ELEMENT_COUNT);
     static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
 };
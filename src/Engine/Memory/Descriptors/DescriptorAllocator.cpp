@@ -63,7 +63,7 @@ DescriptorAllocation DescriptorAllocator::Allocate(u32 numDescriptors)
     return allocation;
 }
 
-void DescriptorAllocator::ReleaseStaleDescriptors()
+void DescriptorAllocator::ReleaseStaleDescriptors(u64 completedFrame)
 {
     std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
@@ -71,7 +71,7 @@ void DescriptorAllocator::ReleaseStaleDescriptors()
     {
         auto page = m_HeapPool[i];
 
-        page->ReleaseStaleDescriptors();
+        page->ReleaseStaleDescriptors(completedFrame);
 
         if (page->NumFreeHandles() > 0)
         {
@@ -18,8 +18,9 @@ public:
 
     /**
      * When the frame has completed, the stale descriptors can be released.
+     * @param completedFrame The last frame that has finished executing on the GPU.
      */
-    void ReleaseStaleDescriptors();
+    void ReleaseStaleDescriptors(u64 completedFrame);
 
     // Can only be created by the Device.
     DescriptorAllocator(Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type, u32 numDescriptorsPerHeap = 256);
@@ -3,6 +3,7 @@
 #include <Pipeline/CommandQueue.h>
 #include "DescriptorAllocatorPage.h"
 #include <Device.h>
+#include <Application.h>
 
 DescriptorAllocatorPage::DescriptorAllocatorPage(Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type,
     u32 numDescriptors)
@@ -111,7 +112,7 @@ void DescriptorAllocatorPage::Free(DescriptorAllocation&& descriptor)
 
     std::lock_guard<std::mutex> lock(m_AllocationMutex);
     // Don't add the block directly to the free list until the frame has completed.
-    m_StaleDescriptors.emplace(offset, descriptor.GetNumHandles());
+    m_StaleDescriptors.emplace(offset, descriptor.GetNumHandles(), Application::GetFrameCount());
 }
 
 void DescriptorAllocatorPage::FreeBlock(u32 offset, u32 numDescriptors)
@@ -178,11 +179,12 @@ void DescriptorAllocatorPage::FreeBlock(u32 offset, u32 numDescriptors)
     AddNewBlock(offset, numDescriptors);
 }
 
-void DescriptorAllocatorPage::ReleaseStaleDescriptors()
+void DescriptorAllocatorPage::ReleaseStaleDescriptors(u64 completedFrame)
 {
     std::lock_guard<std::mutex> lock(m_AllocationMutex);
 
-    while (!m_StaleDescriptors.empty())
+    // Descriptors are queued in the order they were freed, so the frame numbers are ascending.
+    while (!m_StaleDescriptors.empty() && m_StaleDescriptors.front().FrameNumber <= completedFrame)
     {
         auto& staleDescriptor = m_StaleDescriptors.front();
 
@@ -33,16 +33,18 @@ public:
 
     /**
         * Return a descriptor back to the heap.
-        * @param frameNumber Stale descriptors are not freed directly, but put
-        * on a stale allocations queue. Stale allocations are returned to the heap
-        * using the DescriptorAllocatorPage::ReleaseStaleAllocations method.
+        * Stale descriptors are not freed directly, but put on a stale allocations
+        * queue together with the current frame number. Stale allocations are
+        * returned to the heap using the DescriptorAllocatorPage::ReleaseStaleDescriptors method.
         */
     void Free(DescriptorAllocation&& descriptorHandle);
 
     /**
         * Returned the stale descriptors back to the descriptor heap.
+        * @param completedFrame Descriptors that were freed in this frame or an
+        * earlier frame are released.
         */
-    void ReleaseStaleDescriptors();
+    void ReleaseStaleDescriptors(u64 completedFrame);
 
     DescriptorAllocatorPage(Device& device, D3D12_DESCRIPTOR_HEAP_TYPE type, u32 numDescriptors);
     virtual ~DescriptorAllocatorPage() = default;
@@ -85,15 +87,18 @@ private:
 
     struct StaleDescriptorInfo
     {
-        StaleDescriptorInfo(OffsetType offset, SizeType size)
+        StaleDescriptorInfo(OffsetType offset, SizeType size, u64 frame)
             : Offset(offset)
             , Size(size)
+            , FrameNumber(frame)
         {}
 
         // The offset within the descriptor heap.
         OffsetType Offset;
         // The number of descriptors
         SizeType Size;
+        // The frame number that the descriptor was freed.
+        u64 FrameNumber;
     };
 
     // Device that was used to create the descriptor heap.
@@ -6,6 +6,51 @@
 #include <Device.h>
 #include <Pipeline/RootSignature.h>
 
+namespace
+{
+    // Root argument setters for draws.
+    struct GraphicsRootSetter
+    {
+        static void SetDescriptorTable(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+        {
+            commandList->SetGraphicsRootDescriptorTable(rootIndex, baseDescriptor);
+        }
+        static void SetConstantBufferView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetGraphicsRootConstantBufferView(rootIndex, bufferLocation);
+        }
+        static void SetShaderResourceView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetGraphicsRootShaderResourceView(rootIndex, bufferLocation);
+        }
+        static void SetUnorderedAccessView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetGraphicsRootUnorderedAccessView(rootIndex, bufferLocation);
+        }
+    };
+
+    // Root argument setters for dispatches.
+    struct ComputeRootSetter
+    {
+        static void SetDescriptorTable(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+        {
+            commandList->SetComputeRootDescriptorTable(rootIndex, baseDescriptor);
+        }
+        static void SetConstantBufferView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetComputeRootConstantBufferView(rootIndex, bufferLocation);
+        }
+        static void SetShaderResourceView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetComputeRootShaderResourceView(rootIndex, bufferLocation);
+        }
+        static void SetUnorderedAccessView(ID3D12GraphicsCommandList* commandList, UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+        {
+            commandList->SetComputeRootUnorderedAccessView(rootIndex, bufferLocation);
+        }
+    };
+}
+
 DynamicDescriptorHeap::DynamicDescriptorHeap(Device& device, D3D12_DESCRIPTOR_HEAP_TYPE heapType,
     u32 numDescriptorsPerHeap)
     : m_Device(device)
@@ -166,9 +211,8 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::CreateDescri
     return descriptorHeap;
 }
 
-void DynamicDescriptorHeap::CommitDescriptorTables(
-    CommandList& commandList,
-    std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc)
+template<typename RootSetter>
+void DynamicDescriptorHeap::CommitDescriptorTables(CommandList& commandList)
 {
     // Compute the number of descriptors that need to be copied
     u32 numDescriptorsToCommit = ComputeStaleDescriptorCount();
@@ -208,8 +252,8 @@ void DynamicDescriptorHeap::CommitDescriptorTables(
             d3d12Device->CopyDescriptors(1, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes, numSrcDescriptors,
                 pSrcDescriptorHandles, nullptr, m_DescriptorHeapType);
 
-            // Set the descriptors on the command list using the passed-in setter function.
-            setFunc(d3d12GraphicsCommandList, rootIndex, m_CurrentGPUDescriptorHandle);
+            // Set the descriptors on the command list using the root setter policy.
+            RootSetter::SetDescriptorTable(d3d12GraphicsCommandList, rootIndex, m_CurrentGPUDescriptorHandle);
 
             // Offset current CPU and GPU descriptor handles.
             m_CurrentCPUDescriptorHandle.Offset(numSrcDescriptors, m_DescriptorHandleIncrementSize);
@@ -223,9 +267,9 @@ void DynamicDescriptorHeap::CommitDescriptorTables(
     }
 }
 
+template<void (*SetFunc)(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_VIRTUAL_ADDRESS)>
 void DynamicDescriptorHeap::CommitInlineDescriptors(
-    CommandList& commandList, const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, u32& bitMask,
-    std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_VIRTUAL_ADDRESS)> setFunc)
+    CommandList& commandList, const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, u32& bitMask)
 {
     if (bitMask != 0)
     {
@@ -233,7 +277,7 @@ void DynamicDescriptorHeap::CommitInlineDescriptors(
         DWORD rootIndex;
         while (_BitScanForward(&rootIndex, bitMask))
         {
-            setFunc(d3d12GraphicsCommandList, rootIndex, bufferLocations[rootIndex]);
+            SetFunc(d3d12GraphicsCommandList, rootIndex, bufferLocations[rootIndex]);
 
             // Flip the stale bit so the descriptor is not recopied again unless it is updated with a new descriptor.
             bitMask ^= (1 << rootIndex);
@@ -241,26 +285,23 @@ void DynamicDescriptorHeap::CommitInlineDescriptors(
     }
 }
 
+template<typename RootSetter>
+void DynamicDescriptorHeap::CommitStagedDescriptors(CommandList& commandList)
+{
+    CommitDescriptorTables<RootSetter>(commandList);
+    CommitInlineDescriptors<&RootSetter::SetConstantBufferView>(commandList, m_InlineCBV, m_StaleCBVBitMask);
+    CommitInlineDescriptors<&RootSetter::SetShaderResourceView>(commandList, m_InlineSRV, m_StaleSRVBitMask);
+    CommitInlineDescriptors<&RootSetter::SetUnorderedAccessView>(commandList, m_InlineUAV, m_StaleUAVBitMask);
+}
+
 void DynamicDescriptorHeap::CommitStagedDescriptorsForDraw(CommandList& commandList)
 {
-    CommitDescriptorTables(commandList, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable);
-    CommitInlineDescriptors(commandList, m_InlineCBV, m_StaleCBVBitMask,
-        &ID3D12GraphicsCommandList::SetGraphicsRootConstantBufferView);
-    CommitInlineDescriptors(commandList, m_InlineSRV, m_StaleSRVBitMask,
-        &ID3D12GraphicsCommandList::SetGraphicsRootShaderResourceView);
-    CommitInlineDescriptors(commandList, m_InlineUAV, m_StaleUAVBitMask,
-        &ID3D12GraphicsCommandList::SetGraphicsRootUnorderedAccessView);
+    CommitStagedDescriptors<GraphicsRootSetter>(commandList);
 }
 
 void DynamicDescriptorHeap::CommitStagedDescriptorsForDispatch(CommandList& commandList)
 {
-    CommitDescriptorTables(commandList, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable);
-    CommitInlineDescriptors(commandList, m_InlineCBV, m_StaleCBVBitMask,
-        &ID3D12GraphicsCommandList::SetComputeRootConstantBufferView);
-    CommitInlineDescriptors(commandList, m_InlineSRV, m_StaleSRVBitMask,
-        &ID3D12GraphicsCommandList::SetComputeRootShaderResourceView);
-    CommitInlineDescriptors(commandList, m_InlineUAV, m_StaleUAVBitMask,
-        &ID3D12GraphicsCommandList::SetComputeRootUnorderedAccessView);
+    CommitStagedDescriptors<ComputeRootSetter>(commandList);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::CopyDescriptor(CommandList& comandList,
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <queue>
-#include <functional>
 
 class Device;
 class CommandList;
@@ -85,20 +84,21 @@ private:
     /**
      * Copy all of the staged descriptors to the GPU visible descriptor heap and
      * bind the descriptor heap and the descriptor tables to the command list.
-     * The passed-in function object is used to set the GPU visible descriptors
-     * on the command list. Two possible functions are:
-     *   * Before a draw    : ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable
-     *   * Before a dispatch: ID3D12GraphicsCommandList::SetComputeRootDescriptorTable
+     * The RootSetter policy is used to set the GPU visible descriptors on the
+     * command list. Two possible policies are:
+     *   * Before a draw    : GraphicsRootSetter (SetGraphicsRoot*)
+     *   * Before a dispatch: ComputeRootSetter  (SetComputeRoot*)
      *
-     * Since the DynamicDescriptorHeap can't know which function will be used, it must
-     * be passed as an argument to the function.
+     * The policy is resolved at compile time so the per-draw commit path has no
+     * type-erased calls and no allocations.
      */
-    void CommitDescriptorTables(
-        CommandList& commandList,
-        std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc);
+    template<typename RootSetter>
+    void CommitStagedDescriptors(CommandList& commandList);
+    template<typename RootSetter>
+    void CommitDescriptorTables(CommandList& commandList);
+    template<void (*SetFunc)(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_VIRTUAL_ADDRESS)>
     void CommitInlineDescriptors(
-        CommandList& commandList, const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, u32& bitMask,
-        std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_VIRTUAL_ADDRESS)> setFunc);
+        CommandList& commandList, const D3D12_GPU_VIRTUAL_ADDRESS* bufferLocations, u32& bitMask);
 
     /**
      * The maximum number of descriptor tables per root signature.
@@ -47,6 +47,22 @@ public:
     bool CheckFormatSupport(D3D12_FORMAT_SUPPORT1 formatSupport) const;
     bool CheckFormatSupport(D3D12_FORMAT_SUPPORT2 formatSupport) const;
 
+    /**
+     * Flag the resource as manually managed. Command lists in explicit barrier
+     * mode (see CommandList::SetExplicitBarriers) don't track the state of
+     * manually managed resources; their barriers are recorded explicitly
+     * (CommandList::ExplicitTransitionBarrier) or rely on implicit state
+     * promotion and decay.
+     */
+    void SetManuallyManaged(bool manuallyManaged)
+    {
+        m_ManuallyManaged = manuallyManaged;
+    }
+    bool IsManuallyManaged() const
+    {
+        return m_ManuallyManaged;
+    }
+
 protected:
     //    friend class CommandList;
 
@@ -66,6 +82,7 @@ protected:
     D3D12_FEATURE_DATA_FORMAT_SUPPORT      m_FormatSupport;
     std::unique_ptr<D3D12_CLEAR_VALUE>     m_d3d12ClearValue;
     std::wstring                           m_ResourceName;
+    bool                                   m_ManuallyManaged = false;
 
 private:
     // Check the format support and populate the m_FormatSupport structure.
@@ -31,6 +31,7 @@ CommandList::CommandList(Device& device, D3D12_COMMAND_LIST_TYPE type)
     , m_d3d12CommandListType(type)
     , m_RootSignature(nullptr)
     , m_PipelineState(nullptr)
+    , m_ExplicitBarriers(false)
 {
     auto d3d12Device = m_Device.GetD3D12Device();
 
@@ -42,7 +43,7 @@ CommandList::CommandList(Device& device, D3D12_COMMAND_LIST_TYPE type)
 
     m_UploadBuffer = MakeUnique<UploadBuffer>(device);
 
-    m_ResourceStateTracker = MakeUnique<ResourceStateTracker>();
+    m_ResourceStateTracker = MakeUnique<ResourceStateTracker>(m_d3d12CommandListType);
 
     for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
     {
@@ -84,10 +85,59 @@ void CommandList::TransitionBarrier(const std::shared_ptr<Resource>& resource, D
 {
     if (resource)
     {
+        if (IsManuallyManaged(*resource))
+        {
+            // The caller records the barriers of this resource. The resource is still
+            // kept alive until the command list has finished executing.
+            TrackResource(resource);
+            if (DecaysAfterExecution(*resource))
+            {
+                m_ResourceStateTracker->SetUntrackedResourceState(resource->GetD3D12Resource().Get(),
+                    D3D12_RESOURCE_STATE_COMMON);
+            }
+            if (flushBarriers)
+            {
+                FlushResourceBarriers();
+            }
+            return;
+        }
+
         TransitionBarrier(resource->GetD3D12Resource(), stateAfter, subresource, flushBarriers);
     }
 }
 
+void CommandList::ExplicitTransitionBarrier(const std::shared_ptr<Resource>& resource,
+    D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, UINT subresource, bool flushBarriers)
+{
+    if (resource)
+    {
+        auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource->GetD3D12Resource().Get(), stateBefore,
+            stateAfter, subresource);
+        m_ResourceStateTracker->ExplicitResourceBarrier(barrier);
+
+        // Manually managed resources are still in the global state, it must follow the explicit transitions.
+        if (IsManuallyManaged(*resource))
+        {
+            m_ResourceStateTracker->SetUntrackedResourceState(barrier.Transition.pResource,
+                DecaysAfterExecution(*resource) ? D3D12_RESOURCE_STATE_COMMON : stateAfter, subresource);
+        }
+    }
+
+    if (flushBarriers)
+    {
+        FlushResourceBarriers();
+    }
+}
+
+void CommandList::BeginTransitionBarrier(const std::shared_ptr<Resource>& resource,
+    D3D12_RESOURCE_STATES stateAfter, UINT subresource)
+{
+    if (resource && !IsManuallyManaged(*resource))
+    {
+        m_ResourceStateTracker->BeginTransitionResource(*resource, stateAfter, subresource);
+    }
+}
+
 void CommandList::UAVBarrier(Microsoft::WRL::ComPtr<ID3D12Resource> resource, bool flushBarriers)
 {
     auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(resource.Get());
@@ -154,7 +204,15 @@ void CommandList::CopyResource(const std::shared_ptr<Resource>& dstRes, const st
 {
     assert(dstRes && srcRes);
 
-    CopyResource(dstRes->GetD3D12Resource(), srcRes->GetD3D12Resource());
+    TransitionBarrier(dstRes, D3D12_RESOURCE_STATE_COPY_DEST);
+    TransitionBarrier(srcRes, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    FlushResourceBarriers();
+
+    m_d3d12CommandList->CopyResource(dstRes->GetD3D12Resource().Get(), srcRes->GetD3D12Resource().Get());
+
+    TrackResource(dstRes);
+    TrackResource(srcRes);
 }
 
 void CommandList::ResolveSubresource(const std::shared_ptr<Resource>& dstRes, const std::shared_ptr<Resource>& srcRes,
@@ -620,7 +678,7 @@ RefPtr<Scene> CommandList::CreateScene(const VertexCollection& vertices, const I
     // Create a default white material for new meshes.
     auto material = MakeRef<Material>(Material::White);
 
-    mesh->CreatePrimitive(vertexBuffer, indexBuffer);
+    mesh->CreatePrimitive(vertexBuffer, indexBuffer).ComputeBounds(vertices);
     mesh->SetMaterials({ material });
 
     auto scene = MakeRef<Scene>();
@@ -989,6 +1047,9 @@ void CommandList::ClearUnorderedAccessViewUint(const std::shared_ptr<UnorderedAc
 {
     assert(view);
 
+    // Like every other command, the clear must not be recorded in the middle of a barrier batch.
+    FlushResourceBarriers();
+
     auto gpuHandle = m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->CopyDescriptor(*this, view->GetDescriptorHandle());
     m_d3d12CommandList->ClearUnorderedAccessViewUint(gpuHandle, view->GetDescriptorHandle(), view->GetResource()->GetD3D12Resource().Get(), value, 0, nullptr);
    // TransitionBarrier(texture, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true);
@@ -1021,6 +1082,15 @@ void CommandList::ClearDepthStencilTexture(const std::shared_ptr<Texture>& textu
     TrackResource(texture);
 }
 
+void CommandList::DiscardResource(const std::shared_ptr<Resource>& resource)
+{
+    assert(resource);
+
+    m_d3d12CommandList->DiscardResource(resource->GetD3D12Resource().Get(), nullptr);
+
+    TrackResource(resource);
+}
+
 void CommandList::CopyTextureSubresource(const std::shared_ptr<Texture>& texture, u32 firstSubresource,
     u32 numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData)
 {
@@ -1247,7 +1317,7 @@ void CommandList::SetConstantBufferView(u32 rootParameterIndex, const std::share
     if (buffer)
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier(d3d12Resource, stateAfter);
+        TransitionBarrier(buffer, stateAfter);
 
         m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineCBV(
             rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset);
@@ -1262,7 +1332,7 @@ void CommandList::SetShaderResourceView(u32 rootParameterIndex, const std::share
     if (buffer)
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier(d3d12Resource, stateAfter);
+        TransitionBarrier(buffer, stateAfter);
 
         m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineSRV(
             rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset);
@@ -1277,7 +1347,7 @@ void CommandList::SetUnorderedAccessView(u32 rootParameterIndex, const std::shar
     if (buffer)
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
-        TransitionBarrier(d3d12Resource, stateAfter);
+        TransitionBarrier(buffer, stateAfter);
 
         m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineUAV(
             rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset);
@@ -1488,13 +1558,17 @@ void CommandList::Dispatch(u32 numGroupsX, u32 numGroupsY, u32 numGroupsZ)
 
 bool CommandList::Close(const std::shared_ptr<CommandList>& pendingCommandList)
 {
-    // Flush any remaining barriers.
+    // End any open split transitions, restrict the combined read states and flush any remaining barriers.
+    m_ResourceStateTracker->EndSplitTransitions();
+    m_ResourceStateTracker->RestrictMergedReadStates();
     FlushResourceBarriers();
 
     m_d3d12CommandList->Close();
 
     // Flush pending resource barriers.
-    u32 numPendingBarriers = m_ResourceStateTracker->FlushPendingResourceBarriers(pendingCommandList);
+    assert(pendingCommandList || !HasPendingResourceBarriers());
+    u32 numPendingBarriers =
+        pendingCommandList ? m_ResourceStateTracker->FlushPendingResourceBarriers(pendingCommandList) : 0;
     // Commit the final resource state to the global state.
     m_ResourceStateTracker->CommitFinalResourceStates();
 
@@ -1503,10 +1577,22 @@ bool CommandList::Close(const std::shared_ptr<CommandList>& pendingCommandList)
 
 void CommandList::Close()
 {
+    m_ResourceStateTracker->EndSplitTransitions();
+    m_ResourceStateTracker->RestrictMergedReadStates();
     FlushResourceBarriers();
     m_d3d12CommandList->Close();
 }
 
+bool CommandList::HasPendingResourceBarriers() const
+{
+    return m_ResourceStateTracker->HasPendingResourceBarriers();
+}
+
+u64 CommandList::GetGlobalStateShardMask() const
+{
+    return m_ResourceStateTracker->GetGlobalStateShardMask();
+}
+
 void CommandList::Reset()
 {
     ThrowIfFailed(m_d3d12CommandAllocator->Reset());
@@ -1526,6 +1612,22 @@ void CommandList::Reset()
     m_RootSignature = nullptr;
     m_PipelineState = nullptr;
     m_ComputeCommandList = nullptr;
+    m_ExplicitBarriers = false;
+}
+
+bool CommandList::IsManuallyManaged(const Resource& resource) const
+{
+    return m_ExplicitBarriers && resource.IsManuallyManaged();
+}
+
+bool CommandList::DecaysAfterExecution(const Resource& resource) const
+{
+    // Buffers, simultaneous-access textures and anything used on a copy queue decay to COMMON
+    // when ExecuteCommandLists completes. Other textures keep the state of their last transition.
+    D3D12_RESOURCE_DESC desc = resource.GetD3D12ResourceDesc();
+    return desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ||
+           (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS) != 0 ||
+           m_d3d12CommandListType == D3D12_COMMAND_LIST_TYPE_COPY;
 }
 
 void CommandList::TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object)
@@ -74,6 +74,66 @@ public:
     void TransitionBarrier(Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES stateAfter,
         UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flushBarriers = false);
 
+    /**
+        * Enable or disable explicit barrier mode.
+        *
+        * In explicit barrier mode the state of manually managed resources (see
+        * Resource::SetManuallyManaged) is not tracked: transitions requested for them
+        * (including the implicit transitions of the Set*View and Copy functions) are
+        * ignored and the caller records barriers with ExplicitTransitionBarrier.
+        * Other resources are tracked as usual. The mode is disabled when the command
+        * list is reset.
+        *
+        * When the command list is executed, the global state of the manually managed
+        * resources it used is set to the state they are left in: COMMON for resources
+        * that decay (buffers, simultaneous-access textures) and the state after the
+        * last explicit transition otherwise.
+        */
+    void SetExplicitBarriers(bool explicitBarriers)
+    {
+        m_ExplicitBarriers = explicitBarriers;
+    }
+    bool HasExplicitBarriers() const
+    {
+        return m_ExplicitBarriers;
+    }
+
+    /**
+        * Record a transition barrier with a known before state. The barrier is batched
+        * with the other barriers but the state of the resource is not tracked.
+        *
+        * @param resource The resource to transition.
+        * @param stateBefore The current state of the resource.
+        * @param stateAfter The state to transition the resource to.
+        * @param subresource The subresource to transition.
+        * @param flushBarriers Force flush any barriers.
+        */
+    void ExplicitTransitionBarrier(const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES stateBefore,
+        D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+        bool flushBarriers = false);
+
+    /**
+        * Add an object to the list of tracked objects. This ensures the lifetime of the
+        * object while the command list is in-flight on a command queue.
+        */
+    void TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object);
+    void TrackResource(const std::shared_ptr<Resource>& res);
+
+    /**
+        * Begin a split transition of a resource to a particular state.
+        *
+        * The transition is ended by the next TransitionBarrier (or UAV/aliasing barrier) of the
+        * resource, or when the command list is closed. Commands recorded in between can overlap
+        * with the transition. If the state of the resource is not known on this command list
+        * yet, the transition is performed by the next TransitionBarrier instead.
+        *
+        * @param resource The resource to transition.
+        * @param stateAfter The state to transition the resource to.
+        * @param subresource The subresource to transition.
+        */
+    void BeginTransitionBarrier(const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES stateAfter,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
     /**
         * Add a UAV barrier to ensure that any writes to a resource have completed
         * before reading from the resource.
@@ -262,6 +322,13 @@ public:
     void ClearDepthStencilTexture(const std::shared_ptr<Texture>& texture, D3D12_CLEAR_FLAGS clearFlags,
         float depth = 1.0f, u8 stencil = 0);
 
+    /**
+        * Discard the contents of a resource, for example a render target whose memory was
+        * used by another (aliased) resource. The resource must be in the RENDER_TARGET or
+        * DEPTH_WRITE state if it is a render target or depth stencil texture.
+        */
+    void DiscardResource(const std::shared_ptr<Resource>& resource);
+
     /**
         * Generate mips for the texture.
         * The first subresource is used to generate the mip chain.
@@ -464,7 +531,8 @@ protected:
         * Used by the command queue.
         *
         * @param pendingCommandList The command list that is used to execute pending
-        * resource barriers (if any) for this command list.
+        * resource barriers (if any) for this command list. Can be NULL if
+        * HasPendingResourceBarriers returns false.
         *
         * @return true if there are any pending resource barriers that need to be
         * processed.
@@ -473,6 +541,18 @@ protected:
     // Just close the command list. This is useful for pending command lists.
     void Close();
 
+    /**
+        * Returns true if resources were used on this command list without a known state
+        * and a pending command list is needed to transition them before execution.
+        */
+    bool HasPendingResourceBarriers() const;
+
+    /**
+        * Get the global resource state shards referenced by this command list.
+        * The command queue locks these shards around Close and execution.
+        */
+    u64 GetGlobalStateShardMask() const;
+
     /**
         * Reset the command list. This should only be called by the CommandQueue
         * before the command list is returned from CommandQueue::GetCommandList.
@@ -515,10 +595,11 @@ private:
     void CreateCylinderCap(VertexCollection& vertices, IndexCollection& indices, size_t tessellation, float height,
         float radius, bool isTop);
 
-    // Add a resource to a list of tracked resources (ensures lifetime while command list is in-flight on a command
-    // queue.
-    void TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object);
-    void TrackResource(const std::shared_ptr<Resource>& res);
+    // Returns true if the state of the resource is managed by the caller (explicit barrier mode).
+    bool IsManuallyManaged(const Resource& resource) const;
+
+    // Returns true if the resource decays to D3D12_RESOURCE_STATE_COMMON after the command list has executed.
+    bool DecaysAfterExecution(const Resource& resource) const;
 
     // Generate mips for UAV compatible textures.
     void GenerateMips_UAV(const std::shared_ptr<Texture>& texture, bool isSRGB);
@@ -557,6 +638,9 @@ private:
     // global state of a resource in order to minimize resource state transitions.
     std::unique_ptr<ResourceStateTracker> m_ResourceStateTracker;
 
+    // Skip state tracking for manually managed resources.
+    bool m_ExplicitBarriers;
+
     // The dynamic descriptor heap allows for descriptors to be staged before
     // being committed to the command list. Dynamic descriptors need to be
     // committed before a Draw or Dispatch.
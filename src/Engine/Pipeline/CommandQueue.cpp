@@ -1,16 +1,33 @@
 #include "enginepch.h"
 
+#include <Application.h>
 #include <Device.h>
+#include <JobSystem.h>
 #include <Pipeline/ResourceStateTracker.h>
 #include "CommandList.h"
 
 #include "CommandQueue.h"
 
+namespace
+{
+Microsoft::WRL::ComPtr<ID3D12Fence> CreateFence(Device& device)
+{
+    Microsoft::WRL::ComPtr<ID3D12Fence> d3d12Fence;
+    ThrowIfFailed(device.GetD3D12Device()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&d3d12Fence)));
+    return d3d12Fence;
+}
+}  // namespace
+
 CommandQueue::CommandQueue(Device& device, D3D12_COMMAND_LIST_TYPE type)
     : m_Device(device)
     , m_CommandListType(type)
+    , m_d3d12Fence(CreateFence(device))
+    , m_Fence(Fence::Create(m_d3d12Fence))
     , m_FenceValue(0)
-    , m_bProcessInFlightCommandLists(true)
+    , m_NumSubmittedCommandLists(0)
+    , m_InFlightCommandLists(*m_Fence)
+    , m_AvailableCommandLists(MaxCommandLists)
+    , m_NumCommandLists(0)
 {
     auto d3d12Device = m_Device.GetD3D12Device();
 
@@ -21,7 +38,6 @@ CommandQueue::CommandQueue(Device& device, D3D12_COMMAND_LIST_TYPE type)
     desc.NodeMask = 0;
 
     ThrowIfFailed(d3d12Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_d3d12CommandQueue)));
-    ThrowIfFailed(d3d12Device->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
 
     switch (type)
     {
@@ -35,36 +51,17 @@ CommandQueue::CommandQueue(Device& device, D3D12_COMMAND_LIST_TYPE type)
         m_d3d12CommandQueue->SetName(L"Direct Command Queue");
         break;
     }
-
-    // Set the thread name for easy debugging.
-    char threadName[256];
-    sprintf_s(threadName, "ProccessInFlightCommandLists ");
-    switch (type)
-    {
-    case D3D12_COMMAND_LIST_TYPE_DIRECT:
-        strcat_s(threadName, "(Direct)");
-        break;
-    case D3D12_COMMAND_LIST_TYPE_COMPUTE:
-        strcat_s(threadName, "(Compute)");
-        break;
-    case D3D12_COMMAND_LIST_TYPE_COPY:
-        strcat_s(threadName, "(Copy)");
-        break;
-    default:
-        break;
-    }
-
-    m_ProcessInFlightCommandListsThread = std::thread(&CommandQueue::ProccessInFlightCommandLists, this);
-    SetThreadName(m_ProcessInFlightCommandListsThread, threadName);
 }
 
-CommandQueue::~CommandQueue()
+CommandQueue::~CommandQueue() = default;
+
+u64 CommandQueue::Signal()
 {
-    m_bProcessInFlightCommandLists = false;
-    m_ProcessInFlightCommandListsThread.join();
+    std::lock_guard<std::mutex> lock(m_SubmissionMutex);
+    return SignalLocked();
 }
 
-u64 CommandQueue::Signal()
+u64 CommandQueue::SignalLocked()
 {
     u64 fenceValue = ++m_FenceValue;
     m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
@@ -73,49 +70,39 @@ u64 CommandQueue::Signal()
 
 bool CommandQueue::IsFenceComplete(u64 fenceValue)
 {
-    return m_d3d12Fence->GetCompletedValue() >= fenceValue;
+    return m_Fence->GetCompletedValue() >= fenceValue;
 }
 
 void CommandQueue::WaitForFenceValue(u64 fenceValue)
 {
-    if (!IsFenceComplete(fenceValue))
-    {
-        auto event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-        if (event)
-        {
-            // Is this function thread safe?
-            m_d3d12Fence->SetEventOnCompletion(fenceValue, event);
-            ::WaitForSingleObject(event, DWORD_MAX);
-
-            ::CloseHandle(event);
-        }
-    }
+    m_Fence->Wait(fenceValue);
 }
 
 void CommandQueue::Flush()
 {
-    std::unique_lock<std::mutex> lock(m_ProcessInFlightCommandListsThreadMutex);
-    m_ProcessInFlightCommandListsThreadCV.wait(lock, [this] { return m_InFlightCommandLists.Empty(); });
-
     // In case the command queue was signaled directly
     // using the CommandQueue::Signal method then the
     // fence value of the command queue might be higher than the fence
     // value of any of the executed command lists.
     WaitForFenceValue(m_FenceValue);
+
+    // All in-flight command lists are complete; release their tracked objects.
+    ProccessInFlightCommandLists();
 }
 
 std::shared_ptr<CommandList> CommandQueue::GetCommandList()
 {
     std::shared_ptr<CommandList> commandList;
 
+    // Recycle the command lists that have finished executing.
+    ProccessInFlightCommandLists();
+
     // If there is a command list on the queue.
-    if (!m_AvailableCommandLists.Empty())
-    {
-        m_AvailableCommandLists.TryPop(commandList);
-    }
-    else
+    if (!m_AvailableCommandLists.TryPop(commandList))
     {
         // Otherwise create a new command list.
+        [[maybe_unused]] size_t numCommandLists = ++m_NumCommandLists;
+        assert(numCommandLists <= MaxCommandLists && "Too many command lists to recycle; raise MaxCommandLists.");
         commandList = MakeRef<CommandList>(m_Device, m_CommandListType);
     }
 
@@ -129,9 +116,64 @@ u64 CommandQueue::ExecuteCommandList(std::shared_ptr<CommandList> commandList)
     return ExecuteCommandLists(std::vector<std::shared_ptr<CommandList>>({ commandList }));
 }
 
+std::vector<std::shared_ptr<CommandList>> CommandQueue::RecordCommandLists(u32 count,
+    const std::function<void(CommandList& commandList, u32 index)>& recordFunc)
+{
+    return RecordCommandLists(Application::Get().GetJobSystem(), count, recordFunc);
+}
+
+std::vector<std::shared_ptr<CommandList>> CommandQueue::RecordCommandLists(JobSystem& jobSystem, u32 count,
+    const std::function<void(CommandList& commandList, u32 index)>& recordFunc)
+{
+    std::vector<std::shared_ptr<CommandList>> commandLists(count);
+    for (auto& commandList : commandLists)
+    {
+        commandList = GetCommandList();
+    }
+
+    std::vector<std::exception_ptr> exceptions(count);
+    auto record = [&](u32 index) {
+        try
+        {
+            recordFunc(*commandLists[index], index);
+        }
+        catch (...)
+        {
+            exceptions[index] = std::current_exception();
+        }
+    };
+
+    jobSystem.ParallelFor(0, count, 1, [&](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; ++i)
+        {
+            record(i);
+        }
+    });
+
+    for (auto& exception : exceptions)
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    return commandLists;
+}
+
 u64 CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList>>& commandLists)
 {
-    ResourceStateTracker::Lock();
+    // Submissions to this queue are serialized. Of the global resource state, only the shards referenced by
+    // these command lists are locked, so queues submitting disjoint resources don't serialize on each other.
+    std::unique_lock<std::mutex> submissionLock(m_SubmissionMutex);
+
+    u64 shardMask = 0;
+    for (const auto& commandList : commandLists)
+    {
+        shardMask |= commandList->GetGlobalStateShardMask();
+    }
+
+    ResourceStateTracker::Lock(shardMask);
 
     // Command lists that need to put back on the command list queue.
     std::vector<std::shared_ptr<CommandList>> toBeQueued;
@@ -148,18 +190,28 @@ u64 CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<CommandL
 
     for (auto commandList : commandLists)
     {
-        auto pendingCommandList = GetCommandList();
+        // Only command lists that used resources without a known state need a pending
+        // command list (lists that only use explicitly managed resources never do).
+        std::shared_ptr<CommandList> pendingCommandList;
+        if (commandList->HasPendingResourceBarriers())
+        {
+            pendingCommandList = GetCommandList();
+        }
+
         bool hasPendingBarriers = commandList->Close(pendingCommandList);
-        pendingCommandList->Close();
-        // If there are no pending barriers on the pending command list, there is no reason to
-        // execute an empty command list on the command queue.
-        if (hasPendingBarriers)
+        if (pendingCommandList)
         {
-            d3d12CommandLists.push_back(pendingCommandList->GetD3D12CommandList().Get());
+            pendingCommandList->Close();
+            // If there are no pending barriers on the pending command list, there is no reason to
+            // execute an empty command list on the command queue.
+            if (hasPendingBarriers)
+            {
+                d3d12CommandLists.push_back(pendingCommandList->GetD3D12CommandList().Get());
+            }
+            toBeQueued.push_back(pendingCommandList);
         }
         d3d12CommandLists.push_back(commandList->GetD3D12CommandList().Get());
 
-        toBeQueued.push_back(pendingCommandList);
         toBeQueued.push_back(commandList);
 
         auto generateMipsCommandList = commandList->GetGenerateMipsCommandList();
@@ -171,16 +223,19 @@ u64 CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<CommandL
 
     UINT numCommandLists = static_cast<UINT>(d3d12CommandLists.size());
     m_d3d12CommandQueue->ExecuteCommandLists(numCommandLists, d3d12CommandLists.data());
-    u64 fenceValue = Signal();
-
-    ResourceStateTracker::Unlock();
+    m_NumSubmittedCommandLists += numCommandLists;
+    u64 fenceValue = SignalLocked();
 
-    // Queue command lists for reuse.
-    for (auto commandList : toBeQueued)
+    // Queue command lists for reuse. This is done before the submission mutex is unlocked, so the
+    // in-flight command lists stay in the order of their fence values.
+    for (auto& commandList : toBeQueued)
     {
-        m_InFlightCommandLists.Push({ fenceValue, commandList });
+        m_InFlightCommandLists.Push(fenceValue, std::move(commandList));
     }
 
+    ResourceStateTracker::Unlock(shardMask);
+    submissionLock.unlock();
+
     // If there are any command lists that generate mips then execute those
     // after the initial resource command lists have finished.
     if (generateMipsCommandLists.size() > 0)
@@ -198,6 +253,12 @@ void CommandQueue::Wait(const CommandQueue& other)
     m_d3d12CommandQueue->Wait(other.m_d3d12Fence.Get(), other.m_FenceValue);
 }
 
+void CommandQueue::Wait(const CommandQueue& other, u64 fenceValue)
+{
+    assert(fenceValue <= other.m_FenceValue);
+    ThrowIfFailed(m_d3d12CommandQueue->Wait(other.m_d3d12Fence.Get(), fenceValue));
+}
+
 Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
 {
     return m_d3d12CommandQueue;
@@ -205,28 +266,15 @@ Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue()
 
 void CommandQueue::ProccessInFlightCommandLists()
 {
-    std::unique_lock<std::mutex> lock(m_ProcessInFlightCommandListsThreadMutex, std::defer_lock);
+    m_InFlightCommandLists.Recycle([this](std::shared_ptr<CommandList>& commandList) {
+        commandList->Reset();
 
-    while (m_bProcessInFlightCommandLists)
-    {
-        CommandListEntry commandListEntry;
-
-        lock.lock();
-        while (m_InFlightCommandLists.TryPop(commandListEntry))
+        // The available command list queue holds every list the queue created, so it is never full
+        // while the bound holds. Otherwise release the list instead of blocking.
+        if (!m_AvailableCommandLists.TryPush(std::move(commandList)))
         {
-            auto fenceValue = std::get<0>(commandListEntry);
-            auto commandList = std::get<1>(commandListEntry);
-
-            WaitForFenceValue(fenceValue);
-
-            commandList->Reset();
-
-            m_AvailableCommandLists.Push(commandList);
+            assert(false && "The available command list queue is full; raise MaxCommandLists.");
+            --m_NumCommandLists;
         }
-        lock.unlock();
-        m_ProcessInFlightCommandListsThreadCV.notify_one();
-
-        // std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-        std::this_thread::yield();
-    }
-}
\ No newline at end of file
+    });
+}
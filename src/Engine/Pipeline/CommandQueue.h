@@ -1,13 +1,17 @@
 #pragma once
 
-#include <atomic>              // For std::atomic_bool
-#include <condition_variable>  // For std::condition_variable.
-#include <cstdint>             // For uint64_t
+#include <atomic>   // For std::atomic_uint64_t
+#include <cstdint>  // For uint64_t
+#include <functional>  // For std::function
+#include <mutex>       // For std::mutex
 
 #include <Engine/Core/ThreadSafeQueue.h>
+#include <Engine/Pipeline/Fence.h>
+#include <Engine/Pipeline/InFlightQueue.h>
 
 class CommandList;
 class Device;
+class JobSystem;
 
 class CommandQueue
 {
@@ -20,13 +24,39 @@ public:
     u64 ExecuteCommandList(std::shared_ptr<CommandList> commandList);
     u64 ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList>>& commandLists);
 
+    // Record count command lists in parallel. recordFunc(commandList, index) is invoked
+    // once for every index in [0, count), each on its own command list (and so with its
+    // own dynamic descriptor heaps and upload buffer) on the application's job system.
+    // Index 0 is recorded on the calling thread. The command lists are returned in index order, ready to be submitted with
+    // ExecuteCommandLists. Exceptions thrown by recordFunc are rethrown on the calling thread.
+    std::vector<std::shared_ptr<CommandList>> RecordCommandLists(u32 count,
+        const std::function<void(CommandList& commandList, u32 index)>& recordFunc);
+    // Record count command lists in parallel on the workers of jobSystem.
+    std::vector<std::shared_ptr<CommandList>> RecordCommandLists(JobSystem& jobSystem, u32 count,
+        const std::function<void(CommandList& commandList, u32 index)>& recordFunc);
+
     u64 Signal();
+    // Get the last fence value that was signaled on this queue. It may not have completed yet.
+    u64      GetLastSignaledFenceValue() const
+    {
+        return m_FenceValue;
+    }
+    // Get the number of D3D12 command lists that were submitted to this queue, including the
+    // pending command lists that resolve the barriers of the executed command lists.
+    u64      GetNumSubmittedCommandLists() const
+    {
+        return m_NumSubmittedCommandLists;
+    }
     bool     IsFenceComplete(u64 fenceValue);
     void     WaitForFenceValue(u64 fenceValue);
     void     Flush();
 
     // Wait for another command queue to finish.
     void Wait(const CommandQueue& other);
+    // Wait (on the GPU) until another command queue has reached a fence value, for example
+    // a value that was returned by other.ExecuteCommandList. Work that is submitted to the
+    // other queue after that value is not waited for.
+    void Wait(const CommandQueue& other, u64 fenceValue);
 
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
 
@@ -40,26 +70,38 @@ protected:
 
 
 private:
-    // Free any command lists that are finished processing on the command queue.
+    // Reset the in-flight command lists whose fence value has been reached and make
+    // them available again. Called lazily from GetCommandList and Flush.
     void ProccessInFlightCommandLists();
 
-    // Keep track of command allocators that are "in-flight"
-    // The first member is the fence value to wait for, the second is the
-    // a shared pointer to the "in-flight" command list.
-    using CommandListEntry = std::tuple<u64, std::shared_ptr<CommandList>>;
+    // Signal the fence with the next fence value. The submission mutex must be locked.
+    u64 SignalLocked();
 
     Device& m_Device;
     D3D12_COMMAND_LIST_TYPE                    m_CommandListType;
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_d3d12CommandQueue;
+    // The queue signals and waits on the GPU through the D3D12 fence, and observes it
+    // on the CPU through m_Fence.
     Microsoft::WRL::ComPtr<ID3D12Fence>        m_d3d12Fence;
+    UniquePtr<Fence>                           m_Fence;
     std::atomic_uint64_t                       m_FenceValue;
 
-    ThreadSafeQueue<CommandListEntry>             m_InFlightCommandLists;
+    // Serializes the submissions to this queue (closing the command lists, executing them and
+    // signaling the fence), so the fence values are signaled in order and always after the
+    // command lists they belong to.
+    std::mutex m_SubmissionMutex;
+    std::atomic_uint64_t m_NumSubmittedCommandLists;
+
+    // The most command lists a queue creates. Every list is either being recorded, in flight or
+    // available, so all of them fit in the available list queue and recycling never has to block
+    // or drop a list. A frame records a few lists per stage and one per recording thread (each
+    // with at most one pending list), and at most g_NumFrames frames are in flight.
+    static constexpr size_t MaxCommandLists = 1024;
+
+    // In-flight command lists in submission order. Pushed while the submission mutex is
+    // locked, so their fence values never decrease.
+    InFlightQueue<std::shared_ptr<CommandList>>   m_InFlightCommandLists;
     ThreadSafeQueue<std::shared_ptr<CommandList>> m_AvailableCommandLists;
-
-    // A thread to process in-flight command lists.
-    std::thread             m_ProcessInFlightCommandListsThread;
-    std::atomic_bool        m_bProcessInFlightCommandLists;
-    std::mutex              m_ProcessInFlightCommandListsThreadMutex;
-    std::condition_variable m_ProcessInFlightCommandListsThreadCV;
+    // The number of command lists created by the queue, at most MaxCommandLists.
+    std::atomic_size_t                            m_NumCommandLists;
 };
@@ -0,0 +1,84 @@
+#include "enginepch.h"
+
+#include "Fence.h"
+
+#include <mutex>
+
+namespace
+{
+class D3D12Fence : public Fence
+{
+public:
+    explicit D3D12Fence(Microsoft::WRL::ComPtr<ID3D12Fence> d3d12Fence)
+        : m_d3d12Fence(std::move(d3d12Fence))
+    {
+    }
+
+    ~D3D12Fence() override
+    {
+        for (HANDLE event : m_Events)
+        {
+            ::CloseHandle(event);
+        }
+    }
+
+    u64 GetCompletedValue() const override
+    {
+        return m_d3d12Fence->GetCompletedValue();
+    }
+
+    void Wait(u64 value) override
+    {
+        if (GetCompletedValue() >= value)
+        {
+            return;
+        }
+
+        HANDLE event = AcquireEvent();
+
+        ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(value, event));
+        ::WaitForSingleObject(event, DWORD_MAX);
+
+        ReleaseEvent(event);
+    }
+
+private:
+    // Get a (reusable) event to wait for fence completion.
+    HANDLE AcquireEvent()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_EventsMutex);
+            if (!m_Events.empty())
+            {
+                HANDLE event = m_Events.back();
+                m_Events.pop_back();
+                return event;
+            }
+        }
+
+        // Auto-reset, so the event can be reused once the wait has returned.
+        HANDLE event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+        assert(event && "Failed to create fence event.");
+
+        return event;
+    }
+
+    // Return an event to the pool.
+    void ReleaseEvent(HANDLE event)
+    {
+        std::lock_guard<std::mutex> lock(m_EventsMutex);
+        m_Events.push_back(event);
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_d3d12Fence;
+
+    // Events that are not currently used to wait for the fence.
+    std::vector<HANDLE> m_Events;
+    std::mutex          m_EventsMutex;
+};
+}  // namespace
+
+UniquePtr<Fence> Fence::Create(Microsoft::WRL::ComPtr<ID3D12Fence> d3d12Fence)
+{
+    return MakeUnique<D3D12Fence>(std::move(d3d12Fence));
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * The CPU side of a command queue's fence: the value the GPU has completed and a
+ * blocking wait for a value. The command queue only observes its fence through this
+ * interface, so its in-flight bookkeeping can be tested with a fence that is
+ * completed by hand.
+ */
+class Fence
+{
+public:
+    virtual ~Fence() = default;
+
+    /**
+     * @returns The last value the fence has reached. Never blocks.
+     */
+    virtual u64 GetCompletedValue() const = 0;
+
+    /**
+     * Block the calling thread until the fence has reached value.
+     */
+    virtual void Wait(u64 value) = 0;
+
+    /**
+     * Observe a D3D12 fence. Waits use a pool of events, so concurrent waits don't
+     * create an event each.
+     */
+    static UniquePtr<Fence> Create(Microsoft::WRL::ComPtr<ID3D12Fence> d3d12Fence);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cassert>
+#include <deque>    // For std::deque
+#include <mutex>    // For std::mutex
+#include <utility>  // For std::pair
+
+#include <Engine/Pipeline/Fence.h>
+
+/**
+ * Values that the GPU uses until a fence reaches a value, for example the command lists a
+ * command queue has submitted. The values are pushed in submission order, so they complete
+ * in that order too.
+ */
+template<typename T>
+class InFlightQueue
+{
+public:
+    explicit InFlightQueue(const Fence& fence)
+        : m_Fence(fence)
+    {
+    }
+
+    /**
+     * Add a value that is in use until the fence reaches fenceValue. The fence values must
+     * not decrease, so push under the lock that orders the signals of the fence.
+     */
+    void Push(u64 fenceValue, T value)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        assert((m_Values.empty() || m_Values.back().first <= fenceValue) &&
+               "In-flight values must be pushed in submission order.");
+        m_Values.emplace_back(fenceValue, std::move(value));
+    }
+
+    /**
+     * Pass the values whose fence value has been reached to recycleFunc(T&), in submission
+     * order. Only reads the completed value of the fence and never waits for it.
+     *
+     * @returns The number of recycled values.
+     */
+    template<typename RecycleFunc>
+    size_t Recycle(RecycleFunc&& recycleFunc)
+    {
+        u64 completedValue = m_Fence.GetCompletedValue();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // Stop at the first value that is still in use.
+        size_t numRecycled = 0;
+        while (!m_Values.empty() && m_Values.front().first <= completedValue)
+        {
+            T value = std::move(m_Values.front().second);
+            m_Values.pop_front();
+
+            recycleFunc(value);
+            ++numRecycled;
+        }
+
+        return numRecycled;
+    }
+
+    /**
+     * The number of values that are still in flight.
+     * Only a snapshot if other threads are pushing or recycling.
+     */
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Values.size();
+    }
+
+private:
+    const Fence& m_Fence;
+
+    // The fence value to wait for and the in-flight value, in submission order.
+    std::deque<std::pair<u64, T>> m_Values;
+    mutable std::mutex            m_Mutex;
+};
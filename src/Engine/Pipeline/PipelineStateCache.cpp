@@ -0,0 +1,687 @@
+#include "enginepch.h"
+
+#include "PipelineStateCache.h"
+
+#include <Engine/Core/Application.h>
+#include <Device.h>
+#include <Adapter.h>
+#include <Pipeline/PipelineStateObject.h>
+#include <Pipeline/RootSignature.h>
+
+#include <fstream>
+
+namespace
+{
+// Increment when the file layout or the stream hash changes.
+constexpr u32 CacheFileVersion = 1;
+constexpr u32 CacheFileMagic = 'CSPD';
+
+struct CacheFileHeader
+{
+    u32 Magic;
+    u32 Version;
+    // VendorId, DeviceId, SubSysId and Revision of the adapter.
+    u32 AdapterIdentity[4];
+    u64 DriverVersion;
+    u64 NumKeys;
+    u64 LibrarySize;
+    // Followed by NumKeys u64 keys and LibrarySize bytes of serialized library.
+};
+
+/**
+ * Hashes the subobjects of a pipeline state stream. Structures are hashed member by
+ * member since some of them contain padding, and pointers are followed. The hashed
+ * bytes are kept as well, so streams with the same hash can be compared. The root
+ * signature is identified by the hash of its serialized blob.
+ */
+class PipelineStateStreamHasher : public ID3DX12PipelineParserCallbacks
+{
+public:
+    u64  Hash = 0xcbf29ce484222325ULL;
+    bool Valid = true;
+    // The hashed bytes.
+    std::vector<u8> Contents;
+    // The hashes of the bytecode of the shaders in the stream, to evict the pipeline when one is reloaded.
+    std::vector<u64> ShaderHashes;
+
+    void AddBytes(const void* data, size_t size)
+    {
+        Hash = HashBytes(data, size, Hash);
+        Contents.insert(Contents.end(), static_cast<const u8*>(data), static_cast<const u8*>(data) + size);
+    }
+
+    template<typename T>
+    void Add(const T& value)
+    {
+        AddBytes(&value, sizeof(T));
+    }
+
+    void AddString(const char* str)
+    {
+        if (str)
+        {
+            AddBytes(str, strlen(str) + 1);
+        }
+        else
+        {
+            AddBytes("", 1);
+        }
+    }
+
+    void AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type, const D3D12_SHADER_BYTECODE& shader)
+    {
+        Add(type);
+        Add(static_cast<u64>(shader.BytecodeLength));
+        if (shader.pShaderBytecode)
+        {
+            AddBytes(shader.pShaderBytecode, shader.BytecodeLength);
+            ShaderHashes.push_back(HashBytes(shader.pShaderBytecode, shader.BytecodeLength));
+        }
+    }
+
+    void AddDepthStencilOp(const D3D12_DEPTH_STENCILOP_DESC& op)
+    {
+        Add(op.StencilFailOp);
+        Add(op.StencilDepthFailOp);
+        Add(op.StencilPassOp);
+        Add(op.StencilFunc);
+    }
+
+    void FlagsCb(D3D12_PIPELINE_STATE_FLAGS flags) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS);
+        Add(flags);
+    }
+
+    void NodeMaskCb(UINT nodeMask) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK);
+        Add(nodeMask);
+    }
+
+    void RootSignatureCb(ID3D12RootSignature* rootSignature) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE);
+        if (rootSignature)
+        {
+            u64 rootSignatureHash = RootSignature::GetHash(rootSignature);
+            Valid &= rootSignatureHash != 0;
+            Add(rootSignatureHash);
+        }
+    }
+
+    void InputLayoutCb(const D3D12_INPUT_LAYOUT_DESC& inputLayout) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT);
+        Add(inputLayout.NumElements);
+        for (UINT i = 0; i < inputLayout.NumElements; ++i)
+        {
+            const auto& element = inputLayout.pInputElementDescs[i];
+            AddString(element.SemanticName);
+            Add(element.SemanticIndex);
+            Add(element.Format);
+            Add(element.InputSlot);
+            Add(element.AlignedByteOffset);
+            Add(element.InputSlotClass);
+            Add(element.InstanceDataStepRate);
+        }
+    }
+
+    void IBStripCutValueCb(D3D12_INDEX_BUFFER_STRIP_CUT_VALUE value) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE);
+        Add(value);
+    }
+
+    void PrimitiveTopologyTypeCb(D3D12_PRIMITIVE_TOPOLOGY_TYPE topologyType) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY);
+        Add(topologyType);
+    }
+
+    void VSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS, shader);
+    }
+
+    void GSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS, shader);
+    }
+
+    void StreamOutputCb(const D3D12_STREAM_OUTPUT_DESC& streamOutput) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT);
+        Add(streamOutput.NumEntries);
+        for (UINT i = 0; i < streamOutput.NumEntries; ++i)
+        {
+            const auto& entry = streamOutput.pSODeclaration[i];
+            Add(entry.Stream);
+            AddString(entry.SemanticName);
+            Add(entry.SemanticIndex);
+            Add(entry.StartComponent);
+            Add(entry.ComponentCount);
+            Add(entry.OutputSlot);
+        }
+        Add(streamOutput.NumStrides);
+        for (UINT i = 0; i < streamOutput.NumStrides; ++i)
+        {
+            Add(streamOutput.pBufferStrides[i]);
+        }
+        Add(streamOutput.RasterizedStream);
+    }
+
+    void HSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS, shader);
+    }
+
+    void DSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS, shader);
+    }
+
+    void PSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, shader);
+    }
+
+    void CSCb(const D3D12_SHADER_BYTECODE& shader) override
+    {
+        AddShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS, shader);
+    }
+
+    void BlendStateCb(const D3D12_BLEND_DESC& blend) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND);
+        Add(blend.AlphaToCoverageEnable);
+        Add(blend.IndependentBlendEnable);
+        for (const auto& renderTarget : blend.RenderTarget)
+        {
+            Add(renderTarget.BlendEnable);
+            Add(renderTarget.LogicOpEnable);
+            Add(renderTarget.SrcBlend);
+            Add(renderTarget.DestBlend);
+            Add(renderTarget.BlendOp);
+            Add(renderTarget.SrcBlendAlpha);
+            Add(renderTarget.DestBlendAlpha);
+            Add(renderTarget.BlendOpAlpha);
+            Add(renderTarget.LogicOp);
+            Add(renderTarget.RenderTargetWriteMask);
+        }
+    }
+
+    void DepthStencilStateCb(const D3D12_DEPTH_STENCIL_DESC& depthStencil) override
+    {
+        DepthStencilState1Cb(CD3DX12_DEPTH_STENCIL_DESC1(depthStencil));
+    }
+
+    void DepthStencilState1Cb(const D3D12_DEPTH_STENCIL_DESC1& depthStencil) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1);
+        Add(depthStencil.DepthEnable);
+        Add(depthStencil.DepthWriteMask);
+        Add(depthStencil.DepthFunc);
+        Add(depthStencil.StencilEnable);
+        Add(depthStencil.StencilReadMask);
+        Add(depthStencil.StencilWriteMask);
+        AddDepthStencilOp(depthStencil.FrontFace);
+        AddDepthStencilOp(depthStencil.BackFace);
+        Add(depthStencil.DepthBoundsTestEnable);
+    }
+
+    void DSVFormatCb(DXGI_FORMAT format) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT);
+        Add(format);
+    }
+
+    void RasterizerStateCb(const D3D12_RASTERIZER_DESC& rasterizer) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER);
+        Add(rasterizer.FillMode);
+        Add(rasterizer.CullMode);
+        Add(rasterizer.FrontCounterClockwise);
+        Add(rasterizer.DepthBias);
+        Add(rasterizer.DepthBiasClamp);
+        Add(rasterizer.SlopeScaledDepthBias);
+        Add(rasterizer.DepthClipEnable);
+        Add(rasterizer.MultisampleEnable);
+        Add(rasterizer.AntialiasedLineEnable);
+        Add(rasterizer.ForcedSampleCount);
+        Add(rasterizer.ConservativeRaster);
+    }
+
+    void RTVFormatsCb(const D3D12_RT_FORMAT_ARRAY& formats) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS);
+        Add(formats.NumRenderTargets);
+        for (UINT i = 0; i < formats.NumRenderTargets && i < 8; ++i)
+        {
+            Add(formats.RTFormats[i]);
+        }
+    }
+
+    void SampleDescCb(const DXGI_SAMPLE_DESC& sampleDesc) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC);
+        Add(sampleDesc.Count);
+        Add(sampleDesc.Quality);
+    }
+
+    void SampleMaskCb(UINT sampleMask) override
+    {
+        Add(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK);
+        Add(sampleMask);
+    }
+
+    // A cached blob does not change the pipeline, so it's not part of the key.
+    void CachedPSOCb(const D3D12_CACHED_PIPELINE_STATE&) override {}
+
+    void ErrorBadInputParameter(UINT) override
+    {
+        Valid = false;
+    }
+
+    void ErrorDuplicateSubobject(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE) override
+    {
+        Valid = false;
+    }
+
+    void ErrorUnknownSubobject(UINT) override
+    {
+        Valid = false;
+    }
+};
+
+std::wstring GetPipelineName(u64 key)
+{
+    wchar_t name[17];
+    swprintf_s(name, L"%016llx", static_cast<unsigned long long>(key));
+    return name;
+}
+}  // namespace
+
+PipelineStateCache::PipelineStateCache(Device& device, const fs::path& path)
+    : m_Device(device)
+    , m_Path(path)
+    , m_LibraryDirty(false)
+    , m_NumActiveCalls(0)
+{
+    m_Logger = Application::CreateLogger("PipelineStateCache");
+    Load();
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    Save();
+}
+
+bool PipelineStateCache::HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, u64& hash)
+{
+    std::vector<u8>  contents;
+    std::vector<u64> shaderHashes;
+    return HashPipelineStateStream(desc, hash, contents, shaderHashes);
+}
+
+bool PipelineStateCache::HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, u64& hash,
+    std::vector<u8>& contents, std::vector<u64>& shaderHashes)
+{
+    PipelineStateStreamHasher hasher;
+    if (FAILED(D3DX12ParsePipelineStream(desc, &hasher)) || !hasher.Valid)
+    {
+        return false;
+    }
+
+    hash = hasher.Hash;
+    contents = std::move(hasher.Contents);
+    shaderHashes = std::move(hasher.ShaderHashes);
+    return true;
+}
+
+std::shared_ptr<PipelineStateObject> PipelineStateCache::GetOrCreate(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+    ++m_NumActiveCalls;
+    struct ActiveCall
+    {
+        std::atomic_uint32_t& NumActiveCalls;
+        ~ActiveCall()
+        {
+            --NumActiveCalls;
+        }
+    } activeCall{ m_NumActiveCalls };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto addTime = [&]() {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        m_Statistics.TotalMilliseconds += elapsed.count();
+    };
+
+    u64              key = 0;
+    std::vector<u8>  contents;
+    std::vector<u64> shaderHashes;
+    if (!HashPipelineStateStream(desc, key, contents, shaderHashes))
+    {
+        auto pipelineStateObject = MakeRef<PipelineStateObject>(m_Device, desc);
+
+        scoped_lock lock(m_Mutex);
+        ++m_Statistics.NumUncached;
+        addTime();
+        return pipelineStateObject;
+    }
+
+    ComPtr<ID3D12PipelineLibrary1> library;
+    bool                           collision = false;
+    {
+        scoped_lock lock(m_Mutex);
+
+        auto iter = m_PipelineStates.find(key);
+        if (iter != m_PipelineStates.end())
+        {
+            if (iter->second.Contents == contents)
+            {
+                ++m_Statistics.NumMemoryHits;
+                addTime();
+                return iter->second.Pipeline;
+            }
+
+            collision = true;
+        }
+
+        library = m_Library;
+    }
+
+    if (collision)
+    {
+        // Two different streams with the same hash. The second one is not cached.
+        m_Logger->warn("Pipeline state hash collision ({:016x}), creating an uncached pipeline.", key);
+        auto pipelineStateObject = MakeRef<PipelineStateObject>(m_Device, desc);
+
+        scoped_lock lock(m_Mutex);
+        ++m_Statistics.NumCollisions;
+        addTime();
+        return pipelineStateObject;
+    }
+
+    // Loading or compiling a pipeline can take a while, so it's done without holding the lock.
+    std::wstring                 name = GetPipelineName(key);
+    ComPtr<ID3D12PipelineState> d3d12PipelineState;
+    bool                         loaded = library && SUCCEEDED(library->LoadPipeline(name.c_str(), &desc,
+                                                 IID_PPV_ARGS(&d3d12PipelineState)));
+
+    std::shared_ptr<PipelineStateObject> pipelineStateObject =
+        loaded ? MakeRef<PipelineStateObject>(m_Device, d3d12PipelineState)
+               : MakeRef<PipelineStateObject>(m_Device, desc);
+
+    scoped_lock lock(m_Mutex);
+
+    // Another thread may have created the same pipeline (or a colliding one) in the meantime.
+    auto iter = m_PipelineStates.find(key);
+    if (iter != m_PipelineStates.end())
+    {
+        if (iter->second.Contents != contents)
+        {
+            ++m_Statistics.NumCollisions;
+            addTime();
+            return pipelineStateObject;
+        }
+
+        ++m_Statistics.NumMemoryHits;
+        addTime();
+        return iter->second.Pipeline;
+    }
+
+    m_PipelineStates.emplace(key, Entry { pipelineStateObject, std::move(contents), std::move(shaderHashes) });
+
+    if (loaded)
+    {
+        ++m_Statistics.NumLibraryHits;
+    }
+    else
+    {
+        ++m_Statistics.NumCompiled;
+
+        // The library may have been replaced by Save while the pipeline was compiled.
+        if (m_Library && SUCCEEDED(m_Library->StorePipeline(name.c_str(),
+                             pipelineStateObject->GetD3D12PipelineState().Get())))
+        {
+            m_LibraryKeys.push_back(key);
+            m_LibraryDirty = true;
+        }
+    }
+
+    addTime();
+    return pipelineStateObject;
+}
+
+void PipelineStateCache::EvictShader(const D3D12_SHADER_BYTECODE& shader)
+{
+    if (!shader.pShaderBytecode)
+    {
+        return;
+    }
+
+    u64 shaderHash = HashBytes(shader.pShaderBytecode, shader.BytecodeLength);
+
+    scoped_lock lock(m_Mutex);
+
+    size_t numEvicted = std::erase_if(m_PipelineStates, [shaderHash](const auto& keyAndEntry) {
+        const std::vector<u64>& shaderHashes = keyAndEntry.second.ShaderHashes;
+        return std::find(shaderHashes.begin(), shaderHashes.end(), shaderHash) != shaderHashes.end();
+    });
+
+    if (numEvicted > 0)
+    {
+        m_Logger->debug("Evicted {} pipelines of a reloaded shader.", numEvicted);
+    }
+}
+
+PipelineStateCache::Statistics PipelineStateCache::GetStatistics() const
+{
+    scoped_lock lock(m_Mutex);
+    return m_Statistics;
+}
+
+void PipelineStateCache::GetDriverIdentity(u32 identity[4], u64& driverVersion) const
+{
+    auto dxgiAdapter = m_Device.GetAdapter()->GetDXGIAdapter();
+
+    // Doesn't throw, since it's also used by Save in the destructor.
+    DXGI_ADAPTER_DESC3 desc = {};
+    dxgiAdapter->GetDesc3(&desc);
+    identity[0] = desc.VendorId;
+    identity[1] = desc.DeviceId;
+    identity[2] = desc.SubSysId;
+    identity[3] = desc.Revision;
+
+    // The user mode driver version. The runtime also rejects libraries from a different driver,
+    // but checking up front avoids reading the library at all.
+    LARGE_INTEGER umdVersion = {};
+    driverVersion = SUCCEEDED(dxgiAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion))
+                        ? static_cast<u64>(umdVersion.QuadPart)
+                        : 0;
+}
+
+ComPtr<ID3D12PipelineLibrary1> PipelineStateCache::CreateLibrary(const void* data, size_t size) const
+{
+    ComPtr<ID3D12PipelineLibrary1> library;
+
+    HRESULT hr = m_Device.GetD3D12Device()->CreatePipelineLibrary(data, size, IID_PPV_ARGS(&library));
+    if (FAILED(hr))
+    {
+        // D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND or E_INVALIDARG for a
+        // corrupt library. DXGI_ERROR_UNSUPPORTED if pipeline libraries are not supported at all.
+        return nullptr;
+    }
+
+    return library;
+}
+
+void PipelineStateCache::Load()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    u32 identity[4];
+    u64 driverVersion;
+    GetDriverIdentity(identity, driverVersion);
+
+    std::error_code error;
+    u64             fileSize = fs::file_size(m_Path, error);
+
+    std::ifstream file(m_Path, std::ios::in | std::ios::binary);
+    if (file && !error)
+    {
+        CacheFileHeader header = {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        // The sizes in the header are checked against the file before anything is allocated, so a
+        // truncated or corrupt file is discarded instead of causing a huge allocation.
+        u64  payloadSize = file ? fileSize - sizeof(header) : 0;
+        bool sizesValid = file && header.NumKeys <= payloadSize / sizeof(u64) &&
+                          header.LibrarySize == payloadSize - header.NumKeys * sizeof(u64);
+
+        bool valid = sizesValid && header.Magic == CacheFileMagic && header.Version == CacheFileVersion &&
+                     memcmp(header.AdapterIdentity, identity, sizeof(identity)) == 0 &&
+                     header.DriverVersion == driverVersion;
+
+        if (valid)
+        {
+            m_LibraryKeys.resize(header.NumKeys);
+            m_LibraryData.resize(header.LibrarySize);
+            file.read(reinterpret_cast<char*>(m_LibraryKeys.data()), m_LibraryKeys.size() * sizeof(u64));
+            file.read(reinterpret_cast<char*>(m_LibraryData.data()), m_LibraryData.size());
+            valid = static_cast<bool>(file);
+        }
+
+        if (valid)
+        {
+            m_Library = CreateLibrary(m_LibraryData.data(), m_LibraryData.size());
+        }
+
+        if (m_Library)
+        {
+            m_Logger->info("Loaded {} pipelines from the pipeline state cache {}.", m_LibraryKeys.size(),
+                m_Path.string());
+        }
+        else if (!sizesValid)
+        {
+            m_Logger->warn("Discarding the pipeline state cache {}: its size doesn't match its header.",
+                m_Path.string());
+        }
+        else
+        {
+            m_Logger->warn("Discarding the pipeline state cache {}: it was written by a different adapter, driver "
+                         "or engine version.", m_Path.string());
+        }
+    }
+
+    if (!m_Library)
+    {
+        m_LibraryKeys.clear();
+        m_LibraryData.clear();
+        m_Library = CreateLibrary(nullptr, 0);
+
+        if (!m_Library)
+        {
+            m_Logger->warn("Pipeline libraries are not supported. Pipelines are only shared in memory.");
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    m_Statistics.LoadMilliseconds = elapsed.count();
+}
+
+void PipelineStateCache::Save()
+{
+    // The library that a running GetOrCreate holds may be released below (see the declaration).
+    assert(m_NumActiveCalls == 0 && "PipelineStateCache is destroyed while pipelines are created.");
+
+    scoped_lock lock(m_Mutex);
+
+    m_Logger->info("Pipeline state cache: {} compiled, {} loaded from disk, {} shared, {} not cacheable, "
+                 "{} mismatched, {:.2f} ms loading the cache, {:.2f} ms creating pipelines.",
+        m_Statistics.NumCompiled, m_Statistics.NumLibraryHits, m_Statistics.NumMemoryHits,
+        m_Statistics.NumUncached, m_Statistics.NumCollisions, m_Statistics.LoadMilliseconds,
+        m_Statistics.TotalMilliseconds);
+
+    if (!m_Library)
+    {
+        return;
+    }
+
+    // Pipelines can't be removed from a library. If it holds pipelines that were not used during
+    // this run (for example because a shader changed), it's rebuilt from the pipelines that were.
+    bool hasStalePipelines = std::any_of(m_LibraryKeys.begin(), m_LibraryKeys.end(),
+        [this](u64 key) { return m_PipelineStates.find(key) == m_PipelineStates.end(); });
+
+    if (hasStalePipelines && !m_PipelineStates.empty())
+    {
+        auto library = CreateLibrary(nullptr, 0);
+        if (!library)
+        {
+            return;
+        }
+
+        m_LibraryKeys.clear();
+        for (const auto& [key, entry] : m_PipelineStates)
+        {
+            if (SUCCEEDED(library->StorePipeline(GetPipelineName(key).c_str(),
+                    entry.Pipeline->GetD3D12PipelineState().Get())))
+            {
+                m_LibraryKeys.push_back(key);
+            }
+        }
+
+        m_Library = library;
+        m_LibraryData.clear();
+        m_LibraryDirty = true;
+    }
+
+    if (!m_LibraryDirty)
+    {
+        return;
+    }
+
+    std::vector<u8> data(m_Library->GetSerializedSize());
+    if (FAILED(m_Library->Serialize(data.data(), data.size())))
+    {
+        m_Logger->warn("Failed to serialize the pipeline state cache.");
+        return;
+    }
+
+    CacheFileHeader header = {};
+    header.Magic = CacheFileMagic;
+    header.Version = CacheFileVersion;
+    GetDriverIdentity(header.AdapterIdentity, header.DriverVersion);
+    header.NumKeys = m_LibraryKeys.size();
+    header.LibrarySize = data.size();
+
+    // Write to a temporary file first so an interrupted write doesn't leave a corrupt cache behind.
+    std::error_code error;
+    fs::create_directories(m_Path.parent_path(), error);
+
+    fs::path tempPath = m_Path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_LibraryKeys.data()), m_LibraryKeys.size() * sizeof(u64));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)
+        {
+            m_Logger->warn("Failed to write the pipeline state cache {}.", tempPath.string());
+            return;
+        }
+    }
+
+    fs::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        m_Logger->warn("Failed to write the pipeline state cache {}: {}", m_Path.string(), error.message());
+        return;
+    }
+
+    m_LibraryDirty = false;
+    m_Logger->info("Wrote {} pipelines ({} bytes) to the pipeline state cache {}.", m_LibraryKeys.size(),
+        data.size(), m_Path.string());
+}
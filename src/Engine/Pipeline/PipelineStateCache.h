@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+class PipelineStateObject;
+
+/**
+ * Cache of pipeline state objects, in memory and on disk.
+ *
+ * Pipelines are keyed by a hash of the contents of their pipeline state stream:
+ * the serialized root signature, the shader bytecode, the input layout and the
+ * fixed function state. Streams with the same key share a PipelineStateObject.
+ * A hash is not proof of equality: the hashed contents are kept with each pipeline
+ * and compared on a hit, and the runtime checks the stream of a pipeline that is
+ * loaded from the library.
+ *
+ * Compiled pipelines are stored in an ID3D12PipelineLibrary that is written to
+ * disk when the cache is destroyed and loaded again on the next run, so a warm
+ * start does not have to wait for the driver to compile the pipelines. The file
+ * is discarded if the adapter, the driver version or the file version changed, or
+ * if its size doesn't match its header.
+ * A changed shader changes the key of its pipelines. The pipelines of the previous
+ * bytecode of a reloaded shader are evicted (see EvictShader), and pipelines that
+ * are not in the cache anymore are dropped when the library is written back.
+ */
+class PipelineStateCache
+{
+public:
+    struct Statistics
+    {
+        // Streams that returned an existing PipelineStateObject.
+        u32 NumMemoryHits = 0;
+        // Pipelines that were loaded from the pipeline library.
+        u32 NumLibraryHits = 0;
+        // Pipelines that were compiled by the driver.
+        u32 NumCompiled = 0;
+        // Streams that can't be hashed (for example, a root signature that was not created by RootSignature).
+        u32 NumUncached = 0;
+        // Streams whose key matched a pipeline with different contents.
+        u32 NumCollisions = 0;
+        // Time spent in GetOrCreate.
+        double TotalMilliseconds = 0.0;
+        // Time spent reading the cache file and creating the library from it.
+        double LoadMilliseconds = 0.0;
+    };
+
+    PipelineStateCache(Device& device, const fs::path& path);
+    ~PipelineStateCache();
+
+    PipelineStateCache(const PipelineStateCache&) = delete;
+    PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+
+    /**
+     * Get the pipeline state object of a pipeline state stream. The pipeline is
+     * loaded from the library or compiled if it is not in the cache yet.
+     * Thread safe.
+     */
+    std::shared_ptr<PipelineStateObject> GetOrCreate(const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+
+    /**
+     * Remove the pipelines that use the given shader bytecode, for example the previous
+     * version of a hot reloaded shader. Pipeline state objects that are still referenced
+     * stay alive, but they are not returned by GetOrCreate or written to disk anymore.
+     * Thread safe.
+     */
+    void EvictShader(const D3D12_SHADER_BYTECODE& shader);
+
+    Statistics GetStatistics() const;
+
+    /**
+     * Hash the contents of a pipeline state stream.
+     * @returns false if the stream can't be hashed.
+     */
+    static bool HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, u64& hash);
+    /**
+     * Hash the contents of a pipeline state stream, and return the hashed contents and the hashes
+     * of the bytecode of each of its shaders.
+     * @returns false if the stream can't be hashed.
+     */
+    static bool HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, u64& hash,
+        std::vector<u8>& contents, std::vector<u64>& shaderHashes);
+
+private:
+    /**
+     * Write the pipeline library to disk, if pipelines were added to it or pipelines
+     * that were not used during this run have to be dropped.
+     * Only called by the destructor: rebuilding the library releases the data of the
+     * loaded library, which a concurrent GetOrCreate may still be loading a pipeline
+     * from. Asserts that no GetOrCreate is running.
+     */
+    void Save();
+
+    struct Entry
+    {
+        std::shared_ptr<PipelineStateObject> Pipeline;
+        // The hashed contents of the stream, compared on a hit since the key is only a hash.
+        std::vector<u8> Contents;
+        // The hashes of the bytecode of the shaders of the pipeline.
+        std::vector<u64> ShaderHashes;
+    };
+
+    // Load the library from disk, or create an empty library.
+    void Load();
+
+    // Create a library from serialized data (or an empty library if size is 0).
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary1> CreateLibrary(const void* data, size_t size) const;
+
+    // Identifies the driver that the library was compiled with.
+    void GetDriverIdentity(u32 identity[4], u64& driverVersion) const;
+
+    Device&                m_Device;
+    fs::path               m_Path;
+    RefPtr<spdlog::logger> m_Logger;
+
+    mutable std::mutex m_Mutex;
+
+    // Null if pipeline libraries are not supported, in which case the cache only shares
+    // pipelines in memory.
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary1> m_Library;
+    // The serialized library that m_Library was created from. Must outlive the library.
+    std::vector<u8> m_LibraryData;
+    // The keys of the pipelines in m_Library.
+    std::vector<u64> m_LibraryKeys;
+    // True if pipelines were added to the library since it was loaded.
+    bool m_LibraryDirty;
+
+    // The pipelines that were used during this run, minus the evicted ones.
+    std::unordered_map<u64, Entry> m_PipelineStates;
+
+    // The number of GetOrCreate calls that are running, to assert that Save isn't called concurrently.
+    std::atomic_uint32_t m_NumActiveCalls;
+
+    Statistics m_Statistics;
+};
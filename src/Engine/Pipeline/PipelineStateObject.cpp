@@ -9,4 +9,11 @@ PipelineStateObject::PipelineStateObject(Device& device, const D3D12_PIPELINE_ST
     auto d3d12Device = device.GetD3D12Device();
 
     ThrowIfFailed( d3d12Device->CreatePipelineState( &desc, IID_PPV_ARGS( &m_d3d12PipelineState ) ) );
-}
\ No newline at end of file
+}
+
+PipelineStateObject::PipelineStateObject(Device& device, Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState)
+    : m_Device(device)
+    , m_d3d12PipelineState(pipelineState)
+{
+    assert(m_d3d12PipelineState);
+}
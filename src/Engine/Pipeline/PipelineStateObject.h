@@ -13,6 +13,8 @@ public:
     }
 
     PipelineStateObject( Device& device, const D3D12_PIPELINE_STATE_STREAM_DESC& desc );
+    // Wrap a pipeline state that was loaded from a pipeline library.
+    PipelineStateObject( Device& device, Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState );
     virtual ~PipelineStateObject() = default;
 
 private:
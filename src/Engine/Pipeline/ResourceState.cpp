@@ -0,0 +1,119 @@
+#include "enginepch.h"
+
+#include "ResourceState.h"
+
+void ResourceState::SetSubresourceState(UINT subresource, D3D12_RESOURCE_STATES state)
+{
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+    {
+        m_State = state;
+        m_NumSubresources = 0;
+        // clear() keeps the capacity so the next per-subresource transition doesn't allocate.
+        m_OverflowStates.clear();
+    }
+    else
+    {
+        // Grow the slot array and mark new slots as inheriting the resource state.
+        while (m_NumSubresources <= subresource)
+        {
+            if (m_NumSubresources >= InlineSubresources)
+            {
+                m_OverflowStates.push_back(UnknownState);
+            }
+            else
+            {
+                m_InlineStates[m_NumSubresources] = UnknownState;
+            }
+            ++m_NumSubresources;
+        }
+
+        GetSlot(subresource) = static_cast<u32>(state);
+    }
+}
+
+ResourceStateMap::ResourceStateMap(size_t initialCapacity)
+    : m_Entries(Math::NextHighestPow2(static_cast<u64>(std::max<size_t>(initialCapacity, 8))))
+    , m_Size(0)
+{}
+
+size_t ResourceStateMap::FindSlot(ID3D12Resource* resource) const
+{
+    const size_t mask = m_Entries.size() - 1;
+    size_t       slot = Hash(resource) & mask;
+
+    // The load factor is kept below 1, so there is always an empty slot to stop the probe.
+    while (m_Entries[slot].Resource != nullptr && m_Entries[slot].Resource != resource)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+ResourceState* ResourceStateMap::Find(ID3D12Resource* resource)
+{
+    auto& entry = m_Entries[FindSlot(resource)];
+    return entry.Resource != nullptr ? &entry.State : nullptr;
+}
+
+const ResourceState* ResourceStateMap::Find(ID3D12Resource* resource) const
+{
+    const auto& entry = m_Entries[FindSlot(resource)];
+    return entry.Resource != nullptr ? &entry.State : nullptr;
+}
+
+ResourceState& ResourceStateMap::operator[](ID3D12Resource* resource)
+{
+    assert(resource);
+
+    size_t slot = FindSlot(resource);
+    if (m_Entries[slot].Resource == nullptr)
+    {
+        // Keep the load factor at or below 3/4.
+        if ((m_Size + 1) * 4 > m_Entries.size() * 3)
+        {
+            Grow();
+            slot = FindSlot(resource);
+        }
+
+        auto& entry = m_Entries[slot];
+        entry.Resource = resource;
+        // Reuse the slot's storage from a previous Clear.
+        entry.State.SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_STATE_COMMON);
+        ++m_Size;
+    }
+
+    return m_Entries[slot].State;
+}
+
+void ResourceStateMap::Clear()
+{
+    if (m_Size > 0)
+    {
+        for (auto& entry : m_Entries)
+        {
+            entry.Resource = nullptr;
+        }
+        m_Size = 0;
+    }
+}
+
+void ResourceStateMap::Grow()
+{
+    std::vector<Entry> oldEntries(m_Entries.size() * 2);
+    std::swap(oldEntries, m_Entries);
+
+    const size_t mask = m_Entries.size() - 1;
+    for (auto& oldEntry : oldEntries)
+    {
+        if (oldEntry.Resource != nullptr)
+        {
+            size_t slot = Hash(oldEntry.Resource) & mask;
+            while (m_Entries[slot].Resource != nullptr)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_Entries[slot] = std::move(oldEntry);
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vector>
+
+/**
+    * Tracks the state of a particular resource and all of its subresources.
+    *
+    * If no subresource has been set explicitly, the resource state defines the
+    * state of all of the subresources and no storage is used. Explicitly set
+    * subresource states (mips, array slices) are stored in a flat array indexed
+    * by subresource. The first InlineSubresources entries live inside the
+    * object so typical mip chains never touch the heap.
+    */
+class ResourceState
+{
+public:
+    // Marks a subresource slot that has not been set and inherits the resource state.
+    // Slots are stored as u32 since this value is outside the range of D3D12_RESOURCE_STATES.
+    static constexpr u32 UnknownState = ~0u;
+    // Number of subresource states stored without a heap allocation.
+    static constexpr u32 InlineSubresources = 16;
+
+    // Initialize all of the subresources within a resource to the given state.
+    explicit ResourceState(D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON)
+        : m_State(state)
+        , m_NumSubresources(0)
+        , m_InlineStates{}
+    {}
+
+    // Set a subresource to a particular state.
+    void SetSubresourceState(UINT subresource, D3D12_RESOURCE_STATES state);
+
+    // Get the state of a (sub)resource within the resource.
+    // If the specified subresource has not been set explicitly then the state of
+    // the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is returned.
+    D3D12_RESOURCE_STATES GetSubresourceState(UINT subresource) const
+    {
+        if (subresource < m_NumSubresources)
+        {
+            u32 state = GetSlot(subresource);
+            if (state != UnknownState)
+            {
+                return static_cast<D3D12_RESOURCE_STATES>(state);
+            }
+        }
+        return m_State;
+    }
+
+    // Returns true if any subresource has been set explicitly.
+    bool HasSubresourceStates() const
+    {
+        return m_NumSubresources > 0;
+    }
+
+    // Invoke func(subresource, state) for every explicitly set subresource,
+    // in ascending subresource order.
+    template<typename Func>
+    void ForEachSubresourceState(Func&& func) const
+    {
+        for (u32 i = 0; i < m_NumSubresources; ++i)
+        {
+            u32 state = GetSlot(i);
+            if (state != UnknownState)
+            {
+                func(static_cast<UINT>(i), static_cast<D3D12_RESOURCE_STATES>(state));
+            }
+        }
+    }
+
+private:
+    u32 GetSlot(u32 subresource) const
+    {
+        return subresource < InlineSubresources ? m_InlineStates[subresource]
+                                                : m_OverflowStates[subresource - InlineSubresources];
+    }
+
+    u32& GetSlot(u32 subresource)
+    {
+        return subresource < InlineSubresources ? m_InlineStates[subresource]
+                                                : m_OverflowStates[subresource - InlineSubresources];
+    }
+
+    // The state of all subresources that have not been set explicitly.
+    D3D12_RESOURCE_STATES m_State;
+    // The number of subresource slots in use. Zero if all subresources are in m_State.
+    u32 m_NumSubresources;
+
+    u32              m_InlineStates[InlineSubresources];
+    std::vector<u32> m_OverflowStates;
+};
+
+/**
+    * Open addressing (linear probing) hash map from a D3D12 resource to its
+    * tracked state. Entries are never erased individually; Clear empties the
+    * map but keeps its storage, so a command list that is reset every frame
+    * stops allocating once it has seen its working set.
+    */
+class ResourceStateMap
+{
+public:
+    explicit ResourceStateMap(size_t initialCapacity = 64);
+
+    /**
+        * Find the state of a resource.
+        * @return nullptr if the resource is not in the map.
+        */
+    ResourceState*       Find(ID3D12Resource* resource);
+    const ResourceState* Find(ID3D12Resource* resource) const;
+
+    /**
+        * Get the state of a resource, inserting a default (COMMON) state if the
+        * resource is not in the map yet.
+        * The returned reference is invalidated by the next insertion.
+        */
+    ResourceState& operator[](ID3D12Resource* resource);
+
+    /**
+        * Invoke func(resource, state) for every resource in the map.
+        */
+    template<typename Func>
+    void ForEach(Func&& func) const
+    {
+        for (const auto& entry : m_Entries)
+        {
+            if (entry.Resource != nullptr)
+            {
+                func(entry.Resource, entry.State);
+            }
+        }
+    }
+
+    size_t Size() const
+    {
+        return m_Size;
+    }
+
+    bool Empty() const
+    {
+        return m_Size == 0;
+    }
+
+    /**
+        * Remove all entries without releasing memory.
+        */
+    void Clear();
+
+    static u64 Hash(ID3D12Resource* resource)
+    {
+        // Pointers are at least 8-byte aligned; mix the bits so the low bits are usable.
+        u64 h = reinterpret_cast<u64>(resource);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    struct Entry
+    {
+        ID3D12Resource* Resource = nullptr;
+        ResourceState   State;
+    };
+
+    size_t FindSlot(ID3D12Resource* resource) const;
+    void   Grow();
+
+    // Power of two number of slots.
+    std::vector<Entry> m_Entries;
+    size_t             m_Size;
+};
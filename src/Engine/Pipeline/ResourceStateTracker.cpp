@@ -6,54 +6,140 @@
 #include <Memory/WrappedResource.h>
 
 // Static definitions.
-std::mutex                             ResourceStateTracker::ms_GlobalMutex;
-bool                                   ResourceStateTracker::ms_IsLocked = false;
-ResourceStateTracker::ResourceStateMap ResourceStateTracker::ms_GlobalResourceState;
+ResourceStateTracker::GlobalStateShard ResourceStateTracker::ms_GlobalResourceState[NumGlobalStateShards];
 //ResourceStateTracker::ResourceList     ResourceStateTracker::ms_GarbageResources;
 
-ResourceStateTracker::ResourceStateTracker() {}
+std::mutex                              ResourceStateTracker::ms_StatisticsMutex;
+ResourceStateTracker::BarrierStatistics ResourceStateTracker::ms_FrameStatistics;
+ResourceStateTracker::BarrierStatistics ResourceStateTracker::ms_LastFrameStatistics;
+
+ResourceStateTracker::ResourceStateTracker(D3D12_COMMAND_LIST_TYPE type)
+    : m_CommandListType(type)
+{}
 
 ResourceStateTracker::~ResourceStateTracker() {}
 
+bool ResourceStateTracker::IsReadOnlyState(D3D12_RESOURCE_STATES state)
+{
+    constexpr D3D12_RESOURCE_STATES readOnlyStates =
+        D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+    // COMMON (0) is not a read state; it is the state resources decay to.
+    return state != D3D12_RESOURCE_STATE_COMMON && (state & ~readOnlyStates) == 0;
+}
+
+D3D12_RESOURCE_STATES ResourceStateTracker::PushTransition(const D3D12_RESOURCE_BARRIER& barrier,
+    D3D12_RESOURCE_STATES stateBefore)
+{
+    D3D12_RESOURCE_STATES stateAfter = barrier.Transition.StateAfter;
+
+    if (stateAfter == stateBefore)
+    {
+        ++m_Statistics.NumNoOp;
+        return stateBefore;
+    }
+
+    if (IsReadOnlyState(stateBefore) && IsReadOnlyState(stateAfter))
+    {
+        // The (sub)resource is already readable in the requested state(s).
+        if ((stateAfter & ~stateBefore) == 0)
+        {
+            ++m_Statistics.NumNoOp;
+            return stateBefore;
+        }
+
+        // Transition to the combined read state so switching back doesn't need another barrier.
+        if (m_CommandListType == D3D12_COMMAND_LIST_TYPE_DIRECT)
+        {
+            ++m_Statistics.NumReadMerged;
+            stateAfter |= stateBefore;
+            m_MergedResources.push_back(barrier.Transition.pResource);
+        }
+    }
+
+    D3D12_RESOURCE_BARRIER newBarrier = barrier;
+    newBarrier.Transition.StateBefore = stateBefore;
+    newBarrier.Transition.StateAfter = stateAfter;
+    m_ResourceBarriers.push_back(newBarrier);
+
+    return stateAfter;
+}
+
+bool ResourceStateTracker::EndSplitTransitions(ID3D12Resource* resource)
+{
+    bool ended = false;
+
+    for (size_t i = 0; i < m_SplitBarriers.size();)
+    {
+        if (resource == nullptr || m_SplitBarriers[i].Transition.pResource == resource)
+        {
+            m_ResourceBarriers.push_back(m_SplitBarriers[i]);
+            m_SplitBarriers[i] = m_SplitBarriers.back();
+            m_SplitBarriers.pop_back();
+            ended = true;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    return ended;
+}
+
+void ResourceStateTracker::EndSplitTransitions()
+{
+    EndSplitTransitions(nullptr);
+}
+
 void ResourceStateTracker::ResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier)
 {
+    ++m_Statistics.NumRequested;
+
     if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
     {
         const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
 
+        // A split transition of the resource must end before it can be used (or transitioned) again.
+        // The final state of the resource is already the state after the split transition.
+        bool endedSplit = EndSplitTransitions(transitionBarrier.pResource);
+
+        D3D12_RESOURCE_STATES stateAfter = transitionBarrier.StateAfter;
+
         // First check if there is already a known "final" state for the given resource.
         // If there is, the resource has been used on the command list before and
         // already has a known state within the command list execution.
-        const auto iter = m_FinalResourceState.find(transitionBarrier.pResource);
-        if (iter != m_FinalResourceState.end())
+        ResourceState* resourceState = m_FinalResourceState.Find(transitionBarrier.pResource);
+        if (resourceState != nullptr)
         {
-            auto& resourceState = iter->second;
             // If the known final state of the resource is different...
             if (transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                !resourceState.SubresourceState.empty())
+                resourceState->HasSubresourceStates())
             {
                 // First transition all of the subresources if they are different than the StateAfter.
-                for (auto subresourceState : resourceState.SubresourceState)
-                {
-                    if (transitionBarrier.StateAfter != subresourceState.second)
+                resourceState->ForEachSubresourceState([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState) {
+                    if (transitionBarrier.StateAfter != subresourceState)
                     {
                         D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                        newBarrier.Transition.Subresource = subresourceState.first;
-                        newBarrier.Transition.StateBefore = subresourceState.second;
+                        newBarrier.Transition.Subresource = subresource;
+                        newBarrier.Transition.StateBefore = subresourceState;
                         m_ResourceBarriers.push_back(newBarrier);
                     }
-                }
+                });
+                resourceState->SetSubresourceState(transitionBarrier.Subresource, stateAfter);
             }
             else
             {
-                auto finalState = resourceState.GetSubresourceState(transitionBarrier.Subresource);
-                if (transitionBarrier.StateAfter != finalState)
+                auto finalState = resourceState->GetSubresourceState(transitionBarrier.Subresource);
+                if (endedSplit && stateAfter == finalState)
                 {
-                    // Push a new transition barrier with the correct before state.
-                    D3D12_RESOURCE_BARRIER newBarrier = barrier;
-                    newBarrier.Transition.StateBefore = finalState;
-                    m_ResourceBarriers.push_back(newBarrier);
+                    // The split transition already performed this transition.
+                    return;
                 }
+
+                // Push a new transition barrier with the correct before state (if needed).
+                stateAfter = PushTransition(barrier, finalState);
+                resourceState->SetSubresourceState(transitionBarrier.Subresource, stateAfter);
             }
         }
         else  // In this case, the resource is being used on the command list for the first time.
@@ -61,19 +147,49 @@ void ResourceStateTracker::ResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier
             // Add a pending barrier. The pending barriers will be resolved
             // before the command list is executed on the command queue.
             m_PendingResourceBarriers.push_back(barrier);
-        }
 
-        // Push the final known state (possibly replacing the previously known state for the subresource).
-        m_FinalResourceState[transitionBarrier.pResource].SetSubresourceState(transitionBarrier.Subresource,
-            transitionBarrier.StateAfter);
+            // Push the final known state.
+            m_FinalResourceState[transitionBarrier.pResource].SetSubresourceState(transitionBarrier.Subresource,
+                stateAfter);
+        }
     }
     else
     {
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+        {
+            // A NULL UAV barrier covers all resources.
+            EndSplitTransitions(barrier.UAV.pResource);
+        }
+        else
+        {
+            EndSplitTransitions(barrier.Aliasing.pResourceBefore);
+            if (barrier.Aliasing.pResourceAfter != barrier.Aliasing.pResourceBefore)
+            {
+                EndSplitTransitions(barrier.Aliasing.pResourceAfter);
+            }
+        }
+
         // Just push non-transition barriers to the resource barriers array.
         m_ResourceBarriers.push_back(barrier);
     }
 }
 
+void ResourceStateTracker::ExplicitResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier)
+{
+    ++m_Statistics.NumRequested;
+
+    m_ResourceBarriers.push_back(barrier);
+}
+
+void ResourceStateTracker::SetUntrackedResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state,
+    UINT subResource)
+{
+    if (resource)
+    {
+        m_UntrackedResourceState[resource].SetSubresourceState(subResource, state);
+    }
+}
+
 void ResourceStateTracker::TransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter,
     UINT subResource)
 {
@@ -90,6 +206,48 @@ void ResourceStateTracker::TransitionResource(const Resource& resource, D3D12_RE
     TransitionResource(resource.GetD3D12Resource().Get(), stateAfter, subResource);
 }
 
+void ResourceStateTracker::BeginTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter,
+    UINT subResource)
+{
+    if (resource == nullptr)
+    {
+        return;
+    }
+
+    // Only split the transition if the state before is known within this command list.
+    // Per-subresource states are transitioned in full by the TransitionResource that follows.
+    ResourceState* resourceState = m_FinalResourceState.Find(resource);
+    if (resourceState == nullptr ||
+        (subResource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && resourceState->HasSubresourceStates()))
+    {
+        return;
+    }
+
+    EndSplitTransitions(resource);
+
+    auto stateBefore = resourceState->GetSubresourceState(subResource);
+    if (stateBefore == stateAfter)
+    {
+        return;
+    }
+
+    m_ResourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, stateAfter, subResource,
+        D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+    m_SplitBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, stateAfter, subResource,
+        D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+
+    resourceState->SetSubresourceState(subResource, stateAfter);
+
+    ++m_Statistics.NumRequested;
+    ++m_Statistics.NumSplit;
+}
+
+void ResourceStateTracker::BeginTransitionResource(const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
+    UINT subResource)
+{
+    BeginTransitionResource(resource.GetD3D12Resource().Get(), stateAfter, subResource);
+}
+
 void ResourceStateTracker::UAVBarrier(const Resource* resource)
 {
     ID3D12Resource* pResource = resource != nullptr ? resource->GetD3D12Resource().Get() : nullptr;
@@ -105,22 +263,229 @@ void ResourceStateTracker::AliasBarrier(const Resource* resourceBefore, const Re
     ResourceBarrier(CD3DX12_RESOURCE_BARRIER::Aliasing(pResourceBefore, pResourceAfter));
 }
 
+void ResourceStateTracker::RestrictMergedReadStates()
+{
+    // The read states that are also supported on compute command lists.
+    static constexpr D3D12_RESOURCE_STATES computeReadStates =
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+    auto restrictState = [this](ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES state) {
+        D3D12_RESOURCE_STATES restrictedState = state & computeReadStates;
+        if (!IsReadOnlyState(state) || restrictedState == state || restrictedState == D3D12_RESOURCE_STATE_COMMON)
+        {
+            return state;
+        }
+
+        m_ResourceBarriers.push_back(
+            CD3DX12_RESOURCE_BARRIER::Transition(resource, state, restrictedState, subresource));
+        ++m_Statistics.NumRestricted;
+        return restrictedState;
+    };
+
+    for (ID3D12Resource* resource : m_MergedResources)
+    {
+        ResourceState* resourceState = m_FinalResourceState.Find(resource);
+        if (resourceState == nullptr)
+        {
+            continue;
+        }
+
+        if (resourceState->HasSubresourceStates())
+        {
+            // The states are set after the iteration (ForEachSubresourceState is const).
+            std::vector<std::pair<UINT, D3D12_RESOURCE_STATES>> restrictedStates;
+            resourceState->ForEachSubresourceState([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState) {
+                D3D12_RESOURCE_STATES restrictedState = restrictState(resource, subresource, subresourceState);
+                if (restrictedState != subresourceState)
+                {
+                    restrictedStates.emplace_back(subresource, restrictedState);
+                }
+            });
+            for (const auto& [subresource, state] : restrictedStates)
+            {
+                resourceState->SetSubresourceState(subresource, state);
+            }
+        }
+        else
+        {
+            D3D12_RESOURCE_STATES state = resourceState->GetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+            resourceState->SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                restrictState(resource, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state));
+        }
+    }
+
+    m_MergedResources.clear();
+}
+
 void ResourceStateTracker::FlushResourceBarriers(const std::shared_ptr<CommandList>& commandList)
 {
     assert(commandList);
 
+    OptimizeResourceBarriers();
+
     UINT numBarriers = static_cast<UINT>(m_ResourceBarriers.size());
     if (numBarriers > 0)
     {
         auto d3d12CommandList = commandList->GetD3D12CommandList();
         d3d12CommandList->ResourceBarrier(numBarriers, m_ResourceBarriers.data());
         m_ResourceBarriers.clear();
+
+        m_Statistics.NumEmitted += numBarriers;
     }
 }
 
+const std::vector<D3D12_RESOURCE_BARRIER>& ResourceStateTracker::GetOptimizedResourceBarriers()
+{
+    OptimizeResourceBarriers();
+
+    return m_ResourceBarriers;
+}
+
+void ResourceStateTracker::OptimizeResourceBarriers()
+{
+    const size_t numBarriers = m_ResourceBarriers.size();
+    if (numBarriers == 0)
+    {
+        return;
+    }
+
+    m_RemovedBarriers.assign(numBarriers, false);
+
+    auto isTransition = [](const D3D12_RESOURCE_BARRIER& barrier) {
+        // Split barriers are never folded.
+        return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+               barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    };
+
+    auto references = [](const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource) {
+        switch (barrier.Type)
+        {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+            return barrier.Transition.pResource == resource;
+        case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+            return barrier.UAV.pResource == resource || barrier.UAV.pResource == nullptr;
+        default:
+            return true;  // Aliasing barriers are never reordered around.
+        }
+    };
+
+    // Fold transitions first, so the UAV barriers are only checked against the transitions that remain.
+    for (size_t i = 0; i < numBarriers; ++i)
+    {
+        auto& barrier = m_ResourceBarriers[i];
+        if (m_RemovedBarriers[i] || !isTransition(barrier))
+        {
+            continue;
+        }
+
+        auto& transition = barrier.Transition;
+        if (transition.StateBefore == transition.StateAfter)
+        {
+            m_RemovedBarriers[i] = true;
+            ++m_Statistics.NumNoOp;
+            continue;
+        }
+
+        // Fold A->B followed by B->C of the same subresource into A->C. The batch is flushed before
+        // every command, so no command uses the resource in state B. Round trips (C == A) are kept:
+        // removing both barriers would also remove the synchronization with the preceding access
+        // (e.g. UAV writes before UNORDERED_ACCESS->NON_PIXEL_SHADER_RESOURCE->UNORDERED_ACCESS).
+        // Stop at the first barrier that depends on the state of the resource in between.
+        for (size_t j = i + 1; j < numBarriers; ++j)
+        {
+            auto& next = m_ResourceBarriers[j];
+            if (m_RemovedBarriers[j] || !references(next, transition.pResource))
+            {
+                continue;
+            }
+
+            if (isTransition(next) && next.Transition.Subresource == transition.Subresource &&
+                next.Transition.StateBefore == transition.StateAfter &&
+                next.Transition.StateAfter != transition.StateBefore)
+            {
+                next.Transition.StateBefore = transition.StateBefore;
+                m_RemovedBarriers[i] = true;
+                ++m_Statistics.NumCollapsed;
+            }
+            else if (next.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+                     next.Transition.Subresource != transition.Subresource &&
+                     next.Transition.Subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+                     transition.Subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+            {
+                // Transitions of other subresources are independent.
+                continue;
+            }
+            break;
+        }
+    }
+
+    // A UAV barrier is redundant if the batch already waits for all UAV access, waits for
+    // the same resource, or transitions the whole resource after it (which waits for all
+    // preceding access to it, including the UAV writes).
+    bool hasGlobalUAVBarrier = false;
+    for (size_t i = 0; i < numBarriers; ++i)
+    {
+        const auto& barrier = m_ResourceBarriers[i];
+        if (!m_RemovedBarriers[i] && barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && barrier.UAV.pResource == nullptr)
+        {
+            m_RemovedBarriers[i] = hasGlobalUAVBarrier;
+            m_Statistics.NumRedundantUAV += hasGlobalUAVBarrier ? 1 : 0;
+            hasGlobalUAVBarrier = true;
+        }
+    }
+
+    for (size_t i = 0; i < numBarriers; ++i)
+    {
+        const auto& barrier = m_ResourceBarriers[i];
+        if (m_RemovedBarriers[i] || barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_UAV ||
+            barrier.UAV.pResource == nullptr)
+        {
+            continue;
+        }
+
+        bool covered = hasGlobalUAVBarrier;
+        for (size_t j = 0; j < numBarriers && !covered; ++j)
+        {
+            const auto& other = m_ResourceBarriers[j];
+            if (j == i || m_RemovedBarriers[j])
+            {
+                continue;
+            }
+
+            if (other.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+            {
+                // Keep the first of duplicate UAV barriers.
+                covered = j < i && other.UAV.pResource == barrier.UAV.pResource;
+            }
+            else if (isTransition(other))
+            {
+                covered = j > i && other.Transition.pResource == barrier.UAV.pResource &&
+                          other.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            }
+        }
+
+        if (covered)
+        {
+            m_RemovedBarriers[i] = true;
+            ++m_Statistics.NumRedundantUAV;
+        }
+    }
+
+    // Compact the batch, keeping the relative order of the remaining barriers.
+    size_t numKept = 0;
+    for (size_t i = 0; i < numBarriers; ++i)
+    {
+        if (!m_RemovedBarriers[i])
+        {
+            m_ResourceBarriers[numKept++] = m_ResourceBarriers[i];
+        }
+    }
+    m_ResourceBarriers.resize(numKept);
+}
+
 u32 ResourceStateTracker::FlushPendingResourceBarriers(const std::shared_ptr<CommandList>& commandList)
 {
-    assert(ms_IsLocked);
     assert(commandList);
 
     // Resolve the pending resource barriers by checking the global state of the
@@ -137,35 +502,36 @@ u32 ResourceStateTracker::FlushPendingResourceBarriers(const std::shared_ptr<Com
         {
             auto pendingTransition = pendingBarrier.Transition;
 
-            const auto& iter = ms_GlobalResourceState.find(pendingTransition.pResource);
-            if (iter != ms_GlobalResourceState.end())
+            // The shard of this resource has been locked by the command queue.
+            const auto& globalState = ms_GlobalResourceState[GetGlobalStateShard(pendingTransition.pResource)];
+            assert(globalState.IsLocked);
+            const ResourceState* resourceState = globalState.States.Find(pendingTransition.pResource);
+            if (resourceState != nullptr)
             {
                 // If all subresources are being transitioned, and there are multiple
                 // subresources of the resource that are in a different state...
-                auto& resourceState = iter->second;
                 if (pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-                    !resourceState.SubresourceState.empty())
+                    resourceState->HasSubresourceStates())
                 {
                     // Transition all subresources
-                    for (auto subresourceState : resourceState.SubresourceState)
-                    {
-                        if (pendingTransition.StateAfter != subresourceState.second)
+                    resourceState->ForEachSubresourceState([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState) {
+                        if (pendingTransition.StateAfter != subresourceState)
                         {
                             D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
-                            newBarrier.Transition.Subresource = subresourceState.first;
-                            newBarrier.Transition.StateBefore = subresourceState.second;
+                            newBarrier.Transition.Subresource = subresource;
+                            newBarrier.Transition.StateBefore = subresourceState;
                             resourceBarriers.push_back(newBarrier);
                         }
-                    }
+                    });
                 }
                 else
                 {
                     // No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
-                    auto globalState = (iter->second).GetSubresourceState(pendingTransition.Subresource);
-                    if (pendingTransition.StateAfter != globalState)
+                    auto globalSubresourceState = resourceState->GetSubresourceState(pendingTransition.Subresource);
+                    if (pendingTransition.StateAfter != globalSubresourceState)
                     {
                         // Fix-up the before state based on current global state of the resource.
-                        pendingBarrier.Transition.StateBefore = globalState;
+                        pendingBarrier.Transition.StateBefore = globalSubresourceState;
                         resourceBarriers.push_back(pendingBarrier);
                     }
                 }
@@ -178,6 +544,8 @@ u32 ResourceStateTracker::FlushPendingResourceBarriers(const std::shared_ptr<Com
     {
         auto d3d12CommandList = commandList->GetD3D12CommandList();
         d3d12CommandList->ResourceBarrier(numBarriers, resourceBarriers.data());
+
+        m_Statistics.NumEmitted += numBarriers;
     }
 
     m_PendingResourceBarriers.clear();
@@ -187,15 +555,22 @@ u32 ResourceStateTracker::FlushPendingResourceBarriers(const std::shared_ptr<Com
 
 void ResourceStateTracker::CommitFinalResourceStates()
 {
-    assert(ms_IsLocked);
+    // Commit final resource states to the global resource state shards (locked by the command queue).
+    m_FinalResourceState.ForEach([](ID3D12Resource* resource, const ResourceState& resourceState) {
+        auto& globalState = ms_GlobalResourceState[GetGlobalStateShard(resource)];
+        assert(globalState.IsLocked);
+        globalState.States[resource] = resourceState;
+    });
+    m_UntrackedResourceState.ForEach([](ID3D12Resource* resource, const ResourceState& resourceState) {
+        auto& globalState = ms_GlobalResourceState[GetGlobalStateShard(resource)];
+        assert(globalState.IsLocked);
+        globalState.States[resource] = resourceState;
+    });
 
-    // Commit final resource states to the global resource state array (map).
-    for (const auto& resourceState : m_FinalResourceState)
-    {
-        ms_GlobalResourceState[resourceState.first] = resourceState.second;
-    }
+    m_FinalResourceState.Clear();
+    m_UntrackedResourceState.Clear();
 
-    m_FinalResourceState.clear();
+    CommitStatistics();
 }
 
 void ResourceStateTracker::Reset()
@@ -203,28 +578,98 @@ void ResourceStateTracker::Reset()
     // Reset the pending, current, and final resource states.
     m_PendingResourceBarriers.clear();
     m_ResourceBarriers.clear();
-    m_FinalResourceState.clear();
+    m_SplitBarriers.clear();
+    m_MergedResources.clear();
+    m_FinalResourceState.Clear();
+    m_UntrackedResourceState.Clear();
+    m_Statistics = {};
 
     //RemoveGarbageResources();
 }
 
-void ResourceStateTracker::Lock()
+u64 ResourceStateTracker::GetGlobalStateShardMask() const
 {
-    ms_GlobalMutex.lock();
-    ms_IsLocked = true;
+    u64 shardMask = 0;
+
+    // Only transition barriers are pending.
+    for (const auto& pendingBarrier : m_PendingResourceBarriers)
+    {
+        shardMask |= 1ull << GetGlobalStateShard(pendingBarrier.Transition.pResource);
+    }
+
+    m_FinalResourceState.ForEach([&shardMask](ID3D12Resource* resource, const ResourceState&) {
+        shardMask |= 1ull << GetGlobalStateShard(resource);
+    });
+    m_UntrackedResourceState.ForEach([&shardMask](ID3D12Resource* resource, const ResourceState&) {
+        shardMask |= 1ull << GetGlobalStateShard(resource);
+    });
+
+    return shardMask;
 }
 
-void ResourceStateTracker::Unlock()
+void ResourceStateTracker::Lock(u64 shardMask)
 {
-    ms_GlobalMutex.unlock();
-    ms_IsLocked = false;
+    // Lock in ascending shard order to avoid deadlocks between queues.
+    DWORD shard;
+    while (_BitScanForward64(&shard, shardMask))
+    {
+        ms_GlobalResourceState[shard].Mutex.lock();
+        ms_GlobalResourceState[shard].IsLocked = true;
+        shardMask ^= (1ull << shard);
+    }
+}
+
+void ResourceStateTracker::Unlock(u64 shardMask)
+{
+    DWORD shard;
+    while (_BitScanForward64(&shard, shardMask))
+    {
+        ms_GlobalResourceState[shard].IsLocked = false;
+        ms_GlobalResourceState[shard].Mutex.unlock();
+        shardMask ^= (1ull << shard);
+    }
 }
 
 void ResourceStateTracker::AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
 {
     if (resource != nullptr)
     {
-        std::lock_guard<std::mutex> lock(ms_GlobalMutex);
-        ms_GlobalResourceState[resource].SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+        auto& globalState = ms_GlobalResourceState[GetGlobalStateShard(resource)];
+
+        std::lock_guard<std::mutex> lock(globalState.Mutex);
+        globalState.States[resource].SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+    }
+}
+
+void ResourceStateTracker::CommitStatistics()
+{
+    {
+        std::lock_guard<std::mutex> lock(ms_StatisticsMutex);
+
+        ms_FrameStatistics.NumRequested += m_Statistics.NumRequested;
+        ms_FrameStatistics.NumEmitted += m_Statistics.NumEmitted;
+        ms_FrameStatistics.NumNoOp += m_Statistics.NumNoOp;
+        ms_FrameStatistics.NumReadMerged += m_Statistics.NumReadMerged;
+        ms_FrameStatistics.NumCollapsed += m_Statistics.NumCollapsed;
+        ms_FrameStatistics.NumRedundantUAV += m_Statistics.NumRedundantUAV;
+        ms_FrameStatistics.NumSplit += m_Statistics.NumSplit;
+        ms_FrameStatistics.NumRestricted += m_Statistics.NumRestricted;
     }
-}
\ No newline at end of file
+
+    m_Statistics = {};
+}
+
+void ResourceStateTracker::EndFrame()
+{
+    std::lock_guard<std::mutex> lock(ms_StatisticsMutex);
+
+    ms_LastFrameStatistics = ms_FrameStatistics;
+    ms_FrameStatistics = {};
+}
+
+ResourceStateTracker::BarrierStatistics ResourceStateTracker::GetFrameBarrierStatistics()
+{
+    std::lock_guard<std::mutex> lock(ms_StatisticsMutex);
+
+    return ms_LastFrameStatistics;
+}
@@ -1,17 +1,55 @@
 #pragma once
 
-#include <map>
 #include <mutex>
-#include <unordered_map>
 #include <vector>
 
+#include <Engine/Pipeline/ResourceState.h>
+
 class CommandList;
 class Resource;
 
 class ResourceStateTracker
 {
 public:
-    ResourceStateTracker();
+    /**
+        * Statistics about the barriers requested from, and recorded by, the resource
+        * state trackers. Counters are accumulated per frame (see EndFrame).
+        */
+    struct BarrierStatistics
+    {
+        // Transition, UAV and aliasing barriers pushed to the trackers.
+        u32 NumRequested = 0;
+        // Barriers recorded on command lists (including pending barriers).
+        u32 NumEmitted = 0;
+        // Transitions to the state the (sub)resource was already in (or a combined read state that covers it).
+        u32 NumNoOp = 0;
+        // Read transitions that were merged into a combined read state. The combined
+        // transition is still recorded, so these are not counted as saved.
+        u32 NumReadMerged = 0;
+        // Back-to-back transitions of the same (sub)resource folded into one.
+        u32 NumCollapsed = 0;
+        // UAV barriers covered by another barrier in the same batch.
+        u32 NumRedundantUAV = 0;
+        // Transitions recorded as split (begin/end) barriers.
+        u32 NumSplit = 0;
+        // Transitions from combined read states back to the read states of compute command lists,
+        // recorded when a direct command list is closed (see RestrictMergedReadStates). They are the
+        // cost of merging reads: they are not requested, but are included in NumEmitted (or in
+        // NumCollapsed when they fold into the transition to the combined state).
+        u32 NumRestricted = 0;
+
+        u32 GetNumSaved() const
+        {
+            return NumNoOp + NumCollapsed + NumRedundantUAV;
+        }
+    };
+
+    /**
+        * @param type The type of the command list that uses the tracker. Read states
+        * are only combined on direct command lists since the combined states may not
+        * be supported on the other queues.
+        */
+    explicit ResourceStateTracker(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
     virtual ~ResourceStateTracker();
 
     /**
@@ -34,6 +72,48 @@ public:
     void TransitionResource(const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
         UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
 
+    /**
+        * Push a barrier that is not tracked. For transition barriers, the caller provides the
+        * correct before state. The barrier is batched (and optimized) with the other barriers.
+        */
+    void ExplicitResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier);
+
+    /**
+        * Set the state a manually managed (untracked) resource is in after the command
+        * list has executed. The state is committed to the global resource state with the
+        * final resource states, so command lists that do track the resource start from
+        * its actual state.
+        */
+    void SetUntrackedResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state,
+        UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+    /**
+        * Begin a split transition barrier. The transition is ended by the next
+        * barrier on the resource (or when the command list is closed) which gives
+        * the GPU the work recorded in between to perform the transition.
+        *
+        * If the state of the resource is not known in this command list yet, the
+        * call is ignored and the transition is performed by the next TransitionResource.
+        */
+    void BeginTransitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter,
+        UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    void BeginTransitionResource(const Resource& resource, D3D12_RESOURCE_STATES stateAfter,
+        UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+    /**
+        * End any split transition barriers that are still open.
+        * This must be called before the command list is closed.
+        */
+    void EndSplitTransitions();
+
+    /**
+        * Transition the read states that were combined on this (direct) command list to
+        * the read states that are supported on compute command lists, so the global state
+        * never holds a state (like PIXEL_SHADER_RESOURCE) that a compute command list
+        * cannot transition from. This must be called before the command list is closed.
+        */
+    void RestrictMergedReadStates();
+
     /**
         * Push a UAV resource barrier for the given resource.
         *
@@ -53,6 +133,15 @@ public:
         */
     void AliasBarrier(const Resource* resourceBefore = nullptr, const Resource* resourceAfter = nullptr);
 
+    /**
+        * Returns true if there are pending resource barriers that need to be resolved
+        * against the global resource state before the command list is executed.
+        */
+    bool HasPendingResourceBarriers() const
+    {
+        return !m_PendingResourceBarriers.empty();
+    }
+
     /**
         * Flush any pending resource barriers to the command list.
         *
@@ -62,10 +151,18 @@ public:
 
     /**
         * Flush any (non-pending) resource barriers that have been pushed to the resource state
-        * tracker.
+        * tracker. The batch is optimized first: no-op transitions are removed, back-to-back
+        * transitions of the same subresource are folded and redundant UAV barriers are dropped.
         */
     void FlushResourceBarriers(const std::shared_ptr<CommandList>& commandList);
 
+    /**
+        * Optimize the (non-pending) resource barriers like FlushResourceBarriers does and
+        * return them instead of recording them on a command list. The barriers stay batched
+        * until the next flush (or Reset).
+        */
+    const std::vector<D3D12_RESOURCE_BARRIER>& GetOptimizedResourceBarriers();
+
     /**
         * Commit final resource states to the global resource state map.
         * This must be called when the command list is closed.
@@ -78,18 +175,28 @@ public:
     void Reset();
 
     /**
-        * The global state must be locked before flushing pending resource barriers
-        * and committing the final resource state to the global resource state.
-        * This ensures consistency of the global resource state between command list
-        * executions.
+        * Get a bit mask of the global resource state shards that are referenced by
+        * the resources tracked in this command list (both pending and final states).
+        * The shards in this mask must be locked before flushing pending resource
+        * barriers and committing the final resource states.
         */
-    static void Lock();
+    u64 GetGlobalStateShardMask() const;
 
     /**
-        * Unlocks the global resource state after the final states have been committed
-        * to the global resource state array.
+        * The global state is split into NumGlobalStateShards shards, each with its
+        * own mutex. Lock the shards in the mask before flushing pending resource
+        * barriers and committing the final resource state to the global resource
+        * state. This ensures consistency of the global resource state between
+        * command list executions, while submissions that reference disjoint
+        * resources never contend. Shards are always locked in ascending order.
         */
-    static void Unlock();
+    static void Lock(u64 shardMask);
+
+    /**
+        * Unlocks the global resource state shards after the final states have been
+        * committed to the global resource state.
+        */
+    static void Unlock(u64 shardMask);
 
     /**
         * Add a resource with a given state to the global resource state array (map).
@@ -97,6 +204,17 @@ public:
         */
     static void AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
 
+    /**
+        * Mark the end of a frame. The barrier statistics accumulated during the frame
+        * become available through GetFrameBarrierStatistics.
+        */
+    static void EndFrame();
+
+    /**
+        * Get the barrier statistics of the last completed frame.
+        */
+    static BarrierStatistics GetFrameBarrierStatistics();
+
     ///**
     // * Remove a resource from the global resource state array (map).
     // * This should only be done when the resource is destroyed.
@@ -113,6 +231,26 @@ private:
     // An array (vector) of resource barriers.
     using ResourceBarriers = std::vector<D3D12_RESOURCE_BARRIER>;
 
+    // Returns true if the state only contains read states that can be combined.
+    static bool IsReadOnlyState(D3D12_RESOURCE_STATES state);
+
+    // Push a transition barrier with a known before state (or fold it into the final read state).
+    // Returns the state the (sub)resource is in after the barrier.
+    D3D12_RESOURCE_STATES PushTransition(const D3D12_RESOURCE_BARRIER& barrier, D3D12_RESOURCE_STATES stateBefore);
+
+    // End the open split transitions of the given resource (NULL ends all of them).
+    // Returns true if any split transition was ended.
+    bool EndSplitTransitions(ID3D12Resource* resource);
+
+    // Remove no-op transitions, fold back-to-back transitions and drop redundant UAV barriers.
+    void OptimizeResourceBarriers();
+
+    // Add the statistics of this tracker to the current frame.
+    void CommitStatistics();
+
+    // The type of the command list that uses the tracker.
+    D3D12_COMMAND_LIST_TYPE m_CommandListType;
+
     // Pending resource transitions are committed before a command list
     // is executed on the command queue. This guarantees that resources will
     // be in the expected state at the beginning of a command list.
@@ -120,65 +258,56 @@ private:
 
     // Resource barriers that need to be committed to the command list.
     ResourceBarriers m_ResourceBarriers;
+    // Scratch flags used to remove barriers while optimizing the batch.
+    std::vector<bool> m_RemovedBarriers;
 
-    // Tracks the state of a particular resource and all of its subresources.
-    struct ResourceState
-    {
-        // Initialize all of the subresources within a resource to the given state.
-        explicit ResourceState(D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON)
-            : State(state)
-        {}
+    // The END_ONLY halves of split transitions that have been begun but not yet ended.
+    ResourceBarriers m_SplitBarriers;
 
-        // Set a subresource to a particular state.
-        void SetSubresourceState(UINT subresource, D3D12_RESOURCE_STATES state)
-        {
-            if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
-            {
-                State = state;
-                SubresourceState.clear();
-            }
-            else
-            {
-                SubresourceState[subresource] = state;
-            }
-        }
+    // The resources that were transitioned to a combined read state (see RestrictMergedReadStates).
+    std::vector<ID3D12Resource*> m_MergedResources;
 
-        // Get the state of a (sub)resource within the resource.
-        // If the specified subresource is not found in the SubresourceState array (map)
-        // then the state of the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is
-        // returned.
-        D3D12_RESOURCE_STATES GetSubresourceState(UINT subresource) const
-        {
-            D3D12_RESOURCE_STATES state = State;
-            const auto            iter = SubresourceState.find(subresource);
-            if (iter != SubresourceState.end())
-            {
-                state = iter->second;
-            }
-            return state;
-        }
-
-        // If the SubresourceState array (map) is empty, then the State variable defines
-        // the state of all of the subresources.
-        D3D12_RESOURCE_STATES                 State;
-        std::map<UINT, D3D12_RESOURCE_STATES> SubresourceState;
-    };
+    // Barrier statistics of this tracker since it was last committed.
+    BarrierStatistics m_Statistics;
 
     using ResourceList = std::vector<ID3D12Resource*>;
-    using ResourceStateMap = std::unordered_map<ID3D12Resource*, ResourceState>;
 
     // The final (last known state) of the resources within a command list.
     // The final resource state is committed to the global resource state when the
     // command list is closed but before it is executed on the command queue.
     ResourceStateMap m_FinalResourceState;
 
-    // The global resource state array (map) stores the state of a resource
-    // between command list execution.
-    static ResourceStateMap ms_GlobalResourceState;
+    // The states of the manually managed resources after the command list has executed
+    // (see SetUntrackedResourceState). Committed to the global state with the final states.
+    ResourceStateMap m_UntrackedResourceState;
+
+    // Number of global resource state shards. One bit per shard in a u64 mask.
+    static constexpr u32 NumGlobalStateShards = 64;
+
+    // A shard of the global resource state. The mutex protects shared access to
+    // the states of the resources that hash to this shard.
+    struct GlobalStateShard
+    {
+        std::mutex       Mutex;
+        ResourceStateMap States{ 16 };
+        // True while the shard is locked by a command queue (see Lock).
+        bool             IsLocked = false;
+    };
+
+    static u32 GetGlobalStateShard(ID3D12Resource* resource)
+    {
+        // Use the high bits of the hash; the low bits select the slot within the shard's map.
+        return static_cast<u32>(ResourceStateMap::Hash(resource) >> 58);
+    }
+
+    // The global resource state stores the state of a resource between command
+    // list execution.
+    static GlobalStateShard ms_GlobalResourceState[NumGlobalStateShards];
+
+    // Barrier statistics of the current and the last completed frame.
+    static std::mutex        ms_StatisticsMutex;
+    static BarrierStatistics ms_FrameStatistics;
+    static BarrierStatistics ms_LastFrameStatistics;
     // Resources that should be cleaned up when they are no longer being used.
     //static ResourceList ms_GarbageResources;
-
-    // The mutex protects shared access to the GlobalResourceState map.
-    static std::mutex ms_GlobalMutex;
-    static bool       ms_IsLocked;
 };
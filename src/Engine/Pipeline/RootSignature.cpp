@@ -5,14 +5,20 @@
 #include <Application.h>
 #include <Device.h>
 
-RootSignature::RootSignature(Device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
+// Private data of the ID3D12RootSignature that holds the hash of its serialized blob.
+// {6C1D2E0B-3F5A-4C8E-9B27-5E4A1D7C9F31}
+static const GUID RootSignatureHashGuid = { 0x6c1d2e0b, 0x3f5a, 0x4c8e, { 0x9b, 0x27, 0x5e, 0x4a, 0x1d, 0x7c, 0x9f, 0x31 } };
+
+RootSignature::RootSignature(Device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+    const std::vector<u8>& serializedBlob)
     : m_Device(device)
     , m_RootSignatureDesc{}
+    , m_Hash(0)
     , m_NumDescriptorsPerTable{ 0 }
     , m_SamplerTableBitMask(0)
     , m_DescriptorTableBitMask(0)
 {
-    SetRootSignatureDesc(rootSignatureDesc);
+    SetRootSignatureDesc(rootSignatureDesc, serializedBlob);
 }
 
 RootSignature::~RootSignature()
@@ -22,20 +28,12 @@ RootSignature::~RootSignature()
 
 void RootSignature::Destroy()
 {
-    for (UINT i = 0; i < m_RootSignatureDesc.NumParameters; ++i)
-    {
-        const D3D12_ROOT_PARAMETER1& rootParameter = m_RootSignatureDesc.pParameters[i];
-        if (rootParameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
-        {
-            delete[] rootParameter.DescriptorTable.pDescriptorRanges;
-        }
-    }
+    m_Parameters.clear();
+    m_DescriptorRanges.clear();
+    m_StaticSamplers.clear();
 
-    delete[] m_RootSignatureDesc.pParameters;
     m_RootSignatureDesc.pParameters = nullptr;
     m_RootSignatureDesc.NumParameters = 0;
-
-    delete[] m_RootSignatureDesc.pStaticSamplers;
     m_RootSignatureDesc.pStaticSamplers = nullptr;
     m_RootSignatureDesc.NumStaticSamplers = 0;
 
@@ -45,28 +43,29 @@ void RootSignature::Destroy()
     memset(m_NumDescriptorsPerTable, 0, sizeof(m_NumDescriptorsPerTable));
 }
 
-void RootSignature::SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
+void RootSignature::SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+    const std::vector<u8>& serializedBlob)
 {
     // Make sure any previously allocated root signature description is cleaned
     // up first.
     Destroy();
 
-    UINT                   numParameters = rootSignatureDesc.NumParameters;
-    D3D12_ROOT_PARAMETER1* pParameters = numParameters > 0 ? new D3D12_ROOT_PARAMETER1[numParameters] : nullptr;
+    // The copies are owned by vectors, so they are released even if the constructor throws below.
+    UINT numParameters = rootSignatureDesc.NumParameters;
+    m_Parameters.assign(rootSignatureDesc.pParameters, rootSignatureDesc.pParameters + numParameters);
+    m_DescriptorRanges.resize(numParameters);
+    D3D12_ROOT_PARAMETER1* pParameters = numParameters > 0 ? m_Parameters.data() : nullptr;
 
     for (UINT i = 0; i < numParameters; ++i)
     {
         const D3D12_ROOT_PARAMETER1& rootParameter = rootSignatureDesc.pParameters[i];
-        pParameters[i] = rootParameter;
 
         if (rootParameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
         {
-            UINT                     numDescriptorRanges = rootParameter.DescriptorTable.NumDescriptorRanges;
-            D3D12_DESCRIPTOR_RANGE1* pDescriptorRanges =
-                numDescriptorRanges > 0 ? new D3D12_DESCRIPTOR_RANGE1[numDescriptorRanges] : nullptr;
-
-            memcpy(pDescriptorRanges, rootParameter.DescriptorTable.pDescriptorRanges,
-                sizeof(D3D12_DESCRIPTOR_RANGE1) * numDescriptorRanges);
+            UINT numDescriptorRanges = rootParameter.DescriptorTable.NumDescriptorRanges;
+            m_DescriptorRanges[i].assign(rootParameter.DescriptorTable.pDescriptorRanges,
+                rootParameter.DescriptorTable.pDescriptorRanges + numDescriptorRanges);
+            D3D12_DESCRIPTOR_RANGE1* pDescriptorRanges = numDescriptorRanges > 0 ? m_DescriptorRanges[i].data() : nullptr;
 
             pParameters[i].DescriptorTable.NumDescriptorRanges = numDescriptorRanges;
             pParameters[i].DescriptorTable.pDescriptorRanges = pDescriptorRanges;
@@ -98,15 +97,9 @@ void RootSignature::SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootS
     m_RootSignatureDesc.NumParameters = numParameters;
     m_RootSignatureDesc.pParameters = pParameters;
 
-    UINT                       numStaticSamplers = rootSignatureDesc.NumStaticSamplers;
-    D3D12_STATIC_SAMPLER_DESC* pStaticSamplers =
-        numStaticSamplers > 0 ? new D3D12_STATIC_SAMPLER_DESC[numStaticSamplers] : nullptr;
-
-    if (pStaticSamplers)
-    {
-        memcpy(pStaticSamplers, rootSignatureDesc.pStaticSamplers,
-            sizeof(D3D12_STATIC_SAMPLER_DESC) * numStaticSamplers);
-    }
+    UINT numStaticSamplers = rootSignatureDesc.NumStaticSamplers;
+    m_StaticSamplers.assign(rootSignatureDesc.pStaticSamplers, rootSignatureDesc.pStaticSamplers + numStaticSamplers);
+    D3D12_STATIC_SAMPLER_DESC* pStaticSamplers = numStaticSamplers > 0 ? m_StaticSamplers.data() : nullptr;
 
     m_RootSignatureDesc.NumStaticSamplers = numStaticSamplers;
     m_RootSignatureDesc.pStaticSamplers = pStaticSamplers;
@@ -114,23 +107,50 @@ void RootSignature::SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootS
     D3D12_ROOT_SIGNATURE_FLAGS flags = rootSignatureDesc.Flags;
     m_RootSignatureDesc.Flags = flags;
 
-    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC versionRootSignatureDesc;
-    versionRootSignatureDesc.Init_1_1(numParameters, pParameters, numStaticSamplers, pStaticSamplers, flags);
+    if (serializedBlob.empty())
+    {
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC versionRootSignatureDesc;
+        versionRootSignatureDesc.Init_1_1(numParameters, pParameters, numStaticSamplers, pStaticSamplers, flags);
 
-    D3D_ROOT_SIGNATURE_VERSION highestVersion = m_Device.GetHighestRootSignatureVersion();
+        D3D_ROOT_SIGNATURE_VERSION highestVersion = m_Device.GetHighestRootSignatureVersion();
 
-    // Serialize the root signature.
-    Microsoft::WRL::ComPtr<ID3DBlob> rootSignatureBlob;
-    Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
-    ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&versionRootSignatureDesc, highestVersion,
-        &rootSignatureBlob, &errorBlob));
+        // Serialize the root signature.
+        Microsoft::WRL::ComPtr<ID3DBlob> rootSignatureBlob;
+        Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&versionRootSignatureDesc, highestVersion,
+            &rootSignatureBlob, &errorBlob));
+
+        const u8* blobData = static_cast<const u8*>(rootSignatureBlob->GetBufferPointer());
+        m_SerializedBlob.assign(blobData, blobData + rootSignatureBlob->GetBufferSize());
+    }
+    else
+    {
+        m_SerializedBlob = serializedBlob;
+    }
 
     auto d3d12Device = m_Device.GetD3D12Device();
 
     // Create the root signature.
-    ThrowIfFailed(d3d12Device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
-        rootSignatureBlob->GetBufferSize(),
+    ThrowIfFailed(d3d12Device->CreateRootSignature(0, m_SerializedBlob.data(), m_SerializedBlob.size(),
         IID_PPV_ARGS(&m_RootSignature)));
+
+    // Pipeline state streams only reference the D3D12 root signature, so the hash is stored with it
+    // for the pipeline state cache.
+    m_Hash = HashBytes(m_SerializedBlob.data(), m_SerializedBlob.size());
+    ThrowIfFailed(m_RootSignature->SetPrivateData(RootSignatureHashGuid, sizeof(m_Hash), &m_Hash));
+}
+
+u64 RootSignature::GetHash(ID3D12RootSignature* rootSignature)
+{
+    u64  hash = 0;
+    UINT size = sizeof(hash);
+    if (!rootSignature || FAILED(rootSignature->GetPrivateData(RootSignatureHashGuid, &size, &hash)) ||
+        size != sizeof(hash))
+    {
+        return 0;
+    }
+
+    return hash;
 }
 
 u32 RootSignature::GetDescriptorTableBitMask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const
@@ -15,22 +15,53 @@ public:
         return m_RootSignatureDesc;
     }
 
+    // Hash of the serialized root signature.
+    u64 GetHash() const
+    {
+        return m_Hash;
+    }
+
+    // The serialized root signature.
+    const std::vector<u8>& GetSerializedBlob() const
+    {
+        return m_SerializedBlob;
+    }
+
+    /**
+     * Get the hash of the serialized root signature from a D3D12 root signature that
+     * was created by this class. Returns 0 for other root signatures.
+     */
+    static u64 GetHash(ID3D12RootSignature* rootSignature);
+
     u32 GetDescriptorTableBitMask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const;
     u32 GetNumDescriptors(u32 rootIndex) const;
 
     friend struct std::default_delete<RootSignature>;
 
-    RootSignature(Device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
+    /**
+     * @param serializedBlob (Optional) the root signature serialized with the highest root
+     * signature version of the device. If empty, the description is serialized.
+     */
+    RootSignature(Device& device, const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+        const std::vector<u8>& serializedBlob = {});
 
     virtual ~RootSignature();
 
 private:
     void Destroy();
-    void SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
+    void SetRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+        const std::vector<u8>& serializedBlob);
 
     Device& m_Device;
+    // Points into m_Parameters, m_DescriptorRanges and m_StaticSamplers.
     D3D12_ROOT_SIGNATURE_DESC1                  m_RootSignatureDesc;
+    std::vector<D3D12_ROOT_PARAMETER1>          m_Parameters;
+    // The descriptor ranges of each root parameter (empty if it's not a descriptor table).
+    std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> m_DescriptorRanges;
+    std::vector<D3D12_STATIC_SAMPLER_DESC>      m_StaticSamplers;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_RootSignature;
+    u64                                         m_Hash;
+    std::vector<u8>                             m_SerializedBlob;
 
     // Need to know the number of descriptors per descriptor table.
     // A maximum of 32 descriptor tables are supported (since a 32-bit
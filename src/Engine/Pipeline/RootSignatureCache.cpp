@@ -0,0 +1,345 @@
+#include "enginepch.h"
+
+#include "RootSignatureCache.h"
+
+#include <Engine/Core/Application.h>
+#include <Device.h>
+#include <Pipeline/RootSignature.h>
+
+#include <fstream>
+
+namespace
+{
+// Increment when the file layout or the description hash changes.
+constexpr u32 CacheFileVersion = 2;
+constexpr u32 CacheFileMagic = 'CSRD';
+
+// The seed of the second description hash that is stored with every blob. It is checked
+// when a blob is used instead of deserializing the blob and comparing the descriptions.
+constexpr u64 DescHashSeed = 0x9e3779b97f4a7c15ULL;
+
+struct CacheFileHeader
+{
+    u32 Magic;
+    u32 Version;
+    u64 NumBlobs;
+    // Followed by NumBlobs entries of { u64 key, u64 description hash, u64 blob hash, u64 blob size, blob }.
+};
+
+struct CacheFileEntry
+{
+    u64 Key;
+    u64 DescHash;
+    u64 BlobHash;
+    u64 BlobSize;
+};
+
+template<typename T>
+u64 HashValue(const T& value, u64 hash)
+{
+    return HashBytes(&value, sizeof(T), hash);
+}
+
+// Compare two root signature descriptions.
+bool RootSignatureDescsEqual(const D3D12_ROOT_SIGNATURE_DESC1& a, const D3D12_ROOT_SIGNATURE_DESC1& b)
+{
+    if (a.Flags != b.Flags || a.NumParameters != b.NumParameters || a.NumStaticSamplers != b.NumStaticSamplers)
+    {
+        return false;
+    }
+
+    for (UINT i = 0; i < a.NumParameters; ++i)
+    {
+        const D3D12_ROOT_PARAMETER1& parameterA = a.pParameters[i];
+        const D3D12_ROOT_PARAMETER1& parameterB = b.pParameters[i];
+        if (parameterA.ParameterType != parameterB.ParameterType ||
+            parameterA.ShaderVisibility != parameterB.ShaderVisibility)
+        {
+            return false;
+        }
+
+        switch (parameterA.ParameterType)
+        {
+        case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+        {
+            const auto& tableA = parameterA.DescriptorTable;
+            const auto& tableB = parameterB.DescriptorTable;
+            if (tableA.NumDescriptorRanges != tableB.NumDescriptorRanges)
+            {
+                return false;
+            }
+
+            for (UINT j = 0; j < tableA.NumDescriptorRanges; ++j)
+            {
+                const D3D12_DESCRIPTOR_RANGE1& rangeA = tableA.pDescriptorRanges[j];
+                const D3D12_DESCRIPTOR_RANGE1& rangeB = tableB.pDescriptorRanges[j];
+                if (rangeA.RangeType != rangeB.RangeType || rangeA.NumDescriptors != rangeB.NumDescriptors ||
+                    rangeA.BaseShaderRegister != rangeB.BaseShaderRegister ||
+                    rangeA.RegisterSpace != rangeB.RegisterSpace ||
+                    rangeA.OffsetInDescriptorsFromTableStart != rangeB.OffsetInDescriptorsFromTableStart ||
+                    rangeA.Flags != rangeB.Flags)
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+        case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            if (parameterA.Constants.ShaderRegister != parameterB.Constants.ShaderRegister ||
+                parameterA.Constants.RegisterSpace != parameterB.Constants.RegisterSpace ||
+                parameterA.Constants.Num32BitValues != parameterB.Constants.Num32BitValues)
+            {
+                return false;
+            }
+            break;
+        default:
+            if (parameterA.Descriptor.ShaderRegister != parameterB.Descriptor.ShaderRegister ||
+                parameterA.Descriptor.RegisterSpace != parameterB.Descriptor.RegisterSpace ||
+                parameterA.Descriptor.Flags != parameterB.Descriptor.Flags)
+            {
+                return false;
+            }
+            break;
+        }
+    }
+
+    // D3D12_STATIC_SAMPLER_DESC only has 32-bit members, so it has no padding.
+    return a.NumStaticSamplers == 0 ||
+           memcmp(a.pStaticSamplers, b.pStaticSamplers, sizeof(D3D12_STATIC_SAMPLER_DESC) * a.NumStaticSamplers) == 0;
+}
+
+}  // namespace
+
+RootSignatureCache::RootSignatureCache(Device& device, const fs::path& path)
+    : m_Device(device)
+    , m_Path(path)
+    , m_BlobsDirty(false)
+{
+    m_Logger = Application::CreateLogger("RootSignatureCache");
+    Load();
+}
+
+RootSignatureCache::~RootSignatureCache()
+{
+    Save();
+}
+
+u64 RootSignatureCache::HashRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+    D3D_ROOT_SIGNATURE_VERSION version, u64 seed)
+{
+    // The union members of the root parameters are hashed by type, so unused bytes are never read.
+    u64 hash = HashValue(version, seed);
+    hash = HashValue(rootSignatureDesc.Flags, hash);
+    hash = HashValue(rootSignatureDesc.NumParameters, hash);
+
+    for (UINT i = 0; i < rootSignatureDesc.NumParameters; ++i)
+    {
+        const D3D12_ROOT_PARAMETER1& rootParameter = rootSignatureDesc.pParameters[i];
+        hash = HashValue(rootParameter.ParameterType, hash);
+        hash = HashValue(rootParameter.ShaderVisibility, hash);
+
+        switch (rootParameter.ParameterType)
+        {
+        case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+        {
+            const auto& table = rootParameter.DescriptorTable;
+            hash = HashValue(table.NumDescriptorRanges, hash);
+            // D3D12_DESCRIPTOR_RANGE1 only has 32-bit members, so it has no padding.
+            hash = HashBytes(table.pDescriptorRanges, sizeof(D3D12_DESCRIPTOR_RANGE1) * table.NumDescriptorRanges,
+                hash);
+            break;
+        }
+        case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            hash = HashValue(rootParameter.Constants, hash);
+            break;
+        default:
+            hash = HashValue(rootParameter.Descriptor, hash);
+            break;
+        }
+    }
+
+    // D3D12_STATIC_SAMPLER_DESC only has 32-bit members, so it has no padding.
+    hash = HashValue(rootSignatureDesc.NumStaticSamplers, hash);
+    hash = HashBytes(rootSignatureDesc.pStaticSamplers,
+        sizeof(D3D12_STATIC_SAMPLER_DESC) * rootSignatureDesc.NumStaticSamplers, hash);
+
+    return hash;
+}
+
+std::shared_ptr<RootSignature> RootSignatureCache::GetOrCreate(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc)
+{
+    D3D_ROOT_SIGNATURE_VERSION version = m_Device.GetHighestRootSignatureVersion();
+    u64                        key = HashRootSignatureDesc(rootSignatureDesc, version);
+
+    // Creating a root signature is cheap compared to a pipeline state, so the lock is held
+    // while it's created.
+    scoped_lock lock(m_Mutex);
+
+    auto& sharedRootSignature = m_RootSignatures[key];
+    if (auto rootSignature = sharedRootSignature.lock())
+    {
+        if (RootSignatureDescsEqual(rootSignature->GetRootSignatureDesc(), rootSignatureDesc))
+        {
+            ++m_Statistics.NumShared;
+            return rootSignature;
+        }
+
+        // Two different descriptions with the same hash. The second one is not cached.
+        m_Logger->warn("Root signature hash collision ({:016x}), creating an uncached root signature.", key);
+        ++m_Statistics.NumCollisions;
+        return MakeRef<RootSignature>(m_Device, rootSignatureDesc);
+    }
+
+    std::shared_ptr<RootSignature> rootSignature;
+
+    auto blob = m_Blobs.find(key);
+    if (blob != m_Blobs.end())
+    {
+        // Hashing the description again doesn't need a deserializer for the blob.
+        if (blob->second.DescHash != HashRootSignatureDesc(rootSignatureDesc, version, DescHashSeed))
+        {
+            m_Logger->warn("The cached root signature {:016x} does not match its description, serializing it again.",
+                key);
+            ++m_Statistics.NumCollisions;
+            m_Blobs.erase(blob);
+        }
+        else
+        {
+            try
+            {
+                rootSignature = MakeRef<RootSignature>(m_Device, rootSignatureDesc, blob->second.Blob);
+                ++m_Statistics.NumBlobHits;
+            }
+            catch (const std::exception&)
+            {
+                // The device rejected the cached blob. Serialize the description instead.
+                m_Blobs.erase(blob);
+            }
+        }
+    }
+
+    if (!rootSignature)
+    {
+        rootSignature = MakeRef<RootSignature>(m_Device, rootSignatureDesc);
+        ++m_Statistics.NumSerialized;
+
+        m_Blobs[key] = { HashRootSignatureDesc(rootSignatureDesc, version, DescHashSeed),
+            rootSignature->GetSerializedBlob() };
+        m_BlobsDirty = true;
+    }
+
+    sharedRootSignature = rootSignature;
+    return rootSignature;
+}
+
+RootSignatureCache::Statistics RootSignatureCache::GetStatistics() const
+{
+    scoped_lock lock(m_Mutex);
+    return m_Statistics;
+}
+
+void RootSignatureCache::Load()
+{
+    std::error_code error;
+    u64             fileSize = fs::file_size(m_Path, error);
+
+    std::ifstream file(m_Path, std::ios::in | std::ios::binary);
+    if (!file || error)
+    {
+        return;
+    }
+
+    CacheFileHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.Magic != CacheFileMagic || header.Version != CacheFileVersion)
+    {
+        m_Logger->warn("Discarding the root signature cache {}: it was written by a different engine version.",
+            m_Path.string());
+        return;
+    }
+
+    u64 remainingSize = fileSize - sizeof(header);
+    for (u64 i = 0; i < header.NumBlobs; ++i)
+    {
+        CacheFileEntry entry = {};
+        file.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        if (!file)
+        {
+            break;
+        }
+
+        // Checked before the blob is allocated, so a corrupt size can't cause a huge allocation.
+        remainingSize -= sizeof(entry);
+        if (entry.BlobSize > remainingSize)
+        {
+            m_Logger->warn("The root signature cache {} is corrupt.", m_Path.string());
+            m_Blobs.clear();
+            return;
+        }
+        remainingSize -= entry.BlobSize;
+
+        std::vector<u8> blob(entry.BlobSize);
+        file.read(reinterpret_cast<char*>(blob.data()), blob.size());
+        if (!file || HashBytes(blob.data(), blob.size()) != entry.BlobHash)
+        {
+            m_Logger->warn("The root signature cache {} is corrupt.", m_Path.string());
+            m_Blobs.clear();
+            return;
+        }
+
+        m_Blobs.emplace(entry.Key, CachedBlob{ entry.DescHash, std::move(blob) });
+    }
+
+    m_Logger->info("Loaded {} root signatures from the root signature cache {}.", m_Blobs.size(), m_Path.string());
+}
+
+void RootSignatureCache::Save()
+{
+    scoped_lock lock(m_Mutex);
+
+    m_Logger->info("Root signature cache: {} serialized, {} loaded from disk, {} shared, {} mismatched.",
+        m_Statistics.NumSerialized, m_Statistics.NumBlobHits, m_Statistics.NumShared, m_Statistics.NumCollisions);
+
+    if (!m_BlobsDirty)
+    {
+        return;
+    }
+
+    CacheFileHeader header = {};
+    header.Magic = CacheFileMagic;
+    header.Version = CacheFileVersion;
+    header.NumBlobs = m_Blobs.size();
+
+    // Write to a temporary file first so an interrupted write doesn't leave a corrupt cache behind.
+    std::error_code error;
+    fs::create_directories(m_Path.parent_path(), error);
+
+    fs::path tempPath = m_Path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& [key, cachedBlob] : m_Blobs)
+        {
+            const std::vector<u8>& blob = cachedBlob.Blob;
+            CacheFileEntry entry = { key, cachedBlob.DescHash, HashBytes(blob.data(), blob.size()), blob.size() };
+            file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            file.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+        }
+
+        if (!file)
+        {
+            m_Logger->warn("Failed to write the root signature cache {}.", tempPath.string());
+            return;
+        }
+    }
+
+    fs::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        m_Logger->warn("Failed to write the root signature cache {}: {}", m_Path.string(), error.message());
+        return;
+    }
+
+    m_BlobsDirty = false;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+class RootSignature;
+
+/**
+ * Deduplicates root signatures and caches their serialized blobs on disk.
+ *
+ * Root signature descriptions are keyed by a hash of their contents (parameters,
+ * descriptor ranges, static samplers, flags and the root signature version that
+ * they are serialized with). Identical descriptions share a RootSignature, which
+ * also avoids resetting the root signature on a command list when consecutive
+ * passes use the same layout. The serialized blobs are written to disk when the
+ * cache is destroyed, so the next run skips the serialization.
+ *
+ * A hash is not proof of equality: a shared root signature is only returned if its
+ * description matches. Instead of deserializing a blob from disk to compare its
+ * description, every blob is stored with a second hash of its description (with a
+ * different seed), which must match as well before the blob is used.
+ */
+class RootSignatureCache
+{
+public:
+    struct Statistics
+    {
+        // Descriptions that returned an existing RootSignature.
+        u32 NumShared = 0;
+        // Root signatures that were created from a blob in the cache file.
+        u32 NumBlobHits = 0;
+        // Root signatures that had to be serialized.
+        u32 NumSerialized = 0;
+        // Descriptions whose key matched a root signature or a blob with a different description.
+        u32 NumCollisions = 0;
+    };
+
+    RootSignatureCache(Device& device, const fs::path& path);
+    ~RootSignatureCache();
+
+    RootSignatureCache(const RootSignatureCache&) = delete;
+    RootSignatureCache& operator=(const RootSignatureCache&) = delete;
+
+    /**
+     * Get the root signature of a description, creating it if no root signature
+     * with the same description is alive. Thread safe.
+     */
+    std::shared_ptr<RootSignature> GetOrCreate(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc);
+
+    // Write the serialized blobs to disk if new root signatures were serialized.
+    void Save();
+
+    Statistics GetStatistics() const;
+
+    static u64 HashRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc,
+        D3D_ROOT_SIGNATURE_VERSION version, u64 seed = 0xcbf29ce484222325ULL);
+
+private:
+    struct CachedBlob
+    {
+        // The hash of the description with a different seed than the key.
+        u64             DescHash;
+        std::vector<u8> Blob;
+    };
+
+    void Load();
+
+    Device&                m_Device;
+    fs::path               m_Path;
+    RefPtr<spdlog::logger> m_Logger;
+
+    mutable std::mutex m_Mutex;
+
+    // Root signatures are not kept alive by the cache.
+    std::unordered_map<u64, std::weak_ptr<RootSignature>> m_RootSignatures;
+    std::unordered_map<u64, CachedBlob>                   m_Blobs;
+    bool                                                  m_BlobsDirty;
+
+    Statistics m_Statistics;
+};
@@ -0,0 +1,132 @@
+#include "enginepch.h"
+
+#include "ShaderCompiler.h"
+
+#include <dxcapi.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+/**
+ * Compiles shaders with the DirectX shader compiler. dxcompiler.dll is loaded at
+ * runtime, so the engine does not need to link it when hot reloading is not used.
+ */
+class DxcShaderCompiler : public ShaderCompiler
+{
+public:
+    DxcShaderCompiler(HMODULE module, DxcCreateInstanceProc createInstance)
+        : m_Module(module)
+    {
+        ThrowIfFailed(createInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_Utils)));
+        ThrowIfFailed(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_Compiler)));
+        ThrowIfFailed(m_Utils->CreateDefaultIncludeHandler(&m_IncludeHandler));
+    }
+
+    ~DxcShaderCompiler() override
+    {
+        m_IncludeHandler.Reset();
+        m_Compiler.Reset();
+        m_Utils.Reset();
+        FreeLibrary(m_Module);
+    }
+
+    bool Compile(const fs::path& sourceFile, const std::string& entryPoint, const std::string& profile,
+        std::vector<u8>& bytecode, std::string& errors) override
+    {
+        std::ifstream file(sourceFile, std::ios::in | std::ios::binary);
+        if (!file)
+        {
+            errors = "Failed to open " + sourceFile.string();
+            return false;
+        }
+
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string source = stream.str();
+
+        DxcBuffer sourceBuffer;
+        sourceBuffer.Ptr = source.data();
+        sourceBuffer.Size = source.size();
+        sourceBuffer.Encoding = DXC_CP_ACP;
+
+        std::wstring wideEntryPoint(entryPoint.begin(), entryPoint.end());
+        std::wstring wideProfile(profile.begin(), profile.end());
+        std::wstring includeDirectory = sourceFile.parent_path().wstring();
+        std::wstring fileName = sourceFile.wstring();
+
+        // The file name comes first so errors refer to it. Includes are resolved relative to the
+        // source file, like the build does.
+        LPCWSTR arguments[] = {
+            fileName.c_str(),
+            L"-E", wideEntryPoint.c_str(),
+            L"-T", wideProfile.c_str(),
+            L"-I", includeDirectory.c_str(),
+        };
+
+        ComPtr<IDxcResult> result;
+        if (FAILED(m_Compiler->Compile(&sourceBuffer, arguments, _countof(arguments), m_IncludeHandler.Get(),
+                IID_PPV_ARGS(&result))))
+        {
+            errors = "IDxcCompiler3::Compile failed.";
+            return false;
+        }
+
+        ComPtr<IDxcBlobUtf8> errorBlob;
+        if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errorBlob), nullptr)) && errorBlob &&
+            errorBlob->GetStringLength() > 0)
+        {
+            errors.assign(errorBlob->GetStringPointer(), errorBlob->GetStringLength());
+        }
+
+        HRESULT status;
+        if (FAILED(result->GetStatus(&status)) || FAILED(status))
+        {
+            return false;
+        }
+
+        ComPtr<IDxcBlob> objectBlob;
+        if (FAILED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&objectBlob), nullptr)) || !objectBlob)
+        {
+            return false;
+        }
+
+        const u8* data = static_cast<const u8*>(objectBlob->GetBufferPointer());
+        bytecode.assign(data, data + objectBlob->GetBufferSize());
+        return true;
+    }
+
+private:
+    HMODULE                    m_Module;
+    ComPtr<IDxcUtils>          m_Utils;
+    ComPtr<IDxcCompiler3>      m_Compiler;
+    ComPtr<IDxcIncludeHandler> m_IncludeHandler;
+};
+}  // namespace
+
+UniquePtr<ShaderCompiler> ShaderCompiler::CreateDxcCompiler()
+{
+    HMODULE module = LoadLibraryW(L"dxcompiler.dll");
+    if (!module)
+    {
+        return nullptr;
+    }
+
+    auto createInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(module, "DxcCreateInstance"));
+    if (!createInstance)
+    {
+        FreeLibrary(module);
+        return nullptr;
+    }
+
+    try
+    {
+        return MakeUnique<DxcShaderCompiler>(module, createInstance);
+    }
+    catch (const std::exception&)
+    {
+        FreeLibrary(module);
+        return nullptr;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+/**
+ * Compiles HLSL source to shader bytecode. Used by the ShaderManager to
+ * recompile shaders whose source changed.
+ */
+class ShaderCompiler
+{
+public:
+    virtual ~ShaderCompiler() = default;
+
+    /**
+     * Compile a shader. Called from the shader manager's background thread.
+     *
+     * @param sourceFile The HLSL source file. Includes are resolved relative to it.
+     * @param entryPoint The name of the entry point function.
+     * @param profile The target profile, for example cs_6_0.
+     * @param [out] bytecode The compiled shader.
+     * @param [out] errors The compiler errors and warnings.
+     *
+     * @returns false if the shader failed to compile.
+     */
+    virtual bool Compile(const fs::path& sourceFile, const std::string& entryPoint, const std::string& profile,
+        std::vector<u8>& bytecode, std::string& errors) = 0;
+
+    /**
+     * Create a compiler that uses DXC (dxcompiler.dll), like the build.
+     * @returns nullptr if dxcompiler.dll is not available.
+     */
+    static UniquePtr<ShaderCompiler> CreateDxcCompiler();
+};
@@ -0,0 +1,153 @@
+#include "enginepch.h"
+
+#include "ShaderDependencies.h"
+
+#include <FileWatcher.h>
+
+#include <fstream>
+#include <sstream>
+
+static bool ReadTextFile(const fs::path& path, std::string& text)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+std::vector<std::string> ShaderDependencies::ParseIncludes(const std::string& source)
+{
+    std::vector<std::string> includes;
+
+    size_t lineBegin = 0;
+    while (lineBegin < source.size())
+    {
+        size_t lineEnd = source.find('\n', lineBegin);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = source.size();
+        }
+
+        // Match: [whitespace] # [whitespace] include [whitespace] ("path" | <path>)
+        size_t i = source.find_first_not_of(" \t", lineBegin);
+        if (i < lineEnd && source[i] == '#')
+        {
+            i = source.find_first_not_of(" \t", i + 1);
+            if (i < lineEnd && source.compare(i, 7, "include") == 0)
+            {
+                i = source.find_first_not_of(" \t", i + 7);
+                if (i < lineEnd && (source[i] == '"' || source[i] == '<'))
+                {
+                    char   terminator = source[i] == '"' ? '"' : '>';
+                    size_t pathEnd = source.find(terminator, i + 1);
+                    if (pathEnd < lineEnd)
+                    {
+                        includes.push_back(source.substr(i + 1, pathEnd - i - 1));
+                    }
+                }
+            }
+        }
+
+        lineBegin = lineEnd + 1;
+    }
+
+    return includes;
+}
+
+const std::vector<fs::path>& ShaderDependencies::Update(const std::string& shader, const fs::path& sourceFile)
+{
+    Remove(shader);
+
+    std::vector<fs::path> files;
+    std::set<fs::path>    visited;
+    std::vector<fs::path> stack = { FileWatcher::NormalizePath(sourceFile) };
+
+    // The source file is always a dependency, even if it can't be read (yet).
+    while (!stack.empty())
+    {
+        fs::path file = stack.back();
+        stack.pop_back();
+
+        if (!visited.insert(file).second)
+        {
+            continue;
+        }
+        files.push_back(file);
+
+        std::string source;
+        if (!ReadTextFile(file, source))
+        {
+            continue;
+        }
+
+        // Includes are resolved relative to the including file, like the default include handler.
+        for (const auto& include : ParseIncludes(source))
+        {
+            fs::path includePath = FileWatcher::NormalizePath(file.parent_path() / include);
+
+            std::error_code error;
+            if (fs::exists(includePath, error))
+            {
+                stack.push_back(includePath);
+            }
+        }
+    }
+
+    for (const auto& file : files)
+    {
+        m_FileShaders[file].insert(shader);
+    }
+
+    auto& shaderFiles = m_ShaderFiles[shader];
+    shaderFiles = std::move(files);
+    return shaderFiles;
+}
+
+void ShaderDependencies::Remove(const std::string& shader)
+{
+    auto iter = m_ShaderFiles.find(shader);
+    if (iter == m_ShaderFiles.end())
+    {
+        return;
+    }
+
+    for (const auto& file : iter->second)
+    {
+        auto fileShaders = m_FileShaders.find(file);
+        if (fileShaders != m_FileShaders.end())
+        {
+            fileShaders->second.erase(shader);
+            if (fileShaders->second.empty())
+            {
+                m_FileShaders.erase(fileShaders);
+            }
+        }
+    }
+
+    m_ShaderFiles.erase(iter);
+}
+
+std::vector<std::string> ShaderDependencies::GetDependents(const fs::path& file) const
+{
+    auto iter = m_FileShaders.find(FileWatcher::NormalizePath(file));
+    if (iter == m_FileShaders.end())
+    {
+        return {};
+    }
+
+    return std::vector<std::string>(iter->second.begin(), iter->second.end());
+}
+
+const std::vector<fs::path>& ShaderDependencies::GetFiles(const std::string& shader) const
+{
+    static const std::vector<fs::path> noFiles;
+
+    auto iter = m_ShaderFiles.find(shader);
+    return iter != m_ShaderFiles.end() ? iter->second : noFiles;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <unordered_map>
+
+/**
+ * Tracks the source files that every shader is compiled from: the shader's own
+ * source file and the files that it (transitively) includes. Used to find the
+ * shaders that have to be recompiled when a file changes.
+ *
+ * Paths are normalized with FileWatcher::NormalizePath. Not thread safe.
+ */
+class ShaderDependencies
+{
+public:
+    /**
+     * Scan the includes of the shader's source file and replace the files that the
+     * shader depends on. Includes that can't be found are skipped.
+     *
+     * @returns The files that the shader depends on, including its source file.
+     */
+    const std::vector<fs::path>& Update(const std::string& shader, const fs::path& sourceFile);
+
+    void Remove(const std::string& shader);
+
+    // Get the shaders that depend on a file.
+    std::vector<std::string> GetDependents(const fs::path& file) const;
+
+    // Get the files that a shader depends on.
+    const std::vector<fs::path>& GetFiles(const std::string& shader) const;
+
+    /**
+     * Get the paths of the #include directives in HLSL source, in order of
+     * appearance. Both "file" and <file> includes are returned.
+     */
+    static std::vector<std::string> ParseIncludes(const std::string& source);
+
+private:
+    std::unordered_map<std::string, std::vector<fs::path>> m_ShaderFiles;
+    std::map<fs::path, std::set<std::string>>             m_FileShaders;
+};
@@ -0,0 +1,341 @@
+#include "enginepch.h"
+
+#include "ShaderManager.h"
+
+#include <Engine/Core/Application.h>
+#include <Pipeline/ShaderCompiler.h>
+
+namespace
+{
+/**
+ * A compiled shader object that is mapped into memory.
+ */
+class MappedShaderBlob : public ShaderBlob
+{
+public:
+    explicit MappedShaderBlob(const fs::path& path)
+        : m_File(INVALID_HANDLE_VALUE)
+        , m_Mapping(nullptr)
+    {
+        m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_File == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Failed to open shader " + path.string());
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_File, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(m_File);
+            throw std::runtime_error("Empty shader " + path.string());
+        }
+
+        m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        m_Data = m_Mapping ? MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!m_Data)
+        {
+            if (m_Mapping)
+            {
+                CloseHandle(m_Mapping);
+            }
+            CloseHandle(m_File);
+            throw std::runtime_error("Failed to map shader " + path.string());
+        }
+
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+    }
+
+    ~MappedShaderBlob() override
+    {
+        UnmapViewOfFile(m_Data);
+        CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+    }
+
+private:
+    HANDLE m_File;
+    HANDLE m_Mapping;
+};
+
+/**
+ * A recompiled shader.
+ */
+class MemoryShaderBlob : public ShaderBlob
+{
+public:
+    explicit MemoryShaderBlob(std::vector<u8>&& bytecode)
+        : m_Bytecode(std::move(bytecode))
+    {
+        m_Data = m_Bytecode.data();
+        m_Size = m_Bytecode.size();
+    }
+
+private:
+    std::vector<u8> m_Bytecode;
+};
+
+// Shader names are matched case-insensitively, like the file system (ImGuiVS is built from ImguiVS.hlsl).
+std::string ToLower(std::string name)
+{
+    std::transform(name.begin(), name.end(), name.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name;
+}
+}  // namespace
+
+Shader::Shader(const std::string& name, std::shared_ptr<const ShaderBlob> blob)
+    : m_Name(name)
+    , m_Blob(std::move(blob))
+    , m_Version(0)
+{
+    assert(m_Blob);
+}
+
+ShaderManager::ShaderManager(const fs::path& bytecodeDirectory, const fs::path& sourceDirectory,
+    UniquePtr<ShaderCompiler> compiler)
+    : m_BytecodeDirectory(bytecodeDirectory)
+    , m_Compiler(std::move(compiler))
+    , m_StopThread(false)
+{
+    m_Logger = Application::CreateLogger("ShaderManager");
+
+    std::error_code error;
+    if (!fs::is_directory(sourceDirectory, error))
+    {
+        m_Compiler.reset();
+        m_Logger->info("Shader hot reloading is disabled: the shader sources in {} were not found.",
+            sourceDirectory.string());
+        return;
+    }
+
+    if (!m_Compiler)
+    {
+        m_Compiler = ShaderCompiler::CreateDxcCompiler();
+        if (!m_Compiler)
+        {
+            m_Logger->warn("Shader hot reloading is disabled: dxcompiler.dll could not be loaded.");
+            return;
+        }
+    }
+
+    for (const auto& entry : fs::recursive_directory_iterator(sourceDirectory, error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".hlsl")
+        {
+            m_SourceFiles.emplace(ToLower(entry.path().stem().string()), FileWatcher::NormalizePath(entry.path()));
+        }
+    }
+
+    m_FileWatcher.FileChanged += [this](FileChangedEventArgs& e) { OnFileChanged(e); };
+
+    m_Thread = std::thread(&ShaderManager::CompileThread, this);
+    SetThreadName(m_Thread, "Shader Compiler");
+
+    m_Logger->info("Shader hot reloading is enabled for {} shader sources in {}.", m_SourceFiles.size(),
+        sourceDirectory.string());
+}
+
+ShaderManager::~ShaderManager()
+{
+    if (m_Thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_ThreadMutex);
+            m_StopThread = true;
+        }
+        m_ThreadCV.notify_one();
+        m_Thread.join();
+    }
+}
+
+std::string ShaderManager::GetProfile(const std::string& name)
+{
+    static const std::pair<const char*, const char*> profiles[] = {
+        { "VS", "vs_6_0" }, { "PS", "ps_6_0" }, { "GS", "gs_6_0" },
+        { "HS", "hs_6_0" }, { "DS", "ds_6_0" }, { "CS", "cs_6_0" },
+    };
+
+    if (name.size() >= 2)
+    {
+        std::string suffix = name.substr(name.size() - 2);
+        for (const auto& [shaderSuffix, profile] : profiles)
+        {
+            if (suffix == shaderSuffix)
+            {
+                return profile;
+            }
+        }
+    }
+
+    return {};
+}
+
+std::shared_ptr<Shader> ShaderManager::Load(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_ShadersMutex);
+
+    auto iter = m_Shaders.find(name);
+    if (iter != m_Shaders.end())
+    {
+        return iter->second;
+    }
+
+    auto shader = MakeRef<Shader>(name, MakeRef<MappedShaderBlob>(m_BytecodeDirectory / (name + ".cso")));
+    m_Shaders.emplace(name, shader);
+
+    // Watch the source and its includes.
+    auto sourceFile = m_SourceFiles.find(ToLower(name));
+    std::string profile = GetProfile(name);
+    if (m_Compiler && sourceFile != m_SourceFiles.end() && !profile.empty())
+    {
+        m_Sources.emplace(name, ShaderSource{ sourceFile->second, EntryPoint, profile });
+        for (const auto& file : m_Dependencies.Update(name, sourceFile->second))
+        {
+            m_FileWatcher.AddFile(file);
+        }
+    }
+
+    return shader;
+}
+
+void ShaderManager::OnFileChanged(FileChangedEventArgs& e)
+{
+    if (e.Action != FileAction::Modified && e.Action != FileAction::Added)
+    {
+        return;
+    }
+
+    std::vector<std::string> dependents;
+    {
+        std::lock_guard<std::mutex> lock(m_ShadersMutex);
+        dependents = m_Dependencies.GetDependents(e.Path);
+    }
+
+    m_PendingShaders.insert(dependents.begin(), dependents.end());
+}
+
+void ShaderManager::CompileThread()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_ThreadMutex);
+            if (m_ThreadCV.wait_for(lock, PollInterval, [this] { return m_StopThread; }))
+            {
+                return;
+            }
+        }
+
+        // Invokes OnFileChanged on this thread.
+        m_FileWatcher.Poll();
+
+        auto pendingShaders = std::move(m_PendingShaders);
+        m_PendingShaders.clear();
+
+        for (const auto& name : pendingShaders)
+        {
+            Compile(name);
+        }
+    }
+}
+
+void ShaderManager::Compile(const std::string& name)
+{
+    std::shared_ptr<Shader> shader;
+    ShaderSource            source;
+    {
+        std::lock_guard<std::mutex> lock(m_ShadersMutex);
+        shader = m_Shaders.at(name);
+        source = m_Sources.at(name);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<u8> bytecode;
+    std::string     errors;
+    bool            compiled = m_Compiler->Compile(source.Path, source.EntryPoint, source.Profile, bytecode, errors);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    {
+        // The includes may have changed.
+        std::lock_guard<std::mutex> lock(m_ShadersMutex);
+        for (const auto& file : m_Dependencies.Update(name, source.Path))
+        {
+            m_FileWatcher.AddFile(file);
+        }
+    }
+
+    if (!compiled)
+    {
+        m_Logger->error("Failed to recompile shader {}, keeping the previous version:\n{}", name, errors);
+        return;
+    }
+
+    if (!errors.empty())
+    {
+        m_Logger->warn("Shader {}:\n{}", name, errors);
+    }
+    m_Logger->info("Recompiled shader {} in {:.1f} ms.", name, elapsed.count());
+
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    m_Results.push_back({ shader, MakeRef<MemoryShaderBlob>(std::move(bytecode)) });
+}
+
+void ShaderManager::Update()
+{
+    std::vector<CompileResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_ResultsMutex);
+        results.swap(m_Results);
+    }
+
+    for (auto& result : results)
+    {
+        Shader& shader = *result.CompiledShader;
+
+        auto previousBlob = shader.m_Blob;
+        shader.m_Blob = result.Blob;
+        ++shader.m_Version;
+
+        try
+        {
+            EventArgs eventArgs;
+            shader.Reloaded(eventArgs);
+
+            // The owners created their pipelines from the new bytecode, so the pipelines of the
+            // previous version would only take up memory and space in the pipeline library.
+            ShaderBytecodeEventArgs retiredEventArgs(shader.GetName(),
+                { previousBlob->GetBufferPointer(), previousBlob->GetBufferSize() });
+            BytecodeRetired(retiredEventArgs);
+        }
+        catch (const std::exception& e)
+        {
+            // For example, the new shader does not match the root signature. Go back to the previous
+            // bytecode and let the owners recreate their pipelines from it.
+            m_Logger->error("Failed to create the pipelines for shader {}, keeping the previous version: {}",
+                shader.GetName(), e.what());
+
+            shader.m_Blob = previousBlob;
+            ++shader.m_Version;
+
+            try
+            {
+                EventArgs eventArgs;
+                shader.Reloaded(eventArgs);
+            }
+            catch (const std::exception& previousError)
+            {
+                // Update runs between frames, so it doesn't throw. The owners that failed keep the
+                // pipelines they had, if any.
+                m_Logger->error("Failed to recreate the pipelines for the previous version of shader {}: {}",
+                    shader.GetName(), previousError.what());
+            }
+
+            ShaderBytecodeEventArgs retiredEventArgs(shader.GetName(),
+                { result.Blob->GetBufferPointer(), result.Blob->GetBufferSize() });
+            BytecodeRetired(retiredEventArgs);
+        }
+    }
+}
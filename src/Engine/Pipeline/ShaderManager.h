@@ -0,0 +1,205 @@
+/**
+ * Loads compiled shaders and hot reloads them when their source changes.
+ *
+ * Shaders are loaded by name from the compiled shader objects (<name>.cso) that
+ * the build writes next to the executable. The objects are memory-mapped rather
+ * than read into memory.
+ *
+ * If the HLSL sources are available (<name>.hlsl anywhere below the source
+ * directory) and a compiler can be created, a background thread watches the
+ * sources and the files they include. Changed shaders are recompiled on that
+ * thread, and Update swaps in the new bytecode on the main thread and invokes
+ * Shader::Reloaded, where the owners recreate their pipeline state objects.
+ * Since that happens between frames, a frame never sees a mix of old and new
+ * pipelines. If a shader fails to compile, the previous bytecode is kept. The
+ * bytecode that is replaced is reported by BytecodeRetired, so the pipelines
+ * that were created from it can be evicted from the pipeline state cache.
+ */
+#pragma once
+
+#include <Engine/Core/Events.h>
+#include <Engine/Core/FileWatcher.h>
+#include <Engine/Pipeline/ShaderDependencies.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+class ShaderCompiler;
+
+/**
+ * Immutable shader bytecode.
+ */
+class ShaderBlob
+{
+public:
+    virtual ~ShaderBlob() = default;
+
+    const void* GetBufferPointer() const
+    {
+        return m_Data;
+    }
+
+    size_t GetBufferSize() const
+    {
+        return m_Size;
+    }
+
+protected:
+    const void* m_Data = nullptr;
+    size_t      m_Size = 0;
+};
+
+class Shader
+{
+public:
+    Shader(const std::string& name, std::shared_ptr<const ShaderBlob> blob);
+
+    const std::string& GetName() const
+    {
+        return m_Name;
+    }
+
+    /**
+     * Get the bytecode for a pipeline state stream. Only valid until the shader is
+     * reloaded, so only access it from the main thread.
+     */
+    D3D12_SHADER_BYTECODE GetBytecode() const
+    {
+        return { m_Blob->GetBufferPointer(), m_Blob->GetBufferSize() };
+    }
+
+    // Incremented every time the shader is reloaded.
+    u32 GetVersion() const
+    {
+        return m_Version;
+    }
+
+    /**
+     * Invoked on the main thread (from ShaderManager::Update) after the shader was
+     * recompiled. Recreate the pipeline state objects that use the shader here.
+     */
+    Event Reloaded;
+
+private:
+    friend class ShaderManager;
+
+    std::string                       m_Name;
+    std::shared_ptr<const ShaderBlob> m_Blob;
+    u32                               m_Version;
+};
+
+/**
+ * Bytecode of a shader that is not used anymore after a reload.
+ */
+class ShaderBytecodeEventArgs : public EventArgs
+{
+public:
+    using base = EventArgs;
+
+    ShaderBytecodeEventArgs(const std::string& shaderName, const D3D12_SHADER_BYTECODE& bytecode)
+        : base()
+        , ShaderName(shaderName)
+        , Bytecode(bytecode)
+    {}
+
+    const std::string&    ShaderName;  // The name of the reloaded shader.
+    D3D12_SHADER_BYTECODE Bytecode;    // Only valid during the event.
+};
+using ShaderBytecodeEvent = _Delegate<void(ShaderBytecodeEventArgs&)>;
+
+class ShaderManager
+{
+public:
+    /**
+     * @param bytecodeDirectory The directory with the compiled shader objects.
+     * @param sourceDirectory The directory with the HLSL sources. Hot reloading is
+     * disabled if it does not exist.
+     * @param compiler (Optional) the compiler used to recompile shaders. By default DXC is used.
+     */
+    ShaderManager(const fs::path& bytecodeDirectory, const fs::path& sourceDirectory,
+        UniquePtr<ShaderCompiler> compiler = nullptr);
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    /**
+     * Load a compiled shader by name, for example "MaterialResolveCS". Loading the
+     * same shader again returns the same Shader. Throws if the shader object can't
+     * be loaded.
+     */
+    std::shared_ptr<Shader> Load(const std::string& name);
+
+    /**
+     * Apply the shaders that were recompiled since the last update. Must be called
+     * on the main thread, between frames.
+     */
+    void Update();
+
+    bool IsHotReloadEnabled() const
+    {
+        return m_Compiler != nullptr;
+    }
+
+    /**
+     * Invoked by Update, after Shader::Reloaded, with the bytecode that the shader
+     * doesn't use anymore: the previous bytecode, or the new bytecode if the owners
+     * failed to create their pipelines from it.
+     */
+    ShaderBytecodeEvent BytecodeRetired;
+
+    // The entry point of the shaders, the one the build compiles them with (the default of premake's shaderentry).
+    static constexpr const char* EntryPoint = "main";
+
+    // How often the background thread checks the sources for changes.
+    static constexpr std::chrono::milliseconds PollInterval{ 250 };
+
+    // The target profile of a shader, derived from the suffix of its name like the build
+    // does (VS, PS, GS, HS, DS, CS), for example cs_6_0.
+    static std::string GetProfile(const std::string& name);
+
+private:
+    struct ShaderSource
+    {
+        fs::path    Path;
+        std::string EntryPoint;
+        std::string Profile;
+    };
+
+    struct CompileResult
+    {
+        std::shared_ptr<Shader>           CompiledShader;
+        std::shared_ptr<const ShaderBlob> Blob;
+    };
+
+    void OnFileChanged(FileChangedEventArgs& e);
+    void CompileThread();
+    void Compile(const std::string& name);
+
+    fs::path                  m_BytecodeDirectory;
+    RefPtr<spdlog::logger>    m_Logger;
+    UniquePtr<ShaderCompiler> m_Compiler;
+    // The HLSL source of every shader below the source directory, by lower case name. Constant after construction.
+    std::unordered_map<std::string, fs::path> m_SourceFiles;
+
+    // Guards the shaders, sources and dependencies, which are used by Load and the compile thread.
+    std::mutex                                               m_ShadersMutex;
+    std::unordered_map<std::string, std::shared_ptr<Shader>> m_Shaders;
+    std::unordered_map<std::string, ShaderSource>            m_Sources;
+    ShaderDependencies                                       m_Dependencies;
+
+    FileWatcher m_FileWatcher;
+    // Shaders that have to be recompiled. Only used by the compile thread.
+    std::unordered_set<std::string> m_PendingShaders;
+
+    std::mutex                 m_ResultsMutex;
+    std::vector<CompileResult> m_Results;
+
+    std::thread             m_Thread;
+    std::mutex              m_ThreadMutex;
+    std::condition_variable m_ThreadCV;
+    bool                    m_StopThread;
+};
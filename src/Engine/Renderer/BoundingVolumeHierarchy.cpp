@@ -0,0 +1,657 @@
+#include <enginepch.h>
+#include "BoundingVolumeHierarchy.h"
+
+#include <JobSystem.h>
+
+#include <atomic>
+
+namespace
+{
+// The number of bins per axis for the SAH evaluation.
+constexpr u32 NumBins = 16;
+// A node with more items is always split.
+constexpr u32 MaxLeafItems = 4;
+// The relative costs of visiting a node and of testing an item, for the SAH.
+constexpr float TraversalCost = 1.0f;
+constexpr float IntersectionCost = 1.0f;
+// Subtrees with more items are built on another job.
+constexpr u32 ParallelBuildThreshold = 4096;
+// The minimum number of nodes (or items) refit by a single job.
+constexpr u32 RefitGrainSize = 2048;
+
+struct Bounds
+{
+	XMVECTOR Min = g_XMFltMax;
+	XMVECTOR Max = XMVectorNegate(g_XMFltMax);
+
+	void XM_CALLCONV Grow(FXMVECTOR min, FXMVECTOR max)
+	{
+		Min = XMVectorMin(Min, min);
+		Max = XMVectorMax(Max, max);
+	}
+
+	void Grow(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		Grow(XMLoadFloat3(&min), XMLoadFloat3(&max));
+	}
+
+	void Grow(const Bounds& other)
+	{
+		Grow(other.Min, other.Max);
+	}
+
+	float GetArea() const
+	{
+		XMFLOAT3 size;
+		XMStoreFloat3(&size, XMVectorSubtract(Max, Min));
+		return size.x < 0.0f ? 0.0f : 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+};
+
+float GetComponent(const XMFLOAT3& v, u32 axis)
+{
+	return (&v.x)[axis];
+}
+
+// The distance along the ray to the box, or FLT_MAX if the box is missed.
+float IntersectBox(const XMFLOAT3& min, const XMFLOAT3& max, const Vector3& origin, const Vector3& inverseDirection,
+	float maxDistance)
+{
+	float tx1 = (min.x - origin.x) * inverseDirection.x;
+	float tx2 = (max.x - origin.x) * inverseDirection.x;
+	float ty1 = (min.y - origin.y) * inverseDirection.y;
+	float ty2 = (max.y - origin.y) * inverseDirection.y;
+	float tz1 = (min.z - origin.z) * inverseDirection.z;
+	float tz2 = (max.z - origin.z) * inverseDirection.z;
+
+	float tNear = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+	float tFar = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), maxDistance });
+
+	return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+enum class Containment
+{
+	Outside,
+	Intersects,
+	Inside,
+};
+
+Containment Classify(const Frustum& frustum, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float cx = (min.x + max.x) * 0.5f, cy = (min.y + max.y) * 0.5f, cz = (min.z + max.z) * 0.5f;
+	float ex = (max.x - min.x) * 0.5f, ey = (max.y - min.y) * 0.5f, ez = (max.z - min.z) * 0.5f;
+
+	Containment result = Containment::Inside;
+	for (const auto& plane : frustum.m_Planes)
+	{
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float radius = std::abs(plane.x) * ex + std::abs(plane.y) * ey + std::abs(plane.z) * ez;
+		if (distance + radius < 0.0f)
+		{
+			return Containment::Outside;
+		}
+		if (distance - radius < 0.0f)
+		{
+			result = Containment::Intersects;
+		}
+	}
+
+	return result;
+}
+
+float DistanceSquared(const XMFLOAT3& min, const XMFLOAT3& max, const Vector3& position)
+{
+	Vector3 center((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+	return Vector3::DistanceSquared(center, position);
+}
+}  // namespace
+
+struct BoundingVolumeHierarchy::BuildContext
+{
+	// The items are copied into contiguous records that are partitioned in place, so the
+	// build reads memory sequentially instead of following item indices.
+	struct Item
+	{
+		XMFLOAT4 Min;
+		XMFLOAT4 Max;
+		XMFLOAT4 Centroid;
+		u32      Index;
+	};
+
+	JobSystem*        Jobs;
+	std::vector<Item> Items;
+	std::vector<u32>  Depths;
+	std::atomic<u32>  NumNodes;
+};
+
+void BoundingVolumeHierarchy::Clear()
+{
+	m_Nodes.clear();
+	m_Parents.clear();
+	m_ItemIndices.clear();
+	m_ItemLeaves.clear();
+	m_ItemMin.clear();
+	m_ItemMax.clear();
+	m_LevelNodes.clear();
+	m_LevelOffsets.clear();
+}
+
+void BoundingVolumeHierarchy::Build(const std::vector<BoundingBox>& items, JobSystem* jobSystem)
+{
+	Clear();
+
+	const u32 numItems = static_cast<u32>(items.size());
+	if (numItems == 0)
+	{
+		return;
+	}
+
+	BuildContext context;
+	context.Jobs = jobSystem;
+	context.Items.resize(numItems);
+	context.NumNodes = 1;
+
+	m_ItemMin.resize(numItems);
+	m_ItemMax.resize(numItems);
+	m_ItemIndices.resize(numItems);
+	for (u32 i = 0; i < numItems; ++i)
+	{
+		const auto& box = items[i];
+		m_ItemMin[i] = { box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z };
+		m_ItemMax[i] = { box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+		context.Items[i] = { XMFLOAT4(m_ItemMin[i].x, m_ItemMin[i].y, m_ItemMin[i].z, 0.0f),
+			XMFLOAT4(m_ItemMax[i].x, m_ItemMax[i].y, m_ItemMax[i].z, 0.0f),
+			XMFLOAT4(box.Center.x, box.Center.y, box.Center.z, 0.0f), i };
+	}
+
+	// A binary tree with at least one item per leaf has at most 2n - 1 nodes.
+	m_Nodes.resize(2 * numItems - 1);
+	context.Depths.resize(2 * numItems - 1);
+
+	BuildNode(context, 0, 0, numItems, 0);
+
+	const u32 numNodes = context.NumNodes;
+	m_Nodes.resize(numNodes);
+
+	m_Parents.assign(numNodes, ~0u);
+	m_ItemLeaves.resize(numItems);
+	u32 maxDepth = 0;
+	for (u32 nodeIndex = 0; nodeIndex < numNodes; ++nodeIndex)
+	{
+		const Node& node = m_Nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (u32 i = node.First; i < node.First + node.NumItems; ++i)
+			{
+				m_ItemLeaves[m_ItemIndices[i]] = nodeIndex;
+			}
+		}
+		else
+		{
+			m_Parents[node.First] = nodeIndex;
+			m_Parents[node.First + 1] = nodeIndex;
+		}
+		maxDepth = std::max(maxDepth, context.Depths[nodeIndex]);
+	}
+
+	// Sort the nodes by depth for the parallel refit (counting sort).
+	m_LevelOffsets.assign(maxDepth + 2, 0);
+	for (u32 nodeIndex = 0; nodeIndex < numNodes; ++nodeIndex)
+	{
+		++m_LevelOffsets[context.Depths[nodeIndex] + 1];
+	}
+	for (u32 depth = 1; depth < m_LevelOffsets.size(); ++depth)
+	{
+		m_LevelOffsets[depth] += m_LevelOffsets[depth - 1];
+	}
+
+	m_LevelNodes.resize(numNodes);
+	std::vector<u32> offsets(m_LevelOffsets.begin(), m_LevelOffsets.end() - 1);
+	for (u32 nodeIndex = 0; nodeIndex < numNodes; ++nodeIndex)
+	{
+		m_LevelNodes[offsets[context.Depths[nodeIndex]]++] = nodeIndex;
+	}
+}
+
+void BoundingVolumeHierarchy::BuildNode(BuildContext& context, u32 nodeIndex, u32 begin, u32 end, u32 depth)
+{
+	context.Depths[nodeIndex] = depth;
+
+	const auto first = context.Items.begin() + begin;
+	const auto last = context.Items.begin() + end;
+
+	Bounds bounds;
+	Bounds centroidBounds;
+	for (auto item = first; item != last; ++item)
+	{
+		bounds.Grow(XMLoadFloat4(&item->Min), XMLoadFloat4(&item->Max));
+		XMVECTOR centroid = XMLoadFloat4(&item->Centroid);
+		centroidBounds.Grow(centroid, centroid);
+	}
+
+	Node& node = m_Nodes[nodeIndex];
+	XMStoreFloat3(&node.Min, bounds.Min);
+	XMStoreFloat3(&node.Max, bounds.Max);
+
+	const u32 count = end - begin;
+	auto makeLeaf = [&]()
+	{
+		node.First = begin;
+		node.NumItems = count;
+		for (u32 i = begin; i < end; ++i)
+		{
+			m_ItemIndices[i] = context.Items[i].Index;
+		}
+	};
+
+	if (count == 1)
+	{
+		makeLeaf();
+		return;
+	}
+
+	// Find the cheapest split over the bins of the three axes. The costs are not divided by
+	// the area of the node, so nodes with a zero area (points) are handled too.
+	XMFLOAT3 axisMin;
+	XMFLOAT3 axisExtent;
+	XMStoreFloat3(&axisMin, centroidBounds.Min);
+	XMStoreFloat3(&axisExtent, XMVectorSubtract(centroidBounds.Max, centroidBounds.Min));
+
+	XMFLOAT3 axisScale;
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		float extent = GetComponent(axisExtent, axis);
+		(&axisScale.x)[axis] = extent > 0.0f ? NumBins / extent : 0.0f;
+	}
+
+	// Bin the items on all axes in one pass.
+	const XMVECTOR binOffset = centroidBounds.Min;
+	const XMVECTOR binScale = XMLoadFloat3(&axisScale);
+	const XMVECTOR maxBin = XMVectorReplicate(static_cast<float>(NumBins - 1));
+
+	Bounds binBounds[3][NumBins];
+	u32    binCounts[3][NumBins] = {};
+	for (auto item = first; item != last; ++item)
+	{
+		XMVECTOR min = XMLoadFloat4(&item->Min);
+		XMVECTOR max = XMLoadFloat4(&item->Max);
+
+		XMFLOAT3 bins;
+		XMStoreFloat3(&bins, XMVectorMin(XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&item->Centroid), binOffset), binScale), maxBin));
+
+		for (u32 axis = 0; axis < 3; ++axis)
+		{
+			u32 bin = static_cast<u32>(GetComponent(bins, axis));
+			binBounds[axis][bin].Grow(min, max);
+			++binCounts[axis][bin];
+		}
+	}
+
+	float bestCost = FLT_MAX;
+	u32   bestAxis = 0;
+	u32   bestSplit = 0;
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		if (GetComponent(axisScale, axis) == 0.0f)
+		{
+			continue;
+		}
+
+		// Sweep from the right to get the cost of the right side of every split plane.
+		float  rightCosts[NumBins];
+		Bounds right;
+		u32    rightCount = 0;
+		for (u32 bin = NumBins - 1; bin > 0; --bin)
+		{
+			right.Grow(binBounds[axis][bin]);
+			rightCount += binCounts[axis][bin];
+			rightCosts[bin] = rightCount ? right.GetArea() * rightCount : FLT_MAX;
+		}
+
+		Bounds left;
+		u32    leftCount = 0;
+		for (u32 split = 1; split < NumBins; ++split)
+		{
+			left.Grow(binBounds[axis][split - 1]);
+			leftCount += binCounts[axis][split - 1];
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+
+			float cost = left.GetArea() * leftCount + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	u32 middle;
+	if (bestSplit == 0)
+	{
+		// All centroids are the same, split in the middle.
+		if (count <= MaxLeafItems)
+		{
+			makeLeaf();
+			return;
+		}
+		middle = begin + count / 2;
+	}
+	else
+	{
+		float area = bounds.GetArea();
+		float splitCost = TraversalCost * area + IntersectionCost * bestCost;
+		float leafCost = IntersectionCost * count * area;
+		if (count <= MaxLeafItems && leafCost <= splitCost)
+		{
+			makeLeaf();
+			return;
+		}
+
+		// The same computation as the binning, so the items end up on the side of their bin.
+		const float offset = GetComponent(axisMin, bestAxis);
+		const float scale = GetComponent(axisScale, bestAxis);
+		auto split = std::partition(first, last,
+			[&](const BuildContext::Item& item)
+			{
+				float bin = std::min(static_cast<float>(NumBins - 1), ((&item.Centroid.x)[bestAxis] - offset) * scale);
+				return static_cast<u32>(bin) < bestSplit;
+			});
+		middle = static_cast<u32>(split - context.Items.begin());
+	}
+
+	const u32 firstChild = context.NumNodes.fetch_add(2);
+	node.First = firstChild;
+	node.NumItems = 0;
+
+	if (context.Jobs && count > ParallelBuildThreshold)
+	{
+		JobCounter counter;
+		context.Jobs->Schedule([this, &context, firstChild, begin, middle, depth]
+			{ BuildNode(context, firstChild, begin, middle, depth + 1); }, &counter);
+		BuildNode(context, firstChild + 1, middle, end, depth + 1);
+		context.Jobs->Wait(counter);
+	}
+	else
+	{
+		BuildNode(context, firstChild, begin, middle, depth + 1);
+		BuildNode(context, firstChild + 1, middle, end, depth + 1);
+	}
+}
+
+void BoundingVolumeHierarchy::RefitNode(u32 nodeIndex)
+{
+	Node& node = m_Nodes[nodeIndex];
+
+	Bounds bounds;
+	if (node.IsLeaf())
+	{
+		for (u32 i = node.First; i < node.First + node.NumItems; ++i)
+		{
+			bounds.Grow(m_ItemMin[m_ItemIndices[i]], m_ItemMax[m_ItemIndices[i]]);
+		}
+	}
+	else
+	{
+		bounds.Grow(m_Nodes[node.First].Min, m_Nodes[node.First].Max);
+		bounds.Grow(m_Nodes[node.First + 1].Min, m_Nodes[node.First + 1].Max);
+	}
+
+	XMStoreFloat3(&node.Min, bounds.Min);
+	XMStoreFloat3(&node.Max, bounds.Max);
+}
+
+void BoundingVolumeHierarchy::Refit(const std::vector<BoundingBox>& items, JobSystem* jobSystem)
+{
+	assert(items.size() == m_ItemLeaves.size() && "Refit needs the items of the last Build.");
+
+	auto parallelFor = [jobSystem](u32 begin, u32 end, auto&& func)
+	{
+		if (jobSystem && end - begin > RefitGrainSize)
+		{
+			jobSystem->ParallelFor(begin, end, RefitGrainSize, func);
+		}
+		else
+		{
+			func(begin, end);
+		}
+	};
+
+	parallelFor(0, static_cast<u32>(items.size()), [&](u32 begin, u32 end)
+		{
+			for (u32 i = begin; i < end; ++i)
+			{
+				const auto& box = items[i];
+				m_ItemMin[i] = { box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z };
+				m_ItemMax[i] = { box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+			}
+		});
+
+	// Bottom up: the nodes of a level only read the boxes of the level below.
+	for (u32 depth = GetDepth(); depth-- > 0;)
+	{
+		parallelFor(m_LevelOffsets[depth], m_LevelOffsets[depth + 1], [this](u32 begin, u32 end)
+			{
+				for (u32 i = begin; i < end; ++i)
+				{
+					RefitNode(m_LevelNodes[i]);
+				}
+			});
+	}
+}
+
+void BoundingVolumeHierarchy::UpdateItem(u32 item, const BoundingBox& box)
+{
+	m_ItemMin[item] = { box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z };
+	m_ItemMax[item] = { box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+
+	// Walk up until a box doesn't change, the ancestors above it don't change either.
+	for (u32 nodeIndex = m_ItemLeaves[item]; nodeIndex != ~0u; nodeIndex = m_Parents[nodeIndex])
+	{
+		Node previous = m_Nodes[nodeIndex];
+		RefitNode(nodeIndex);
+
+		const Node& node = m_Nodes[nodeIndex];
+		if (node.Min.x == previous.Min.x && node.Min.y == previous.Min.y && node.Min.z == previous.Min.z &&
+			node.Max.x == previous.Max.x && node.Max.y == previous.Max.y && node.Max.z == previous.Max.z)
+		{
+			break;
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, std::vector<u32>& items,
+	const Vector3* viewPosition) const
+{
+	items.clear();
+	if (m_Nodes.empty())
+	{
+		return;
+	}
+
+	// The items of a subtree are contiguous, from the first item of its leftmost leaf to the
+	// last item of its rightmost leaf.
+	auto addSubtree = [&](u32 nodeIndex)
+	{
+		u32 first = nodeIndex;
+		while (!m_Nodes[first].IsLeaf())
+		{
+			first = m_Nodes[first].First;
+		}
+		u32 last = nodeIndex;
+		while (!m_Nodes[last].IsLeaf())
+		{
+			last = m_Nodes[last].First + 1;
+		}
+
+		items.insert(items.end(), m_ItemIndices.begin() + m_Nodes[first].First,
+			m_ItemIndices.begin() + m_Nodes[last].First + m_Nodes[last].NumItems);
+	};
+
+	// A depth first traversal has at most one pending sibling per level.
+	std::vector<u32> stack;
+	stack.reserve(GetDepth() + 1);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		u32 nodeIndex = stack.back();
+		stack.pop_back();
+
+		const Node& node = m_Nodes[nodeIndex];
+
+		Containment containment = Classify(frustum, node.Min, node.Max);
+		if (containment == Containment::Outside)
+		{
+			continue;
+		}
+
+		if (containment == Containment::Inside && !viewPosition)
+		{
+			addSubtree(nodeIndex);
+		}
+		else if (node.IsLeaf())
+		{
+			for (u32 i = node.First; i < node.First + node.NumItems; ++i)
+			{
+				u32 item = m_ItemIndices[i];
+				if (containment == Containment::Inside || Classify(frustum, m_ItemMin[item], m_ItemMax[item]) != Containment::Outside)
+				{
+					items.push_back(item);
+				}
+			}
+		}
+		else
+		{
+			// Push the far child first, so the near child is visited first.
+			u32 nearChild = node.First;
+			u32 farChild = node.First + 1;
+			if (viewPosition && DistanceSquared(m_Nodes[farChild].Min, m_Nodes[farChild].Max, *viewPosition) <
+				DistanceSquared(m_Nodes[nearChild].Min, m_Nodes[nearChild].Max, *viewPosition))
+			{
+				std::swap(nearChild, farChild);
+			}
+
+			stack.push_back(farChild);
+			stack.push_back(nearChild);
+		}
+	}
+}
+
+BoundingVolumeHierarchy::RayHit BoundingVolumeHierarchy::Raycast(const Vector3& origin, const Vector3& direction,
+	float maxDistance, const RayItemTest& itemTest) const
+{
+	RayHit hit;
+	hit.Distance = maxDistance;
+	if (m_Nodes.empty())
+	{
+		return hit;
+	}
+
+	const Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	struct Entry
+	{
+		u32   Node;
+		float Distance;
+	};
+	std::vector<Entry> stack;
+	stack.reserve(GetDepth() + 1);
+
+	float rootDistance = IntersectBox(m_Nodes[0].Min, m_Nodes[0].Max, origin, inverseDirection, hit.Distance);
+	if (rootDistance != FLT_MAX)
+	{
+		stack.push_back({ 0, rootDistance });
+	}
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+		if (entry.Distance > hit.Distance)
+		{
+			continue;
+		}
+
+		const Node& node = m_Nodes[entry.Node];
+		if (node.IsLeaf())
+		{
+			for (u32 i = node.First; i < node.First + node.NumItems; ++i)
+			{
+				u32   item = m_ItemIndices[i];
+				float distance = IntersectBox(m_ItemMin[item], m_ItemMax[item], origin, inverseDirection, hit.Distance);
+				if (distance == FLT_MAX)
+				{
+					continue;
+				}
+
+				if (itemTest)
+				{
+					distance = itemTest(item, distance);
+				}
+
+				if (distance >= 0.0f && distance <= hit.Distance)
+				{
+					hit.Item = item;
+					hit.Distance = distance;
+				}
+			}
+			continue;
+		}
+
+		Entry left = { node.First, IntersectBox(m_Nodes[node.First].Min, m_Nodes[node.First].Max, origin,
+			inverseDirection, hit.Distance) };
+		Entry right = { node.First + 1, IntersectBox(m_Nodes[node.First + 1].Min, m_Nodes[node.First + 1].Max,
+			origin, inverseDirection, hit.Distance) };
+		if (left.Distance < right.Distance)
+		{
+			std::swap(left, right);
+		}
+
+		// Push the far child first, so the near child is visited first.
+		if (left.Distance != FLT_MAX)
+		{
+			stack.push_back(left);
+		}
+		if (right.Distance != FLT_MAX)
+		{
+			stack.push_back(right);
+		}
+	}
+
+	return hit;
+}
+
+float BoundingVolumeHierarchy::GetSAHCost() const
+{
+	if (m_Nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	auto getArea = [](const Node& node)
+	{
+		Bounds bounds;
+		bounds.Grow(node.Min, node.Max);
+		return bounds.GetArea();
+	};
+
+	float rootArea = getArea(m_Nodes[0]);
+	if (rootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float cost = 0.0f;
+	for (const Node& node : m_Nodes)
+	{
+		float area = getArea(node) / rootArea;
+		cost += node.IsLeaf() ? IntersectionCost * node.NumItems * area : TraversalCost * area;
+	}
+
+	return cost;
+}
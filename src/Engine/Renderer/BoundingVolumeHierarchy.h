@@ -0,0 +1,143 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <Engine/Renderer/FrustumCulling.h>
+
+class JobSystem;
+
+/**
+ * Bounding volume hierarchy over world space boxes (items), for frustum and ray
+ * queries over large scenes.
+ *
+ * The tree is built top-down with the surface area heuristic (SAH), evaluated
+ * on a fixed number of bins per axis. Large subtrees are built in parallel on
+ * the job system. When items move, the tree is refit (the node boxes are
+ * recomputed, the topology is kept), which is much cheaper than a rebuild but
+ * degrades the tree when items move far; rebuild when GetSAHCost grows too much.
+ */
+class BoundingVolumeHierarchy
+{
+public:
+	struct RayHit
+	{
+		u32   Item = ~0u;
+		float Distance = FLT_MAX;
+
+		bool IsHit() const
+		{
+			return Item != ~0u;
+		}
+	};
+
+	/**
+	 * Exact intersection test for an item whose box is hit by a ray.
+	 *
+	 * @param item The index of the item.
+	 * @param boxDistance The distance along the ray to the item's box.
+	 * @returns The distance to the hit, or a negative value if the item is missed.
+	 */
+	using RayItemTest = std::function<float(u32 item, float boxDistance)>;
+
+	/**
+	 * Build the tree. Replaces the previous tree.
+	 *
+	 * @param items The boxes. The index of a box is the item index used by the queries.
+	 * @param jobSystem (Optional) build large subtrees in parallel.
+	 */
+	void Build(const std::vector<DirectX::BoundingBox>& items, JobSystem* jobSystem = nullptr);
+
+	void Clear();
+
+	/**
+	 * Recompute all node boxes from new item boxes. The items must be the same as
+	 * in the last Build, only their boxes changed.
+	 *
+	 * @param jobSystem (Optional) refit each level of the tree in parallel.
+	 */
+	void Refit(const std::vector<DirectX::BoundingBox>& items, JobSystem* jobSystem = nullptr);
+
+	/**
+	 * Change the box of a single item and refit its ancestors. Cheaper than Refit
+	 * when only a few items move.
+	 */
+	void UpdateItem(u32 item, const DirectX::BoundingBox& box);
+
+	/**
+	 * Find the items whose boxes intersect the frustum.
+	 *
+	 * @param [out] items The indices of the visible items.
+	 * @param viewPosition (Optional) visit nearer subtrees first, so the items are
+	 * roughly sorted front to back (occluders first, for occlusion culling).
+	 */
+	void QueryFrustum(const Frustum& frustum, std::vector<u32>& items, const Vector3* viewPosition = nullptr) const;
+
+	/**
+	 * Find the closest item hit by a ray.
+	 *
+	 * @param direction Normalized ray direction.
+	 * @param itemTest (Optional) exact test of the items. Without it the boxes are the hits.
+	 */
+	RayHit Raycast(const Vector3& origin, const Vector3& direction, float maxDistance = FLT_MAX,
+		const RayItemTest& itemTest = nullptr) const;
+
+	/**
+	 * The SAH cost of the tree relative to the root box: the expected cost of a
+	 * random ray query. Lower is better.
+	 */
+	float GetSAHCost() const;
+
+	size_t GetNumItems() const
+	{
+		return m_ItemLeaves.size();
+	}
+
+	size_t GetNumNodes() const
+	{
+		return m_Nodes.size();
+	}
+
+	u32 GetDepth() const
+	{
+		return m_LevelOffsets.empty() ? 0 : static_cast<u32>(m_LevelOffsets.size() - 1);
+	}
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		// The first child for an internal node (the children are adjacent), the first item in m_ItemIndices for a leaf.
+		u32               First;
+		DirectX::XMFLOAT3 Max;
+		// The number of items of a leaf, 0 for an internal node.
+		u32               NumItems;
+
+		bool IsLeaf() const
+		{
+			return NumItems != 0;
+		}
+	};
+
+	struct BuildContext;
+
+	void BuildNode(BuildContext& context, u32 nodeIndex, u32 begin, u32 end, u32 depth);
+
+	// Recompute the box of a node from its children or items.
+	void RefitNode(u32 nodeIndex);
+
+	std::vector<Node> m_Nodes;
+	std::vector<u32>  m_Parents;
+
+	// The items of the leaves, in leaf order.
+	std::vector<u32> m_ItemIndices;
+	// The leaf of each item.
+	std::vector<u32> m_ItemLeaves;
+
+	std::vector<DirectX::XMFLOAT3> m_ItemMin;
+	std::vector<DirectX::XMFLOAT3> m_ItemMax;
+
+	// The nodes sorted by depth. Level d is m_LevelNodes[m_LevelOffsets[d], m_LevelOffsets[d + 1]).
+	std::vector<u32> m_LevelNodes;
+	std::vector<u32> m_LevelOffsets;
+};
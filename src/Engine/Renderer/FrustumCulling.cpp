@@ -0,0 +1,270 @@
+#include <enginepch.h>
+#include "FrustumCulling.h"
+
+#include <bit>
+#include <cmath>
+#include <immintrin.h>
+#include <intrin.h>
+
+Frustum XM_CALLCONV Frustum::FromViewProjection(FXMMATRIX viewProjection)
+{
+	// With row vectors, clip = v * M, so the clip coordinates are dot products with the columns of M.
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR planes[NumPlanes];
+	planes[Left] = XMVectorAdd(columns.r[3], columns.r[0]);      // -w <= x
+	planes[Right] = XMVectorSubtract(columns.r[3], columns.r[0]); //  x <= w
+	planes[Bottom] = XMVectorAdd(columns.r[3], columns.r[1]);    // -w <= y
+	planes[Top] = XMVectorSubtract(columns.r[3], columns.r[1]);   //  y <= w
+	planes[Near] = columns.r[2];                                  //  0 <= z
+	planes[Far] = XMVectorSubtract(columns.r[3], columns.r[2]);   //  z <= w
+
+	Frustum frustum;
+	for (u32 i = 0; i < NumPlanes; ++i)
+	{
+		XMStoreFloat4(&frustum.m_Planes[i], XMPlaneNormalize(planes[i]));
+	}
+
+	return frustum;
+}
+
+void BoundsArray::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+}
+
+void BoundsArray::Reserve(size_t count)
+{
+	m_CenterX.reserve(count);
+	m_CenterY.reserve(count);
+	m_CenterZ.reserve(count);
+	m_ExtentX.reserve(count);
+	m_ExtentY.reserve(count);
+	m_ExtentZ.reserve(count);
+}
+
+void BoundsArray::Add(const BoundingBox& box)
+{
+	m_CenterX.push_back(box.Center.x);
+	m_CenterY.push_back(box.Center.y);
+	m_CenterZ.push_back(box.Center.z);
+	m_ExtentX.push_back(box.Extents.x);
+	m_ExtentY.push_back(box.Extents.y);
+	m_ExtentZ.push_back(box.Extents.z);
+}
+
+void XM_CALLCONV BoundsArray::Add(const BoundingBox& box, FXMMATRIX world)
+{
+	// The extents of the transformed box are the sums of the absolute values of the transformed axes.
+	XMVECTOR center = XMVector3Transform(XMLoadFloat3(&box.Center), world);
+	XMVECTOR extents = XMVectorMultiply(XMVectorAbs(world.r[0]), XMVectorReplicate(box.Extents.x));
+	extents = XMVectorMultiplyAdd(XMVectorAbs(world.r[1]), XMVectorReplicate(box.Extents.y), extents);
+	extents = XMVectorMultiplyAdd(XMVectorAbs(world.r[2]), XMVectorReplicate(box.Extents.z), extents);
+
+	BoundingBox worldBox;
+	XMStoreFloat3(&worldBox.Center, center);
+	XMStoreFloat3(&worldBox.Extents, extents);
+	Add(worldBox);
+}
+
+BoundingBox BoundsArray::Get(size_t index) const
+{
+	assert(index < GetSize());
+
+	BoundingBox box;
+	box.Center = { m_CenterX[index], m_CenterY[index], m_CenterZ[index] };
+	box.Extents = { m_ExtentX[index], m_ExtentY[index], m_ExtentZ[index] };
+	return box;
+}
+
+namespace
+{
+// A box is outside if it is entirely behind one of the planes: dot(n, c) + w < -dot(|n|, e).
+bool IsVisible(const Frustum& frustum, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+	for (const auto& plane : frustum.m_Planes)
+	{
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float radius = std::abs(plane.x) * ex + std::abs(plane.y) * ey + std::abs(plane.z) * ez;
+		if (!(distance + radius >= 0.0f))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// AVX needs the support of the CPU and of the OS, which has to save the upper halves of the YMM registers.
+bool DetectAvx()
+{
+	int info[4];
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+
+	return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+}
+}  // namespace
+
+u32 BoundsArray::Cull(const Frustum& frustum, std::vector<u32>& visible) const
+{
+	return IsAvxSupported() ? CullAVX(frustum, visible) : CullSSE(frustum, visible);
+}
+
+bool BoundsArray::IsAvxSupported()
+{
+	static const bool avxSupported = DetectAvx();
+	return avxSupported;
+}
+
+u32 BoundsArray::CullSSE(const Frustum& frustum, std::vector<u32>& visible) const
+{
+	const size_t count = GetSize();
+	visible.resize(count);
+
+	u32* output = visible.data();
+	u32  numVisible = 0;
+	size_t i = 0;
+
+	constexpr size_t Width = 4;
+
+	__m128 planeX[Frustum::NumPlanes], planeY[Frustum::NumPlanes], planeZ[Frustum::NumPlanes], planeW[Frustum::NumPlanes];
+	__m128 absX[Frustum::NumPlanes], absY[Frustum::NumPlanes], absZ[Frustum::NumPlanes];
+	for (u32 p = 0; p < Frustum::NumPlanes; ++p)
+	{
+		const auto& plane = frustum.m_Planes[p];
+		planeX[p] = _mm_set1_ps(plane.x);
+		planeY[p] = _mm_set1_ps(plane.y);
+		planeZ[p] = _mm_set1_ps(plane.z);
+		planeW[p] = _mm_set1_ps(plane.w);
+		absX[p] = _mm_set1_ps(std::abs(plane.x));
+		absY[p] = _mm_set1_ps(std::abs(plane.y));
+		absZ[p] = _mm_set1_ps(std::abs(plane.z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + Width <= count; i += Width)
+	{
+		__m128 cx = _mm_loadu_ps(&m_CenterX[i]);
+		__m128 cy = _mm_loadu_ps(&m_CenterY[i]);
+		__m128 cz = _mm_loadu_ps(&m_CenterZ[i]);
+		__m128 ex = _mm_loadu_ps(&m_ExtentX[i]);
+		__m128 ey = _mm_loadu_ps(&m_ExtentY[i]);
+		__m128 ez = _mm_loadu_ps(&m_ExtentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (u32 p = 0; p < Frustum::NumPlanes; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_mul_ps(planeZ[p], cz)), planeW[p]);
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)),
+				_mm_mul_ps(absZ[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		for (u32 mask = static_cast<u32>(_mm_movemask_ps(inside)); mask; mask &= mask - 1)
+		{
+			output[numVisible++] = static_cast<u32>(i) + std::countr_zero(mask);
+		}
+	}
+
+	numVisible = CullRemainder(frustum, i, output, numVisible);
+
+	visible.resize(numVisible);
+	return numVisible;
+}
+
+u32 BoundsArray::CullAVX(const Frustum& frustum, std::vector<u32>& visible) const
+{
+	assert(IsAvxSupported());
+
+	const size_t count = GetSize();
+	visible.resize(count);
+
+	u32* output = visible.data();
+	u32  numVisible = 0;
+	size_t i = 0;
+
+	constexpr size_t Width = 8;
+
+	__m256 planeX[Frustum::NumPlanes], planeY[Frustum::NumPlanes], planeZ[Frustum::NumPlanes], planeW[Frustum::NumPlanes];
+	__m256 absX[Frustum::NumPlanes], absY[Frustum::NumPlanes], absZ[Frustum::NumPlanes];
+	for (u32 p = 0; p < Frustum::NumPlanes; ++p)
+	{
+		const auto& plane = frustum.m_Planes[p];
+		planeX[p] = _mm256_set1_ps(plane.x);
+		planeY[p] = _mm256_set1_ps(plane.y);
+		planeZ[p] = _mm256_set1_ps(plane.z);
+		planeW[p] = _mm256_set1_ps(plane.w);
+		absX[p] = _mm256_set1_ps(std::abs(plane.x));
+		absY[p] = _mm256_set1_ps(std::abs(plane.y));
+		absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (; i + Width <= count; i += Width)
+	{
+		__m256 cx = _mm256_loadu_ps(&m_CenterX[i]);
+		__m256 cy = _mm256_loadu_ps(&m_CenterY[i]);
+		__m256 cz = _mm256_loadu_ps(&m_CenterZ[i]);
+		__m256 ex = _mm256_loadu_ps(&m_ExtentX[i]);
+		__m256 ey = _mm256_loadu_ps(&m_ExtentY[i]);
+		__m256 ez = _mm256_loadu_ps(&m_ExtentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (u32 p = 0; p < Frustum::NumPlanes; ++p)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx),
+				_mm256_mul_ps(planeY[p], cy)), _mm256_mul_ps(planeZ[p], cz)), planeW[p]);
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)),
+				_mm256_mul_ps(absZ[p], ez));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+		}
+
+		for (u32 mask = static_cast<u32>(_mm256_movemask_ps(inside)); mask; mask &= mask - 1)
+		{
+			output[numVisible++] = static_cast<u32>(i) + std::countr_zero(mask);
+		}
+	}
+
+	// The code around it isn't compiled for AVX, so avoid the penalty of mixing it with SSE code.
+	_mm256_zeroupper();
+
+	numVisible = CullRemainder(frustum, i, output, numVisible);
+
+	visible.resize(numVisible);
+	return numVisible;
+}
+
+u32 BoundsArray::CullRemainder(const Frustum& frustum, size_t first, u32* output, u32 numVisible) const
+{
+	for (size_t i = first; i < GetSize(); ++i)
+	{
+		if (IsVisible(frustum, m_CenterX[i], m_CenterY[i], m_CenterZ[i], m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]))
+		{
+			output[numVisible++] = static_cast<u32>(i);
+		}
+	}
+
+	return numVisible;
+}
+
+u32 BoundsArray::CullScalar(const Frustum& frustum, std::vector<u32>& visible) const
+{
+	visible.clear();
+	for (size_t i = 0; i < GetSize(); ++i)
+	{
+		if (IsVisible(frustum, m_CenterX[i], m_CenterY[i], m_CenterZ[i], m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]))
+		{
+			visible.push_back(static_cast<u32>(i));
+		}
+	}
+
+	return static_cast<u32>(visible.size());
+}
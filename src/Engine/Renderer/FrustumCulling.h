@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * The six planes of a view frustum. The planes point inwards: a point p is
+ * inside the frustum if dot(plane.xyz, p) + plane.w >= 0 for all planes.
+ */
+struct Frustum
+{
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		NumPlanes
+	};
+
+	DirectX::XMFLOAT4 m_Planes[NumPlanes];
+
+	// Extract the (normalized) planes from a view * projection matrix with a [0, 1] depth range.
+	static Frustum XM_CALLCONV FromViewProjection(DirectX::FXMMATRIX viewProjection);
+};
+
+/**
+ * World space axis-aligned bounding boxes, stored as separate center and extent
+ * arrays (structure of arrays) so several boxes can be tested against a plane
+ * at once.
+ *
+ * The index of a box is the order in which it was added, so the visible list
+ * returned by Cull can be used to look up whatever the boxes were added for.
+ */
+class BoundsArray
+{
+public:
+	void Clear();
+	void Reserve(size_t count);
+
+	size_t GetSize() const
+	{
+		return m_CenterX.size();
+	}
+
+	// Add a world space box.
+	void Add(const DirectX::BoundingBox& box);
+
+	// Add an object space box, transformed by world. The result encloses the transformed box.
+	void XM_CALLCONV Add(const DirectX::BoundingBox& box, DirectX::FXMMATRIX world);
+
+	DirectX::BoundingBox Get(size_t index) const;
+
+	/**
+	 * Find the boxes that intersect (or are inside) the frustum. Tests 8 boxes at
+	 * once with AVX if the CPU supports it (see IsAvxSupported), or 4 with SSE.
+	 *
+	 * @param [out] visible The indices of the visible boxes, in increasing order.
+	 * @returns The number of visible boxes.
+	 */
+	u32 Cull(const Frustum& frustum, std::vector<u32>& visible) const;
+
+	// The SSE and AVX implementations of Cull. CullAVX may only be used if IsAvxSupported.
+	u32 CullSSE(const Frustum& frustum, std::vector<u32>& visible) const;
+	u32 CullAVX(const Frustum& frustum, std::vector<u32>& visible) const;
+
+	// Reference implementation of Cull that tests one box at a time.
+	u32 CullScalar(const Frustum& frustum, std::vector<u32>& visible) const;
+
+	// Returns true if the CPU and the OS support AVX. Checked once, with CPUID.
+	static bool IsAvxSupported();
+
+private:
+	// Test the boxes from first on one at a time and append the visible ones to output.
+	u32 CullRemainder(const Frustum& frustum, size_t first, u32* output, u32 numVisible) const;
+
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+};
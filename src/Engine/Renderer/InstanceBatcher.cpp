@@ -0,0 +1,67 @@
+#include <enginepch.h>
+#include "InstanceBatcher.h"
+
+#include <numeric>
+
+void InstanceBatcher::Clear()
+{
+	m_Draws.clear();
+	m_Batches.clear();
+	m_Instances.clear();
+	m_PrimitiveBatches.clear();
+}
+
+void InstanceBatcher::Add(const MeshPrimitive& primitive, u32 materialKey, u32 instance, u32 lod)
+{
+	auto [iterator, inserted] = m_PrimitiveBatches.try_emplace(BatchKey(&primitive, lod), static_cast<u32>(m_Batches.size()));
+	if (inserted)
+	{
+		m_Batches.push_back({ &primitive, lod, materialKey, 0, 0 });
+	}
+
+	u32 batch = iterator->second;
+	++m_Batches[batch].NumInstances;
+	m_Draws.push_back({ batch, instance });
+}
+
+void InstanceBatcher::Build()
+{
+	const u32 numBatches = static_cast<u32>(m_Batches.size());
+
+	// Sort the batches by material key. The sort is stable, so batches with the same key stay in the
+	// order in which their first draw was added.
+	m_BatchOrder.resize(numBatches);
+	std::iota(m_BatchOrder.begin(), m_BatchOrder.end(), 0);
+	std::stable_sort(m_BatchOrder.begin(), m_BatchOrder.end(), [this](u32 a, u32 b)
+	{
+		return m_Batches[a].MaterialKey < m_Batches[b].MaterialKey;
+	});
+
+	std::vector<Batch>& batches = m_SortedBatches;
+	batches.resize(numBatches);
+	m_BatchRemap.resize(numBatches);
+	u32 firstInstance = 0;
+	for (u32 i = 0; i < numBatches; ++i)
+	{
+		Batch& batch = batches[i];
+		batch = m_Batches[m_BatchOrder[i]];
+		batch.FirstInstance = firstInstance;
+		firstInstance += batch.NumInstances;
+
+		m_BatchRemap[m_BatchOrder[i]] = i;
+	}
+	m_Batches.swap(batches);
+
+	// Scatter the instances into their batches (a counting sort by batch, so it keeps the order of the draws).
+	m_BatchOrder.resize(numBatches);
+	for (u32 i = 0; i < numBatches; ++i)
+	{
+		m_BatchOrder[i] = m_Batches[i].FirstInstance;
+	}
+
+	m_Instances.resize(m_Draws.size());
+	for (const Draw& draw : m_Draws)
+	{
+		m_Instances[m_BatchOrder[m_BatchRemap[draw.Batch]]++] = draw.Instance;
+	}
+}
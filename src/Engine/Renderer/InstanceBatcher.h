@@ -0,0 +1,101 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+struct MeshPrimitive;
+
+/**
+ * Groups the draws of a frame into instanced draws. Draws of the same mesh
+ * primitive (models that share a mesh) at the same level of detail use the
+ * same vertex and index buffers and material, so they are merged into one
+ * batch that is drawn with a single instanced draw call.
+ *
+ * The batches are sorted by a material key that the caller assigns (e.g. the
+ * index of the material in the frame), so batches with the same material are
+ * recorded next to each other and the order does not change between runs. The
+ * instances of a batch keep the order in which they were added.
+ */
+class InstanceBatcher
+{
+public:
+	struct Batch
+	{
+		const MeshPrimitive* Primitive;
+		u32                  Lod;
+		// The material key of the primitive. The batches are sorted by it.
+		u32                  MaterialKey;
+		// The range of the instances of the batch in GetInstances.
+		u32                  FirstInstance;
+		u32                  NumInstances;
+	};
+
+	void Clear();
+
+	/**
+	 * Add a draw.
+	 *
+	 * @param materialKey Orders the batches, draws of the same material should have the same key.
+	 * @param instance Identifies the draw for the caller (e.g. a draw call index).
+	 * @param lod The level of detail of the primitive that is drawn.
+	 */
+	void Add(const MeshPrimitive& primitive, u32 materialKey, u32 instance, u32 lod = 0);
+
+	// Group the draws added since the last Clear into batches.
+	void Build();
+
+	const std::vector<Batch>& GetBatches() const
+	{
+		return m_Batches;
+	}
+
+	// The instances of all batches, batch after batch.
+	const std::vector<u32>& GetInstances() const
+	{
+		return m_Instances;
+	}
+
+	u32 GetNumDraws() const
+	{
+		return static_cast<u32>(m_Batches.size());
+	}
+
+	u32 GetNumInstances() const
+	{
+		return static_cast<u32>(m_Instances.size());
+	}
+
+	// The average number of instances per draw. 1 if nothing was batched.
+	float GetBatchingRatio() const
+	{
+		return m_Batches.empty() ? 1.0f : static_cast<float>(m_Instances.size()) / m_Batches.size();
+	}
+
+private:
+	struct Draw
+	{
+		u32 Batch;
+		u32 Instance;
+	};
+
+	std::vector<Draw>  m_Draws;
+	std::vector<Batch> m_Batches;
+	std::vector<u32>   m_Instances;
+
+	using BatchKey = std::pair<const MeshPrimitive*, u32>;
+
+	struct BatchKeyHash
+	{
+		size_t operator()(const BatchKey& key) const
+		{
+			return std::hash<const MeshPrimitive*>()(key.first) ^ (static_cast<size_t>(key.second) * 0x9E3779B97F4A7C15ull);
+		}
+	};
+
+	// The batch of each primitive and level of detail added since the last Clear.
+	std::unordered_map<BatchKey, u32, BatchKeyHash> m_PrimitiveBatches;
+	// Scratch space for Build.
+	std::vector<Batch> m_SortedBatches;
+	std::vector<u32> m_BatchOrder;
+	std::vector<u32> m_BatchRemap;
+};
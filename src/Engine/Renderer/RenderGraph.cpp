@@ -0,0 +1,695 @@
+#include <enginepch.h>
+#include "RenderGraph.h"
+
+#include <Engine/Core/Application.h>
+#include <Engine/Core/Device.h>
+#include <Engine/Pipeline/CommandList.h>
+#include <Engine/Pipeline/ResourceStateTracker.h>
+#include <Engine/Buffers/StructuredBuffer.h>
+#include <Engine/Buffers/Texture.h>
+#include <Engine/Buffers/UnorderedAccessView.h>
+
+#include <cstring>
+
+static u64 AlignUp(u64 value, u64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+RenderGraphResource RenderGraphBuilder::Read(RenderGraphResource resource, D3D12_RESOURCE_STATES state)
+{
+	m_Graph.AddAccess(m_PassIndex, resource, state, false);
+	return resource;
+}
+
+RenderGraphResource RenderGraphBuilder::Write(RenderGraphResource resource, D3D12_RESOURCE_STATES state)
+{
+	m_Graph.AddAccess(m_PassIndex, resource, state, true);
+	return resource;
+}
+
+void RenderGraphBuilder::SetSideEffect()
+{
+	m_Graph.m_Passes[m_PassIndex].SideEffect = true;
+}
+
+RenderGraph::RenderGraph(Device& device, const std::string& name)
+	: RenderGraph([&device](const D3D12_RESOURCE_DESC& desc)
+		{
+			return device.GetD3D12Device()->GetResourceAllocationInfo(0, 1, &desc);
+		}, name)
+{
+	m_Device = &device;
+	m_Logger = Application::Get().CreateLogger("RenderGraph");
+}
+
+RenderGraph::RenderGraph(AllocationInfoFunc allocationInfo, const std::string& name)
+	: m_Device(nullptr)
+	, m_AllocationInfo(std::move(allocationInfo))
+	, m_Name(name)
+	, m_Compiled(false)
+	, m_HeapSizes{}
+	, m_HeapAlignments{}
+	, m_PhysicalHeapSizes{}
+{
+	assert(m_AllocationInfo);
+}
+
+RenderGraph::~RenderGraph() = default;
+
+void RenderGraph::Reset()
+{
+	m_Resources.clear();
+	m_Passes.clear();
+	m_Compiled = false;
+}
+
+RenderGraphResource RenderGraph::CreateBuffer(const std::string& name, size_t numElements, size_t elementSize)
+{
+	ResourceEntry entry;
+	entry.Name = name;
+	entry.Desc = CD3DX12_RESOURCE_DESC::Buffer(numElements * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	entry.NumElements = numElements;
+	entry.ElementSize = elementSize;
+
+	m_Resources.push_back(std::move(entry));
+	return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& resourceDesc,
+	const D3D12_CLEAR_VALUE* clearValue)
+{
+	assert(resourceDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
+
+	ResourceEntry entry;
+	entry.Name = name;
+	entry.Desc = resourceDesc;
+	if (clearValue)
+	{
+		entry.HasClearValue = true;
+		entry.ClearValue = *clearValue;
+	}
+
+	m_Resources.push_back(std::move(entry));
+	return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportResource(const std::string& name, const std::shared_ptr<Resource>& resource,
+	D3D12_RESOURCE_STATES state)
+{
+	assert(resource);
+
+	ResourceEntry entry;
+	entry.Name = name;
+	entry.Desc = resource->GetD3D12ResourceDesc();
+	entry.Imported = resource;
+	entry.ImportedState = state;
+
+	m_Resources.push_back(std::move(entry));
+	return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+void RenderGraph::AddPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute)
+{
+	assert(!m_Compiled);
+
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	m_Passes.push_back(std::move(pass));
+
+	RenderGraphBuilder builder(*this, static_cast<u32>(m_Passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::AddAccess(u32 passIndex, RenderGraphResource resource, D3D12_RESOURCE_STATES state, bool write)
+{
+	assert(resource < m_Resources.size());
+	assert(!write || IsWriteState(state));
+
+	auto& accesses = m_Passes[passIndex].Accesses;
+	for (auto& access : accesses)
+	{
+		if (access.Resource == resource)
+		{
+			if (!access.Write && !write)
+			{
+				// Multiple read states are combined.
+				access.State |= state;
+			}
+			else
+			{
+				// A resource can only be in one write state at a time.
+				assert(access.State == state);
+				access.Write = true;
+			}
+			return;
+		}
+	}
+
+	accesses.push_back({ resource, state, write });
+}
+
+bool RenderGraph::IsWriteState(D3D12_RESOURCE_STATES state)
+{
+	return (state & (D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+		D3D12_RESOURCE_STATE_DEPTH_WRITE | D3D12_RESOURCE_STATE_STREAM_OUT | D3D12_RESOURCE_STATE_COPY_DEST |
+		D3D12_RESOURCE_STATE_RESOLVE_DEST)) != 0;
+}
+
+bool RenderGraph::HasExplicitBarriers(const ResourceEntry& entry) const
+{
+	return entry.IsTransient() || entry.Imported->IsManuallyManaged();
+}
+
+bool RenderGraph::LifetimesOverlap(const ResourceEntry& a, const ResourceEntry& b)
+{
+	return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+}
+
+bool RenderGraph::MemoryOverlaps(const ResourceEntry& a, const ResourceEntry& b)
+{
+	return a.Heap == b.Heap && a.HeapOffset < b.HeapOffset + b.Size && b.HeapOffset < a.HeapOffset + a.Size;
+}
+
+void RenderGraph::Compile()
+{
+	assert(!m_Compiled);
+
+	m_Statistics = {};
+	m_Statistics.NumPasses = static_cast<u32>(m_Passes.size());
+
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransientResources();
+	ScheduleBarriers();
+
+	m_Compiled = true;
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walk the passes backwards. A pass is kept if it has side effects, writes an imported
+	// resource or writes a transient resource whose contents are used by a later pass.
+	std::vector<bool> contentsUsed(m_Resources.size(), false);
+
+	for (size_t i = m_Passes.size(); i-- > 0;)
+	{
+		auto& pass = m_Passes[i];
+
+		bool keep = pass.SideEffect;
+		for (const auto& access : pass.Accesses)
+		{
+			if (access.Write && (!m_Resources[access.Resource].IsTransient() || contentsUsed[access.Resource]))
+			{
+				keep = true;
+			}
+		}
+
+		pass.Culled = !keep;
+		if (!keep)
+		{
+			++m_Statistics.NumCulledPasses;
+			continue;
+		}
+
+		// Writes (other than UAV writes, which may be partial) overwrite the previous contents...
+		for (const auto& access : pass.Accesses)
+		{
+			if (access.Write && access.State != D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+			{
+				contentsUsed[access.Resource] = false;
+			}
+		}
+		// ...and everything the pass reads has to be produced by the passes before it.
+		for (const auto& access : pass.Accesses)
+		{
+			if (!access.Write || access.State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+			{
+				contentsUsed[access.Resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (u32 i = 0; i < static_cast<u32>(m_Passes.size()); ++i)
+	{
+		const auto& pass = m_Passes[i];
+		if (pass.Culled)
+		{
+			continue;
+		}
+
+		for (const auto& access : pass.Accesses)
+		{
+			auto& entry = m_Resources[access.Resource];
+			if (entry.FirstPass == ~0u)
+			{
+				// The contents of a transient resource are undefined until it is written.
+				assert(!entry.IsTransient() || access.Write);
+				entry.FirstPass = i;
+			}
+			entry.LastPass = i;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransientResources()
+{
+	std::vector<u32> placementOrder;
+	for (u32 i = 0; i < static_cast<u32>(m_Resources.size()); ++i)
+	{
+		auto& entry = m_Resources[i];
+		if (!entry.IsTransient() || entry.FirstPass == ~0u)
+		{
+			continue;
+		}
+
+		auto allocationInfo = m_AllocationInfo(entry.Desc);
+		entry.Size = allocationInfo.SizeInBytes;
+		entry.Alignment = allocationInfo.Alignment;
+
+		if (entry.Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			entry.Heap = BufferHeap;
+		}
+		else if (entry.Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+		{
+			entry.Heap = RenderTargetHeap;
+		}
+		else
+		{
+			entry.Heap = TextureHeap;
+		}
+
+		placementOrder.push_back(i);
+
+		++m_Statistics.NumTransientResources;
+		m_Statistics.TransientBytes += entry.Size;
+	}
+
+	// Place the largest resources first. Every resource goes to the lowest offset that does
+	// not overlap a resource (in the same heap) that is alive at the same time.
+	std::stable_sort(placementOrder.begin(), placementOrder.end(), [this](u32 a, u32 b)
+	{
+		return m_Resources[a].Size > m_Resources[b].Size;
+	});
+
+	std::fill(std::begin(m_HeapSizes), std::end(m_HeapSizes), 0);
+	std::fill(std::begin(m_HeapAlignments), std::end(m_HeapAlignments), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	for (size_t i = 0; i < placementOrder.size(); ++i)
+	{
+		auto& entry = m_Resources[placementOrder[i]];
+		entry.HeapOffset = 0;
+
+		bool moved = true;
+		while (moved)
+		{
+			moved = false;
+			for (size_t j = 0; j < i; ++j)
+			{
+				const auto& placed = m_Resources[placementOrder[j]];
+				if (LifetimesOverlap(entry, placed) && MemoryOverlaps(entry, placed))
+				{
+					entry.HeapOffset = AlignUp(placed.HeapOffset + placed.Size, entry.Alignment);
+					moved = true;
+				}
+			}
+		}
+
+		m_HeapSizes[entry.Heap] = std::max(m_HeapSizes[entry.Heap], entry.HeapOffset + entry.Size);
+		m_HeapAlignments[entry.Heap] = std::max(m_HeapAlignments[entry.Heap], entry.Alignment);
+
+		for (size_t j = 0; j < i; ++j)
+		{
+			auto& placed = m_Resources[placementOrder[j]];
+			if (MemoryOverlaps(entry, placed))
+			{
+				entry.Aliased = true;
+				placed.Aliased = true;
+			}
+		}
+	}
+
+	for (auto heapSize : m_HeapSizes)
+	{
+		m_Statistics.HeapBytes += heapSize;
+	}
+	for (auto index : placementOrder)
+	{
+		m_Statistics.NumAliasedResources += m_Resources[index].Aliased ? 1 : 0;
+	}
+}
+
+void RenderGraph::ScheduleBarriers()
+{
+	struct State
+	{
+		D3D12_RESOURCE_STATES Current;
+		bool Known;
+		bool Accessed;
+		bool LastWrite;
+	};
+
+	std::vector<State> states(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+	{
+		const auto& entry = m_Resources[i];
+		// Transient resources are in the COMMON state between executions of the graph.
+		// The state of tracked resources is resolved by the command list.
+		states[i].Current = entry.IsTransient() ? D3D12_RESOURCE_STATE_COMMON : entry.ImportedState;
+		states[i].Known = HasExplicitBarriers(entry);
+		states[i].Accessed = false;
+		states[i].LastWrite = false;
+	}
+
+	for (u32 i = 0; i < static_cast<u32>(m_Passes.size()); ++i)
+	{
+		auto& pass = m_Passes[i];
+		pass.Barriers.clear();
+		pass.PostBarriers.clear();
+		pass.Discards.clear();
+
+		if (pass.Culled)
+		{
+			continue;
+		}
+
+		for (const auto& access : pass.Accesses)
+		{
+			const auto& entry = m_Resources[access.Resource];
+			auto& state = states[access.Resource];
+
+			// The memory of an aliased resource was used by another resource before.
+			if (entry.Aliased && entry.FirstPass == i)
+			{
+				pass.Barriers.push_back({ Barrier::Aliasing, access.Resource, state.Current, state.Current });
+
+				// The contents (and compression metadata) of an aliased render target or depth stencil are
+				// undefined, so it has to be discarded (or cleared) before it is rendered to.
+				if (entry.Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+				{
+					assert(access.Write &&
+						(access.State & (D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_DEPTH_WRITE)) &&
+						"The first pass of an aliased render target or depth stencil has to render to it.");
+					pass.Discards.push_back(access.Resource);
+					++m_Statistics.NumDiscards;
+				}
+			}
+
+			if (!state.Known || state.Current != access.State)
+			{
+				pass.Barriers.push_back({ Barrier::Transition, access.Resource, state.Current, access.State });
+			}
+			else if (access.State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && state.Accessed &&
+				(state.LastWrite || access.Write))
+			{
+				// UAV accesses of consecutive passes have to be ordered if either of them writes.
+				pass.Barriers.push_back({ Barrier::UAV, access.Resource, access.State, access.State });
+			}
+
+			state.Current = access.State;
+			state.Known = true;
+			state.Accessed = true;
+			state.LastWrite = access.Write;
+		}
+
+		// Return transient and manually managed resources to their initial state after their last use.
+		for (const auto& access : pass.Accesses)
+		{
+			const auto& entry = m_Resources[access.Resource];
+			auto& state = states[access.Resource];
+
+			if (entry.LastPass == i && HasExplicitBarriers(entry))
+			{
+				auto finalState = entry.IsTransient() ? D3D12_RESOURCE_STATE_COMMON : entry.ImportedState;
+				if (state.Current != finalState)
+				{
+					pass.PostBarriers.push_back({ Barrier::Transition, access.Resource, state.Current, finalState });
+					state.Current = finalState;
+				}
+			}
+		}
+
+		m_Statistics.NumBarriers += static_cast<u32>(pass.Barriers.size() + pass.PostBarriers.size());
+	}
+}
+
+void RenderGraph::CreatePhysicalResources()
+{
+	bool changed = m_PhysicalResources.size() != m_Resources.size();
+	for (size_t i = 0; i < m_Resources.size() && !changed; ++i)
+	{
+		const auto& entry = m_Resources[i];
+		const auto& physical = m_PhysicalResources[i];
+
+		bool placed = entry.IsTransient() && entry.FirstPass != ~0u;
+		if (placed != (physical.PlacedResource != nullptr))
+		{
+			changed = true;
+		}
+		else if (placed)
+		{
+			changed = physical.Heap != entry.Heap || physical.HeapOffset != entry.HeapOffset ||
+				std::memcmp(&physical.Desc, &entry.Desc, sizeof(D3D12_RESOURCE_DESC)) != 0;
+		}
+	}
+	for (u32 i = 0; i < NumHeapTypes; ++i)
+	{
+		changed |= m_HeapSizes[i] > m_PhysicalHeapSizes[i];
+	}
+
+	if (!changed)
+	{
+		return;
+	}
+
+	auto d3d12Device = m_Device->GetD3D12Device();
+
+	// Resources that are still in flight keep the old heaps alive (see Execute).
+	for (u32 i = 0; i < NumHeapTypes; ++i)
+	{
+		if (m_HeapSizes[i] <= m_PhysicalHeapSizes[i])
+		{
+			continue;
+		}
+
+		static const D3D12_HEAP_FLAGS heapFlags[NumHeapTypes] = {
+			D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+			D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+			D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+		};
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = AlignUp(m_HeapSizes[i], m_HeapAlignments[i]);
+		heapDesc.Alignment = m_HeapAlignments[i];
+		heapDesc.Flags = heapFlags[i];
+		heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+		m_Heaps[i].Reset();
+		ThrowIfFailed(d3d12Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_Heaps[i])));
+		m_PhysicalHeapSizes[i] = heapDesc.SizeInBytes;
+	}
+
+	m_PhysicalResources.clear();
+	m_PhysicalResources.resize(m_Resources.size());
+
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+	{
+		const auto& entry = m_Resources[i];
+		if (!entry.IsTransient() || entry.FirstPass == ~0u)
+		{
+			continue;
+		}
+
+		auto& physical = m_PhysicalResources[i];
+		physical.Desc = entry.Desc;
+		physical.Heap = entry.Heap;
+		physical.HeapOffset = entry.HeapOffset;
+
+		const D3D12_CLEAR_VALUE* clearValue = entry.HasClearValue ? &entry.ClearValue : nullptr;
+
+		ComPtr<ID3D12Resource> d3d12Resource;
+		ThrowIfFailed(d3d12Device->CreatePlacedResource(m_Heaps[entry.Heap].Get(), entry.HeapOffset, &entry.Desc,
+			D3D12_RESOURCE_STATE_COMMON, clearValue, IID_PPV_ARGS(&d3d12Resource)));
+
+		ResourceStateTracker::AddGlobalResourceState(d3d12Resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+
+		if (entry.Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			auto buffer = m_Device->CreateStructuredBuffer(d3d12Resource, entry.NumElements, entry.ElementSize);
+
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+			uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+			uavDesc.Buffer.StructureByteStride = static_cast<UINT>(entry.ElementSize);
+			uavDesc.Buffer.CounterOffsetInBytes = 0;
+			uavDesc.Buffer.FirstElement = 0;
+			uavDesc.Buffer.NumElements = static_cast<UINT>(entry.NumElements);
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+
+			physical.UAV = m_Device->CreateUnorderedAccessView(buffer, buffer->GetCounterBuffer(), &uavDesc);
+			physical.PlacedResource = buffer;
+		}
+		else
+		{
+			physical.PlacedResource = m_Device->CreateTexture(d3d12Resource, clearValue);
+		}
+
+		physical.PlacedResource->SetManuallyManaged(true);
+		physical.PlacedResource->SetName(std::wstring(entry.Name.begin(), entry.Name.end()));
+	}
+
+	m_Logger->info("{}: {} transient resources, {} KB in {} KB of heap memory ({} KB saved by aliasing), {} of {} passes culled",
+		m_Name, m_Statistics.NumTransientResources, m_Statistics.TransientBytes / 1024, m_Statistics.HeapBytes / 1024,
+		m_Statistics.GetSavedBytes() / 1024, m_Statistics.NumCulledPasses, m_Statistics.NumPasses);
+}
+
+void RenderGraph::RecordBarrier(CommandList& commandList, const Barrier& barrier)
+{
+	const auto& entry = m_Resources[barrier.Resource];
+	auto resource = GetResource(barrier.Resource);
+
+	switch (barrier.Type)
+	{
+	case Barrier::Transition:
+		if (HasExplicitBarriers(entry))
+		{
+			commandList.ExplicitTransitionBarrier(resource, barrier.StateBefore, barrier.StateAfter);
+		}
+		else
+		{
+			commandList.TransitionBarrier(resource, barrier.StateAfter);
+		}
+		break;
+	case Barrier::UAV:
+		commandList.UAVBarrier(resource);
+		break;
+	case Barrier::Aliasing:
+		commandList.AliasingBarrier(nullptr, resource);
+		break;
+	}
+}
+
+void RenderGraph::Execute(CommandList& commandList)
+{
+	assert(m_Compiled);
+	assert(m_Device && "A render graph without a device can't be executed.");
+
+	CreatePhysicalResources();
+
+	commandList.SetExplicitBarriers(true);
+
+	for (auto& pass : m_Passes)
+	{
+		if (pass.Culled)
+		{
+			continue;
+		}
+
+		for (const auto& barrier : pass.Barriers)
+		{
+			RecordBarrier(commandList, barrier);
+		}
+		commandList.FlushResourceBarriers();
+		for (auto resource : pass.Discards)
+		{
+			commandList.DiscardResource(GetResource(resource));
+		}
+
+		pass.Execute(commandList, *this);
+
+		for (const auto& barrier : pass.PostBarriers)
+		{
+			RecordBarrier(commandList, barrier);
+		}
+	}
+	commandList.FlushResourceBarriers();
+
+	// Keep the heaps and the placed resources alive while the command list is in flight.
+	for (const auto& heap : m_Heaps)
+	{
+		if (heap)
+		{
+			commandList.TrackResource(heap);
+		}
+	}
+	for (const auto& physical : m_PhysicalResources)
+	{
+		if (physical.PlacedResource)
+		{
+			commandList.TrackResource(physical.PlacedResource);
+		}
+	}
+}
+
+std::shared_ptr<Resource> RenderGraph::GetResource(RenderGraphResource resource) const
+{
+	assert(resource < m_Resources.size());
+
+	const auto& entry = m_Resources[resource];
+	if (!entry.IsTransient())
+	{
+		return entry.Imported;
+	}
+
+	return resource < m_PhysicalResources.size() ? m_PhysicalResources[resource].PlacedResource : nullptr;
+}
+
+std::shared_ptr<StructuredBuffer> RenderGraph::GetBuffer(RenderGraphResource resource) const
+{
+	return std::dynamic_pointer_cast<StructuredBuffer>(GetResource(resource));
+}
+
+std::shared_ptr<Texture> RenderGraph::GetTexture(RenderGraphResource resource) const
+{
+	return std::dynamic_pointer_cast<Texture>(GetResource(resource));
+}
+
+std::shared_ptr<UnorderedAccessView> RenderGraph::GetUnorderedAccessView(RenderGraphResource resource) const
+{
+	assert(resource < m_Resources.size() && m_Resources[resource].IsTransient());
+
+	return resource < m_PhysicalResources.size() ? m_PhysicalResources[resource].UAV : nullptr;
+}
+
+bool RenderGraph::IsPassCulled(const std::string& name) const
+{
+	for (const auto& pass : m_Passes)
+	{
+		if (pass.Name == name)
+		{
+			return pass.Culled;
+		}
+	}
+	return true;
+}
+
+u32 RenderGraph::GetFirstPass(RenderGraphResource resource) const
+{
+	assert(m_Compiled && resource < m_Resources.size());
+	return m_Resources[resource].FirstPass;
+}
+
+u32 RenderGraph::GetLastPass(RenderGraphResource resource) const
+{
+	assert(m_Compiled && resource < m_Resources.size());
+	return m_Resources[resource].LastPass;
+}
+
+u64 RenderGraph::GetHeapOffset(RenderGraphResource resource) const
+{
+	assert(m_Compiled && resource < m_Resources.size() && m_Resources[resource].IsTransient());
+	return m_Resources[resource].HeapOffset;
+}
+
+bool RenderGraph::IsAliased(RenderGraphResource resource) const
+{
+	assert(m_Compiled && resource < m_Resources.size());
+	return m_Resources[resource].Aliased;
+}
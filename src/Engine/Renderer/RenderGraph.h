@@ -0,0 +1,280 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class CommandList;
+class Device;
+class Resource;
+class StructuredBuffer;
+class Texture;
+class UnorderedAccessView;
+class RenderGraph;
+
+// Handle to a resource of a render graph. Handles are valid until the graph is reset.
+using RenderGraphResource = u32;
+constexpr RenderGraphResource InvalidRenderGraphResource = ~0u;
+
+/**
+ * Declares the resources that a pass reads and writes. Passed to the setup function of a pass.
+ */
+class RenderGraphBuilder
+{
+public:
+	// Read a resource in the given state, for example NON_PIXEL_SHADER_RESOURCE or INDIRECT_ARGUMENT.
+	RenderGraphResource Read(RenderGraphResource resource, D3D12_RESOURCE_STATES state);
+
+	// Write a resource in the given state, for example RENDER_TARGET or UNORDERED_ACCESS.
+	// UAV writes are treated as read-modify-write, so the previous writer of the resource is kept.
+	RenderGraphResource Write(RenderGraphResource resource, D3D12_RESOURCE_STATES state);
+
+	// Never cull the pass, even if none of its outputs are used.
+	void SetSideEffect();
+
+private:
+	friend class RenderGraph;
+
+	RenderGraphBuilder(RenderGraph& graph, u32 passIndex)
+		: m_Graph(graph)
+		, m_PassIndex(passIndex)
+	{}
+
+	RenderGraph& m_Graph;
+	u32 m_PassIndex;
+};
+
+/**
+ * A frame render graph.
+ *
+ * Passes declare the resources they read and write in a setup function, and
+ * record their commands in an execute function. Compile culls the passes whose
+ * outputs are never used, computes the lifetime of the transient resources,
+ * places transient resources with disjoint lifetimes in the same heap memory and
+ * schedules the barriers between the passes. Execute records the passes in
+ * declaration order into a single command list.
+ *
+ * Transient resources are created by the graph and only live for the duration
+ * of the graph: their contents are undefined before the first pass that writes
+ * them. The first pass of a transient render target or depth stencil texture has
+ * to render to it: if the texture shares memory with other resources, the graph
+ * discards it before that pass. Imported resources are owned by
+ * the caller and are never culled or aliased; writes to an imported resource keep
+ * the pass alive.
+ *
+ * The graph is meant to be rebuilt every frame (Reset, AddPass, Compile, Execute).
+ * The heaps and placed resources are kept between frames and are only recreated
+ * when the layout of the transient resources changes.
+ */
+class RenderGraph
+{
+public:
+	using ExecuteFunc = std::function<void(CommandList& commandList, const RenderGraph& graph)>;
+	using SetupFunc = std::function<void(RenderGraphBuilder& builder)>;
+	// Returns the size and alignment of a (placed) resource, like ID3D12Device::GetResourceAllocationInfo.
+	using AllocationInfoFunc = std::function<D3D12_RESOURCE_ALLOCATION_INFO(const D3D12_RESOURCE_DESC& desc)>;
+
+	struct MemoryStatistics
+	{
+		// Sum of the sizes of the transient resources if every resource had its own allocation.
+		u64 TransientBytes = 0;
+		// Size of the heaps that the transient resources are placed in.
+		u64 HeapBytes = 0;
+		u32 NumTransientResources = 0;
+		// Number of transient resources that share memory with another transient resource.
+		u32 NumAliasedResources = 0;
+		u32 NumPasses = 0;
+		u32 NumCulledPasses = 0;
+		u32 NumBarriers = 0;
+		// Number of aliased render target and depth stencil textures that are discarded before their first pass.
+		u32 NumDiscards = 0;
+
+		u64 GetSavedBytes() const
+		{
+			return TransientBytes - HeapBytes;
+		}
+	};
+
+	explicit RenderGraph(Device& device, const std::string& name = "RenderGraph");
+	// A graph without a device. It can be compiled (for example in the tests) but not executed.
+	explicit RenderGraph(AllocationInfoFunc allocationInfo, const std::string& name = "RenderGraph");
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Remove all passes and resources. The heaps and placed resources are kept for the next frame.
+	void Reset();
+
+	// Create a transient structured buffer (with an unordered access view).
+	RenderGraphResource CreateBuffer(const std::string& name, size_t numElements, size_t elementSize);
+	// Create a transient texture.
+	RenderGraphResource CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& resourceDesc,
+		const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	/**
+	 * Import a resource that is owned by the caller.
+	 *
+	 * If the resource is manually managed (see Resource::SetManuallyManaged), the graph
+	 * records its barriers explicitly: the resource has to be in the given state when the
+	 * graph executes, and is transitioned back to it after its last use. Otherwise the
+	 * state of the resource is tracked by the command list and the state is ignored.
+	 */
+	RenderGraphResource ImportResource(const std::string& name, const std::shared_ptr<Resource>& resource,
+		D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON);
+
+	// Add a pass. The setup function is invoked immediately.
+	void AddPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute);
+
+	// Cull the unused passes, place the transient resources and schedule the barriers.
+	void Compile();
+
+	// Record the passes that survived culling into the command list. The list is switched
+	// to explicit barrier mode.
+	void Execute(CommandList& commandList);
+
+	// Access the resources from the execute function of a pass.
+	std::shared_ptr<Resource> GetResource(RenderGraphResource resource) const;
+	std::shared_ptr<StructuredBuffer> GetBuffer(RenderGraphResource resource) const;
+	std::shared_ptr<Texture> GetTexture(RenderGraphResource resource) const;
+	// The unordered access view of a transient buffer.
+	std::shared_ptr<UnorderedAccessView> GetUnorderedAccessView(RenderGraphResource resource) const;
+
+	// Returns true if the pass was culled by the last Compile.
+	bool IsPassCulled(const std::string& name) const;
+
+	// The first and last pass (in declaration order) that use the resource, set by Compile.
+	// Both are ~0u if no pass that survived culling uses the resource.
+	u32 GetFirstPass(RenderGraphResource resource) const;
+	u32 GetLastPass(RenderGraphResource resource) const;
+	// The offset of a transient resource in its heap, set by Compile.
+	u64 GetHeapOffset(RenderGraphResource resource) const;
+	// Returns true if a transient resource shares memory with another transient resource, set by Compile.
+	bool IsAliased(RenderGraphResource resource) const;
+
+	const MemoryStatistics& GetMemoryStatistics() const
+	{
+		return m_Statistics;
+	}
+
+private:
+	friend class RenderGraphBuilder;
+
+	// The heaps are split by the resource types they may contain, as required by resource heap tier 1.
+	enum HeapType
+	{
+		BufferHeap,
+		RenderTargetHeap,  // Render target and depth stencil textures.
+		TextureHeap,       // Other textures.
+		NumHeapTypes
+	};
+
+	struct ResourceEntry
+	{
+		std::string Name;
+		D3D12_RESOURCE_DESC Desc = {};
+		bool HasClearValue = false;
+		D3D12_CLEAR_VALUE ClearValue = {};
+		size_t NumElements = 0;
+		size_t ElementSize = 0;
+
+		// Imported resources only.
+		std::shared_ptr<Resource> Imported;
+		D3D12_RESOURCE_STATES ImportedState = D3D12_RESOURCE_STATE_COMMON;
+
+		// Set by Compile. Passes are indices into m_Passes.
+		u32 FirstPass = ~0u;
+		u32 LastPass = ~0u;
+		HeapType Heap = BufferHeap;
+		u64 Size = 0;
+		u64 Alignment = 0;
+		u64 HeapOffset = 0;
+		bool Aliased = false;
+
+		bool IsTransient() const
+		{
+			return !Imported;
+		}
+	};
+
+	struct Access
+	{
+		RenderGraphResource Resource;
+		D3D12_RESOURCE_STATES State;
+		bool Write;
+	};
+
+	struct Barrier
+	{
+		enum BarrierType
+		{
+			Transition,
+			UAV,
+			Aliasing,
+		} Type;
+		RenderGraphResource Resource;
+		D3D12_RESOURCE_STATES StateBefore;
+		D3D12_RESOURCE_STATES StateAfter;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFunc Execute;
+		std::vector<Access> Accesses;
+		bool SideEffect = false;
+
+		// Set by Compile.
+		bool Culled = false;
+		std::vector<Barrier> Barriers;      // Recorded before the pass.
+		std::vector<Barrier> PostBarriers;  // Recorded after the pass (end of lifetime transitions).
+		std::vector<RenderGraphResource> Discards;  // Aliased render targets, discarded before the pass.
+	};
+
+	// A heap allocated transient resource, kept between frames.
+	struct PhysicalResource
+	{
+		D3D12_RESOURCE_DESC Desc = {};
+		HeapType Heap = BufferHeap;
+		u64 HeapOffset = 0;
+
+		std::shared_ptr<Resource> PlacedResource;
+		std::shared_ptr<UnorderedAccessView> UAV;
+	};
+
+	void AddAccess(u32 passIndex, RenderGraphResource resource, D3D12_RESOURCE_STATES state, bool write);
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransientResources();
+	void ScheduleBarriers();
+
+	// Returns true if the resource is transitioned by the graph (rather than the command list's state tracker).
+	bool HasExplicitBarriers(const ResourceEntry& entry) const;
+	static bool IsWriteState(D3D12_RESOURCE_STATES state);
+	static bool LifetimesOverlap(const ResourceEntry& a, const ResourceEntry& b);
+	static bool MemoryOverlaps(const ResourceEntry& a, const ResourceEntry& b);
+
+	// (Re)create the heaps and placed resources if the layout of the transient resources changed.
+	void CreatePhysicalResources();
+	void RecordBarrier(CommandList& commandList, const Barrier& barrier);
+
+	// Null for graphs that can only be compiled.
+	Device* m_Device;
+	AllocationInfoFunc m_AllocationInfo;
+	std::string m_Name;
+	RefPtr<spdlog::logger> m_Logger;
+
+	std::vector<ResourceEntry> m_Resources;
+	std::vector<Pass> m_Passes;
+	bool m_Compiled;
+
+	u64 m_HeapSizes[NumHeapTypes];
+	u64 m_HeapAlignments[NumHeapTypes];
+	MemoryStatistics m_Statistics;
+
+	// Indexed like m_Resources for the transient resources, empty for imported ones.
+	std::vector<PhysicalResource> m_PhysicalResources;
+	Microsoft::WRL::ComPtr<ID3D12Heap> m_Heaps[NumHeapTypes];
+	u64 m_PhysicalHeapSizes[NumHeapTypes];
+};
@@ -30,7 +30,7 @@ void SceneRenderer::RenderScene(RenderTarget& renderTarget, const Scene& scene,
 
 	//for (RefPtr<Model> model : scene.m_Models)
 	//{
-	//	XMMATRIX worldMatrix = model->GetTransform() * model->GetRotation() * model->GetScale();
+	//	XMMATRIX worldMatrix = model->GetWorldMatrix();
 
 	//	std::vector<XMMATRIX> instances;
 	//	instances.push_back(worldMatrix);
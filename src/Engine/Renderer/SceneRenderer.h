@@ -17,6 +17,11 @@ class SceneRenderer : public Renderer
 public:
 	bool Initialize();
 	void RenderScene(RenderTarget& renderTarget, const Scene& scene, RefPtr<CommandList> commandList = nullptr);
+
+	const VisibilityBufferRenderer& GetVisibilityBufferRenderer() const
+	{
+		return *m_VisibilityBufferRenderer;
+	}
 private:    
 	UniquePtr<VisibilityBufferRenderer> m_VisibilityBufferRenderer;
 
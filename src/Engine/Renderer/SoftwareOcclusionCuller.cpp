@@ -0,0 +1,348 @@
+#include <enginepch.h>
+#include "SoftwareOcclusionCuller.h"
+
+#include "FrustumCulling.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+namespace
+{
+// Triangles are clipped to [-GuardBand, GuardBand] in normalized device coordinates, which keeps the
+// edge functions precise for triangles that end far outside the screen.
+constexpr float GuardBand = 2.0f;
+// The near plane and the four guard band planes. A clip space point p is inside if dot(plane, p) >= 0.
+constexpr u32 NumClipPlanes = 5;
+constexpr float ClipPlanes[NumClipPlanes][4] = {
+	{ 0.0f, 0.0f, 1.0f, 0.0f },        //  0 <= z
+	{ 1.0f, 0.0f, 0.0f, GuardBand },   // -g * w <= x
+	{ -1.0f, 0.0f, 0.0f, GuardBand },  //  x <= g * w
+	{ 0.0f, 1.0f, 0.0f, GuardBand },   // -g * w <= y
+	{ 0.0f, -1.0f, 0.0f, GuardBand },  //  y <= g * w
+};
+// A triangle clipped by all planes has at most 3 + NumClipPlanes vertices.
+constexpr u32 MaxClippedVertices = 3 + NumClipPlanes;
+
+float PlaneDistance(const float plane[4], const XMFLOAT4& p)
+{
+	return plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3] * p.w;
+}
+}  // namespace
+
+void SoftwareOcclusionCuller::Resize(u32 width, u32 height)
+{
+	assert(width > 0 && height > 0);
+
+	m_Width = (width + 3) & ~3u;
+	m_Height = height;
+
+	m_Levels.clear();
+	u32 levelWidth = m_Width;
+	u32 levelHeight = m_Height;
+	while (true)
+	{
+		m_Levels.push_back({ levelWidth, levelHeight, std::vector<float>(static_cast<size_t>(levelWidth) * levelHeight, 1.0f) });
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = std::max(levelWidth >> 1, 1u);
+		levelHeight = std::max(levelHeight >> 1, 1u);
+	}
+}
+
+void XM_CALLCONV SoftwareOcclusionCuller::Begin(FXMMATRIX viewProjection)
+{
+	assert(!m_Levels.empty() && "Resize must be called before Begin.");
+
+	XMStoreFloat4x4(&m_ViewProjection, viewProjection);
+	std::fill(m_Levels[0].Depth.begin(), m_Levels[0].Depth.end(), 1.0f);
+	m_NumTriangles = 0;
+}
+
+void XM_CALLCONV SoftwareOcclusionCuller::RenderOccluder(const XMFLOAT3* positions, u32 numVertices, u32 stride,
+	const u32* indices, u32 numIndices, FXMMATRIX world)
+{
+	XMMATRIX worldViewProjection = XMMatrixMultiply(world, XMLoadFloat4x4(&m_ViewProjection));
+
+	m_ClipVertices.resize(numVertices);
+	const u8* position = reinterpret_cast<const u8*>(positions);
+	for (u32 i = 0; i < numVertices; ++i, position += stride)
+	{
+		XMStoreFloat4(&m_ClipVertices[i], XMVector3Transform(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(position)), worldViewProjection));
+	}
+
+	for (u32 i = 0; i + 2 < numIndices; i += 3)
+	{
+		assert(indices[i] < numVertices && indices[i + 1] < numVertices && indices[i + 2] < numVertices);
+		ClipAndRasterize(m_ClipVertices[indices[i]], m_ClipVertices[indices[i + 1]], m_ClipVertices[indices[i + 2]]);
+	}
+}
+
+void SoftwareOcclusionCuller::ClipAndRasterize(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c)
+{
+	XMFLOAT4 polygon[2][MaxClippedVertices] = { { a, b, c } };
+	u32 numVertices = 3;
+	u32 current = 0;
+
+	for (const auto& plane : ClipPlanes)
+	{
+		float da = PlaneDistance(plane, a);
+		float db = PlaneDistance(plane, b);
+		float dc = PlaneDistance(plane, c);
+		if (da < 0.0f && db < 0.0f && dc < 0.0f)
+		{
+			return;
+		}
+		if (da >= 0.0f && db >= 0.0f && dc >= 0.0f)
+		{
+			continue;
+		}
+
+		// Sutherland-Hodgman: keep the inside vertices and add the intersections of the crossing edges.
+		const XMFLOAT4* input = polygon[current];
+		XMFLOAT4* output = polygon[current ^ 1];
+		u32 numOutput = 0;
+		for (u32 i = 0; i < numVertices; ++i)
+		{
+			const XMFLOAT4& p = input[i];
+			const XMFLOAT4& q = input[(i + 1) % numVertices];
+			float dp = PlaneDistance(plane, p);
+			float dq = PlaneDistance(plane, q);
+
+			if (dp >= 0.0f)
+			{
+				output[numOutput++] = p;
+			}
+			if ((dp >= 0.0f) != (dq >= 0.0f))
+			{
+				float t = dp / (dp - dq);
+				output[numOutput++] = { p.x + (q.x - p.x) * t, p.y + (q.y - p.y) * t, p.z + (q.z - p.z) * t, p.w + (q.w - p.w) * t };
+			}
+		}
+
+		current ^= 1;
+		numVertices = numOutput;
+		if (numVertices < 3)
+		{
+			return;
+		}
+	}
+
+	// Project to pixels. y points down in the depth buffer.
+	XMFLOAT3 screen[MaxClippedVertices];
+	for (u32 i = 0; i < numVertices; ++i)
+	{
+		const XMFLOAT4& p = polygon[current][i];
+		float invW = 1.0f / p.w;
+		screen[i] = { (p.x * invW * 0.5f + 0.5f) * m_Width, (0.5f - p.y * invW * 0.5f) * m_Height, p.z * invW };
+	}
+
+	// The clipped polygon is convex, so it is drawn as a fan.
+	for (u32 i = 1; i + 1 < numVertices; ++i)
+	{
+		RasterizeTriangle(screen[0], screen[i], screen[i + 1]);
+	}
+}
+
+void SoftwareOcclusionCuller::RasterizeTriangle(XMFLOAT3 v0, XMFLOAT3 v1, XMFLOAT3 v2)
+{
+	// Twice the signed area. Swap to counter-clockwise (in pixels) so the inside is where all edge functions are positive.
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+	if (!(area > 1e-6f))
+	{
+		return;
+	}
+
+	// The pixels whose centers are inside the bounds of the triangle.
+	int minX = std::max(static_cast<int>(std::ceil(std::min({ v0.x, v1.x, v2.x }) - 0.5f)), 0);
+	int maxX = std::min(static_cast<int>(std::floor(std::max({ v0.x, v1.x, v2.x }) - 0.5f)), static_cast<int>(m_Width) - 1);
+	int minY = std::max(static_cast<int>(std::ceil(std::min({ v0.y, v1.y, v2.y }) - 0.5f)), 0);
+	int maxY = std::min(static_cast<int>(std::floor(std::max({ v0.y, v1.y, v2.y }) - 0.5f)), static_cast<int>(m_Height) - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+	// Groups of 4 pixels start at multiples of 4, so they never cross the end of a row.
+	minX &= ~3;
+
+	++m_NumTriangles;
+
+	// The edge function of the edge a -> b is A * x + B * y + C, positive on the inside.
+	auto edge = [](const XMFLOAT3& a, const XMFLOAT3& b, float& A, float& B, float& C)
+	{
+		A = a.y - b.y;
+		B = b.x - a.x;
+		C = -(A * a.x + B * a.y);
+	};
+	float a0, b0, c0, a1, b1, c1, a2, b2, c2;
+	edge(v1, v2, a0, b0, c0);  // Barycentric weight of v0.
+	edge(v2, v0, a1, b1, c1);  // Barycentric weight of v1.
+	edge(v0, v1, a2, b2, c2);  // Barycentric weight of v2.
+
+	// The depth is linear in screen space: z = zA * x + zB * y + zC.
+	float invArea = 1.0f / area;
+	float zA = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+	float zB = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+	float zC = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 edgeA0 = _mm_set1_ps(a0), edgeA1 = _mm_set1_ps(a1), edgeA2 = _mm_set1_ps(a2);
+	const __m128 depthA = _mm_set1_ps(zA);
+
+	float* depthBuffer = m_Levels[0].Depth.data();
+	for (int y = minY; y <= maxY; ++y)
+	{
+		float pixelY = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(b0 * pixelY + c0);
+		const __m128 row1 = _mm_set1_ps(b1 * pixelY + c1);
+		const __m128 row2 = _mm_set1_ps(b2 * pixelY + c2);
+		const __m128 rowDepth = _mm_set1_ps(zB * pixelY + zC);
+
+		float* row = depthBuffer + static_cast<size_t>(y) * m_Width;
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), row0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), row1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), row2);
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			__m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+			__m128 previous = _mm_loadu_ps(row + x);
+			__m128 nearest = _mm_min_ps(previous, depth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+		}
+	}
+}
+
+void SoftwareOcclusionCuller::End()
+{
+	for (size_t i = 1; i < m_Levels.size(); ++i)
+	{
+		const Level& source = m_Levels[i - 1];
+		Level& level = m_Levels[i];
+
+		// Every texel covers 2x2 source texels. At odd source sizes, the last texel of a row (or column) also
+		// covers the last source texel.
+		for (u32 y = 0; y < level.Height; ++y)
+		{
+			u32 sourceY0 = std::min(y * 2, source.Height - 1);
+			u32 sourceY1 = y == level.Height - 1 ? source.Height - 1 : y * 2 + 1;
+
+			for (u32 x = 0; x < level.Width; ++x)
+			{
+				u32 sourceX0 = std::min(x * 2, source.Width - 1);
+				u32 sourceX1 = x == level.Width - 1 ? source.Width - 1 : x * 2 + 1;
+
+				float depth = 0.0f;
+				for (u32 sy = sourceY0; sy <= sourceY1; ++sy)
+				{
+					for (u32 sx = sourceX0; sx <= sourceX1; ++sx)
+					{
+						depth = std::max(depth, source.Depth[static_cast<size_t>(sy) * source.Width + sx]);
+					}
+				}
+				level.Depth[static_cast<size_t>(y) * level.Width + x] = depth;
+			}
+		}
+	}
+}
+
+bool SoftwareOcclusionCuller::IsVisible(const BoundingBox& box) const
+{
+	XMMATRIX viewProjection = XMLoadFloat4x4(&m_ViewProjection);
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	// The screen rectangle and nearest depth of the corners.
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (u32 i = 0; i < 8; ++i)
+	{
+		XMVECTOR sign = XMVectorSet(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 0.0f);
+		XMFLOAT4 corner;
+		XMStoreFloat4(&corner, XMVector3Transform(XMVectorMultiplyAdd(extents, sign, center), viewProjection));
+
+		// A box that crosses the near plane covers the whole screen, in the worst case.
+		if (corner.z < 0.0f || corner.w <= 0.0f)
+		{
+			return true;
+		}
+
+		float invW = 1.0f / corner.w;
+		minX = std::min(minX, corner.x * invW);
+		maxX = std::max(maxX, corner.x * invW);
+		minY = std::min(minY, corner.y * invW);
+		maxY = std::max(maxY, corner.y * invW);
+		minZ = std::min(minZ, corner.z * invW);
+	}
+
+	// The pixels the rectangle touches.
+	float left = (minX * 0.5f + 0.5f) * m_Width;
+	float right = (maxX * 0.5f + 0.5f) * m_Width;
+	float top = (0.5f - maxY * 0.5f) * m_Height;
+	float bottom = (0.5f - minY * 0.5f) * m_Height;
+	if (right < 0.0f || bottom < 0.0f || left >= m_Width || top >= m_Height)
+	{
+		// Outside the screen: this is for frustum culling to decide.
+		return true;
+	}
+
+	u32 x0 = static_cast<u32>(std::max(left, 0.0f));
+	u32 x1 = static_cast<u32>(std::min(right, static_cast<float>(m_Width - 1)));
+	u32 y0 = static_cast<u32>(std::max(top, 0.0f));
+	u32 y1 = static_cast<u32>(std::min(bottom, static_cast<float>(m_Height - 1)));
+
+	// The finest level at which the rectangle covers at most 4x4 texels.
+	u32 levelIndex = 0;
+	while (levelIndex + 1 < m_Levels.size() && ((x1 >> levelIndex) - (x0 >> levelIndex) > 3 || (y1 >> levelIndex) - (y0 >> levelIndex) > 3))
+	{
+		++levelIndex;
+	}
+
+	const Level& level = m_Levels[levelIndex];
+	u32 levelX0 = std::min(x0 >> levelIndex, level.Width - 1);
+	u32 levelX1 = std::min(x1 >> levelIndex, level.Width - 1);
+	u32 levelY0 = std::min(y0 >> levelIndex, level.Height - 1);
+	u32 levelY1 = std::min(y1 >> levelIndex, level.Height - 1);
+	for (u32 y = levelY0; y <= levelY1; ++y)
+	{
+		for (u32 x = levelX0; x <= levelX1; ++x)
+		{
+			if (minZ <= level.Depth[static_cast<size_t>(y) * level.Width + x])
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+u32 SoftwareOcclusionCuller::Cull(const BoundsArray& bounds, std::vector<u32>& visible) const
+{
+	size_t numVisible = 0;
+	for (u32 index : visible)
+	{
+		if (IsVisible(bounds.Get(index)))
+		{
+			visible[numVisible++] = index;
+		}
+	}
+
+	u32 numOccluded = static_cast<u32>(visible.size() - numVisible);
+	visible.resize(numVisible);
+	return numOccluded;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+
+class BoundsArray;
+
+/**
+ * Occlusion culling on the CPU, for when the GPU occlusion culling results are
+ * not available.
+ *
+ * The depth of a few large occluders is rasterized into a small depth buffer
+ * (4 pixels at once with SSE), which is then reduced to a pyramid of maximum
+ * depths. A box is occluded if its nearest depth is behind the maximum depth
+ * of all the pixels its screen rectangle covers. The pyramid level is chosen
+ * so the rectangle covers at most 4x4 texels.
+ *
+ * The depth range is [0, 1] with 0 at the near plane, like the renderer.
+ */
+class SoftwareOcclusionCuller
+{
+public:
+	/**
+	 * Set the resolution of the depth buffer. The width is rounded up to a
+	 * multiple of 4, the number of pixels rasterized at once.
+	 */
+	void Resize(u32 width, u32 height);
+
+	u32 GetWidth() const
+	{
+		return m_Width;
+	}
+
+	u32 GetHeight() const
+	{
+		return m_Height;
+	}
+
+	/**
+	 * Clear the depth buffer and start rasterizing occluders.
+	 *
+	 * @param viewProjection The view * projection matrix of the occluders and the tested boxes.
+	 */
+	void XM_CALLCONV Begin(DirectX::FXMMATRIX viewProjection);
+
+	/**
+	 * Rasterize the depth of an occluder (an indexed triangle list). Both sides
+	 * of the triangles are rasterized.
+	 *
+	 * @param positions The object space positions, stride bytes apart.
+	 */
+	void XM_CALLCONV RenderOccluder(const DirectX::XMFLOAT3* positions, u32 numVertices, u32 stride,
+		const u32* indices, u32 numIndices, DirectX::FXMMATRIX world);
+
+	// Build the depth pyramid from the occluders. Call after the occluders and before the tests.
+	void End();
+
+	// Returns false if the world space box is hidden behind the occluders.
+	bool IsVisible(const DirectX::BoundingBox& box) const;
+
+	/**
+	 * Remove the occluded boxes from a list. The order of the list is kept.
+	 *
+	 * @param [in, out] visible Indices of boxes in bounds.
+	 * @returns The number of boxes that were removed.
+	 */
+	u32 Cull(const BoundsArray& bounds, std::vector<u32>& visible) const;
+
+	// The depth of a pixel (1 where no occluder was rasterized).
+	float GetDepth(u32 x, u32 y) const
+	{
+		return m_Levels[0].Depth[static_cast<size_t>(y) * m_Width + x];
+	}
+
+	// The number of triangles rasterized since Begin (after clipping).
+	u32 GetNumTriangles() const
+	{
+		return m_NumTriangles;
+	}
+
+private:
+	// Clip a triangle (in clip space) against the near plane and a guard band, then rasterize it.
+	void ClipAndRasterize(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c);
+
+	// Rasterize a triangle with vertices in pixels (x, y) and depth (z).
+	void RasterizeTriangle(DirectX::XMFLOAT3 v0, DirectX::XMFLOAT3 v1, DirectX::XMFLOAT3 v2);
+
+	struct Level
+	{
+		u32 Width;
+		u32 Height;
+		std::vector<float> Depth;
+	};
+
+	u32 m_Width = 0;
+	u32 m_Height = 0;
+	DirectX::XMFLOAT4X4 m_ViewProjection;
+
+	// Level 0 is the depth buffer. A texel of a level holds the maximum depth of the (2x2, or
+	// up to 3x3 at odd edges) texels of the level below.
+	std::vector<Level> m_Levels;
+
+	// Scratch space for the clip space vertices of an occluder.
+	std::vector<DirectX::XMFLOAT4> m_ClipVertices;
+
+	u32 m_NumTriangles = 0;
+};
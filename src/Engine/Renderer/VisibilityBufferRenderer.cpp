@@ -1,13 +1,16 @@
 #include <enginepch.h>
 #include "VisibilityBufferRenderer.h"
+#include <Engine/Renderer/RenderGraph.h>
 
 #include <Engine/Core/Device.h>
 #include <Engine/Core/Scene.h>
 #include <Engine/Core/Application.h>
+#include <Engine/Core/JobSystem.h>
 #include <Engine/Pipeline/CommandQueue.h>
 #include <Engine/Pipeline/CommandList.h>
 #include <Engine/Pipeline/RootSignature.h>
 #include <Engine/Pipeline/PipelineStateObject.h>
+#include <Engine/Pipeline/ShaderManager.h>
 #include <Engine/Buffers/Texture.h>
 #include <Engine/Core/RenderTarget.h>
 #include <Engine/Buffers/Texture.h>
@@ -20,7 +23,26 @@
 #include <Engine/Buffers/IndexBuffer.h>
 #include <Engine/Buffers/VertexBuffer.h>
 
+#include <numeric>
+
 constexpr u32 MaterialLimit = 96;
+// Minimum number of draws recorded by a single command list in the raster stage.
+constexpr u32 MinDrawsPerRecordingChunk = 64;
+// The visibility buffer stores the draw call id of every pixel next to the index offset of its triangle, and the offset
+// buffer holds the material and vertex offset of every draw call id, so its size limits the instances drawn in a frame.
+constexpr u32 MaxDrawCallIds = 4096;
+// The most draw calls that are tested for occlusion on the GPU in a frame, the first (nearest) visible ones. The rest
+// are not tested.
+constexpr u32 MaxOcclusionTests = 1u << 16;
+// The software occlusion rasterizer renders at this width (and the aspect ratio of the window), with at most
+// this many of the nearest visible primitives as occluders. Primitives whose bounds are smaller on screen than
+// MinOccluderSize (the radius over the distance) would hide little, so they are not used.
+constexpr u32 SoftwareOcclusionWidth = 320;
+constexpr u32 MaxOccluders = 64;
+constexpr float MinOccluderSize = 0.05f;
+constexpr u32 MaxOccluderTriangles = 16384;
+// The cluster cones are only used for instances whose squared axis scales differ by less than this fraction.
+constexpr float MaxScaleDifference = 1e-3f;
 
 namespace RasterizeTriangleDataRootParameters
 {
@@ -96,11 +118,50 @@ namespace MaterialResolveParameters
 	};
 }
 
+namespace HiZParameters
+{
+	enum
+	{
+		Constants,
+		DepthBuffer,
+		SourceMip,
+		DestinationMip,
+		NumParameters
+	};
+}
+namespace OcclusionCullParameters
+{
+	enum
+	{
+		Constants,
+		Bounds,
+		HiZ,
+		VisibilityFlags,
+		NumParameters
+	};
+}
+
 using namespace RasterizeTriangleDataRootParameters;
 
+void VisibilityBufferRenderer::CreatePipelineState(std::initializer_list<std::shared_ptr<Shader>> shaders, std::function<void()> createPipelineState)
+{
+	createPipelineState();
+
+	for (const auto& shader : shaders)
+	{
+		m_ShaderReloadConnections.emplace_back(shader->Reloaded += [createPipelineState](EventArgs&)
+		{
+			createPipelineState();
+		});
+	}
+}
+
 bool VisibilityBufferRenderer::Initialize()
 {
 	m_Device = Application::Get().GetDevice();
+	m_ComputeGraph = MakeRef<RenderGraph>(*m_Device, "VisibilityBufferCompute");
+
+	ShaderManager& shaderManager = Application::Get().GetShaderManager();
 
 	auto& commandQueue = m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
 	auto  commandList = commandQueue.GetCommandList();
@@ -109,11 +170,9 @@ bool VisibilityBufferRenderer::Initialize()
 		RASTERIZE TRIANGLE STAGE
 	*/
 	{
-		ComPtr<ID3DBlob> vertexShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/GenericMeshVS.cso", &vertexShaderBlob));
-
-		ComPtr<ID3DBlob> pixelShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/RasterizeTriangleDataPS.cso", &pixelShaderBlob));
+		auto vertexShader = shaderManager.Load("GenericMeshVS");
+		auto compactVertexShader = shaderManager.Load("CompactMeshVS");
+		auto pixelShader = shaderManager.Load("RasterizeTriangleDataPS");
 
 		D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
@@ -126,7 +185,7 @@ bool VisibilityBufferRenderer::Initialize()
 		CD3DX12_ROOT_PARAMETER1 rootParameters[RasterizeTriangleDataRootParameters::NumParameters];
 		rootParameters[RasterizeTriangleDataRootParameters::CameraCB].InitAsConstants((sizeof(Matrix) * 2) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 		rootParameters[RasterizeTriangleDataRootParameters::InstancesSB].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
-		rootParameters[RasterizeTriangleDataRootParameters::DrawCallInfoCB].InitAsConstants(4, 0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[RasterizeTriangleDataRootParameters::DrawCallInfoCB].InitAsConstants(11, 0, 1, D3D12_SHADER_VISIBILITY_ALL);
 		rootParameters[RasterizeTriangleDataRootParameters::OffsetBuffer].InitAsDescriptorTable(1, &offsetBufferRange, D3D12_SHADER_VISIBILITY_PIXEL);
 
 		CD3DX12_STATIC_SAMPLER_DESC linearRepeatSampler(0, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR);
@@ -153,53 +212,59 @@ bool VisibilityBufferRenderer::Initialize()
 
 		// Create a color buffer with sRGB for gamma correction.
 
-		DXGI_FORMAT backBufferFormat = DXGI_FORMAT_R32_UINT;
+		DXGI_FORMAT backBufferFormat = DXGI_FORMAT_R32G32_UINT;
 		DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_D32_FLOAT;
 
 
-		// Create an off-screen render target with a single color buffer and a depth buffer.
-		auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(backBufferFormat, WND_PROP.Width, WND_PROP.Height, 1, 1, 1,
-			0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-		D3D12_CLEAR_VALUE colorClearValue;
-		colorClearValue.Format = colorDesc.Format;
-		colorClearValue.Color[0] = 0;
-
-		auto colorTexture = m_Device->CreateTexture(colorDesc, &colorClearValue);
-		colorTexture->SetName(L"Visibility Buffer");
-
-		// Create a depth buffer.
-		auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D(depthBufferFormat, WND_PROP.Width, WND_PROP.Height, 1, 1, 1,
+		// Create a depth buffer. The raster stage only runs on the direct queue, so it is shared by the frame buffers.
+		// It is typeless, because the Hi-Z stage reads it.
+		auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_TYPELESS, WND_PROP.Width, WND_PROP.Height, 1, 1, 1,
 			0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
 		D3D12_CLEAR_VALUE depthClearValue;
-		depthClearValue.Format = depthDesc.Format;
+		depthClearValue.Format = depthBufferFormat;
 		depthClearValue.DepthStencil = { 1.0f, 0 };
 
 		auto depthTexture = m_Device->CreateTexture(depthDesc, &depthClearValue);
 		depthTexture->SetName(L"Depth Render Target");
+		m_DepthTexture = depthTexture;
 
 		// TODO: Actually bind default depth texture and dont create new one
 
-		// Attach the textures to the render target.
-		m_VisibilityBuffer.AttachTexture(AttachmentPoint::Color0, colorTexture);
-		m_VisibilityBuffer.AttachTexture(AttachmentPoint::DepthStencil, depthTexture);
-
 		constexpr u32 offsetStride = sizeof(u32) * 2;
-		constexpr u32 numOffsets = 4096;
+		constexpr u32 numOffsets = MaxDrawCallIds;
 
-		m_OffsetBuffer = m_Device->CreateStructuredBuffer(numOffsets, offsetStride);
+		for (auto& frame : m_FrameBuffers)
+		{
+			// Create an off-screen render target with a single color buffer and a depth buffer.
+			auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(backBufferFormat, WND_PROP.Width, WND_PROP.Height, 1, 1, 1,
+				0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			D3D12_CLEAR_VALUE colorClearValue;
+			colorClearValue.Format = colorDesc.Format;
+			colorClearValue.Color[0] = 0;
+			colorClearValue.Color[1] = 0;
 
-		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-		uavDesc.Buffer.StructureByteStride = offsetStride;
-		uavDesc.Buffer.CounterOffsetInBytes = 0;
-		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = numOffsets;
-		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+			auto colorTexture = m_Device->CreateTexture(colorDesc, &colorClearValue);
+			colorTexture->SetName(L"Visibility Buffer");
+
+			// Attach the textures to the render target.
+			frame.m_VisibilityBuffer.AttachTexture(AttachmentPoint::Color0, colorTexture);
+			frame.m_VisibilityBuffer.AttachTexture(AttachmentPoint::DepthStencil, depthTexture);
 
-		m_OffsetBufferUAV = m_Device->CreateUnorderedAccessView(m_OffsetBuffer, m_OffsetBuffer->GetCounterBuffer(), &uavDesc);
+			frame.m_OffsetBuffer = m_Device->CreateStructuredBuffer(numOffsets, offsetStride);
 
-		colorTexture->CreateViews();
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+			uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+			uavDesc.Buffer.StructureByteStride = offsetStride;
+			uavDesc.Buffer.CounterOffsetInBytes = 0;
+			uavDesc.Buffer.FirstElement = 0;
+			uavDesc.Buffer.NumElements = numOffsets;
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+
+			frame.m_OffsetBufferUAV = m_Device->CreateUnorderedAccessView(frame.m_OffsetBuffer, frame.m_OffsetBuffer->GetCounterBuffer(), &uavDesc);
+
+			colorTexture->CreateViews();
+		}
 
 		D3D12_RT_FORMAT_ARRAY rtvFormats = {};
 		rtvFormats.NumRenderTargets = 1;
@@ -208,21 +273,35 @@ bool VisibilityBufferRenderer::Initialize()
 		pipelineStateStream.pRootSignature = m_RasterizeTriangleState.m_RootSignature->GetD3D12RootSignature().Get();
 		pipelineStateStream.InputLayout = VertexPositionNormalTangentBitangentTexture::InputLayout;
 		pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-		pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
 		pipelineStateStream.DSVFormat = depthBufferFormat;
 		pipelineStateStream.RTVFormats = rtvFormats;
 		//pipelineStateStream.SampleDesc = sampleDesc;
 
-		m_RasterizeTriangleState.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ vertexShader, pixelShader }, [this, pipelineStateStream, vertexShader, pixelShader]() mutable
+		{
+			pipelineStateStream.VS = vertexShader->GetBytecode();
+			pipelineStateStream.PS = pixelShader->GetBytecode();
+			m_RasterizeTriangleState.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
+
+		// Primitives with compact vertex buffers are drawn with the same stage, decoding their vertices in the vertex shader.
+		pipelineStateStream.InputLayout = VertexCompact::InputLayout;
+		CreatePipelineState({ compactVertexShader, pixelShader }, [this, pipelineStateStream, compactVertexShader, pixelShader]() mutable
+		{
+			pipelineStateStream.VS = compactVertexShader->GetBytecode();
+			pipelineStateStream.PS = pixelShader->GetBytecode();
+			m_RasterizeTriangleState.m_CompactPipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 	}
 
 	/*
 		MATERIAL COUNT STAGE
 	*/
 	{
+		// The counts persist between frames (the prefix sum stage resets them), so this is imported
+		// into the compute graph rather than transient. The graph records its barriers.
 		m_MaterialCountBuffer = m_Device->CreateStructuredBuffer(MaterialLimit, 4);
-		m_MaterialOffsetBuffer = m_Device->CreateStructuredBuffer(MaterialLimit, 4);
+		m_MaterialCountBuffer->SetManuallyManaged(true);
 
 		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
@@ -234,10 +313,8 @@ bool VisibilityBufferRenderer::Initialize()
 		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
 
 		m_MaterialCountUAV = m_Device->CreateUnorderedAccessView(m_MaterialCountBuffer, m_MaterialCountBuffer->GetCounterBuffer(), &uavDesc);
-		m_MaterialOffsetUAV = m_Device->CreateUnorderedAccessView(m_MaterialOffsetBuffer, m_MaterialOffsetBuffer->GetCounterBuffer(), &uavDesc);
 
-		ComPtr<ID3DBlob> computeShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/MaterialCountCS.cso", &computeShaderBlob));
+		auto computeShader = shaderManager.Load("MaterialCountCS");
 
 		CD3DX12_DESCRIPTOR_RANGE1 visbufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
 		CD3DX12_DESCRIPTOR_RANGE1 offsetBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
@@ -263,17 +340,19 @@ bool VisibilityBufferRenderer::Initialize()
 		} pipelineStateStream;
 
 		pipelineStateStream.pRootSignature = m_MaterialCountStage.m_RootSignature->GetD3D12RootSignature().Get();
-		pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
 
-		m_MaterialCountStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ computeShader }, [this, pipelineStateStream, computeShader]() mutable
+		{
+			pipelineStateStream.CS = computeShader->GetBytecode();
+			m_MaterialCountStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 	}
 
 	/*
 		MATERIAL PREFIX SUM STAGE
 	*/
 	{
-		ComPtr<ID3DBlob> computeShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/MaterialPrefixSumCS.cso", &computeShaderBlob));
+		auto computeShader = shaderManager.Load("MaterialPrefixSumCS");
 
 		CD3DX12_DESCRIPTOR_RANGE1 countBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0,
 			D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
@@ -302,17 +381,19 @@ bool VisibilityBufferRenderer::Initialize()
 		} pipelineStateStream;
 
 		pipelineStateStream.pRootSignature = m_MaterialPrefixSumStage.m_RootSignature->GetD3D12RootSignature().Get();
-		pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
 
-		m_MaterialPrefixSumStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ computeShader }, [this, pipelineStateStream, computeShader]() mutable
+		{
+			pipelineStateStream.CS = computeShader->GetBytecode();
+			m_MaterialPrefixSumStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 	}
 
 	/*
 		PIXEL POSITION BUFFER STAGE
 	*/
 	{
-		ComPtr<ID3DBlob> computeShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/PixelPositionBufferCS.cso", &computeShaderBlob));
+		auto computeShader = shaderManager.Load("PixelPositionBufferCS");
 
 		CD3DX12_DESCRIPTOR_RANGE1 visBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
 		CD3DX12_DESCRIPTOR_RANGE1 offsetBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
@@ -342,9 +423,12 @@ bool VisibilityBufferRenderer::Initialize()
 		} pipelineStateStream;
 
 		pipelineStateStream.pRootSignature = m_PixelPositionBufferStage.m_RootSignature->GetD3D12RootSignature().Get();
-		pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
 
-		m_PixelPositionBufferStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ computeShader }, [this, pipelineStateStream, computeShader]() mutable
+		{
+			pipelineStateStream.CS = computeShader->GetBytecode();
+			m_PixelPositionBufferStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 	}
 
 
@@ -352,8 +436,7 @@ bool VisibilityBufferRenderer::Initialize()
 		MATERIAL RESOLVE STAGE
 	*/
 	{
-		ComPtr<ID3DBlob> computeShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/MaterialResolveCS.cso", &computeShaderBlob));
+		auto computeShader = shaderManager.Load("MaterialResolveCS");
 
 		CD3DX12_DESCRIPTOR_RANGE1 visBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0);
 		CD3DX12_DESCRIPTOR_RANGE1 offsetBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
@@ -394,9 +477,12 @@ bool VisibilityBufferRenderer::Initialize()
 		} pipelineStateStream;
 
 		pipelineStateStream.pRootSignature = m_MaterialResolveStage.m_RootSignature->GetD3D12RootSignature().Get();
-		pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
 
-		m_MaterialResolveStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ computeShader }, [this, pipelineStateStream, computeShader]() mutable
+		{
+			pipelineStateStream.CS = computeShader->GetBytecode();
+			m_MaterialResolveStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 
 		D3D12_INDIRECT_ARGUMENT_DESC args[2];
 		args[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
@@ -415,14 +501,116 @@ bool VisibilityBufferRenderer::Initialize()
 	}
 
 	/*
-		FULLSCREEN DEBUG STAGE
+		HI-Z STAGE
 	*/
 	{
-		ComPtr<ID3DBlob> vertexShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/FullscreenVS.cso", &vertexShaderBlob));
+		auto initShader = shaderManager.Load("HiZInitCS");
+		auto reduceShader = shaderManager.Load("HiZReduceCS");
+
+		// The pyramid starts at half the resolution of the depth buffer and goes down to 1x1.
+		u32 width = std::max(WND_PROP.Width >> 1, 1u);
+		u32 height = std::max(WND_PROP.Height >> 1, 1u);
+		u16 numMips = 1;
+		while ((std::max(width, height) >> numMips) > 0)
+		{
+			++numMips;
+		}
+
+		auto hiZDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, width, height, 1, numMips, 1,
+			0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		m_HiZTexture = m_Device->CreateTexture(hiZDesc);
+		m_HiZTexture->SetName(L"Hi-Z Pyramid");
+
+		CD3DX12_DESCRIPTOR_RANGE1 depthBufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+		CD3DX12_DESCRIPTOR_RANGE1 sourceRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+		CD3DX12_DESCRIPTOR_RANGE1 destinationRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+
+		CD3DX12_ROOT_PARAMETER1 rootParameters[HiZParameters::NumParameters];
+		rootParameters[HiZParameters::Constants].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[HiZParameters::DepthBuffer].InitAsDescriptorTable(1, &depthBufferRange, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[HiZParameters::SourceMip].InitAsDescriptorTable(1, &sourceRange, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[HiZParameters::DestinationMip].InitAsDescriptorTable(1, &destinationRange, D3D12_SHADER_VISIBILITY_ALL);
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription(HiZParameters::NumParameters, rootParameters);
+
+		m_HiZStage.m_RootSignature = m_Device->CreateRootSignature(rootSignatureDescription.Desc_1_1);
+		m_HiZStage.m_RootSignature->GetD3D12RootSignature()->SetName(L"HiZ");
+
+		struct PipelineStateStream
+		{
+			CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE        pRootSignature;
+			CD3DX12_PIPELINE_STATE_STREAM_CS                    CS;
+		} pipelineStateStream;
+
+		pipelineStateStream.pRootSignature = m_HiZStage.m_RootSignature->GetD3D12RootSignature().Get();
+
+		CreatePipelineState({ initShader }, [this, pipelineStateStream, initShader]() mutable
+		{
+			pipelineStateStream.CS = initShader->GetBytecode();
+			m_HiZStage.m_InitPipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
+		CreatePipelineState({ reduceShader }, [this, pipelineStateStream, reduceShader]() mutable
+		{
+			pipelineStateStream.CS = reduceShader->GetBytecode();
+			m_HiZStage.m_ReducePipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
+	}
 
-		ComPtr<ID3DBlob> pixelShaderBlob;
-		ThrowIfFailed(D3DReadFileToBlob(L"Shaders/DeferredLitPS.cso", &pixelShaderBlob));
+	/*
+		OCCLUSION CULL STAGE
+	*/
+	{
+		auto computeShader = shaderManager.Load("OcclusionCullCS");
+
+		CD3DX12_DESCRIPTOR_RANGE1 hiZRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+
+		CD3DX12_ROOT_PARAMETER1 rootParameters[OcclusionCullParameters::NumParameters];
+		rootParameters[OcclusionCullParameters::Constants].InitAsConstants((sizeof(Matrix) + sizeof(u32) * 4) / 4, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[OcclusionCullParameters::Bounds].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[OcclusionCullParameters::HiZ].InitAsDescriptorTable(1, &hiZRange, D3D12_SHADER_VISIBILITY_ALL);
+		rootParameters[OcclusionCullParameters::VisibilityFlags].InitAsUnorderedAccessView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription(OcclusionCullParameters::NumParameters, rootParameters);
+
+		m_OcclusionCullStage.m_RootSignature = m_Device->CreateRootSignature(rootSignatureDescription.Desc_1_1);
+		m_OcclusionCullStage.m_RootSignature->GetD3D12RootSignature()->SetName(L"OcclusionCull");
+
+		struct PipelineStateStream
+		{
+			CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE        pRootSignature;
+			CD3DX12_PIPELINE_STATE_STREAM_CS                    CS;
+		} pipelineStateStream;
+
+		pipelineStateStream.pRootSignature = m_OcclusionCullStage.m_RootSignature->GetD3D12RootSignature().Get();
+
+		CreatePipelineState({ computeShader }, [this, pipelineStateStream, computeShader]() mutable
+		{
+			pipelineStateStream.CS = computeShader->GetBytecode();
+			m_OcclusionCullStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
+
+		m_OcclusionFlagBuffer = m_Device->CreateStructuredBuffer(MaxOcclusionTests, sizeof(u32));
+
+		// The readback buffers stay mapped. The CPU only reads them after their fence has completed.
+		auto readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(MaxOcclusionTests * sizeof(u32));
+		for (auto& readback : m_OcclusionReadbacks)
+		{
+			ThrowIfFailed(m_Device->GetD3D12Device()->CreateCommittedResource(ADDR(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK)),
+				D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readback.m_Buffer)));
+			readback.m_Buffer->SetName(L"Occlusion Readback");
+
+			void* flags = nullptr;
+			ThrowIfFailed(readback.m_Buffer->Map(0, nullptr, &flags));
+			readback.m_Flags = static_cast<const u32*>(flags);
+		}
+	}
+
+	/*
+		FULLSCREEN DEBUG STAGE
+	*/
+	{
+		auto vertexShader = shaderManager.Load("FullscreenVS");
+		auto pixelShader = shaderManager.Load("DeferredLitPS");
 
 		D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
@@ -474,47 +662,39 @@ bool VisibilityBufferRenderer::Initialize()
 		pipelineStateStream.pRootSignature = m_DebugTriangleStage.m_RootSignature->GetD3D12RootSignature().Get();
 		pipelineStateStream.InputLayout = VertexPositionNormalTangentBitangentTexture::InputLayout;
 		pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-		pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
 		pipelineStateStream.DSVFormat = depthBufferFormat;
 		pipelineStateStream.RTVFormats = rtvFormats;
 		pipelineStateStream.SampleDesc = sampleDesc;
 
-		m_DebugTriangleStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		CreatePipelineState({ vertexShader, pixelShader }, [this, pipelineStateStream, vertexShader, pixelShader]() mutable
+		{
+			pipelineStateStream.VS = vertexShader->GetBytecode();
+			pipelineStateStream.PS = pixelShader->GetBytecode();
+			m_DebugTriangleStage.m_PipelineState = m_Device->CreatePipelineStateObject(pipelineStateStream);
+		});
 	}
 
 	{
 		DXGI_FORMAT backBufferFormat = DXGI_FORMAT_R32_FLOAT;
 		DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_D32_FLOAT;
 
-		// Create an off-screen render target with a single color buffer and a depth buffer.
-		auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(backBufferFormat, WND_PROP.Width * 4, WND_PROP.Height, 1, 1, 1,
-			0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-		D3D12_CLEAR_VALUE colorClearValue;
-		colorClearValue.Format = colorDesc.Format;
-		colorClearValue.Color[0] = 0;
-
-		auto colorTexture = m_Device->CreateTexture(colorDesc, &colorClearValue);
-		colorTexture->SetName(L"GBuffer Texture");
-
-
-		// Create a depth buffer.
-		//auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D(depthBufferFormat, WND_PROP.Width * 4, WND_PROP.Height, 1, 1, 1,
-		//	0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-		//D3D12_CLEAR_VALUE depthClearValue;
-		//depthClearValue.Format = depthDesc.Format;
-		//depthClearValue.DepthStencil = { 1.0f, 0 };
-
-		//auto depthTexture = m_Device->CreateTexture(depthDesc, &depthClearValue);
-		//depthTexture->SetName(L"Depth Render Target");
+		for (auto& frame : m_FrameBuffers)
+		{
+			// Create an off-screen render target with a single color buffer and a depth buffer.
+			auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(backBufferFormat, WND_PROP.Width * 4, WND_PROP.Height, 1, 1, 1,
+				0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			D3D12_CLEAR_VALUE colorClearValue;
+			colorClearValue.Format = colorDesc.Format;
+			colorClearValue.Color[0] = 0;
 
-		// TODO: Actually bind default depth texture and dont create new one
+			auto colorTexture = m_Device->CreateTexture(colorDesc, &colorClearValue);
+			colorTexture->SetName(L"GBuffer Texture");
 
-		// Attach the textures to the render target.
-		m_GBuffer.AttachTexture(AttachmentPoint::Color0, colorTexture);
-		//m_GBuffer.AttachTexture(AttachmentPoint::DepthStencil, depthTexture);
+			// Attach the textures to the render target.
+			frame.m_GBuffer.AttachTexture(AttachmentPoint::Color0, colorTexture);
 
-		colorTexture->CreateViews();
+			colorTexture->CreateViews();
+		}
 	}
 
 	commandQueue.Flush();  // Wait for loading operations to complete before rendering the first frame.
@@ -526,33 +706,8 @@ void VisibilityBufferRenderer::BeginFrame()
 {
 }
 
-static u32 drawCallId = 0;
-
 void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Scene& scene, RefPtr<CommandList> commandList)
 {
-	if (!m_PixelPositionUAV || !m_PixelPositionBuffer || (u64)WND_PROP.Height * WND_PROP.Width != m_PixelPositionBuffer->GetNumElements())
-	{
-		//auto& copyQueue = m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-		//auto list = copyQueue.GetCommandList();
-
-		u32 num = WND_PROP.Height * WND_PROP.Width;
-
-		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-		uavDesc.Buffer.StructureByteStride = sizeof(Vector2);
-		uavDesc.Buffer.CounterOffsetInBytes = 0;
-		uavDesc.Buffer.FirstElement = 0;
-		uavDesc.Buffer.NumElements = num;
-		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
-
-		m_PixelPositionBuffer = m_Device->CreateStructuredBuffer(num, sizeof(Vector2));
-		m_PixelPositionUAV = m_Device->CreateUnorderedAccessView(m_PixelPositionBuffer, m_PixelPositionBuffer->GetCounterBuffer(), &uavDesc);
-		
-		//copyQueue.WaitForFenceValue(copyQueue.ExecuteCommandList(list));
-		//copyQueue.Flush();
-	}
-
 	auto& commandQueue = m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 	auto& computeQueue = m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
 
@@ -561,6 +716,10 @@ void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Sce
 		commandList = commandQueue.GetCommandList();
 	}
 
+	// The buffers that are written this frame. With async compute they were last read by the debug stage of the
+	// previous frame, which is ordered before this frame's raster stage on the direct queue.
+	auto& frame = m_FrameBuffers[m_FrameIndex % NumFrameBuffers];
+
 	u32 materialCount = 0;
 	std::unordered_map<Material*, u32> materialCache;
 
@@ -569,25 +728,83 @@ void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Sce
 		RASTERIZE TRIANGLE STAGE
 	*/
 	{
-		m_VisibilityBuffer.Clear(commandList, { 0, 0, 0, 0 }, true);
+		const auto& models = scene.GetModels();
+
+		// The primitives of all models are numbered up front, and their world space bounds are indexed by that number.
+		m_FirstDrawCallIds.resize(models.size());
+		m_DrawCallModels.clear();
+		m_PrimitiveBounds.Clear();
+		u32 numDrawCalls = 0;
+		for (size_t i = 0; i < models.size(); ++i)
+		{
+			const auto& model = models[i];
+			m_FirstDrawCallIds[i] = numDrawCalls;
 
-		commandList->SetPipelineState(m_RasterizeTriangleState.m_PipelineState);
-		commandList->SetGraphicsRootSignature(m_RasterizeTriangleState.m_RootSignature);
+			for (const auto& primitive : model->GetMesh()->GetPrimitives())
+			{
+				m_DrawCallModels.push_back(static_cast<u32>(i));
+				m_PrimitiveBounds.Add(primitive.m_BoundingBox, model->GetWorldMatrix());
+				++numDrawCalls;
+			}
+		}
 
-		commandList->SetViewport(WND_PROP.Viewport);
-		commandList->SetScissorRect(WND_PROP.ScissorRect);
-		commandList->SetRenderTarget(m_VisibilityBuffer);
-		commandList->SetUnorderedAccessView(RasterizeTriangleDataRootParameters::OffsetBuffer, 0, m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		// Only the primitives that intersect the view frustum are drawn. The items of the scene's BVH are numbered like
+		// the draw calls, and its query returns them roughly front to back, which the occlusion culling relies on to
+		// test and rasterize the nearest primitives first. The flat cull is only used while the BVH is out of date.
+		const Camera& camera = scene.GetCameraRef();
+		const Matrix viewProjection = camera.get_ViewMatrix() * camera.get_ProjectionMatrix();
+		const BoundingVolumeHierarchy& bvh = scene.GetBVH();
+		m_VisibleFrontToBack = false;
+		if (m_FrustumCulling)
+		{
+			Frustum frustum = Frustum::FromViewProjection(viewProjection);
+			if (bvh.GetNumItems() == numDrawCalls)
+			{
+				const Vector3 viewPosition = camera.get_Translation();
+				bvh.QueryFrustum(frustum, m_VisibleDrawCalls, &viewPosition);
+				m_VisibleFrontToBack = true;
+			}
+			else
+			{
+				m_PrimitiveBounds.Cull(frustum, m_VisibleDrawCalls);
+			}
+		}
+		else
+		{
+			m_VisibleDrawCalls.resize(numDrawCalls);
+			std::iota(m_VisibleDrawCalls.begin(), m_VisibleDrawCalls.end(), 0);
+		}
 
-		XMMATRIX matrices[2] = {
-			scene.GetCameraRef().get_ViewMatrix(),
-			scene.GetCameraRef().get_ProjectionMatrix()
-		};
+		// The primitives that passed frustum culling are tested against the previous frame's depth buffer before it
+		// is cleared, and the ones that are hidden behind others are not drawn.
+		const u32 occlusionReadback = m_FrameIndex % NumOcclusionReadbacks;
+		const bool occlusionTest = m_OcclusionCulling == OcclusionCulling::HierarchicalZ &&
+			RecordOcclusionTest(*commandList, scene, numDrawCalls);
+		CullOccludedDrawCalls(scene, numDrawCalls, viewProjection);
 
-		commandList->SetGraphics32BitConstants(RasterizeTriangleDataRootParameters::CameraCB, matrices);
+		frame.m_VisibilityBuffer.Clear(commandList, { 0, 0, 0, 0 }, true);
+		m_DepthScene = &scene;
+		m_DepthViewProjection = viewProjection;
 
-		drawCallId = 0;
-		for (RefPtr<Model> model : scene.GetModels())
+		// The level of detail of a draw call is selected by how large the error of the levels is on screen. An object
+		// space unit at distance d covers pixelsAtUnitDistance / d pixels vertically (the projection scales y by cot(fov / 2)).
+		if (m_LodScene != &scene || m_DrawCallLods.size() != numDrawCalls)
+		{
+			m_DrawCallLods.assign(numDrawCalls, 0);
+			m_LodScene = &scene;
+		}
+
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, camera.get_ProjectionMatrix());
+		const float pixelsAtUnitDistance = projection._22 * 0.5f * WND_PROP.Height;
+		const XMVECTOR eye = camera.get_Translation();
+		m_LodStatistics = {};
+
+		// The visible primitives of models that share a mesh are merged into one instanced draw per primitive and level of
+		// detail. The instances get consecutive draw call ids in the visibility buffer, and their world matrices are stored
+		// at their draw call id in an instance buffer for the frame, so the compute stages can look them up.
+		// The batches are sorted by the index of their material in the frame, which the materials of all models get up front.
+		for (RefPtr<Model> model : models)
 		{
 			for (auto& material : model->GetMesh()->GetMaterials())
 			{
@@ -597,50 +814,195 @@ void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Sce
 					materialCount++;
 				}
 			}
-		
+		}
+
+		m_InstanceBatcher.Clear();
+		for (u32 drawCall : m_VisibleDrawCalls)
+		{
+			u32 modelIndex = m_DrawCallModels[drawCall];
+			const Model& model = *models[modelIndex];
+			const Mesh& mesh = *model.GetMesh();
+			const MeshPrimitive& primitive = mesh.GetPrimitives()[drawCall - m_FirstDrawCallIds[modelIndex]];
+
+			const auto& materials = mesh.GetMaterials();
+			const u32 materialKey = primitive.m_MaterialIndex < materials.size() ? materialCache[materials[primitive.m_MaterialIndex].get()] : ~0u;
+
+			u32 lod = 0;
+			if (m_LodSelection && primitive.GetNumLods() > 1)
+			{
+				// The nearest point of the bounds, and the largest scale of the world matrix.
+				BoundingBox box = m_PrimitiveBounds.Get(drawCall);
+				float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents)));
+				float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&box.Center), eye))) - radius;
+
+				XMMATRIX world = model.GetWorldMatrix();
+				float scale = std::sqrt(std::max({ XMVectorGetX(XMVector3LengthSq(world.r[0])), XMVectorGetX(XMVector3LengthSq(world.r[1])),
+					XMVectorGetX(XMVector3LengthSq(world.r[2])) }));
+
+				lod = SelectLod(primitive, m_DrawCallLods[drawCall], pixelsAtUnitDistance * scale / std::max(distance, camera.get_NearPlane()));
+			}
+			m_DrawCallLods[drawCall] = static_cast<u8>(lod);
+
+			++m_LodStatistics.NumInstances[lod];
+			m_LodStatistics.NumTriangles += primitive.GetIndices(lod).size() / 3;
+			m_LodStatistics.NumFullDetailTriangles += primitive.m_IndexContainer.size() / 3;
+
+			m_InstanceBatcher.Add(primitive, materialKey, drawCall, lod);
+		}
+		m_InstanceBatcher.Build();
+
+		// Instances beyond the draw call ids that fit in the offset buffer are not drawn.
+		const auto& batches = m_InstanceBatcher.GetBatches();
+		const auto& instances = m_InstanceBatcher.GetInstances();
+		const u32 numInstances = std::min(m_InstanceBatcher.GetNumInstances(), MaxDrawCallIds);
+		const u32 numBatches = static_cast<u32>(std::partition_point(batches.begin(), batches.end(),
+			[numInstances](const InstanceBatcher::Batch& batch) { return batch.FirstInstance < numInstances; }) - batches.begin());
+
+		m_InstanceMatrices.resize(numInstances);
+		for (u32 i = 0; i < numInstances; ++i)
+		{
+			m_InstanceMatrices[i] = models[m_DrawCallModels[instances[i]]]->GetWorldMatrix();
+		}
+
+		m_BatchingStatistics.NumInstances = numInstances;
+		m_BatchingStatistics.NumDraws = numBatches;
+		m_NextDrawCallId = numInstances;
+
+		// The clusters are culled in the object space of every instance. A world space plane is in object space after
+		// the (row vector) world matrix times the plane as a column, and the camera after the inverse world matrix.
+		if (m_ClusterCulling)
+		{
+			const Frustum frustum = Frustum::FromViewProjection(viewProjection);
+
+			m_InstanceViews.resize(numInstances);
+			for (u32 i = 0; i < numInstances; ++i)
+			{
+				const XMMATRIX world = m_InstanceMatrices[i];
+				const XMMATRIX planeTransform = XMMatrixTranspose(world);
+
+				InstanceView& view = m_InstanceViews[i];
+				for (u32 plane = 0; plane < Frustum::NumPlanes; ++plane)
+				{
+					XMStoreFloat4(&view.Planes[plane], XMPlaneNormalize(XMVector4Transform(XMLoadFloat4(&frustum.m_Planes[plane]), planeTransform)));
+				}
+
+				XMVECTOR determinant;
+				XMStoreFloat3(&view.Eye, XMVector3Transform(eye, XMMatrixInverse(&determinant, world)));
+
+				const float scaleX = XMVectorGetX(XMVector3LengthSq(world.r[0]));
+				const float scaleY = XMVectorGetX(XMVector3LengthSq(world.r[1]));
+				const float scaleZ = XMVectorGetX(XMVector3LengthSq(world.r[2]));
+				const bool uniformScale = std::max({ scaleX, scaleY, scaleZ }) <= std::min({ scaleX, scaleY, scaleZ }) * (1.0f + MaxScaleDifference);
+				view.ConeCulling = uniformScale && XMVectorGetX(determinant) > 0.0f;
+			}
+		}
+
+		for (RefPtr<Model> model : models)
+		{
 			for (auto& primitive : model->GetMesh()->GetPrimitives())
 			{
 				if (m_StorageInfo.find((MeshPrimitive*)&primitive) == m_StorageInfo.end())
 				{
 					auto vertexContainerOffset = m_VisibleVertexContainer.size();
 					auto indexContainerOffset = m_VisibleIndexContainer.size();
-					m_VisibleVertexContainer.insert(m_VisibleVertexContainer.end(), primitive.m_VertexContainer.begin(), primitive.m_VertexContainer.end());
+					primitive.AppendDecodedVertices(m_VisibleVertexContainer);
 					m_VisibleIndexContainer.insert(m_VisibleIndexContainer.end(), primitive.m_IndexContainer.begin(), primitive.m_IndexContainer.end());
-					m_StorageInfo.emplace(std::make_pair((MeshPrimitive*)&primitive, VisibilityStorageInfo{
+					auto& storageInfo = m_StorageInfo.emplace(std::make_pair((MeshPrimitive*)&primitive, VisibilityStorageInfo{
 						(u32)(vertexContainerOffset),
 						(u32)(indexContainerOffset),
 						(u32)(m_VisibleVertexContainer.size() - vertexContainerOffset),
 						(u32)(m_VisibleIndexContainer.size() - indexContainerOffset)
-					}));
+					})).first->second;
+
+					// The levels of detail index the same vertices.
+					storageInfo.LodIndexOffsets[0] = storageInfo.IndexOffset;
+					for (u32 lod = 1; lod < primitive.GetNumLods(); ++lod)
+					{
+						const auto& lodIndices = primitive.GetIndices(lod);
+						storageInfo.LodIndexOffsets[lod] = (u32)m_VisibleIndexContainer.size();
+						m_VisibleIndexContainer.insert(m_VisibleIndexContainer.end(), lodIndices.begin(), lodIndices.end());
+					}
 				}
 			}
 		}
-		for (RefPtr<Model> model : scene.GetModels())
-		{
-			XMMATRIX worldMatrix = model->GetTransform() * model->GetRotation() * model->GetScale();
+		XMMATRIX matrices[2] = {
+			scene.GetCameraRef().get_ViewMatrix(),
+			scene.GetCameraRef().get_ProjectionMatrix()
+		};
 
-			std::vector<XMMATRIX> instances;
-			instances.push_back(worldMatrix);
-			RenderInstancedIndexedMesh(*commandList, *model->GetMesh(), instances);
-		}
-		commandList->TransitionBarrier(m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0), D3D12_RESOURCE_STATE_COMMON);
+		// Record the draws in chunks on worker threads, each into its own command list. The chunks are
+		// submitted in order after the clear, so the pending barriers of each list are resolved against
+		// the final states of the lists before it.
+		u32 numChunks = std::max<u32>(1, std::min<u32>(Application::Get().GetJobSystem().GetNumWorkers() + 1,
+			(numBatches + MinDrawsPerRecordingChunk - 1) / MinDrawsPerRecordingChunk));
 
-		commandQueue.WaitForFenceValue(commandQueue.ExecuteCommandList(commandList));
-		if (!m_IndirectComputeArguementBuffer || !m_IndirectComputeArguementUAV || m_IndirectComputeArguementBuffer->GetNumElements() != materialCount)
+		std::vector<ClusterStatistics> chunkStatistics(numChunks);
+		auto chunkLists = commandQueue.RecordCommandLists(numChunks, [&](CommandList& chunkList, u32 chunk)
 		{
-			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-			uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-			uavDesc.Buffer.StructureByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS) + sizeof(UINT) * 2;
-			uavDesc.Buffer.CounterOffsetInBytes = 0;
-			uavDesc.Buffer.FirstElement = 0;
-			uavDesc.Buffer.NumElements = materialCount;
-			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-			uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+			chunkList.SetPipelineState(m_RasterizeTriangleState.m_PipelineState);
+			chunkList.SetGraphicsRootSignature(m_RasterizeTriangleState.m_RootSignature);
+
+			chunkList.SetViewport(WND_PROP.Viewport);
+			chunkList.SetScissorRect(WND_PROP.ScissorRect);
+			chunkList.SetRenderTarget(frame.m_VisibilityBuffer);
+			chunkList.SetUnorderedAccessView(RasterizeTriangleDataRootParameters::OffsetBuffer, 0, frame.m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-			m_IndirectComputeArguementBuffer = m_Device->CreateStructuredBuffer(materialCount, sizeof(D3D12_DISPATCH_ARGUMENTS) + sizeof(UINT) * 2);
-			m_IndirectComputeArguementUAV = m_Device->CreateUnorderedAccessView(m_IndirectComputeArguementBuffer, m_IndirectComputeArguementBuffer->GetCounterBuffer(), &uavDesc);
+			chunkList.SetGraphics32BitConstants(RasterizeTriangleDataRootParameters::CameraCB, matrices);
+
+			u32 begin = static_cast<u32>(static_cast<u64>(numBatches) * chunk / numChunks);
+			u32 end = static_cast<u32>(static_cast<u64>(numBatches) * (chunk + 1) / numChunks);
+			if (begin == end)
+			{
+				return;
+			}
+
+			// The instances of consecutive batches are consecutive, so each chunk only uploads the world matrices of its own batches.
+			u32 firstInstance = batches[begin].FirstInstance;
+			u32 endInstance = std::min(batches[end - 1].FirstInstance + batches[end - 1].NumInstances, numInstances);
+			chunkList.SetGraphicsDynamicStructuredBuffer(RasterizeTriangleDataRootParameters::InstancesSB, endInstance - firstInstance,
+				sizeof(Matrix), m_InstanceMatrices.data() + firstInstance);
+
+			D3D_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+			std::vector<IndexRange> ranges;
+			for (u32 i = begin; i < end; ++i)
+			{
+				const InstanceBatcher::Batch& batch = batches[i];
+				const Mesh& mesh = *models[m_DrawCallModels[instances[batch.FirstInstance]]]->GetMesh();
+
+				if (mesh.GetPrimitiveTopology() != topology)
+				{
+					topology = mesh.GetPrimitiveTopology();
+					chunkList.SetPrimitiveTopology(topology);
+				}
+
+				u32 instanceCount = std::min(batch.NumInstances, numInstances - batch.FirstInstance);
+				if (m_ClusterCulling && topology == D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST && !batch.Primitive->GetClusters(batch.Lod).empty())
+				{
+					CullClusters(*batch.Primitive, batch.Lod, batch.FirstInstance, instanceCount, ranges, chunkStatistics[chunk]);
+					if (!ranges.empty())
+					{
+						RecordPrimitive(chunkList, *batch.Primitive, batch.Lod, batch.FirstInstance, batch.FirstInstance - firstInstance, instanceCount, &ranges);
+					}
+				}
+				else
+				{
+					RecordPrimitive(chunkList, *batch.Primitive, batch.Lod, batch.FirstInstance, batch.FirstInstance - firstInstance, instanceCount);
+				}
+			}
+		});
+
+		m_ClusterStatistics = {};
+		for (const ClusterStatistics& statistics : chunkStatistics)
+		{
+			m_ClusterStatistics.NumClusters += statistics.NumClusters;
+			m_ClusterStatistics.NumFrustumCulled += statistics.NumFrustumCulled;
+			m_ClusterStatistics.NumBackfaceCulled += statistics.NumBackfaceCulled;
+			m_ClusterStatistics.NumDraws += statistics.NumDraws;
 		}
 
+		chunkLists.back()->TransitionBarrier(frame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0), D3D12_RESOURCE_STATE_COMMON);
+		chunkLists.insert(chunkLists.begin(), commandList);
+
 		if (!m_VisibleIndexBuffer || m_VisibleIndexBuffer->GetNumElements() != m_VisibleIndexContainer.size())
 		{
 			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
@@ -659,7 +1021,7 @@ void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Sce
 		{
 			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
 			uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-			uavDesc.Buffer.StructureByteStride = sizeof(VertexPositionNormalTangentBitangentTexture);
+			uavDesc.Buffer.StructureByteStride = sizeof(VertexPositionTexture);
 			uavDesc.Buffer.CounterOffsetInBytes = 0;
 			uavDesc.Buffer.FirstElement = 0;
 			uavDesc.Buffer.NumElements = m_VisibleVertexContainer.size();
@@ -669,226 +1031,605 @@ void VisibilityBufferRenderer::RenderScene(RenderTarget& renderTarget, const Sce
 			m_VisibleVertexBuffer = commandList->CopyStructuredBuffer(m_VisibleVertexContainer);
 			m_VisibleVertexBufferUAV = m_Device->CreateUnorderedAccessView(m_VisibleVertexBuffer, m_VisibleVertexBuffer->GetCounterBuffer(), &uavDesc);
 		}
+
+		// The geometry copies are recorded into the clear list, which is submitted before the draws.
+		u64 fenceValue = commandQueue.ExecuteCommandLists(chunkLists);
+		if (occlusionTest)
+		{
+			m_OcclusionReadbacks[occlusionReadback].m_FenceValue = fenceValue;
+		}
 	}
 
+	// The compute stages consume the visibility buffer, so the compute queue waits (on the GPU) for
+	// the raster stage. The compute stages are ordered by the compute queue itself.
+	computeQueue.Wait(commandQueue);
+
 	/*
-		MATERIAL COUNT STAGE
+		COMPUTE STAGES
 	*/
 	{
-		auto computeList = computeQueue.GetCommandList();
+		auto& computeGraph = *m_ComputeGraph;
+		computeGraph.Reset();
+
+		auto visibilityBuffer = computeGraph.ImportResource("VisibilityBuffer", frame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0));
+		auto offsetBuffer = computeGraph.ImportResource("OffsetBuffer", frame.m_OffsetBuffer);
+		auto gbuffer = computeGraph.ImportResource("GBuffer", frame.m_GBuffer.GetTexture(AttachmentPoint::Color0));
+		auto visibleVertexBuffer = computeGraph.ImportResource("VisibleVertexBuffer", m_VisibleVertexBuffer);
+		auto visibleIndexBuffer = computeGraph.ImportResource("VisibleIndexBuffer", m_VisibleIndexBuffer);
+		auto materialCountBuffer = computeGraph.ImportResource("MaterialCountBuffer", m_MaterialCountBuffer, D3D12_RESOURCE_STATE_COMMON);
+
+		// Only live between the compute stages of this frame.
+		auto materialOffsetBuffer = computeGraph.CreateBuffer("MaterialOffsetBuffer", MaterialLimit, sizeof(u32));
+		auto indirectArguementBuffer = computeGraph.CreateBuffer("IndirectArguementBuffer", std::max(materialCount, 1u), sizeof(D3D12_DISPATCH_ARGUMENTS) + sizeof(UINT) * 2);
+		auto pixelPositionBuffer = computeGraph.CreateBuffer("PixelPositionBuffer", (u64)WND_PROP.Height * WND_PROP.Width, sizeof(Vector2));
+
+		const float width = frame.m_VisibilityBuffer.GetWidth();
+		const float height = frame.m_VisibilityBuffer.GetHeight();
+
+		computeGraph.AddPass("MaterialCount",
+			[&](RenderGraphBuilder& builder)
+			{
+				builder.Read(visibilityBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(offsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Write(materialCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			},
+			[=, this, &frame](CommandList& computeList, const RenderGraph&)
+			{
+				computeList.SetPipelineState(m_MaterialCountStage.m_PipelineState);
+				computeList.SetComputeRootSignature(m_MaterialCountStage.m_RootSignature);
 
-		computeList->SetPipelineState(m_MaterialCountStage.m_PipelineState);
-		computeList->SetComputeRootSignature(m_MaterialCountStage.m_RootSignature);
+				auto visbuffer = frame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
 
-		auto visbuffer = m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
+				computeList.SetUnorderedAccessView(MaterialCountParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialCountParameters::OffsetBuffer, 0, frame.m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialCountParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		computeList->SetUnorderedAccessView(MaterialCountParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialCountParameters::OffsetBuffer, 0, m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialCountParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.Dispatch((u32)std::ceil(width / 32) + 1, (u32)std::ceil(height / 32) + 1);
+			});
 
-		computeList->Dispatch((u32)std::ceil(m_VisibilityBuffer.GetWidth() / 32) + 1, (u32)std::ceil(m_VisibilityBuffer.GetHeight() / 32) + 1);
+		computeGraph.AddPass("MaterialPrefixSum",
+			[&](RenderGraphBuilder& builder)
+			{
+				builder.Write(materialCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Write(materialOffsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Write(indirectArguementBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			},
+			[=, this](CommandList& computeList, const RenderGraph& graph)
+			{
+				computeList.SetComputeRootSignature(m_MaterialPrefixSumStage.m_RootSignature);
+				computeList.SetPipelineState(m_MaterialPrefixSumStage.m_PipelineState);
 
-		computeQueue.WaitForFenceValue(computeQueue.ExecuteCommandList(computeList));
-	}
+				computeList.SetUnorderedAccessView(MaterialPrefixSumParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialPrefixSumParameters::MaterialOffsetBuffer, 0, graph.GetUnorderedAccessView(materialOffsetBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialPrefixSumParameters::IndirectArguementBuffer, 0, graph.GetUnorderedAccessView(indirectArguementBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-	/*
-		MATERIAL PREFIX SUM SCAN STAGE
-	*/
-	{
-		auto computeList = computeQueue.GetCommandList();
+				computeList.Dispatch(1);
+			});
 
-		computeList->SetComputeRootSignature(m_MaterialPrefixSumStage.m_RootSignature);
-		computeList->SetPipelineState(m_MaterialPrefixSumStage.m_PipelineState);
+		computeGraph.AddPass("PixelPosition",
+			[&](RenderGraphBuilder& builder)
+			{
+				builder.Read(visibilityBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(offsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(materialOffsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Write(materialCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Write(pixelPositionBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			},
+			[=, this, &frame](CommandList& computeList, const RenderGraph& graph)
+			{
+				computeList.SetPipelineState(m_PixelPositionBufferStage.m_PipelineState);
+				computeList.SetComputeRootSignature(m_PixelPositionBufferStage.m_RootSignature);
 
-		computeList->SetUnorderedAccessView(MaterialPrefixSumParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialPrefixSumParameters::MaterialOffsetBuffer, 0, m_MaterialOffsetUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialPrefixSumParameters::IndirectArguementBuffer, 0, m_IndirectComputeArguementUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				auto visbuffer = frame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
 
-		computeList->TransitionBarrier(m_MaterialCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->TransitionBarrier(m_MaterialOffsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->TransitionBarrier(m_IndirectComputeArguementBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(PixelPositionBufferParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(PixelPositionBufferParameters::OffsetBuffer, 0, frame.m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(PixelPositionBufferParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(PixelPositionBufferParameters::MaterialOffsetBuffer, 0, graph.GetUnorderedAccessView(materialOffsetBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(PixelPositionBufferParameters::PixelPositionBuffer, 0, graph.GetUnorderedAccessView(pixelPositionBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		computeList->Dispatch(1);
+				computeList.Dispatch((u32)std::ceil(width / 4) + 1, (u32)std::ceil(height / 8) + 1);
+			});
 
-		computeList->UAVBarrier(m_MaterialCountUAV->GetResource());
-		computeList->UAVBarrier(m_MaterialOffsetUAV->GetResource());
-		computeList->UAVBarrier(m_IndirectComputeArguementUAV->GetResource());
+		computeGraph.AddPass("MaterialResolve",
+			[&](RenderGraphBuilder& builder)
+			{
+				builder.Read(visibilityBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(offsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(materialOffsetBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(materialCountBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(pixelPositionBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(visibleVertexBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(visibleIndexBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				builder.Read(indirectArguementBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+				builder.Write(gbuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			},
+			[=, this, &frame, &scene, &materialCache](CommandList& computeList, const RenderGraph& graph)
+			{
+				computeList.SetComputeRootSignature(m_MaterialResolveStage.m_RootSignature);
+				computeList.SetPipelineState(m_MaterialResolveStage.m_PipelineState);
 
-		computeQueue.WaitForFenceValue(computeQueue.ExecuteCommandList(computeList));
-	}
+				auto visbuffer = frame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
+				auto target = frame.m_GBuffer.GetTexture(AttachmentPoint::Color0);
 
-	/*
-		PIXEL XY BUFFER STAGE
-	*/
-	{
-		auto computeList = computeQueue.GetCommandList();
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::OffsetBuffer, 0, frame.m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::MaterialOffsetBuffer, 0, graph.GetUnorderedAccessView(materialOffsetBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::PixelPositionBuffer, 0, graph.GetUnorderedAccessView(pixelPositionBuffer), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::RenderTarget, 0, target, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		computeList->SetPipelineState(m_PixelPositionBufferStage.m_PipelineState);
-		computeList->SetComputeRootSignature(m_PixelPositionBufferStage.m_RootSignature);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::VisibleVertexBuffer, 0, m_VisibleVertexBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				computeList.SetUnorderedAccessView(MaterialResolveParameters::VisibleIndexBuffer, 0, m_VisibleIndexBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		auto visbuffer = m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
+				struct CameraCB
+				{
+					XMMATRIX view;
+					XMMATRIX projection;
+					XMMATRIX inverseviewproj;
+				} cameraCB;
 
-		computeList->SetUnorderedAccessView(PixelPositionBufferParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(PixelPositionBufferParameters::OffsetBuffer, 0, m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(PixelPositionBufferParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(PixelPositionBufferParameters::MaterialOffsetBuffer, 0, m_MaterialOffsetUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(PixelPositionBufferParameters::PixelPositionBuffer, 0, m_PixelPositionUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				cameraCB.view = scene.GetCameraRef().get_ViewMatrix();
+				cameraCB.projection = scene.GetCameraRef().get_ProjectionMatrix();
+				cameraCB.inverseviewproj = scene.GetCameraRef().get_InverseViewProjectionMatrix();
 
-		computeList->Dispatch((u32)std::ceil(m_VisibilityBuffer.GetWidth() / 4) + 1, (u32)std::ceil(m_VisibilityBuffer.GetHeight() / 8) + 1);
+				computeList.SetCompute32BitConstants(MaterialResolveParameters::CameraCB, cameraCB);
 
-		computeList->UAVBarrier(m_MaterialCountUAV->GetResource());
-		computeList->UAVBarrier(m_MaterialOffsetUAV->GetResource());
-		computeList->UAVBarrier(m_PixelPositionUAV->GetResource());
+				// The world matrices of all instances of the frame, indexed by draw call id.
+				if (!m_InstanceMatrices.empty())
+				{
+					computeList.SetComputeDynamicStructuredBuffer(MaterialResolveParameters::InstancesSB, m_InstanceMatrices);
+				}
 
-		computeQueue.WaitForFenceValue(computeQueue.ExecuteCommandList(computeList));
+				for (auto& mat : materialCache)
+				{
+					computeList.SetShaderResourceView(MaterialResolveParameters::AlbedoTexture, mat.second, mat.first->GetTexture(Material::TextureType::Diffuse), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				}
+				if (materialCount < MaterialLimit)
+				{
+					auto defaultMaterial = MaterialAssetHandler::Get().GetDefaultMaterial()->GetTexture(Material::TextureType::Diffuse);
+					for (u32 i = materialCount; i < MaterialLimit; ++i)
+					{
+						computeList.SetShaderResourceView(MaterialResolveParameters::AlbedoTexture, i, defaultMaterial, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+					}
+				}
+
+				computeList.FlushResourceBarriers();
+				computeList.CommitStagedDescriptorsForDispatch();
+
+				computeList.GetD3D12CommandList()->ExecuteIndirect(m_IndirectSignature.Get(), materialCount, graph.GetResource(indirectArguementBuffer)->GetD3D12Resource().Get(), 0, NULL, 0);
+			});
+
+		// Barriers between the stages (and the transitions of the transient buffers) are scheduled by the graph.
+		computeGraph.Compile();
+
+		auto computeList = computeQueue.GetCommandList();
+		computeGraph.Execute(*computeList);
+
+		frame.m_ComputeFenceValue = computeQueue.ExecuteCommandList(computeList);
 	}
 
+	// With async compute the debug stage composites the previous frame, so the compute stages of this frame
+	// overlap with the rest of this frame and the raster stage of the next frame on the direct queue. The first
+	// frame has no previous results, so it composites its own.
+	auto& previousFrame = m_FrameBuffers[(m_FrameIndex + NumFrameBuffers - 1) % NumFrameBuffers];
+	auto& compositeFrame = m_AsyncCompute && previousFrame.m_ComputeFenceValue != 0 ? previousFrame : frame;
+	++m_FrameIndex;
+
+	// The debug stage reads the resolved gbuffer. The wait also orders the next raster stage that writes
+	// these frame buffers after the compute stages that read them.
+	assert(compositeFrame.m_ComputeFenceValue != 0 && "The composited frame buffers were never resolved.");
+	commandQueue.Wait(computeQueue, compositeFrame.m_ComputeFenceValue);
+
 	/*
-		MATERIAL RESOLVE STAGE
+		DEBUG TRIANGLE STAGE
 	*/
+	commandList = commandQueue.GetCommandList();
+
+	commandList->SetRenderTarget(renderTarget);
+	commandList->SetPipelineState(m_DebugTriangleStage.m_PipelineState);
+	commandList->SetGraphicsRootSignature(m_DebugTriangleStage.m_RootSignature);
+
+	commandList->SetViewport(WND_PROP.Viewport);
+	commandList->SetScissorRect(WND_PROP.ScissorRect);
+	commandList->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	auto visbuffer = compositeFrame.m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
+	auto gbuffer = compositeFrame.m_GBuffer.GetTexture(AttachmentPoint::Color0);
+
+	commandList->SetUnorderedAccessView(DebugTriangleParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	commandList->SetUnorderedAccessView(DebugTriangleParameters::OffsetBuffer, 0, compositeFrame.m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	commandList->SetShaderResourceView(DebugTriangleParameters::GBuffer, 0, gbuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	commandList->Draw(3, 1, 0, 0);
+
+	commandList->TransitionBarrier(gbuffer, D3D12_RESOURCE_STATE_COMMON);
+
+	commandQueue.ExecuteCommandList(commandList);
+}
+
+void VisibilityBufferRenderer::EndFrame()
+{
+}
+
+bool VisibilityBufferRenderer::RecordOcclusionTest(CommandList& commandList, const Scene& scene, u32 numDrawCalls)
+{
+	// The readback buffer of this frame was written NumOcclusionReadbacks frames ago, so this rarely waits.
+	OcclusionReadback& readback = m_OcclusionReadbacks[m_FrameIndex % NumOcclusionReadbacks];
+	if (readback.m_FenceValue != 0)
 	{
-		auto computeList = computeQueue.GetCommandList();
+		m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT).WaitForFenceValue(readback.m_FenceValue);
+		readback.m_FenceValue = 0;
+	}
 
-		computeList->SetComputeRootSignature(m_MaterialResolveStage.m_RootSignature);
-		computeList->SetPipelineState(m_MaterialResolveStage.m_PipelineState);
+	if (m_DepthScene != &scene || m_VisibleDrawCalls.empty())
+	{
+		return false;
+	}
 
-		auto visbuffer = m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
-		auto target = m_GBuffer.GetTexture(AttachmentPoint::Color0);
+	const u32 numTests = std::min(static_cast<u32>(m_VisibleDrawCalls.size()), MaxOcclusionTests);
+	readback.m_FrameIndex = m_FrameIndex;
+	readback.m_Scene = &scene;
+	readback.m_NumDrawCalls = numDrawCalls;
+	readback.m_DrawCalls.assign(m_VisibleDrawCalls.begin(), m_VisibleDrawCalls.begin() + numTests);
 
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::OffsetBuffer, 0, m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::MaterialOffsetBuffer, 0, m_MaterialOffsetUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::MaterialCountBuffer, 0, m_MaterialCountUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::PixelPositionBuffer, 0, m_PixelPositionUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::RenderTarget, 0, target, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	m_OcclusionTestBounds.resize(numTests);
+	for (u32 i = 0; i < numTests; ++i)
+	{
+		m_OcclusionTestBounds[i] = m_PrimitiveBounds.Get(readback.m_DrawCalls[i]);
+	}
 
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::VisibleVertexBuffer, 0, m_VisibleVertexBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		computeList->SetUnorderedAccessView(MaterialResolveParameters::VisibleIndexBuffer, 0, m_VisibleIndexBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	struct HiZConstants
+	{
+		u32 SourceSize[2];
+		u32 DestinationSize[2];
+	} hiZConstants;
 
-		struct CameraCB
-		{
-			XMMATRIX view;
-			XMMATRIX projection;
-			XMMATRIX inverseviewproj;
-		} cameraCB;
-		
-		cameraCB.view = scene.GetCameraRef().get_ViewMatrix();
-		cameraCB.projection = scene.GetCameraRef().get_ProjectionMatrix();
-		cameraCB.inverseviewproj = scene.GetCameraRef().get_InverseViewProjectionMatrix();
+	const u32 depthWidth = static_cast<u32>(m_DepthTexture->GetD3D12ResourceDesc().Width);
+	const u32 depthHeight = m_DepthTexture->GetD3D12ResourceDesc().Height;
+	const u32 numMips = m_HiZTexture->GetD3D12ResourceDesc().MipLevels;
 
-		computeList->SetCompute32BitConstants(MaterialResolveParameters::CameraCB, cameraCB);
+	// Reduce the depth buffer to the first mip of the pyramid, then every mip to the next one.
+	commandList.SetPipelineState(m_HiZStage.m_InitPipelineState);
+	commandList.SetComputeRootSignature(m_HiZStage.m_RootSignature);
 
-		// TODO: Make instance array global and access individual instance with drawcall_id
-		for (RefPtr<Model> model : scene.GetModels())
-		{
-			XMMATRIX worldMatrix = model->GetTransform() * model->GetRotation() * model->GetScale();
-			std::vector<XMMATRIX> instances;
-			instances.push_back(worldMatrix);
-			computeList->SetComputeDynamicStructuredBuffer(MaterialResolveParameters::InstancesSB, instances);
-			break;
-		}
+	u32 sourceWidth = depthWidth;
+	u32 sourceHeight = depthHeight;
+	for (u32 mip = 0; mip < numMips; ++mip)
+	{
+		const u32 width = std::max(sourceWidth >> 1, 1u);
+		const u32 height = std::max(sourceHeight >> 1, 1u);
+		hiZConstants = { { sourceWidth, sourceHeight }, { width, height } };
 
-		for (auto& mat : materialCache)
+		if (mip == 0)
 		{
-			computeList->SetShaderResourceView(MaterialResolveParameters::AlbedoTexture, mat.second, mat.first->GetTexture(Material::TextureType::Diffuse), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			commandList.SetShaderResourceView(HiZParameters::DepthBuffer, 0, m_DepthTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 		}
-		if (materialCount < MaterialLimit)
+		else
 		{
-			auto defaultMaterial = MaterialAssetHandler::Get().GetDefaultMaterial()->GetTexture(Material::TextureType::Diffuse);
-			for (u32 i = materialCount; i < MaterialLimit; ++i)
+			if (mip == 1)
 			{
-				computeList->SetShaderResourceView(MaterialResolveParameters::AlbedoTexture, i, defaultMaterial, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				commandList.SetPipelineState(m_HiZStage.m_ReducePipelineState);
 			}
+			commandList.UAVBarrier(m_HiZTexture);
+			commandList.SetUnorderedAccessView(HiZParameters::SourceMip, 0, m_HiZTexture, mip - 1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 		}
+		commandList.SetUnorderedAccessView(HiZParameters::DestinationMip, 0, m_HiZTexture, mip, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		commandList.SetCompute32BitConstants(HiZParameters::Constants, hiZConstants);
+
+		commandList.Dispatch((width + 7) / 8, (height + 7) / 8);
+
+		sourceWidth = width;
+		sourceHeight = height;
+	}
+
+	/*
+		OCCLUSION CULL STAGE
+	*/
+	struct CullConstants
+	{
+		XMMATRIX ViewProjection;
+		u32 NumBounds;
+		u32 DepthSize[2];
+		u32 NumMips;
+	} cullConstants;
+
+	// The boxes of this frame are projected with the camera of the depth buffer.
+	cullConstants.ViewProjection = m_DepthViewProjection;
+	cullConstants.NumBounds = numTests;
+	cullConstants.DepthSize[0] = depthWidth;
+	cullConstants.DepthSize[1] = depthHeight;
+	cullConstants.NumMips = numMips;
+
+	commandList.SetPipelineState(m_OcclusionCullStage.m_PipelineState);
+	commandList.SetComputeRootSignature(m_OcclusionCullStage.m_RootSignature);
+
+	commandList.SetCompute32BitConstants(OcclusionCullParameters::Constants, cullConstants);
+	commandList.SetComputeDynamicStructuredBuffer(OcclusionCullParameters::Bounds, m_OcclusionTestBounds);
+	commandList.SetShaderResourceView(OcclusionCullParameters::HiZ, 0, m_HiZTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	commandList.SetUnorderedAccessView(OcclusionCullParameters::VisibilityFlags, m_OcclusionFlagBuffer);
+
+	commandList.Dispatch((numTests + 63) / 64);
+
+	commandList.TransitionBarrier(m_OcclusionFlagBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	commandList.FlushResourceBarriers();
+	commandList.GetD3D12CommandList()->CopyBufferRegion(readback.m_Buffer.Get(), 0,
+		m_OcclusionFlagBuffer->GetD3D12Resource().Get(), 0, numTests * sizeof(u32));
 
-		computeList->FlushResourceBarriers();
-		
-		computeList->CommitStagedDescriptorsForDispatch();
+	return true;
+}
 
-		computeList->GetD3D12CommandList()->ExecuteIndirect(m_IndirectSignature.Get(), materialCount, m_IndirectComputeArguementBuffer->GetD3D12Resource().Get(), 0, NULL, 0);
+void XM_CALLCONV VisibilityBufferRenderer::CullOccludedDrawCalls(const Scene& scene, u32 numDrawCalls, FXMMATRIX viewProjection)
+{
+	m_OcclusionStatistics = {};
+	m_OcclusionStatistics.NumTested = static_cast<u32>(m_VisibleDrawCalls.size());
+	if (m_OcclusionCulling == OcclusionCulling::Disabled || m_VisibleDrawCalls.empty())
+	{
+		return;
+	}
 
-		//computeList->Dispatch(1024);
+	// Use the latest GPU results that have been read back. They lag a frame or two behind, so a primitive that
+	// becomes visible may appear late.
+	if (m_OcclusionCulling == OcclusionCulling::HierarchicalZ)
+	{
+		auto& commandQueue = m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
-		//computeList->UAVBarrier(target);
+		const OcclusionReadback* latest = nullptr;
+		for (const auto& readback : m_OcclusionReadbacks)
+		{
+			if (readback.m_FenceValue != 0 && readback.m_Scene == &scene && readback.m_NumDrawCalls == numDrawCalls &&
+				(!latest || readback.m_FrameIndex > latest->m_FrameIndex) && commandQueue.IsFenceComplete(readback.m_FenceValue))
+			{
+				latest = &readback;
+			}
+		}
 
+		if (latest)
+		{
+			m_OccludedDrawCalls.assign(numDrawCalls, 0);
+			for (size_t i = 0; i < latest->m_DrawCalls.size(); ++i)
+			{
+				m_OccludedDrawCalls[latest->m_DrawCalls[i]] = latest->m_Flags[i] == 0;
+			}
 
-		computeQueue.WaitForFenceValue(computeQueue.ExecuteCommandList(computeList));
+			size_t numVisible = m_VisibleDrawCalls.size();
+			std::erase_if(m_VisibleDrawCalls, [this](u32 drawCall) { return m_OccludedDrawCalls[drawCall] != 0; });
+
+			m_OcclusionStatistics.NumOccluded = static_cast<u32>(numVisible - m_VisibleDrawCalls.size());
+			m_OcclusionStatistics.Method = OcclusionCulling::HierarchicalZ;
+			return;
+		}
 	}
 
-	/*
-		DEBUG TRIANGLE STAGE
-	*/
-	if (true)
+	// Rasterize the nearest primitives that are large enough on screen (roughly, by the size of their bounds over
+	// their distance) on the CPU, front to back, and test the rest against them.
+	const auto& models = scene.GetModels();
+	XMVECTOR eye = scene.GetCameraRef().get_Translation();
+
+	m_OccluderCandidates.clear();
+	for (u32 drawCall : m_VisibleDrawCalls)
 	{
-		commandList = commandQueue.GetCommandList();
+		BoundingBox box = m_PrimitiveBounds.Get(drawCall);
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents)));
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&box.Center), eye)));
+		if (radius >= MinOccluderSize * distance)
+		{
+			m_OccluderCandidates.emplace_back(distance, drawCall);
 
-		commandList->SetRenderTarget(renderTarget);
-		commandList->SetPipelineState(m_DebugTriangleStage.m_PipelineState);
-		commandList->SetGraphicsRootSignature(m_DebugTriangleStage.m_RootSignature);
+			// The BVH query already returned the draw calls front to back, so the first candidates are the nearest.
+			if (m_VisibleFrontToBack && m_OccluderCandidates.size() == MaxOccluders)
+			{
+				break;
+			}
+		}
+	}
 
-		commandList->SetViewport(WND_PROP.Viewport);
-		commandList->SetScissorRect(WND_PROP.ScissorRect);
-		commandList->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	const size_t numCandidates = std::min<size_t>(m_OccluderCandidates.size(), MaxOccluders);
+	if (!m_VisibleFrontToBack)
+	{
+		std::partial_sort(m_OccluderCandidates.begin(), m_OccluderCandidates.begin() + numCandidates, m_OccluderCandidates.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+	}
 
-		auto visbuffer = m_VisibilityBuffer.GetTexture(AttachmentPoint::Color0);
-		auto gbuffer = m_GBuffer.GetTexture(AttachmentPoint::Color0);
+	const u32 height = std::max<u32>(SoftwareOcclusionWidth * WND_PROP.Height / std::max<u32>(WND_PROP.Width, 1), 1);
+	if (m_SoftwareOcclusionCuller.GetWidth() != SoftwareOcclusionWidth || m_SoftwareOcclusionCuller.GetHeight() != height)
+	{
+		m_SoftwareOcclusionCuller.Resize(SoftwareOcclusionWidth, height);
+	}
 
-		commandList->SetUnorderedAccessView(DebugTriangleParameters::VisibilityBuffer, 0, visbuffer, 0, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		commandList->SetUnorderedAccessView(DebugTriangleParameters::OffsetBuffer, 0, m_OffsetBufferUAV, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-		commandList->SetShaderResourceView(DebugTriangleParameters::GBuffer, 0, gbuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	
-		commandList->Draw(3, 1, 0, 0);
+	m_SoftwareOcclusionCuller.Begin(viewProjection);
+	u32 numTriangles = 0;
+	for (size_t i = 0; i < numCandidates; ++i)
+	{
+		u32 drawCall = m_OccluderCandidates[i].second;
+		u32 modelIndex = m_DrawCallModels[drawCall];
+		const Model& model = *models[modelIndex];
+		const MeshPrimitive& primitive = model.GetMesh()->GetPrimitives()[drawCall - m_FirstDrawCallIds[modelIndex]];
 
-		commandList->TransitionBarrier(gbuffer, D3D12_RESOURCE_STATE_COMMON);
+		const u32 numIndices = static_cast<u32>(primitive.m_IndexContainer.size());
+		if (numIndices == 0 || numTriangles + numIndices / 3 > MaxOccluderTriangles)
+		{
+			continue;
+		}
+		numTriangles += numIndices / 3;
 
-		commandQueue.WaitForFenceValue(commandQueue.ExecuteCommandList(commandList));
+		m_SoftwareOcclusionCuller.RenderOccluder(&primitive.m_VertexContainer[0].Position, static_cast<u32>(primitive.m_VertexContainer.size()),
+			sizeof(VertexPositionNormalTangentBitangentTexture), primitive.m_IndexContainer.data(), numIndices, model.GetWorldMatrix());
 	}
+	m_SoftwareOcclusionCuller.End();
+
+	m_OcclusionStatistics.NumOccluded = m_SoftwareOcclusionCuller.Cull(m_PrimitiveBounds, m_VisibleDrawCalls);
+	m_OcclusionStatistics.Method = OcclusionCulling::Software;
 }
 
-void VisibilityBufferRenderer::EndFrame()
+void VisibilityBufferRenderer::RenderInstancedIndexedMesh(CommandList& commandList, const Mesh& mesh, const std::vector<XMMATRIX>& instances)
 {
+	// The draw call ids continue after the instances of the scene, so they don't overwrite their offsets.
+	RecordInstancedIndexedMesh(commandList, mesh, instances, m_NextDrawCallId);
+	m_NextDrawCallId += static_cast<u32>(mesh.GetPrimitives().size() * instances.size());
 }
 
-void VisibilityBufferRenderer::RenderInstancedIndexedMesh(CommandList& commandList, const Mesh& mesh, const std::vector<XMMATRIX>& instances)
+void VisibilityBufferRenderer::RecordInstancedIndexedMesh(CommandList& commandList, const Mesh& mesh, const std::vector<XMMATRIX>& instances, u32 firstDrawCallId)
 {
 	commandList.SetPrimitiveTopology(mesh.GetPrimitiveTopology());
 	commandList.SetGraphicsDynamicStructuredBuffer(RasterizeTriangleDataRootParameters::InstancesSB, instances);
 
+	const u32 instanceCount = static_cast<u32>(instances.size());
 	auto& primitives = mesh.GetPrimitives();
 	for (size_t i = 0; i < primitives.size(); ++i)
 	{
-		auto& primitive = primitives[i];
-		
-		struct PackedDrawCallInfo
-		{
-			u32 DrawCallId;
-			u32 MaterialId;
-			u32 MeshVertexOffset;
-			u32 MeshIndexOffset;
-		} drawCallInfo;
-		
-		drawCallInfo.DrawCallId = drawCallId;
-		drawCallInfo.MaterialId = primitive.m_MaterialIndex;
-		drawCallId++;
+		RecordPrimitive(commandList, primitives[i], 0, firstDrawCallId + static_cast<u32>(i) * instanceCount, 0, instanceCount);
+	}
+}
+
+u32 VisibilityBufferRenderer::SelectLod(const MeshPrimitive& primitive, u32 currentLod, float pixelsPerUnit) const
+{
+	// A coarser level is selected once its error is below this fraction of the threshold.
+	constexpr float LodHysteresis = 0.75f;
+
+	const u32 numLods = primitive.GetNumLods();
 
-		if (auto iterator = m_StorageInfo.find((MeshPrimitive*)&primitive); iterator != m_StorageInfo.end())
+	// The errors grow with the level, so find the coarsest levels that are below the threshold, and well below it.
+	u32 coarsestLod = 0;
+	u32 preferredLod = 0;
+	for (u32 lod = 1; lod < numLods; ++lod)
+	{
+		float error = primitive.GetLodError(lod) * pixelsPerUnit;
+		if (error <= m_LodErrorThreshold)
+		{
+			coarsestLod = lod;
+		}
+		if (error <= m_LodErrorThreshold * LodHysteresis)
 		{
-			drawCallInfo.MeshIndexOffset = iterator->second.IndexOffset;
-			drawCallInfo.MeshVertexOffset = iterator->second.VertexOffset;
+			preferredLod = lod;
 		}
+	}
+
+	if (currentLod > coarsestLod)
+	{
+		return coarsestLod;
+	}
+	if (currentLod < preferredLod)
+	{
+		return preferredLod;
+	}
+	return currentLod;
+}
+
+void VisibilityBufferRenderer::CullClusters(const MeshPrimitive& primitive, u32 lod, u32 firstInstance, u32 instanceCount,
+	std::vector<IndexRange>& ranges, ClusterStatistics& statistics) const
+{
+	const auto& clusters = primitive.GetClusters(lod);
+	statistics.NumClusters += static_cast<u32>(clusters.size());
+
+	ranges.clear();
+	for (const MeshCluster& cluster : clusters)
+	{
+		const XMFLOAT3& center = cluster.m_BoundingSphere.Center;
+		const float radius = cluster.m_BoundingSphere.Radius;
+
+		// The views are in the object space of their instance, so the clusters are tested without transforming them.
+		bool insideFrustum = false;
+		bool visible = false;
+		for (u32 i = firstInstance; i < firstInstance + instanceCount && !visible; ++i)
+		{
+			const InstanceView& view = m_InstanceViews[i];
+
+			bool inside = true;
+			for (const XMFLOAT4& plane : view.Planes)
+			{
+				if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+				{
+					inside = false;
+					break;
+				}
+			}
+			if (!inside)
+			{
+				continue;
+			}
+			insideFrustum = true;
 
-		commandList.SetGraphics32BitConstants(RasterizeTriangleDataRootParameters::DrawCallInfoCB, drawCallInfo);
+			XMFLOAT3 direction = { cluster.m_ConeApex.x - view.Eye.x, cluster.m_ConeApex.y - view.Eye.y, cluster.m_ConeApex.z - view.Eye.z };
+			float alignment = direction.x * cluster.m_ConeAxis.x + direction.y * cluster.m_ConeAxis.y + direction.z * cluster.m_ConeAxis.z;
+			float distance = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+			visible = !view.ConeCulling || cluster.m_ConeCutoff >= 1.0f || alignment < cluster.m_ConeCutoff * distance;
+		}
 
-		commandList.SetVertexBuffer(0, primitive.m_VertexBuffer);
+		if (!visible)
+		{
+			++(insideFrustum ? statistics.NumBackfaceCulled : statistics.NumFrustumCulled);
+			continue;
+		}
 
-		if (auto indexCount = primitive.m_IndexBuffer->GetNumIndices(); indexCount > 0)
+		if (!ranges.empty() && ranges.back().FirstIndex + ranges.back().NumIndices == cluster.m_FirstIndex)
+		{
+			ranges.back().NumIndices += cluster.m_NumIndices;
+		}
+		else
 		{
-			commandList.SetIndexBuffer(primitive.m_IndexBuffer);
-			commandList.DrawIndexed(indexCount, instances.size());
+			ranges.push_back({ cluster.m_FirstIndex, cluster.m_NumIndices });
 		}
-		else if (auto vertexCount = primitive.m_VertexBuffer->GetNumVertices(); vertexCount > 0)
+	}
+
+	statistics.NumDraws += static_cast<u32>(ranges.size());
+}
+
+void VisibilityBufferRenderer::RecordPrimitive(CommandList& commandList, const MeshPrimitive& primitive, u32 lod, u32 firstDrawCallId, u32 firstInstance, u32 instanceCount,
+	const std::vector<IndexRange>* ranges)
+{
+	struct PackedDrawCallInfo
+	{
+		u32 DrawCallId;
+		u32 MaterialId;
+		u32 MeshVertexOffset;
+		u32 MeshIndexOffset;
+		u32 FirstInstance;
+		// Only read by CompactMeshVS.
+		XMFLOAT3 PositionScale;
+		XMFLOAT3 PositionOffset;
+	} drawCallInfo;
+	static_assert(sizeof(PackedDrawCallInfo) == 11 * sizeof(u32), "Update the DrawCallInfoCB root constants");
+
+	drawCallInfo.DrawCallId = firstDrawCallId;
+	drawCallInfo.FirstInstance = firstInstance;
+	drawCallInfo.MaterialId = primitive.m_MaterialIndex;
+	drawCallInfo.PositionScale = primitive.m_PositionScale;
+	drawCallInfo.PositionOffset = primitive.m_PositionOffset;
+
+	if (auto iterator = m_StorageInfo.find((MeshPrimitive*)&primitive); iterator != m_StorageInfo.end())
+	{
+		drawCallInfo.MeshIndexOffset = iterator->second.LodIndexOffsets[lod];
+		drawCallInfo.MeshVertexOffset = iterator->second.VertexOffset;
+	}
+
+	// The command list skips the state change if consecutive primitives have the same vertex format.
+	commandList.SetPipelineState(primitive.m_VertexFormat == VertexFormat::Compact ? m_RasterizeTriangleState.m_CompactPipelineState
+		: m_RasterizeTriangleState.m_PipelineState);
+	commandList.SetGraphics32BitConstants(RasterizeTriangleDataRootParameters::DrawCallInfoCB, drawCallInfo);
+
+	commandList.SetVertexBuffer(0, primitive.m_VertexBuffer);
+
+	const auto& indexBuffer = primitive.GetIndexBuffer(lod);
+	if (ranges)
+	{
+		// SV_PrimitiveID restarts at 0 in every draw, so the index offset in the visibility buffer moves with the range.
+		const u32 meshIndexOffset = drawCallInfo.MeshIndexOffset;
+		commandList.SetIndexBuffer(indexBuffer);
+		for (const IndexRange& range : *ranges)
 		{
-			commandList.Draw(vertexCount, instances.size());
+			drawCallInfo.MeshIndexOffset = meshIndexOffset + range.FirstIndex;
+			commandList.SetGraphics32BitConstants(RasterizeTriangleDataRootParameters::DrawCallInfoCB, drawCallInfo);
+			commandList.DrawIndexed(range.NumIndices, instanceCount, range.FirstIndex);
 		}
 	}
+	else if (auto indexCount = indexBuffer->GetNumIndices(); indexCount > 0)
+	{
+		commandList.SetIndexBuffer(indexBuffer);
+		commandList.DrawIndexed(indexCount, instanceCount);
+	}
+	else if (auto vertexCount = primitive.m_VertexBuffer->GetNumVertices(); vertexCount > 0)
+	{
+		commandList.Draw(vertexCount, instanceCount);
+	}
 }
@@ -2,6 +2,9 @@
 #include <Engine/Core/Events.h>
 
 #include "Renderer.h"
+#include <Engine/Renderer/FrustumCulling.h>
+#include <Engine/Renderer/InstanceBatcher.h>
+#include <Engine/Renderer/SoftwareOcclusionCuller.h>
 #include <Engine/Core/RenderTarget.h>
 #include <Engine/Core/VertexTypes.h>
 
@@ -13,7 +16,11 @@ class Device;
 class StructuredBuffer;
 struct MeshPrimitive;
 class UnorderedAccessView;
+class RenderGraph;
+class Shader;
+class Texture;
 struct ID3D12CommandSignature;
+struct ID3D12Resource;
 
 struct VisibilityStorageInfo
 {
@@ -21,23 +28,212 @@ struct VisibilityStorageInfo
 	u32 IndexOffset;
 	u32 VertexCount;
 	u32 IndexCount;
+	// The offset of the indices of every level of detail. LOD 0 is at IndexOffset.
+	u32 LodIndexOffsets[MeshPrimitive::MaxLods];
 };
 
 class VisibilityBufferRenderer : Renderer
 {
 public:
+	struct BatchingStatistics
+	{
+		// The number of visible primitives (of all models) that were drawn.
+		u32 NumInstances = 0;
+		// The number of draw calls they were drawn with.
+		u32 NumDraws = 0;
+
+		float GetBatchingRatio() const
+		{
+			return NumDraws == 0 ? 1.0f : static_cast<float>(NumInstances) / NumDraws;
+		}
+	};
+
+	struct LodStatistics
+	{
+		// The number of drawn instances at each level of detail.
+		u32 NumInstances[MeshPrimitive::MaxLods] = {};
+		// The number of triangles drawn, and the number that would be drawn without levels of detail.
+		u64 NumTriangles = 0;
+		u64 NumFullDetailTriangles = 0;
+	};
+
+	struct ClusterStatistics
+	{
+		// The number of clusters of the drawn primitives.
+		u32 NumClusters = 0;
+		// The clusters outside the view frustum of every instance, and the ones that only face away from the camera.
+		u32 NumFrustumCulled = 0;
+		u32 NumBackfaceCulled = 0;
+		// The number of draws of the remaining clusters (consecutive clusters are drawn together).
+		u32 NumDraws = 0;
+	};
+
+	enum class OcclusionCulling
+	{
+		Disabled,
+		// Test against a Hi-Z pyramid of the previous frame's depth buffer on the GPU. The results are read back a
+		// frame or two later, and the software rasterizer is used until they are available.
+		HierarchicalZ,
+		// Test against the depth of the largest visible primitives, rasterized on the CPU.
+		Software,
+	};
+
+	struct OcclusionStatistics
+	{
+		// The number of draw calls that passed frustum culling and were tested for occlusion.
+		u32 NumTested = 0;
+		u32 NumOccluded = 0;
+		// The test that was applied this frame. Disabled if there was nothing to test with.
+		OcclusionCulling Method = OcclusionCulling::Disabled;
+	};
+
 	bool Initialize();
 	void BeginFrame();
 	void RenderScene(RenderTarget& renderTarget, const Scene& scene, RefPtr<CommandList> commandList = nullptr);
 	void EndFrame();
 
 	virtual void RenderInstancedIndexedMesh(CommandList& commandList, const Mesh& mesh, const std::vector<XMMATRIX>& instances) override;
+
+	// When enabled (the default), the compute stages of a frame run on the compute queue while the direct queue
+	// renders the next frame, and the result is composited into the render target one frame later.
+	void SetAsyncCompute(bool asyncCompute)
+	{
+		m_AsyncCompute = asyncCompute;
+	}
+
+	bool GetAsyncCompute() const
+	{
+		return m_AsyncCompute;
+	}
+
+	// When enabled (the default), only the primitives whose bounds intersect the camera frustum are rasterized.
+	void SetFrustumCulling(bool frustumCulling)
+	{
+		m_FrustumCulling = frustumCulling;
+	}
+
+	bool GetFrustumCulling() const
+	{
+		return m_FrustumCulling;
+	}
+
+	// When enabled (the default), every instance is drawn at the coarsest level of detail whose error covers less
+	// than the LOD error threshold in pixels on screen.
+	void SetLodSelection(bool lodSelection)
+	{
+		m_LodSelection = lodSelection;
+	}
+
+	bool GetLodSelection() const
+	{
+		return m_LodSelection;
+	}
+
+	void SetLodErrorThreshold(float pixels)
+	{
+		m_LodErrorThreshold = pixels;
+	}
+
+	float GetLodErrorThreshold() const
+	{
+		return m_LodErrorThreshold;
+	}
+
+	const LodStatistics& GetLodStatistics() const
+	{
+		return m_LodStatistics;
+	}
+
+	// When enabled (the default), the clusters of the drawn primitives that are outside the view frustum or that only have
+	// back faces towards the camera are not drawn.
+	void SetClusterCulling(bool clusterCulling)
+	{
+		m_ClusterCulling = clusterCulling;
+	}
+
+	bool GetClusterCulling() const
+	{
+		return m_ClusterCulling;
+	}
+
+	const ClusterStatistics& GetClusterStatistics() const
+	{
+		return m_ClusterStatistics;
+	}
+
+	// Which test removes the primitives that are hidden behind other primitives (HierarchicalZ by default).
+	void SetOcclusionCulling(OcclusionCulling occlusionCulling)
+	{
+		m_OcclusionCulling = occlusionCulling;
+	}
+
+	OcclusionCulling GetOcclusionCulling() const
+	{
+		return m_OcclusionCulling;
+	}
+
+	const OcclusionStatistics& GetOcclusionStatistics() const
+	{
+		return m_OcclusionStatistics;
+	}
+
+	// How well the draws of the last frame were merged into instanced draws.
+	const BatchingStatistics& GetBatchingStatistics() const
+	{
+		return m_BatchingStatistics;
+	}
 	
 private:
+	// Record the draws of a mesh into the visibility buffer. The instances of the primitives get consecutive draw call ids
+	// starting at firstDrawCallId. Only reads renderer state, so chunks of the scene can be recorded concurrently.
+	void RecordInstancedIndexedMesh(CommandList& commandList, const Mesh& mesh, const std::vector<XMMATRIX>& instances, u32 firstDrawCallId);
+	struct IndexRange
+	{
+		u32 FirstIndex;
+		u32 NumIndices;
+	};
+
+	// Record an instanced draw of a single primitive. The topology and instance buffer have to be set already. Instance i
+	// gets draw call id firstDrawCallId + i and reads its world matrix at firstInstance + i in the instance buffer.
+	// If ranges is not null, only those index ranges of the primitive's level of detail are drawn. Sets the pipeline state
+	// for the vertex format of the primitive.
+	void RecordPrimitive(CommandList& commandList, const MeshPrimitive& primitive, u32 lod, u32 firstDrawCallId, u32 firstInstance, u32 instanceCount,
+		const std::vector<IndexRange>* ranges = nullptr);
+
+	/**
+	 * Find the clusters of a primitive that are visible in any of its instances this frame, merged into index ranges
+	 * where consecutive clusters are visible. Only reads renderer state, so it can run on the recording threads.
+	 *
+	 * @param firstInstance The first instance in m_InstanceViews.
+	 * @param [out] ranges The visible index ranges of the primitive's level of detail.
+	 */
+	void CullClusters(const MeshPrimitive& primitive, u32 lod, u32 firstInstance, u32 instanceCount,
+		std::vector<IndexRange>& ranges, ClusterStatistics& statistics) const;
+
+	/**
+	 * Select the level of detail of a primitive. A finer level is selected as soon as the error of the current one
+	 * exceeds the threshold, but a coarser one only once its error is well below it, so an instance at the
+	 * distance where the levels change does not switch back and forth.
+	 *
+	 * @param pixelsPerUnit The size on screen of an object space unit of the primitive, in pixels.
+	 */
+	u32 SelectLod(const MeshPrimitive& primitive, u32 currentLod, float pixelsPerUnit) const;
+
+	// Remove the occluded draw calls from m_VisibleDrawCalls, with the latest GPU results or the software rasterizer.
+	void XM_CALLCONV CullOccludedDrawCalls(const Scene& scene, u32 numDrawCalls, DirectX::FXMMATRIX viewProjection);
+	// Test the draw calls in m_VisibleDrawCalls against the previous frame's depth buffer. The results are
+	// copied to the readback buffer of this frame. Returns false if there was no depth buffer to test against.
+	bool RecordOcclusionTest(CommandList& commandList, const Scene& scene, u32 numDrawCalls);
+
+	// Call createPipelineState now and again whenever one of the shaders is hot reloaded.
+	void CreatePipelineState(std::initializer_list<std::shared_ptr<Shader>> shaders, std::function<void()> createPipelineState);
+
 	struct RasterizeTriangleStage
 	{
 		RefPtr<RootSignature> m_RootSignature;
 		RefPtr<PipelineStateObject> m_PipelineState;
+		// For the primitives with compact vertex buffers.
+		RefPtr<PipelineStateObject> m_CompactPipelineState;
 	} m_RasterizeTriangleState;
 
 	struct DebugTriangleStage
@@ -70,23 +266,51 @@ private:
 		RefPtr<PipelineStateObject> m_PipelineState;
 	} m_MaterialResolveStage;
 
-	RenderTarget m_VisibilityBuffer;
-	RenderTarget m_GBuffer;
+	// The Hi-Z init and reduce stages share a root signature.
+	struct HiZStage
+	{
+		RefPtr<RootSignature> m_RootSignature;
+		RefPtr<PipelineStateObject> m_InitPipelineState;
+		RefPtr<PipelineStateObject> m_ReducePipelineState;
+	} m_HiZStage;
 
-	RefPtr<StructuredBuffer> m_OffsetBuffer;
-	RefPtr<UnorderedAccessView> m_OffsetBufferUAV;
+	struct OcclusionCullStage
+	{
+		RefPtr<RootSignature> m_RootSignature;
+		RefPtr<PipelineStateObject> m_PipelineState;
+	} m_OcclusionCullStage;
 
-	RefPtr<StructuredBuffer> m_MaterialCountBuffer;
-	RefPtr<UnorderedAccessView> m_MaterialCountUAV;
+	// The buffers that are shared between the direct queue (raster and debug stages) and the compute stages.
+	// They are double buffered so the compute stages of a frame can overlap with the raster stage of the next one.
+	struct FrameBuffers
+	{
+		RenderTarget m_VisibilityBuffer;
+		RenderTarget m_GBuffer;
 
-	RefPtr<StructuredBuffer> m_MaterialOffsetBuffer;
-	RefPtr<UnorderedAccessView> m_MaterialOffsetUAV;
+		RefPtr<StructuredBuffer> m_OffsetBuffer;
+		RefPtr<UnorderedAccessView> m_OffsetBufferUAV;
 
-	RefPtr<StructuredBuffer> m_PixelPositionBuffer;
-	RefPtr<UnorderedAccessView> m_PixelPositionUAV;
+		// Signaled on the compute queue when the compute stages have written m_GBuffer. 0 if they never ran.
+		u64 m_ComputeFenceValue = 0;
+	};
 
-	RefPtr<StructuredBuffer> m_IndirectComputeArguementBuffer;
-	RefPtr<UnorderedAccessView> m_IndirectComputeArguementUAV;
+	static constexpr u32 NumFrameBuffers = 2;
+	FrameBuffers m_FrameBuffers[NumFrameBuffers];
+	// The number of frames rendered by this renderer. Selects the frame buffers.
+	u64 m_FrameIndex = 0;
+	bool m_AsyncCompute = true;
+	bool m_FrustumCulling = true;
+	OcclusionCulling m_OcclusionCulling = OcclusionCulling::HierarchicalZ;
+	bool m_LodSelection = true;
+	float m_LodErrorThreshold = 1.0f;
+	bool m_ClusterCulling = true;
+
+	RefPtr<StructuredBuffer> m_MaterialCountBuffer;
+	RefPtr<UnorderedAccessView> m_MaterialCountUAV;
+
+	// Schedules the compute stages. The material offset, pixel position and indirect argument
+	// buffers are transient resources of this graph.
+	RefPtr<RenderGraph> m_ComputeGraph;
 
 	ComPtr<ID3D12CommandSignature> m_IndirectSignature;
 
@@ -95,10 +319,83 @@ private:
 	RefPtr<UnorderedAccessView> m_VisibleIndexBufferUAV;
 	RefPtr<UnorderedAccessView> m_VisibleVertexBufferUAV;
 
-	std::vector<VertexPositionNormalTangentBitangentTexture> m_VisibleVertexContainer;
+	// The vertices as the material resolve reads them. Compact vertices are decoded, so they match the rasterized ones.
+	std::vector<VertexPositionTexture> m_VisibleVertexContainer;
 	std::vector<u32> m_VisibleIndexContainer;
 
 	std::unordered_map<MeshPrimitive*, VisibilityStorageInfo> m_StorageInfo;
+	// The draw call id of the first primitive of every model in the scene.
+	std::vector<u32> m_FirstDrawCallIds;
+	// The model of every draw call (primitive) in the scene.
+	std::vector<u32> m_DrawCallModels;
+	// The world space bounds of every draw call, and the draw calls that passed culling this frame.
+	BoundsArray m_PrimitiveBounds;
+	std::vector<u32> m_VisibleDrawCalls;
+	// True if m_VisibleDrawCalls comes from the scene's BVH, roughly sorted front to back.
+	bool m_VisibleFrontToBack = false;
+	// Merges the visible draw calls of the same primitive into instanced draws.
+	InstanceBatcher m_InstanceBatcher;
+	// The draw call id of the next draw recorded with RenderInstancedIndexedMesh. Each frame starts it after the instances of the scene.
+	u32 m_NextDrawCallId = 0;
+	// The world matrices of the instances drawn this frame, indexed by their id in the visibility buffer.
+	std::vector<Matrix> m_InstanceMatrices;
+	BatchingStatistics m_BatchingStatistics;
+
+	// The camera of every instance drawn this frame in the object space of the instance, for culling its clusters.
+	struct InstanceView
+	{
+		DirectX::XMFLOAT4 Planes[Frustum::NumPlanes];
+		DirectX::XMFLOAT3 Eye;
+		// False if the cluster cones do not apply: a mirroring world matrix turns the back faces to the front, and a
+		// non-uniform scale bends the normals away from the axes of the cones.
+		bool ConeCulling;
+	};
+	std::vector<InstanceView> m_InstanceViews;
+	ClusterStatistics m_ClusterStatistics;
+
+	// The level of detail every draw call of the scene was drawn with last, for the hysteresis of the selection.
+	std::vector<u8> m_DrawCallLods;
+	const Scene* m_LodScene = nullptr;
+	LodStatistics m_LodStatistics;
+
+	// The depth buffer of the raster stage (shared by the frame buffers) and its max depth pyramid, which
+	// starts at half its resolution. Both are only used on the direct queue.
+	RefPtr<Texture> m_DepthTexture;
+	RefPtr<Texture> m_HiZTexture;
+	// The scene and camera the depth buffer was last rendered with. The GPU test needs a depth buffer of the same scene.
+	const Scene* m_DepthScene = nullptr;
+	Matrix m_DepthViewProjection;
+
+	// The GPU test writes a flag per tested draw call, which is copied to a readback buffer. A readback
+	// buffer is reused once the frame that wrote it has completed.
+	struct OcclusionReadback
+	{
+		ComPtr<ID3D12Resource> m_Buffer;
+		const u32* m_Flags = nullptr;
+		// Signaled on the direct queue when the flags were copied. 0 if the buffer holds no results.
+		u64 m_FenceValue = 0;
+		u64 m_FrameIndex = 0;
+		const Scene* m_Scene = nullptr;
+		u32 m_NumDrawCalls = 0;
+		// The tested draw calls, in the order of the flags.
+		std::vector<u32> m_DrawCalls;
+	};
+
+	static constexpr u32 NumOcclusionReadbacks = 3;
+	OcclusionReadback m_OcclusionReadbacks[NumOcclusionReadbacks];
+	RefPtr<StructuredBuffer> m_OcclusionFlagBuffer;
+	// The world space bounds of the draw calls that are tested on the GPU this frame.
+	std::vector<DirectX::BoundingBox> m_OcclusionTestBounds;
+	// Whether each draw call of the scene is occluded, from the latest GPU results.
+	std::vector<u8> m_OccludedDrawCalls;
+
+	SoftwareOcclusionCuller m_SoftwareOcclusionCuller;
+	// Scratch space for choosing the occluders of the software rasterizer: the distance and the draw call.
+	std::vector<std::pair<float, u32>> m_OccluderCandidates;
+	OcclusionStatistics m_OcclusionStatistics;
 
 	RefPtr<Device> m_Device;
+
+	// Recreate the pipeline states when their shaders are reloaded. Disconnected with the renderer.
+	std::vector<Event::scoped_connection> m_ShaderReloadConnections;
 };
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 #include <Engine/Pipeline/CommandList.h>
 #include <Engine/Pipeline/CommandQueue.h>
+#include <Engine/Pipeline/ResourceStateTracker.h>
 #include <Engine/Core/Device.h>
 #include <Engine/Core/GUI.h>
 #include <Engine/Core/Helpers.h>
@@ -105,9 +106,12 @@ bool Tutorial::LoadContent()
 
 	//m_Models.push_back(Model("Sponza"_hs, "Assets/Sponza/Sponza.gltf"));
 
-	auto model = m_Scene.AddModel(MakeRef<Model>("Sponza"_hs, "Assets/Sponza/Sponza.gltf"));
-	spdlog::info("Loaded sponza");
-	model->SetScale(0.1f);
+	// The node hierarchy of the file is kept, below a node that scales it down to the units of the scene.
+	TransformHandle sponza = m_Scene.AddNode(Vector3::Zero, Quaternion::Identity, Vector3(0.1f));
+	if (MeshAssetHandler::Get().LoadScene("Assets/Sponza/Sponza.gltf", m_Scene, sponza, ML_COMPACT_VERTICES))
+	{
+		spdlog::info("Loaded sponza");
+	}
 	//m_Sponza = MeshAssetHandler::Get().GetOrLoad("Sponza"_hs, "Assets/Chess/ABeautifulGame.gltf");
 
 	//m_Cube = commandList->CreateSphere();
@@ -250,6 +254,9 @@ void Tutorial::OnUpdate(UpdateEventArgs& e)
 
 	Game::OnUpdate(e);
 
+	// Recompute the world matrices of the models that moved.
+	m_Scene.Update();
+
 	OnRender();
 }
 
@@ -263,6 +270,69 @@ void Tutorial::OnGUI(const std::shared_ptr<CommandList>& commandList, const Rend
 		ImGui::ShowDemoWindow(&showDemoWindow);
 	}
 
+	static bool showBarrierStatistics = true;
+	if (showBarrierStatistics)
+	{
+		auto statistics = ResourceStateTracker::GetFrameBarrierStatistics();
+
+		ImGui::Begin("Resource Barriers", &showBarrierStatistics);
+		ImGui::Text("Requested:     %u", statistics.NumRequested);
+		ImGui::Text("Emitted:       %u", statistics.NumEmitted);
+		ImGui::Text("Saved:         %u", statistics.GetNumSaved());
+		ImGui::Separator();
+		ImGui::Text("No-op:         %u", statistics.NumNoOp);
+		ImGui::Text("Read merged:   %u", statistics.NumReadMerged);
+		ImGui::Text("Collapsed:     %u", statistics.NumCollapsed);
+		ImGui::Text("Redundant UAV: %u", statistics.NumRedundantUAV);
+		ImGui::Text("Split:         %u", statistics.NumSplit);
+		ImGui::Text("Restricted:    %u", statistics.NumRestricted);
+		ImGui::End();
+	}
+
+	static bool showScene = true;
+	if (showScene)
+	{
+		const auto& bvh = m_Scene.GetBVH();
+
+		ImGui::Begin("Scene", &showScene);
+		ImGui::Text("Primitives:    %zu", bvh.GetNumItems());
+		ImGui::Text("BVH nodes:     %zu", bvh.GetNumNodes());
+		ImGui::Text("BVH depth:     %u", bvh.GetDepth());
+		ImGui::Text("BVH SAH cost:  %.2f", bvh.GetSAHCost());
+		ImGui::Separator();
+
+		const auto& batching = m_SceneRenderer->GetVisibilityBufferRenderer().GetBatchingStatistics();
+		ImGui::Text("Instances:     %u", batching.NumInstances);
+		ImGui::Text("Draws:         %u", batching.NumDraws);
+		ImGui::Text("Batching:      %.2f", batching.GetBatchingRatio());
+
+		using OcclusionCulling = VisibilityBufferRenderer::OcclusionCulling;
+		const auto& occlusion = m_SceneRenderer->GetVisibilityBufferRenderer().GetOcclusionStatistics();
+		const char* method = occlusion.Method == OcclusionCulling::HierarchicalZ ? "Hi-Z" :
+			occlusion.Method == OcclusionCulling::Software ? "Software" : "None";
+		ImGui::Text("Occluded:      %u / %u (%s)", occlusion.NumOccluded, occlusion.NumTested, method);
+
+		const auto& lods = m_SceneRenderer->GetVisibilityBufferRenderer().GetLodStatistics();
+		ImGui::Text("LODs:          %u / %u / %u / %u", lods.NumInstances[0], lods.NumInstances[1], lods.NumInstances[2], lods.NumInstances[3]);
+		ImGui::Text("Triangles:     %llu / %llu", static_cast<unsigned long long>(lods.NumTriangles),
+			static_cast<unsigned long long>(lods.NumFullDetailTriangles));
+
+		const auto& clusters = m_SceneRenderer->GetVisibilityBufferRenderer().GetClusterStatistics();
+		ImGui::Text("Clusters:      %u (%u frustum, %u backface culled)", clusters.NumClusters, clusters.NumFrustumCulled,
+			clusters.NumBackfaceCulled);
+		ImGui::Text("Cluster draws: %u", clusters.NumDraws);
+		ImGui::Separator();
+		if (m_PickResult.m_Model)
+		{
+			ImGui::Text("Picked primitive %u at distance %.2f", m_PickResult.m_PrimitiveIndex, m_PickResult.m_Distance);
+		}
+		else
+		{
+			ImGui::Text("Right click to pick a primitive.");
+		}
+		ImGui::End();
+	}
+
 	m_GUI->Render(commandList, renderTarget);
 }
 
@@ -293,7 +363,8 @@ void Tutorial::OnRender()
 	// move this or remove it
 	//commandList->SetShaderResourceView(RootParameters::Textures, 0, m_Texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-	commandQueue.WaitForFenceValue(commandQueue.ExecuteCommandList(commandList));
+	// Work on the direct queue executes in submission order, so the clear doesn't need to be waited on.
+	commandQueue.ExecuteCommandList(commandList);
 
 	m_SceneRenderer->RenderScene(m_RenderTarget, m_Scene);
 
@@ -471,6 +542,31 @@ void Tutorial::OnMouseMoved(MouseMotionEventArgs& e)
 	}
 }
 
+void Tutorial::OnMouseButtonPressed(MouseButtonEventArgs& e)
+{
+	Game::OnMouseButtonPressed(e);
+
+	if (ImGui::GetIO().WantCaptureMouse || e.Button != MouseButton::Right)
+	{
+		return;
+	}
+
+	// Unproject the cursor onto the near and far planes to get the picking ray.
+	const Camera& camera = m_Scene.GetCameraRef();
+	XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, camera.get_ViewMatrix() * camera.get_ProjectionMatrix());
+
+	float x = 2.0f * e.X / m_Width - 1.0f;
+	float y = 1.0f - 2.0f * e.Y / m_Height;
+	Vector3 nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverseViewProjection);
+	Vector3 farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverseViewProjection);
+
+	Vector3 direction = farPoint - nearPoint;
+	direction.Normalize();
+
+	m_PickResult = {};
+	m_Scene.Raycast(nearPoint, direction, m_PickResult);
+}
+
 void Tutorial::OnResize(ResizeEventArgs& e)
 {
 	if (e.Width != GetClientWidth() || e.Height != GetClientHeight())
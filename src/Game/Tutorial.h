@@ -31,6 +31,7 @@ protected:
     void OnKeyReleased(KeyEventArgs& e) override;
     void OnMouseWheel(MouseWheelEventArgs& e) override;
     void OnMouseMoved(MouseMotionEventArgs& e) override;
+    void OnMouseButtonPressed(MouseButtonEventArgs& e) override;
     void OnResize(ResizeEventArgs& e) override;
     void OnGUI(const std::shared_ptr<CommandList>& commandList, const RenderTarget& renderTarget);
 
@@ -55,6 +56,9 @@ private:
 
     Scene m_Scene;
 
+    // The primitive that was picked with the right mouse button.
+    Scene::PickResult m_PickResult;
+
     RenderTarget m_RenderTarget;
 
     D3D12_VIEWPORT m_Viewport;
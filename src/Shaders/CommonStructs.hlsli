@@ -1,20 +1,21 @@
 #pragma once
 
+#include "VertexFormats.hlsli"
+
 #define MATERIAL_UPPER_LIMIT 32
-#define NUM_TRIANGLE_BITS 23
-#define TRIANGLE_MASK 0x7fffff
-//0x7fffff 
-//(0xFFFFFF) >> 1
 
 struct VertexPositionNormalTangentBitangentTexture
 {
     uint InstanceId : SV_InstanceID;
     
-    float3 Position : POSITION;
-    float3 Normal : NORMAL;
-    float3 Tangent : TANGENT;
-    float3 Bitangent : BITANGENT;
-    float3 TexCoord : TEXCOORD;
+    VERTEX_POSITION_NORMAL_TANGENT_BITANGENT_TEXTURE(VERTEX_HLSL_MEMBER)
+};
+
+struct VertexCompact
+{
+    uint InstanceId : SV_InstanceID;
+    
+    VERTEX_COMPACT(VERTEX_HLSL_MEMBER)
 };
 
 struct VertexShaderOutput
@@ -24,6 +25,7 @@ struct VertexShaderOutput
     float3 TangentVS : TANGENT;
     float3 BitangentVS : BITANGENT;
     float2 TexCoord : TEXCOORD;
+    nointerpolation uint InstanceId : INSTANCEID;
     float4 Position : SV_Position;
 };
 
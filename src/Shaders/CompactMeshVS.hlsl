@@ -0,0 +1,46 @@
+#include "CommonStructs.hlsli"
+
+struct CameraBuffer
+{
+    matrix View;
+    matrix Projection;
+};
+
+ConstantBuffer<CameraBuffer> CameraCB : register(b0);
+StructuredBuffer<float4x4> InstancesSB : register(t0, space0);
+
+// The same draw call info as GenericMeshVS, with the dequantization of the positions of the primitive.
+cbuffer DrawCallInfo : register(b0, space1)
+{
+    uint DrawCallId;
+    uint MaterialId;
+    uint MeshVertexOffset;
+    uint MeshIndexOffset;
+    uint FirstInstance;
+    float3 PositionScale;
+    float3 PositionOffset;
+}
+
+VertexShaderOutput main(VertexCompact IN)
+{
+    VertexShaderOutput OUT;
+
+    float3 position = IN.Position.xyz * PositionScale + PositionOffset;
+    float3 normal = DecodeOctahedral(IN.Normal);
+    float3 tangent = DecodeOctahedral(IN.Tangent);
+    float3 bitangent = cross(normal, tangent) * (IN.Position.w * 2.0f - 1.0f);
+
+    float4x4 world = InstancesSB[FirstInstance + IN.InstanceId];
+    float4x4 viewMatrix = mul(CameraCB.View, world);
+    float4x4 viewProjection = mul(CameraCB.Projection, viewMatrix);
+    float4x4 inverseViewMatrix = transpose(viewMatrix);
+
+    OUT.PositionVS = mul(viewMatrix, float4(position, 1.0f));
+    OUT.NormalVS = mul((float3x3) inverseViewMatrix, normal);
+    OUT.TangentVS = mul((float3x3) inverseViewMatrix, tangent);
+    OUT.BitangentVS = mul((float3x3) inverseViewMatrix, bitangent);
+    OUT.TexCoord = IN.TexCoord;
+    OUT.InstanceId = IN.InstanceId;
+    OUT.Position = mul(viewProjection, float4(position, 1.0f));
+    return OUT;
+}
@@ -1,6 +1,6 @@
 #include "CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint2> offsetBuffer : register(u1);
 Texture2D<float> gBuffer : register(t0);
 
@@ -23,10 +23,9 @@ float4 main(FullscreenPixelInput input) : SV_TARGET
     float h;
     visibilityBuffer.GetDimensions(w, h);
 
-    uint packedvis = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)].r;
-    uint drawCallId = packedvis.r >> NUM_TRIANGLE_BITS;
-    uint triangleId = packedvis.r & TRIANGLE_MASK;
-   // uint materialId = packedvis.g;
+    uint2 visibility = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)];
+    uint drawCallId = visibility.x;
+    uint triangleId = visibility.y;
     
     float4 tri = GetProceduralColor(triangleId);
     float s = (tri.r + tri.g + tri.b) * (1 / 3.f);
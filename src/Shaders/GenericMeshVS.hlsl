@@ -9,11 +9,21 @@ struct CameraBuffer
 ConstantBuffer<CameraBuffer> CameraCB : register(b0);
 StructuredBuffer<float4x4> InstancesSB : register(t0, space0);
 
+// The instances of a draw read their world matrices from InstancesSB, starting at FirstInstance.
+cbuffer DrawCallInfo : register(b0, space1)
+{
+    uint DrawCallId;
+    uint MaterialId;
+    uint MeshVertexOffset;
+    uint MeshIndexOffset;
+    uint FirstInstance;
+}
+
 VertexShaderOutput main(VertexPositionNormalTangentBitangentTexture IN)
 {
     VertexShaderOutput OUT;
     
-    float4x4 world = InstancesSB[IN.InstanceId];
+    float4x4 world = InstancesSB[FirstInstance + IN.InstanceId];
     float4x4 viewMatrix = mul(CameraCB.View, world);
     float4x4 viewProjection = mul(CameraCB.Projection, viewMatrix);
     float4x4 inverseViewMatrix = transpose(viewMatrix);
@@ -23,6 +33,7 @@ VertexShaderOutput main(VertexPositionNormalTangentBitangentTexture IN)
     OUT.TangentVS = mul((float3x3) inverseViewMatrix, IN.Tangent);
     OUT.BitangentVS = mul((float3x3) inverseViewMatrix, IN.Bitangent);
     OUT.TexCoord = IN.TexCoord.xy;
+    OUT.InstanceId = IN.InstanceId;
     OUT.Position = mul(viewProjection, float4(IN.Position, 1.0f));
     return OUT;
 }
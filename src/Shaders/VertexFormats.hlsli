@@ -0,0 +1,51 @@
+#pragma once
+
+// The vertex formats, included by both the shaders and the engine (VertexTypes.h), so the HLSL structs, the C++
+// structs and the input layouts are generated from the same description and cannot disagree.
+// Every element is X(Name, Semantic, HLSL type, C++ type, DXGI format without the DXGI_FORMAT_ prefix).
+
+// Full precision, 60 bytes. The texture coordinate has z = 0.
+#define VERTEX_POSITION_NORMAL_TANGENT_BITANGENT_TEXTURE(X) \
+    X(Position,  POSITION,  float3, DirectX::XMFLOAT3, R32G32B32_FLOAT) \
+    X(Normal,    NORMAL,    float3, DirectX::XMFLOAT3, R32G32B32_FLOAT) \
+    X(Tangent,   TANGENT,   float3, DirectX::XMFLOAT3, R32G32B32_FLOAT) \
+    X(Bitangent, BITANGENT, float3, DirectX::XMFLOAT3, R32G32B32_FLOAT) \
+    X(TexCoord,  TEXCOORD,  float3, DirectX::XMFLOAT3, R32G32B32_FLOAT)
+
+// Compact, 20 bytes. The position is quantized to the bounding box of its primitive (decoded with the scale and
+// offset of the draw) and its w is 1 if the bitangent is cross(normal, tangent), 0 if it is the opposite. The
+// normal and tangent are octahedral encoded unit vectors and the texture coordinate is half precision.
+#define VERTEX_COMPACT(X) \
+    X(Position, POSITION, float4, DirectX::PackedVector::XMUSHORTN4, R16G16B16A16_UNORM) \
+    X(Normal,   NORMAL,   float2, DirectX::PackedVector::XMSHORTN2,  R16G16_SNORM) \
+    X(Tangent,  TANGENT,  float2, DirectX::PackedVector::XMSHORTN2,  R16G16_SNORM) \
+    X(TexCoord, TEXCOORD, float2, DirectX::PackedVector::XMHALF2,    R16G16_FLOAT)
+
+// The attributes the material resolve reads from the visible vertex buffer, 20 bytes. Compact vertices are
+// stored decoded, so the resolve sees the same positions as the rasterizer.
+#define VERTEX_POSITION_TEXTURE(X) \
+    X(Position, POSITION, float3, DirectX::XMFLOAT3, R32G32B32_FLOAT) \
+    X(TexCoord, TEXCOORD, float2, DirectX::XMFLOAT2, R32G32_FLOAT)
+
+#ifdef __cplusplus
+
+#define VERTEX_CPP_MEMBER(name, semantic, hlslType, cppType, format) cppType name;
+#define VERTEX_INPUT_ELEMENT(name, semantic, hlslType, cppType, format) \
+    { #semantic, 0, DXGI_FORMAT_##format, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+#define VERTEX_ELEMENT_COUNT(name, semantic, hlslType, cppType, format) + 1
+
+#else
+
+#define VERTEX_HLSL_MEMBER(name, semantic, hlslType, cppType, format) hlslType name : semantic;
+
+float3 DecodeOctahedral(float2 encoded)
+{
+    // The lower hemisphere is folded over the diagonals of the square.
+    float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+#endif
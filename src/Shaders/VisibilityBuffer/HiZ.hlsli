@@ -0,0 +1,44 @@
+// Shared by the Hi-Z reduction shaders. The including shader defines LOAD_SOURCE_DEPTH(texel).
+
+cbuffer HiZConstants : register(b0)
+{
+    uint2 SourceSize;
+    uint2 DestinationSize;
+}
+
+RWTexture2D<float> Destination : register(u1);
+
+#define GROUP_SIZE 8
+
+// Every texel holds the maximum depth of the 2x2 source texels it covers. At odd source sizes, the last
+// texel of a row (or column) also covers the last source texel, so nothing is left out.
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= DestinationSize.x || DTid.y >= DestinationSize.y)
+    {
+        return;
+    }
+    
+    uint2 first = min(DTid.xy * 2, SourceSize - 1);
+    uint2 last = min(DTid.xy * 2 + 1, SourceSize - 1);
+    if (DTid.x == DestinationSize.x - 1)
+    {
+        last.x = SourceSize.x - 1;
+    }
+    if (DTid.y == DestinationSize.y - 1)
+    {
+        last.y = SourceSize.y - 1;
+    }
+    
+    float depth = 0.0f;
+    for (uint y = first.y; y <= last.y; ++y)
+    {
+        for (uint x = first.x; x <= last.x; ++x)
+        {
+            depth = max(depth, LOAD_SOURCE_DEPTH(uint2(x, y)));
+        }
+    }
+    
+    Destination[DTid.xy] = depth;
+}
@@ -0,0 +1,7 @@
+// Reduces the depth buffer to the first (half resolution) mip of the Hi-Z pyramid.
+
+Texture2D<float> DepthBuffer : register(t0);
+
+#define LOAD_SOURCE_DEPTH(texel) DepthBuffer[texel]
+
+#include "HiZ.hlsli"
@@ -0,0 +1,7 @@
+// Reduces a mip of the Hi-Z pyramid to the next one.
+
+RWTexture2D<float> Source : register(u0);
+
+#define LOAD_SOURCE_DEPTH(texel) Source[texel]
+
+#include "HiZ.hlsli"
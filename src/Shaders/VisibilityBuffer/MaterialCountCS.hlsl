@@ -1,6 +1,6 @@
 #include "../CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint2> offsetBuffer : register(u1);
 RWStructuredBuffer<uint> materialCountBuffer : register(u2);
 
@@ -22,8 +22,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint GTid : SV_GroupIndex)
     } 
     else
     {
-        uint packedvis = visibilityBuffer[DTid.xy].r;
-        uint drawCallId = packedvis.r >> NUM_TRIANGLE_BITS;
+        uint drawCallId = visibilityBuffer[DTid.xy].x;
         uint materialId = offsetBuffer[drawCallId].r;
         
         intermediateCountBuffer[GTid] = materialId;
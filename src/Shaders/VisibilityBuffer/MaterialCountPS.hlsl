@@ -1,6 +1,6 @@
 #include "../CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint> materialCountBuffer : register(u1);
 
 float4 GetProceduralColor(int index)
@@ -22,8 +22,7 @@ float4 main(FullscreenPixelInput input) : SV_TARGET
     float h;
     visibilityBuffer.GetDimensions(w, h);
 
-    uint packedvis = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)].r;
-    uint materialId = packedvis >> NUM_TRIANGLE_BITS;
+    uint materialId = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)].x;
     
     uint count;
     InterlockedAdd(materialCountBuffer[materialId], 1, count);
@@ -1,19 +1,16 @@
 #include "../CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint2> offsetBuffer : register(u1);
 RWStructuredBuffer<uint> materialCountBuffer : register(u2);
 RWStructuredBuffer<uint> materialOffsetBuffer : register(u3);
 RWStructuredBuffer<float2> pixelPositionBuffer : register(u4);
 RWTexture2D<float> renderTarget: register(u5);
 
+// The vertices are stored as VertexPositionTexture, see VertexFormats.hlsli.
 struct VertexData
 {
-    float3 Position : POSITION;
-    float3 Normal : NORMAL;
-    float3 Tangent : TANGENT;
-    float3 Bitangent : BITANGENT;
-    float3 TexCoord : TEXCOORD;
+    VERTEX_POSITION_TEXTURE(VERTEX_HLSL_MEMBER)
 };
 
 RWStructuredBuffer<VertexData> visibleVertexBuffer : register(u7);
@@ -213,9 +210,9 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
         return;
     }
     
-    uint packedvis = visibilityBuffer[coords];
-    uint drawCallId = packedvis >> NUM_TRIANGLE_BITS;
-    uint triangleId = packedvis & TRIANGLE_MASK;
+    uint2 visibility = visibilityBuffer[coords];
+    uint drawCallId = visibility.x;
+    uint triangleId = visibility.y;
     
     uint2 offsetData = offsetBuffer[drawCallId].rg;
     uint materialId = offsetData.r;
@@ -226,8 +223,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
     uint3 indices = FetchTriangleIndices(triangleId);
     TriangleData tri = FetchTriangle(vertexOffset, indices);
     
-    // TODO: Replace [0] with instance index
-    float4x4 world = InstancesSB[0];
+    // The instance buffer of the frame is indexed by draw call id.
+    float4x4 world = InstancesSB[drawCallId];
     float4x4 viewMatrix = mul(CameraCB.View, world);
     float4x4 viewProjection = mul(CameraCB.Projection, viewMatrix);
    // float4x4 inverseViewMatrix = transpose(viewMatrix);
@@ -300,10 +297,9 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
     renderTarget[coords + uint2(3 * width, 0)] = finalColor.a;
     
   //  uint2 coords = uint2(id % width, id / width);
-  //  uint2 packedvis = visibilityBuffer[coords].rg;
-  //  uint drawCallId = packedvis.r >> NUM_TRIANGLE_BITS;
-  //  uint triangleId = packedvis.r & TRIANGLE_MASK;
-  //  uint materialId = packedvis.g;
+  //  uint2 visibility = visibilityBuffer[coords];
+  //  uint drawCallId = visibility.x;
+  //  uint triangleId = visibility.y;
     
     
   ////  uint count = materialCountBuffer[materialId]
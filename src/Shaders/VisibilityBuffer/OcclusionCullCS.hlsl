@@ -0,0 +1,95 @@
+// Tests world space boxes against the Hi-Z pyramid of a depth buffer. A box is occluded if its nearest
+// depth is behind the maximum depth of all the pixels its screen rectangle covers.
+
+struct Bounds
+{
+    float3 Center;
+    float3 Extents;
+};
+
+cbuffer CullConstants : register(b0)
+{
+    // The view * projection matrix the depth buffer was rendered with.
+    matrix ViewProjection;
+    uint NumBounds;
+    uint2 DepthSize;
+    uint NumMips;
+}
+
+StructuredBuffer<Bounds> BoundsSB : register(t0);
+// Mip m holds the maximum depth of 2^(m + 1) x 2^(m + 1) pixels of the depth buffer.
+Texture2D<float> HiZ : register(t1);
+RWStructuredBuffer<uint> VisibilityFlags : register(u0);
+
+#define GROUP_SIZE 64
+
+bool IsVisible(Bounds bounds)
+{
+    float2 minXY = 1e30f;
+    float2 maxXY = -1e30f;
+    float minZ = 1.0f;
+    
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = bounds.Center + bounds.Extents * float3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+        float4 position = mul(ViewProjection, float4(corner, 1.0f));
+        
+        // A box that crosses the near plane covers the whole screen, in the worst case.
+        if (position.z < 0.0f || position.w <= 0.0f)
+        {
+            return true;
+        }
+        
+        float3 ndc = position.xyz / position.w;
+        minXY = min(minXY, ndc.xy);
+        maxXY = max(maxXY, ndc.xy);
+        minZ = min(minZ, ndc.z);
+    }
+    
+    // The pixels the rectangle touches. y points down in the depth buffer.
+    float2 topLeft = float2(minXY.x * 0.5f + 0.5f, 0.5f - maxXY.y * 0.5f) * DepthSize;
+    float2 bottomRight = float2(maxXY.x * 0.5f + 0.5f, 0.5f - minXY.y * 0.5f) * DepthSize;
+    if (any(bottomRight < 0.0f) || any(topLeft >= float2(DepthSize)))
+    {
+        // Outside the screen: this is for frustum culling to decide.
+        return true;
+    }
+    
+    uint2 pixel0 = uint2(max(topLeft, 0.0f));
+    uint2 pixel1 = uint2(min(bottomRight, float2(DepthSize - 1)));
+    
+    // The finest mip at which the rectangle covers at most 4x4 texels. Mip m is level m + 1 of the depth buffer.
+    uint level = 1;
+    while (level < NumMips && any((pixel1 >> level) - (pixel0 >> level) > 3))
+    {
+        ++level;
+    }
+    
+    uint2 mipSize = max(DepthSize >> level, 1);
+    uint2 texel0 = min(pixel0 >> level, mipSize - 1);
+    uint2 texel1 = min(pixel1 >> level, mipSize - 1);
+    for (uint y = texel0.y; y <= texel1.y; ++y)
+    {
+        for (uint x = texel0.x; x <= texel1.x; ++x)
+        {
+            if (minZ <= HiZ.Load(int3(x, y, level - 1)))
+            {
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= NumBounds)
+    {
+        return;
+    }
+    
+    VisibilityFlags[DTid.x] = IsVisible(BoundsSB[DTid.x]) ? 1 : 0;
+}
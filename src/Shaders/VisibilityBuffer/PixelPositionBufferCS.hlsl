@@ -1,6 +1,6 @@
 #include "../CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint2> offsetBuffer : register(u1);
 RWStructuredBuffer<uint> materialCountBuffer : register(u2);
 RWStructuredBuffer<uint> materialOffsetBuffer : register(u3);
@@ -23,8 +23,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint GTid : SV_GroupIndex)
         return;
     }
     
-    uint packedvis = visibilityBuffer[DTid.xy];
-    uint drawcallId = packedvis >> NUM_TRIANGLE_BITS;
+    uint drawcallId = visibilityBuffer[DTid.xy].x;
     uint materialId = offsetBuffer[drawcallId].r;
     
     float2 texCoord = float2((float) DTid.x / w, (float) DTid.y / h);
@@ -1,6 +1,6 @@
 #include "../CommonStructs.hlsli"
 
-RWTexture2D<uint> visibilityBuffer : register(u0);
+RWTexture2D<uint2> visibilityBuffer : register(u0);
 RWStructuredBuffer<uint2> offsetBuffer : register(u1);
 RWStructuredBuffer<uint> materialCountBuffer : register(u2);
 RWStructuredBuffer<uint> materialOffsetBuffer : register(u3);
@@ -12,8 +12,7 @@ float4 main(FullscreenPixelInput input) : SV_TARGET
     float h;
     visibilityBuffer.GetDimensions(w, h);
 
-    uint packedvis = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)].r;
-    uint drawcallId = packedvis >> NUM_TRIANGLE_BITS;
+    uint drawcallId = visibilityBuffer[uint2(w * input.TexCoord.x, h * input.TexCoord.y)].x;
     uint materialId = offsetBuffer[drawcallId].r;
     
     uint id = 0;
@@ -7,6 +7,7 @@ struct PixelShaderInput
     float3 TangentVS : TANGENT;
     float3 BitangentVS : BITANGENT;
     float2 TexCoord : TEXCOORD;
+    nointerpolation uint InstanceId : INSTANCEID;
     
     uint TriangleID : SV_PrimitiveID;
 };
@@ -20,11 +21,14 @@ cbuffer DrawCallInfo : register(b0, space1)
     uint MaterialId;
     uint MeshVertexOffset;
     uint MeshIndexOffset;
+    uint FirstInstance;
 }
 
-uint main(PixelShaderInput IN) : SV_Target
+// The draw call id and the index offset of the triangle, in full 32 bits each.
+uint2 main(PixelShaderInput IN) : SV_Target
 {
-    //return uint2((MaterialId << NUM_TRIANGLE_BITS) | (MeshIndexOffset + (IN.TriangleID * 3)), | MeshVertexOffset);
-    offsetBuffer[DrawCallId] = uint2(MaterialId, MeshVertexOffset);
-    return (DrawCallId << NUM_TRIANGLE_BITS) | (MeshIndexOffset + (IN.TriangleID * 3));
+    // The instances of an instanced draw have consecutive draw call ids.
+    uint drawCallId = DrawCallId + IN.InstanceId;
+    offsetBuffer[drawCallId] = uint2(MaterialId, MeshVertexOffset);
+    return uint2(drawCallId, MeshIndexOffset + (IN.TriangleID * 3));
 }
\ No newline at end of file
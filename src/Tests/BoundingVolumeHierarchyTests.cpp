@@ -0,0 +1,242 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestFrustums.h"
+
+#include <Engine/Core/JobSystem.h>
+#include <Engine/Renderer/BoundingVolumeHierarchy.h>
+
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    enum class Distribution
+    {
+        // Boxes spread evenly over a level, like the props of a large scene.
+        Uniform,
+        // Boxes whose distance along x grows exponentially, so most of them are bunched near the origin.
+        Clustered,
+    };
+
+    std::vector<BoundingBox> CreateBoxes(size_t count, Distribution distribution, u32 seed)
+    {
+        std::mt19937 random(seed);
+        auto         uniform = [&random](float min, float max) { return std::uniform_real_distribution<float>(min, max)(random); };
+
+        std::vector<BoundingBox> boxes(count);
+        for (BoundingBox& box : boxes)
+        {
+            if (distribution == Distribution::Clustered)
+            {
+                box.Center = { std::pow(2.0f, uniform(0.0f, 20.0f)), uniform(-1.0f, 1.0f), 0.0f };
+            }
+            else
+            {
+                box.Center = { uniform(-1000.0f, 1000.0f), uniform(-50.0f, 50.0f), uniform(-1000.0f, 1000.0f) };
+            }
+            box.Extents = { uniform(0.1f, 3.0f), uniform(0.1f, 3.0f), uniform(0.1f, 3.0f) };
+        }
+        return boxes;
+    }
+
+    // A far plane beyond most of the level, so the queries return thousands of boxes.
+    constexpr float FarZ = 1000.0f;
+
+    bool Intersects(const Frustum& frustum, const BoundingBox& box)
+    {
+        for (const XMFLOAT4& plane : frustum.m_Planes)
+        {
+            float distance = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+            float radius = std::abs(plane.x) * box.Extents.x + std::abs(plane.y) * box.Extents.y + std::abs(plane.z) * box.Extents.z;
+            if (distance + radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<u32> QueryBruteForce(const Frustum& frustum, const std::vector<BoundingBox>& boxes)
+    {
+        std::vector<u32> items;
+        for (u32 i = 0; i < boxes.size(); ++i)
+        {
+            if (Intersects(frustum, boxes[i]))
+            {
+                items.push_back(i);
+            }
+        }
+        return items;
+    }
+
+    float DistanceSquared(const BoundingBox& box, const Vector3& position)
+    {
+        return Vector3::DistanceSquared(Vector3(box.Center.x, box.Center.y, box.Center.z), position);
+    }
+}
+
+TEST(BoundingVolumeHierarchyQueryMatchesBruteForce)
+{
+    Frustum frustum = Tests::CreateFrustum(FarZ);
+    Vector3 viewPosition(0.0f, 0.0f, 0.0f);
+
+    for (Distribution distribution : { Distribution::Uniform, Distribution::Clustered })
+    {
+        std::vector<BoundingBox> boxes = CreateBoxes(20000, distribution, 1);
+        std::vector<u32>         expected = QueryBruteForce(frustum, boxes);
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Build(boxes);
+        CHECK(bvh.GetNumItems() == boxes.size());
+
+        std::vector<u32> items;
+        bvh.QueryFrustum(frustum, items);
+        std::sort(items.begin(), items.end());
+        CHECK(items == expected);
+
+        bvh.QueryFrustum(frustum, items, &viewPosition);
+        std::sort(items.begin(), items.end());
+        CHECK(items == expected);
+    }
+}
+
+TEST(BoundingVolumeHierarchyQueryIsFrontToBack)
+{
+    Frustum                  frustum = Tests::CreateFrustum(FarZ);
+    Vector3                  viewPosition(0.0f, 0.0f, 0.0f);
+    std::vector<BoundingBox> boxes = CreateBoxes(20000, Distribution::Uniform, 2);
+
+    BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+
+    std::vector<u32> items;
+    bvh.QueryFrustum(frustum, items, &viewPosition);
+    CHECK(items.size() > 100);
+
+    // The order is only by subtree, so compare the average distance of the first and the last quarter.
+    const size_t quarter = items.size() / 4;
+    double       nearDistance = 0.0;
+    double       farDistance = 0.0;
+    for (size_t i = 0; i < quarter; ++i)
+    {
+        nearDistance += std::sqrt(DistanceSquared(boxes[items[i]], viewPosition));
+        farDistance += std::sqrt(DistanceSquared(boxes[items[items.size() - 1 - i]], viewPosition));
+    }
+    CHECK(nearDistance < farDistance * 0.75);
+}
+
+TEST(BoundingVolumeHierarchyRefitAndUpdate)
+{
+    Frustum                  frustum = Tests::CreateFrustum(FarZ);
+    std::vector<BoundingBox> boxes = CreateBoxes(20000, Distribution::Uniform, 3);
+
+    JobSystem               jobSystem(4);
+    BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes, &jobSystem);
+
+    std::mt19937                          random(3);
+    std::uniform_real_distribution<float> offset(-50.0f, 50.0f);
+    for (BoundingBox& box : boxes)
+    {
+        box.Center.x += offset(random);
+    }
+    bvh.Refit(boxes, &jobSystem);
+
+    std::vector<u32> items;
+    bvh.QueryFrustum(frustum, items);
+    std::sort(items.begin(), items.end());
+    CHECK(items == QueryBruteForce(frustum, boxes));
+
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        u32 item = random() % boxes.size();
+        boxes[item].Center.z += offset(random);
+        bvh.UpdateItem(item, boxes[item]);
+    }
+
+    bvh.QueryFrustum(frustum, items);
+    std::sort(items.begin(), items.end());
+    CHECK(items == QueryBruteForce(frustum, boxes));
+
+    // Moving the boxes can only make the tree worse than a fresh build.
+    float refitCost = bvh.GetSAHCost();
+    bvh.Build(boxes, &jobSystem);
+    CHECK(bvh.GetSAHCost() <= refitCost);
+}
+
+BENCHMARK(BoundingVolumeHierarchyBuild)
+{
+    JobSystem jobSystem;
+
+    for (size_t count : { 100000, 1000000 })
+    {
+        std::vector<BoundingBox> boxes = CreateBoxes(count, Distribution::Uniform, 1);
+        BoundingVolumeHierarchy  bvh;
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "Build %zuK boxes", count / 1000);
+        Tests::Report(label, Tests::Measure(3, [&]() { bvh.Build(boxes); }), count);
+
+        std::snprintf(label, sizeof(label), "Build %zuK boxes (%u workers)", count / 1000, jobSystem.GetNumWorkers());
+        Tests::Report(label, Tests::Measure(3, [&]() { bvh.Build(boxes, &jobSystem); }), count);
+
+        std::snprintf(label, sizeof(label), "Refit %zuK boxes (%u workers)", count / 1000, jobSystem.GetNumWorkers());
+        Tests::Report(label, Tests::Measure(3, [&]() { bvh.Refit(boxes, &jobSystem); }), count);
+    }
+}
+
+BENCHMARK(BoundingVolumeHierarchyQuery)
+{
+    constexpr size_t NumBoxes = 1000000;
+    constexpr u32    Iterations = 20;
+
+    Frustum                  frustum = Tests::CreateFrustum(FarZ);
+    Vector3                  viewPosition(0.0f, 0.0f, 0.0f);
+    std::vector<BoundingBox> boxes = CreateBoxes(NumBoxes, Distribution::Uniform, 1);
+
+    BoundingVolumeHierarchy bvh;
+    bvh.Build(boxes);
+
+    std::vector<u32> items;
+    Tests::Report("QueryFrustum", Tests::Measure(Iterations, [&]() {
+        bvh.QueryFrustum(frustum, items);
+        Tests::Consume(items.size());
+    }), NumBoxes);
+    Tests::Report("QueryFrustum (front to back)", Tests::Measure(Iterations, [&]() {
+        bvh.QueryFrustum(frustum, items, &viewPosition);
+        Tests::Consume(items.size());
+    }), NumBoxes);
+    Tests::Report("Brute force", Tests::Measure(Iterations, [&]() { Tests::Consume(QueryBruteForce(frustum, boxes).size()); }), NumBoxes);
+}
+
+BENCHMARK(BoundingVolumeHierarchySAHQuality)
+{
+    // The SAH cost is the expected cost of a random ray relative to testing the root box, lower is better.
+    // A refit keeps the topology, so its cost grows with the distance the items moved.
+    for (Distribution distribution : { Distribution::Uniform, Distribution::Clustered })
+    {
+        const char*              name = distribution == Distribution::Uniform ? "uniform" : "clustered";
+        std::vector<BoundingBox> boxes = CreateBoxes(100000, distribution, 1);
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Build(boxes);
+        std::printf("  %-40s %10.2f SAH, %zu nodes, depth %u\n", name, bvh.GetSAHCost(), bvh.GetNumNodes(), bvh.GetDepth());
+
+        std::mt19937                          random(1);
+        std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+        for (BoundingBox& box : boxes)
+        {
+            box.Center.x += offset(random);
+            box.Center.z += offset(random);
+        }
+
+        bvh.Refit(boxes);
+        float refitCost = bvh.GetSAHCost();
+        bvh.Build(boxes);
+        std::printf("  %-40s %10.2f SAH refit, %.2f SAH rebuilt\n", name, refitCost, bvh.GetSAHCost());
+        CHECK(bvh.GetSAHCost() <= refitCost);
+    }
+}
@@ -0,0 +1,318 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <Engine/Buffers/StructuredBuffer.h>
+#include <Engine/Core/JobSystem.h>
+#include <Engine/Pipeline/CommandList.h>
+#include <Engine/Pipeline/CommandQueue.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    constexpr DXGI_FORMAT RenderTargetFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    // Record the draws [begin, end) of a frame like a recording chunk of the raster pass: bind the state once, then
+    // set root constants, upload a constant buffer and draw for every draw.
+    void RecordDraws(CommandList& commandList, const Tests::TriangleState& state, const RenderTarget& renderTarget,
+        u32 begin, u32 end)
+    {
+        commandList.SetPipelineState(state.m_PipelineState);
+        commandList.SetGraphicsRootSignature(state.m_RootSignature);
+        commandList.SetViewport(CD3DX12_VIEWPORT(0.0f, 0.0f, 64.0f, 64.0f));
+        commandList.SetScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX));
+        commandList.SetRenderTarget(renderTarget);
+        commandList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        for (u32 i = begin; i < end; ++i)
+        {
+            float offset[2] = { (i % 32) / 16.0f - 1.0f, (i / 32 % 32) / 16.0f - 1.0f };
+            float color[4] = { (i % 7) / 7.0f, (i % 5) / 5.0f, (i % 3) / 3.0f, 1.0f };
+
+            commandList.SetGraphics32BitConstants(Tests::TriangleState::OffsetCB, offset);
+            commandList.SetGraphicsDynamicConstantBuffer(Tests::TriangleState::ColorCB, color);
+            commandList.Draw(3);
+        }
+    }
+
+    // Stands in for a single lock around the global resource state, which the shards replaced.
+    std::mutex gs_GlobalStateMutex;
+}
+
+TEST(RecordCommandListsRecordsEveryIndexOnItsOwnList)
+{
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& commandQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    JobSystem     jobSystem(3);
+
+    constexpr u32                 NumLists = 16;
+    std::vector<CommandList*>     recordedLists(NumLists, nullptr);
+    std::vector<std::atomic<u32>> timesRecorded(NumLists);
+
+    auto commandLists = commandQueue.RecordCommandLists(jobSystem, NumLists, [&](CommandList& commandList, u32 index) {
+        recordedLists[index] = &commandList;
+        ++timesRecorded[index];
+    });
+
+    CHECK(commandLists.size() == NumLists);
+    for (u32 i = 0; i < NumLists; ++i)
+    {
+        CHECK(timesRecorded[i] == 1);
+        // The lists are returned in index order.
+        CHECK(recordedLists[i] == commandLists[i].get());
+        for (u32 j = 0; j < i; ++j)
+        {
+            CHECK(commandLists[i] != commandLists[j]);
+        }
+    }
+    commandQueue.ExecuteCommandLists(commandLists);
+
+    // An exception thrown while recording a list reaches the caller after all lists have been recorded.
+    bool rethrown = false;
+    try
+    {
+        commandQueue.RecordCommandLists(jobSystem, NumLists, [&](CommandList&, u32 index) {
+            if (index == NumLists - 1)
+            {
+                throw std::runtime_error("Recording failed.");
+            }
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        rethrown = true;
+    }
+    CHECK(rethrown);
+
+    commandQueue.Flush();
+}
+
+TEST(DirectQueueWaitsForTheComputeFenceValue)
+{
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& directQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    CommandQueue& computeQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    auto state = Tests::CreateWriteValueState(device);
+    auto result = device.CreateStructuredBuffer(1, sizeof(u32));
+    auto readbackBuffer = Tests::CreateReadbackBuffer(device, sizeof(u32));
+
+    // Hold the compute queue back, so the direct queue would run ahead of it if it didn't wait.
+    Tests::QueueGate gate(device);
+    gate.Block(computeQueue);
+
+    // The compute stages write their results...
+    auto computeList = computeQueue.GetCommandList();
+    computeList->SetComputeRootSignature(state.m_RootSignature);
+    computeList->SetPipelineState(state.m_PipelineState);
+    computeList->SetCompute32BitConstants(Tests::WriteValueState::ValueCB, 42u);
+    computeList->SetUnorderedAccessView(Tests::WriteValueState::ResultUAV, result);
+    computeList->Dispatch(1);
+    u64 computeFenceValue = computeQueue.ExecuteCommandList(computeList);
+
+    // ...and the direct queue waits for their fence value before it reads them, like the debug stage of the renderer.
+    directQueue.Wait(computeQueue, computeFenceValue);
+
+    auto directList = directQueue.GetCommandList();
+    directList->TransitionBarrier(result, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    directList->FlushResourceBarriers();
+    directList->GetD3D12CommandList()->CopyBufferRegion(readbackBuffer.Get(), 0, result->GetD3D12Resource().Get(), 0,
+        sizeof(u32));
+    u64 directFenceValue = directQueue.ExecuteCommandList(directList);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!computeQueue.IsFenceComplete(computeFenceValue));
+    CHECK(!directQueue.IsFenceComplete(directFenceValue));
+
+    gate.Open();
+    directQueue.WaitForFenceValue(directFenceValue);
+    CHECK(computeQueue.IsFenceComplete(computeFenceValue));
+    CHECK(Tests::ReadValue(readbackBuffer.Get()) == 42);
+
+    computeQueue.Flush();
+    directQueue.Flush();
+}
+
+TEST(ExecuteCommandListsOnlySubmitsPendingListsWithBarriers)
+{
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& commandQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+    // The number of D3D12 command lists a submission of commandList adds to the queue.
+    auto numSubmitted = [&](std::shared_ptr<CommandList> commandList) {
+        u64 numSubmittedBefore = commandQueue.GetNumSubmittedCommandLists();
+        commandQueue.ExecuteCommandList(commandList);
+        return commandQueue.GetNumSubmittedCommandLists() - numSubmittedBefore;
+    };
+
+    auto manuallyManaged = device.CreateStructuredBuffer(1, sizeof(u32));
+    manuallyManaged->SetManuallyManaged(true);
+    auto tracked = device.CreateStructuredBuffer(1, sizeof(u32));
+
+    // A list that only records explicit barriers knows all its states: no pending command list.
+    auto explicitList = commandQueue.GetCommandList();
+    explicitList->SetExplicitBarriers(true);
+    explicitList->ExplicitTransitionBarrier(manuallyManaged, D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    // Ignored in explicit mode.
+    explicitList->TransitionBarrier(manuallyManaged, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    explicitList->ExplicitTransitionBarrier(manuallyManaged, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true);
+    CHECK(numSubmitted(explicitList) == 1);
+
+    // A list whose first use of a resource matches its global state has a pending barrier that resolves to nothing,
+    // so its pending command list isn't submitted either.
+    auto matchingList = commandQueue.GetCommandList();
+    matchingList->TransitionBarrier(tracked, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true);
+    CHECK(numSubmitted(matchingList) == 1);
+
+    // Only a first use that needs a transition submits the pending command list in front of the list.
+    auto transitionList = commandQueue.GetCommandList();
+    transitionList->TransitionBarrier(tracked, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true);
+    CHECK(numSubmitted(transitionList) == 2);
+
+    commandQueue.Flush();
+}
+
+BENCHMARK(RecordCommandListsScaling)
+{
+    constexpr u32 NumDraws = 20000;
+    constexpr u32 NumFrames = 10;
+
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& commandQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+    auto state = Tests::CreateTriangleState(device, RenderTargetFormat);
+    auto renderTarget = Tests::CreateRenderTarget(device, 64, 64, RenderTargetFormat);
+
+    // Record a frame of NumDraws draws in one list per thread (the workers and the calling thread), like the raster
+    // pass does. Only the recording is timed; the lists are executed after it, so they are recycled for the next
+    // frame.
+    auto measure = [&](u32 numThreads) {
+        // A single list is recorded on the calling thread.
+        JobSystem jobSystem(std::max(numThreads - 1, 1u));
+
+        double totalMilliseconds = 0.0;
+        for (u32 frame = 0; frame <= NumFrames; ++frame)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            auto commandLists = commandQueue.RecordCommandLists(jobSystem, numThreads, [&](CommandList& commandList, u32 index) {
+                RecordDraws(commandList, state, renderTarget, NumDraws * index / numThreads, NumDraws * (index + 1) / numThreads);
+            });
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            // The first frame creates the command lists and their upload pages.
+            if (frame > 0)
+            {
+                totalMilliseconds += elapsed.count();
+            }
+
+            commandQueue.ExecuteCommandLists(commandLists);
+            commandQueue.Flush();
+        }
+
+        return totalMilliseconds / NumFrames;
+    };
+
+    double serialMilliseconds = measure(1);
+    Tests::Report("1 recording thread", serialMilliseconds, NumDraws);
+
+    for (u32 numThreads : { 2u, 4u, 8u })
+    {
+        double milliseconds = measure(numThreads);
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "%u recording threads", numThreads);
+        Tests::Report(label, milliseconds, NumDraws);
+        std::printf("  %-40s %10.2fx\n", "Speedup over 1 thread", serialMilliseconds / milliseconds);
+    }
+}
+
+BENCHMARK(ExecuteCommandListsConcurrentSubmission)
+{
+    // Every queue submits lists that transition a few buffers of its own, so with the sharded global state only the
+    // submissions whose buffers hash to the same shard contend. The copy queue limits the states to the copy states.
+    constexpr u32 NumBuffersPerQueue = 64;
+    constexpr u32 NumBuffersPerList = 4;
+    constexpr u32 NumListsPerQueue = 2000;
+
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue* commandQueues[] = {
+        &device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT),
+        &device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE),
+        &device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY),
+    };
+
+    std::vector<std::shared_ptr<StructuredBuffer>> buffers;
+    for (u32 i = 0; i < NumBuffersPerQueue * std::size(commandQueues); ++i)
+    {
+        buffers.push_back(device.CreateStructuredBuffer(1, sizeof(u32)));
+    }
+
+    // Record and execute lists on numQueues queues at the same time, one thread per queue.
+    auto submit = [&](u32 numQueues, bool globalLock) {
+        std::vector<std::thread> threads;
+        for (u32 queue = 0; queue < numQueues; ++queue)
+        {
+            threads.emplace_back([&, queue]() {
+                CommandQueue& commandQueue = *commandQueues[queue];
+                for (u32 list = 0; list < NumListsPerQueue; ++list)
+                {
+                    auto commandList = commandQueue.GetCommandList();
+                    for (u32 i = 0; i < NumBuffersPerList; ++i)
+                    {
+                        auto& buffer = buffers[queue * NumBuffersPerQueue + (list * NumBuffersPerList + i) % NumBuffersPerQueue];
+                        commandList->TransitionBarrier(buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+                        commandList->TransitionBarrier(buffer, D3D12_RESOURCE_STATE_COPY_SOURCE);
+                    }
+
+                    std::unique_lock<std::mutex> globalStateLock(gs_GlobalStateMutex, std::defer_lock);
+                    if (globalLock)
+                    {
+                        globalStateLock.lock();
+                    }
+                    commandQueue.ExecuteCommandList(commandList);
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    };
+    auto flush = [&]() {
+        for (auto commandQueue : commandQueues)
+        {
+            commandQueue->Flush();
+        }
+    };
+
+    // Create the command lists and the first states of the buffers.
+    submit(static_cast<u32>(std::size(commandQueues)), false);
+    flush();
+
+    for (bool globalLock : { true, false })
+    {
+        for (u32 numQueues = 1; numQueues <= std::size(commandQueues); ++numQueues)
+        {
+            // Only the submissions are timed, not waiting for the GPU.
+            double milliseconds = Tests::Measure(1, [&]() {
+                submit(numQueues, globalLock);
+            });
+            flush();
+
+            char label[64];
+            std::snprintf(label, sizeof(label), "%u queue(s), %s", numQueues, globalLock ? "global lock" : "sharded");
+            Tests::Report(label, milliseconds, static_cast<u64>(numQueues) * NumListsPerQueue);
+        }
+    }
+}
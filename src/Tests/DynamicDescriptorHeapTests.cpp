@@ -0,0 +1,64 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <Engine/Memory/DynamicDescriptorHeap.h>
+#include <Engine/Pipeline/CommandList.h>
+#include <Engine/Pipeline/CommandQueue.h>
+
+#include <cstdio>
+
+BENCHMARK(CommitInlineDescriptors)
+{
+    constexpr u32 NumCommits = 100000;
+    constexpr u32 NumRounds = 10;
+
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& commandQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    auto state = Tests::CreateWriteValueState(device);
+    auto result = device.CreateStructuredBuffer(1, sizeof(u32));
+    D3D12_GPU_VIRTUAL_ADDRESS resultAddress = result->GetD3D12Resource()->GetGPUVirtualAddress();
+
+    // A heap of its own, so only the inline descriptors staged here are committed: the commit path is
+    // CommitInlineDescriptors<SetComputeRootUnorderedAccessView>, with no descriptor tables to copy.
+    DynamicDescriptorHeap descriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    descriptorHeap.ParseRootSignature(state.m_RootSignature);
+
+    double totalMilliseconds = 0.0;
+    u64    numAllocations = 0;
+    for (u32 round = 0; round <= NumRounds; ++round)
+    {
+        auto commandList = commandQueue.GetCommandList();
+        commandList->SetComputeRootSignature(state.m_RootSignature);
+
+        u64  allocationsBefore = Tests::GetNumAllocations();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (u32 i = 0; i < NumCommits; ++i)
+        {
+            descriptorHeap.StageInlineUAV(Tests::WriteValueState::ResultUAV, resultAddress);
+            descriptorHeap.CommitStagedDescriptorsForDispatch(*commandList);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        // The first round warms up the command list.
+        if (round > 0)
+        {
+            totalMilliseconds += elapsed.count();
+            numAllocations += Tests::GetNumAllocations() - allocationsBefore;
+        }
+
+        commandQueue.ExecuteCommandList(commandList);
+        commandQueue.Flush();
+    }
+    descriptorHeap.Reset();
+
+    double milliseconds = totalMilliseconds / NumRounds;
+    Tests::Report("Stage and commit an inline UAV", milliseconds, NumCommits);
+    std::printf("  %-40s %10.1f ns\n", "Per commit", milliseconds * 1e6 / NumCommits);
+    std::printf("  %-40s %10llu\n", "Allocations", static_cast<unsigned long long>(numAllocations));
+
+    // The root setter is a template argument, so committing never allocates.
+    CHECK(numAllocations == 0);
+}
@@ -0,0 +1,96 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <Engine/Core/FrameFences.h>
+#include <Engine/Pipeline/CommandQueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    // Wait until value reaches expected, or give up after a while so a broken test fails instead of hanging.
+    bool WaitUntil(const std::atomic<u64>& value, u64 expected)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (value < expected)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+}
+
+TEST(FrameFencesKeepTheCpuAtMostNumFramesAhead)
+{
+    constexpr u64 NumFrames = 3 * g_NumFrames;
+
+    Device&       device = Tests::GetWarpDevice();
+    CommandQueue& directQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    CommandQueue& computeQueue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    FrameFences fences(directQueue, computeQueue);
+
+    // The GPU work of frame n is delayed until its gates are opened to n + 1, one queue at a time.
+    Tests::QueueGate directGate(device);
+    Tests::QueueGate computeGate(device);
+    std::atomic<u64> directReleased{ 0 };
+    std::atomic<u64> computeReleased{ 0 };
+
+    // The number of frames the CPU has started, like SwapChain::Present does at the end of every frame.
+    std::atomic<u64> framesStarted{ 1 };
+
+    std::thread cpuThread([&]() {
+        for (u64 frame = 0; frame < NumFrames; ++frame)
+        {
+            computeGate.Block(computeQueue, frame + 1);
+            computeQueue.Signal();
+            directGate.Block(directQueue, frame + 1);
+
+            fences.EndFrame(frame);
+            fences.BeginFrame(frame + 1);
+
+            // Frame n may only start once frame n - g_NumFrames has finished on both queues.
+            if (frame + 1 >= g_NumFrames)
+            {
+                CHECK(directReleased >= frame + 2 - g_NumFrames);
+                CHECK(computeReleased >= frame + 2 - g_NumFrames);
+            }
+            framesStarted = frame + 2;
+        }
+    });
+
+    for (u64 released = 0; released < NumFrames; ++released)
+    {
+        // With the first frames released, the CPU runs g_NumFrames frames ahead of them...
+        u64 maxFramesStarted = std::min(released + g_NumFrames, NumFrames + 1);
+        CHECK(WaitUntil(framesStarted, maxFramesStarted));
+
+        // ...but not further, however long the GPU takes.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(framesStarted <= maxFramesStarted);
+
+        // The next frame has finished on the direct queue, but its compute stages are still running.
+        ++directReleased;
+        directGate.Open(directReleased);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(framesStarted <= maxFramesStarted);
+
+        ++computeReleased;
+        computeGate.Open(computeReleased);
+    }
+
+    cpuThread.join();
+    CHECK(framesStarted == NumFrames + 1);
+
+    computeQueue.Flush();
+    directQueue.Flush();
+}
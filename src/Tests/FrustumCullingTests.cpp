@@ -0,0 +1,137 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestFrustums.h"
+
+#include <Engine/Renderer/FrustumCulling.h>
+
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    // Random boxes around the camera, so some are inside, some outside and some cross a plane.
+    void AddRandomBoxes(BoundsArray& bounds, size_t count, u32 seed)
+    {
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+        std::uniform_real_distribution<float> extent(0.0f, 5.0f);
+
+        bounds.Reserve(bounds.GetSize() + count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            BoundingBox box;
+            box.Center = { position(random), position(random), position(random) };
+            box.Extents = { extent(random), extent(random), extent(random) };
+            bounds.Add(box);
+        }
+    }
+}
+
+TEST(FrustumCullingClassifiesBoxes)
+{
+    Frustum frustum = Tests::CreateFrustum();
+
+    BoundsArray bounds;
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 10.0f }, { 1.0f, 1.0f, 1.0f }));     // Inside.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, -10.0f }, { 1.0f, 1.0f, 1.0f }));    // Behind the camera.
+    bounds.Add(BoundingBox({ 50.0f, 0.0f, 10.0f }, { 1.0f, 1.0f, 1.0f }));    // Right of the frustum.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 150.0f }, { 1.0f, 1.0f, 1.0f }));    // Beyond the far plane.
+    bounds.Add(BoundingBox({ 10.5f, 0.0f, 10.0f }, { 1.0f, 1.0f, 1.0f }));    // Crosses the right plane.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 0.5f }, { 0.1f, 0.1f, 0.1f }));      // In front of the near plane.
+
+    std::vector<u32> visible;
+    CHECK(bounds.Cull(frustum, visible) == 2);
+    CHECK(visible == std::vector<u32>({ 0, 4 }));
+
+    std::vector<u32> visibleScalar;
+    CHECK(bounds.CullScalar(frustum, visibleScalar) == 2);
+    CHECK(visibleScalar == visible);
+}
+
+TEST(FrustumCullingMatchesScalar)
+{
+    Frustum frustum = Tests::CreateFrustum();
+
+    // Sizes that are not a multiple of the SIMD width test the remainder.
+    for (u32 i = 0; i < 20; ++i)
+    {
+        BoundsArray bounds;
+        AddRandomBoxes(bounds, 1000 + i * 37, i);
+
+        std::vector<u32> visibleScalar;
+        u32              numVisibleScalar = bounds.CullScalar(frustum, visibleScalar);
+
+        // Both widths, whichever one Cull picks on this CPU.
+        std::vector<u32> visible;
+        CHECK(bounds.CullSSE(frustum, visible) == numVisibleScalar);
+        CHECK(visible == visibleScalar);
+
+        if (BoundsArray::IsAvxSupported())
+        {
+            CHECK(bounds.CullAVX(frustum, visible) == numVisibleScalar);
+            CHECK(visible == visibleScalar);
+        }
+
+        CHECK(bounds.Cull(frustum, visible) == numVisibleScalar);
+        CHECK(visible == visibleScalar);
+    }
+}
+
+TEST(FrustumCullingTransformedBoxEnclosesCorners)
+{
+    BoundingBox box({ 1.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 3.0f });
+    XMMATRIX    world = XMMatrixScaling(2.0f, 1.0f, 1.0f) * XMMatrixRotationZ(XM_PIDIV2) * XMMatrixTranslation(5.0f, 6.0f, 7.0f);
+
+    BoundsArray bounds;
+    bounds.Add(box, world);
+    BoundingBox transformed = bounds.Get(0);
+
+    XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+    box.GetCorners(corners);
+    for (const XMFLOAT3& corner : corners)
+    {
+        XMFLOAT3 point;
+        XMStoreFloat3(&point, XMVector3Transform(XMLoadFloat3(&corner), world));
+        CHECK(std::abs(point.x - transformed.Center.x) <= transformed.Extents.x + 1e-4f);
+        CHECK(std::abs(point.y - transformed.Center.y) <= transformed.Extents.y + 1e-4f);
+        CHECK(std::abs(point.z - transformed.Center.z) <= transformed.Extents.z + 1e-4f);
+    }
+
+    // The rotation maps the scaled x extent onto y, so the box is tight.
+    CHECK_NEAR(transformed.Extents.x, 2.0f, 1e-4f);
+    CHECK_NEAR(transformed.Extents.y, 2.0f, 1e-4f);
+    CHECK_NEAR(transformed.Extents.z, 3.0f, 1e-4f);
+}
+
+BENCHMARK(FrustumCulling1MBoxes)
+{
+    constexpr size_t NumBoxes = 1000000;
+    constexpr u32    Iterations = 20;
+
+    Frustum     frustum = Tests::CreateFrustum();
+    BoundsArray bounds;
+    AddRandomBoxes(bounds, NumBoxes, 1);
+
+    std::vector<u32> visibleScalar;
+    double           scalar = Tests::Measure(Iterations, [&]() { Tests::Consume(bounds.CullScalar(frustum, visibleScalar)); });
+    Tests::Report("CullScalar", scalar, NumBoxes);
+
+    std::vector<u32> visible;
+    double           sse = Tests::Measure(Iterations, [&]() { Tests::Consume(bounds.CullSSE(frustum, visible)); });
+    Tests::Report("CullSSE (4 boxes)", sse, NumBoxes);
+    CHECK(visible == visibleScalar);
+
+    if (BoundsArray::IsAvxSupported())
+    {
+        double avx = Tests::Measure(Iterations, [&]() { Tests::Consume(bounds.CullAVX(frustum, visible)); });
+        Tests::Report("CullAVX (8 boxes)", avx, NumBoxes);
+        CHECK(visible == visibleScalar);
+    }
+    else
+    {
+        std::printf("  %-40s %10s\n", "CullAVX (8 boxes)", "no AVX");
+    }
+}
@@ -0,0 +1,171 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/ThreadSafeQueue.h>
+#include <Engine/Pipeline/Fence.h>
+#include <Engine/Pipeline/InFlightQueue.h>
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    // A fence that the test completes by hand. Waiting is counted, so a test can check that
+    // recycling never blocks on the GPU.
+    class FakeFence : public Fence
+    {
+    public:
+        u64 GetCompletedValue() const override
+        {
+            return CompletedValue.load();
+        }
+
+        void Wait(u64 value) override
+        {
+            ++NumWaits;
+            if (CompletedValue.load() < value)
+            {
+                CompletedValue.store(value);
+            }
+        }
+
+        std::atomic<u64> CompletedValue{ 0 };
+        std::atomic<u32> NumWaits{ 0 };
+    };
+
+    struct FakeCommandList
+    {
+        u32 Index = 0;
+        u32 NumResets = 0;
+    };
+
+    using CommandListPtr = std::shared_ptr<FakeCommandList>;
+
+    // Recycle the completed command lists like CommandQueue does: reset them and make them available again.
+    size_t Recycle(InFlightQueue<CommandListPtr>& inFlight, ThreadSafeQueue<CommandListPtr>& available)
+    {
+        return inFlight.Recycle([&](CommandListPtr& commandList) {
+            ++commandList->NumResets;
+            CHECK(available.TryPush(std::move(commandList)));
+        });
+    }
+}
+
+TEST(InFlightQueueRecyclesCompletedListsWithoutWaiting)
+{
+    FakeFence                       fence;
+    InFlightQueue<CommandListPtr>   inFlight(fence);
+    ThreadSafeQueue<CommandListPtr> available;
+
+    // Two submissions of a command list and its pending command list, which share a fence value.
+    std::vector<CommandListPtr> commandLists;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        commandLists.push_back(MakeRef<FakeCommandList>(FakeCommandList{ i }));
+        inFlight.Push(i / 2 + 1, commandLists.back());
+    }
+
+    // Nothing has completed yet.
+    CHECK(Recycle(inFlight, available) == 0);
+    CHECK(available.Empty());
+    CHECK(inFlight.Size() == 4);
+
+    // The first submission completes.
+    fence.CompletedValue = 1;
+    CHECK(Recycle(inFlight, available) == 2);
+    CHECK(inFlight.Size() == 2);
+
+    CommandListPtr commandList;
+    CHECK(available.TryPop(commandList) && commandList == commandLists[0]);
+    CHECK(available.TryPop(commandList) && commandList == commandLists[1]);
+    CHECK(commandList->NumResets == 1);
+    CHECK(!available.TryPop(commandList));
+
+    // Recycling again doesn't reset the recycled lists twice.
+    CHECK(Recycle(inFlight, available) == 0);
+    CHECK(commandLists[0]->NumResets == 1);
+
+    fence.CompletedValue = 2;
+    CHECK(Recycle(inFlight, available) == 2);
+    CHECK(inFlight.Size() == 0);
+    CHECK(available.Size() == 2);
+    CHECK(commandLists[3]->NumResets == 1);
+
+    CHECK(fence.NumWaits == 0);
+}
+
+TEST(InFlightQueueStopsAtTheFirstIncompleteList)
+{
+    FakeFence                       fence;
+    InFlightQueue<CommandListPtr>   inFlight(fence);
+    ThreadSafeQueue<CommandListPtr> available;
+
+    for (u32 i = 0; i < 8; ++i)
+    {
+        inFlight.Push(i + 1, MakeRef<FakeCommandList>(FakeCommandList{ i }));
+    }
+
+    // A fence can skip values (CommandQueue::Signal doesn't submit command lists).
+    fence.CompletedValue = 5;
+    CHECK(Recycle(inFlight, available) == 5);
+
+    // The command lists are recycled in submission order.
+    CommandListPtr commandList;
+    for (u32 i = 0; i < 5; ++i)
+    {
+        CHECK(available.TryPop(commandList) && commandList->Index == i);
+    }
+    CHECK(inFlight.Size() == 3);
+
+    // Flushing a queue waits for its last value first.
+    fence.Wait(8);
+    CHECK(Recycle(inFlight, available) == 3);
+    CHECK(inFlight.Size() == 0);
+    CHECK(fence.NumWaits == 1);
+}
+
+TEST(InFlightQueueRecyclesEveryListOnceUnderContention)
+{
+    constexpr u32 NumSubmissions = 20000;
+    constexpr u32 NumRecyclers = 3;
+
+    FakeFence                       fence;
+    InFlightQueue<CommandListPtr>   inFlight(fence);
+    ThreadSafeQueue<CommandListPtr> available(NumSubmissions);
+
+    std::vector<CommandListPtr> commandLists(NumSubmissions);
+    std::atomic<bool>           submitted{ false };
+
+    // Threads that get command lists recycle while one thread submits and the GPU completes them.
+    std::vector<std::thread> recyclers;
+    for (u32 i = 0; i < NumRecyclers; ++i)
+    {
+        recyclers.emplace_back([&]() {
+            while (!submitted || inFlight.Size() > 0)
+            {
+                Recycle(inFlight, available);
+            }
+        });
+    }
+
+    for (u32 i = 0; i < NumSubmissions; ++i)
+    {
+        commandLists[i] = MakeRef<FakeCommandList>(FakeCommandList{ i });
+        inFlight.Push(i + 1, commandLists[i]);
+        fence.CompletedValue = i + 1;
+    }
+    submitted = true;
+
+    for (auto& recycler : recyclers)
+    {
+        recycler.join();
+    }
+
+    CHECK(available.Size() == NumSubmissions);
+    for (const auto& commandList : commandLists)
+    {
+        CHECK(commandList->NumResets == 1);
+    }
+    CHECK(fence.NumWaits == 0);
+}
@@ -0,0 +1,143 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/Mesh.h>
+#include <Engine/Renderer/InstanceBatcher.h>
+
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    struct TestDraw
+    {
+        u32 Primitive;
+        u32 MaterialKey;
+        u32 Lod;
+    };
+
+    // Draws of random primitives, like the visible draw calls of a scene where numPrimitives meshes are shared by many models.
+    std::vector<TestDraw> CreateDraws(size_t count, u32 numPrimitives, u32 numMaterials, u32 seed)
+    {
+        std::mt19937 random(seed);
+
+        std::vector<TestDraw> draws(count);
+        for (TestDraw& draw : draws)
+        {
+            draw.Primitive = random() % numPrimitives;
+            // The material belongs to the primitive, like in a mesh.
+            draw.MaterialKey = draw.Primitive % numMaterials;
+            draw.Lod = random() % MeshPrimitive::MaxLods;
+        }
+        return draws;
+    }
+
+    void AddDraws(InstanceBatcher& batcher, const std::vector<MeshPrimitive>& primitives, const std::vector<TestDraw>& draws)
+    {
+        batcher.Clear();
+        for (u32 i = 0; i < draws.size(); ++i)
+        {
+            batcher.Add(primitives[draws[i].Primitive], draws[i].MaterialKey, i, draws[i].Lod);
+        }
+        batcher.Build();
+    }
+}
+
+TEST(InstanceBatcherGroupsDrawsOfAPrimitiveAndLod)
+{
+    std::vector<MeshPrimitive> primitives(2);
+
+    InstanceBatcher batcher;
+    batcher.Clear();
+    batcher.Add(primitives[0], 0, 10);
+    batcher.Add(primitives[1], 0, 11);
+    batcher.Add(primitives[0], 0, 12);
+    batcher.Add(primitives[0], 0, 13, 1);
+    batcher.Add(primitives[1], 0, 14);
+    batcher.Build();
+
+    // The batches with the same key keep the order of their first draw, and the instances the order of the draws.
+    const auto& batches = batcher.GetBatches();
+    CHECK(batcher.GetNumDraws() == 3);
+    CHECK(batcher.GetNumInstances() == 5);
+    CHECK(batches[0].Primitive == &primitives[0] && batches[0].Lod == 0 && batches[0].FirstInstance == 0 && batches[0].NumInstances == 2);
+    CHECK(batches[1].Primitive == &primitives[1] && batches[1].Lod == 0 && batches[1].FirstInstance == 2 && batches[1].NumInstances == 2);
+    CHECK(batches[2].Primitive == &primitives[0] && batches[2].Lod == 1 && batches[2].FirstInstance == 4 && batches[2].NumInstances == 1);
+    CHECK(batcher.GetInstances() == std::vector<u32>({ 10, 12, 11, 14, 13 }));
+    CHECK_NEAR(batcher.GetBatchingRatio(), 5.0f / 3.0f, 1e-6f);
+
+    batcher.Clear();
+    batcher.Build();
+    CHECK(batcher.GetNumDraws() == 0);
+    CHECK(batcher.GetBatchingRatio() == 1.0f);
+}
+
+TEST(InstanceBatcherSortsByMaterialKey)
+{
+    std::vector<MeshPrimitive> primitives(64);
+    std::vector<TestDraw>      draws = CreateDraws(10000, static_cast<u32>(primitives.size()), 7, 1);
+
+    InstanceBatcher batcher;
+    AddDraws(batcher, primitives, draws);
+
+    const auto& batches = batcher.GetBatches();
+    const auto& instances = batcher.GetInstances();
+    CHECK(batcher.GetNumInstances() == draws.size());
+
+    std::vector<u32> numDraws(draws.size(), 0);
+    u32              firstInstance = 0;
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        const InstanceBatcher::Batch& batch = batches[i];
+        CHECK(i == 0 || batches[i - 1].MaterialKey <= batch.MaterialKey);
+        CHECK(batch.FirstInstance == firstInstance);
+        firstInstance += batch.NumInstances;
+
+        // Every instance of a batch is a draw of its primitive and level of detail, in the order they were added.
+        for (u32 j = batch.FirstInstance; j < batch.FirstInstance + batch.NumInstances; ++j)
+        {
+            const TestDraw& draw = draws[instances[j]];
+            CHECK(&primitives[draw.Primitive] == batch.Primitive && draw.Lod == batch.Lod && draw.MaterialKey == batch.MaterialKey);
+            CHECK(j == batch.FirstInstance || instances[j - 1] < instances[j]);
+            ++numDraws[instances[j]];
+        }
+    }
+    CHECK(std::all_of(numDraws.begin(), numDraws.end(), [](u32 count) { return count == 1; }));
+
+    // The order only depends on the keys and the order of the draws, so a second run gives the same batches.
+    std::vector<InstanceBatcher::Batch> firstBatches = batches;
+    std::vector<u32>                    firstInstances = instances;
+    AddDraws(batcher, primitives, draws);
+    CHECK(batcher.GetInstances() == firstInstances);
+    CHECK(batcher.GetNumDraws() == firstBatches.size());
+    for (size_t i = 0; i < firstBatches.size() && i < batches.size(); ++i)
+    {
+        CHECK(batches[i].Primitive == firstBatches[i].Primitive && batches[i].Lod == firstBatches[i].Lod);
+    }
+}
+
+BENCHMARK(InstanceBatcherBuild)
+{
+    constexpr u32 Iterations = 20;
+
+    // Few primitives shared by many draws batch well, as many primitives as draws don't batch at all.
+    for (u32 numPrimitives : { 100u, 10000u, 100000u })
+    {
+        constexpr size_t NumDraws = 100000;
+
+        std::vector<MeshPrimitive> primitives(numPrimitives);
+        std::vector<TestDraw>      draws = CreateDraws(NumDraws, numPrimitives, 96, 1);
+
+        InstanceBatcher batcher;
+        double          milliseconds = Tests::Measure(Iterations, [&]() {
+            AddDraws(batcher, primitives, draws);
+            Tests::Consume(batcher.GetNumDraws());
+        });
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "%zuK draws of %u primitives", NumDraws / 1000, numPrimitives);
+        Tests::Report(label, milliseconds, NumDraws);
+        std::printf("  %-40s %10u draws %10.2f instances per draw\n", "Batches", batcher.GetNumDraws(), batcher.GetBatchingRatio());
+    }
+}
@@ -0,0 +1,206 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/JobSystem.h>
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+    // A few hundred nanoseconds of work per element.
+    float Work(u32 index)
+    {
+        float value = static_cast<float>(index);
+        for (u32 i = 0; i < 32; ++i)
+        {
+            value = std::sqrt(value + static_cast<float>(i));
+        }
+        return value;
+    }
+}
+
+TEST(JobSystemParallelForVisitsEveryIndexOnce)
+{
+    JobSystem jobSystem(4);
+
+    struct Range
+    {
+        u32 Begin;
+        u32 End;
+        u32 GrainSize;
+    };
+    for (const Range& range : { Range{ 0, 0, 1 }, Range{ 5, 6, 1 }, Range{ 0, 7, 1 }, Range{ 3, 1000, 16 },
+             Range{ 0, 100000, 1 }, Range{ 0, 100000, 0 }, Range{ 100, 50000, 100000 } })
+    {
+        std::vector<std::atomic<u32>> visits(range.End);
+        std::atomic<u32>              numEmptyRanges{ 0 };
+        jobSystem.ParallelFor(range.Begin, range.End, range.GrainSize, [&](u32 begin, u32 end) {
+            numEmptyRanges.fetch_add(begin < end ? 0 : 1);
+            for (u32 i = begin; i < end; ++i)
+            {
+                visits[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        CHECK(numEmptyRanges.load() == 0);
+
+        for (u32 i = 0; i < range.End; ++i)
+        {
+            CHECK(visits[i].load() == (i >= range.Begin ? 1u : 0u));
+        }
+    }
+}
+
+TEST(JobSystemRunsDependentJobsAfterTheirDependency)
+{
+    JobSystem jobSystem(4);
+
+    for (u32 repeat = 0; repeat < 100; ++repeat)
+    {
+        JobCounter       first;
+        JobCounter       second;
+        std::atomic<u32> numFirstDone{ 0 };
+        std::atomic<u32> numSecondDone{ 0 };
+        std::atomic<u32> numOutOfOrder{ 0 };
+
+        for (u32 i = 0; i < 64; ++i)
+        {
+            jobSystem.Schedule([&]() { numFirstDone.fetch_add(1); }, &first);
+        }
+
+        // Scheduled before the first jobs finish (usually), so most are queued as continuations.
+        for (u32 i = 0; i < 16; ++i)
+        {
+            jobSystem.Schedule([&]() {
+                numOutOfOrder.fetch_add(numFirstDone.load() != 64 ? 1 : 0);
+                numSecondDone.fetch_add(1);
+            }, &second, &first);
+        }
+
+        jobSystem.Wait(second);
+        CHECK(first.IsDone());
+        CHECK(numFirstDone.load() == 64);
+        CHECK(numSecondDone.load() == 16);
+        CHECK(numOutOfOrder.load() == 0);
+    }
+
+    // A dependency that is already done doesn't hold the job back.
+    JobCounter done;
+    JobCounter counter;
+    bool       ran = false;
+    jobSystem.Schedule([&]() { ran = true; }, &counter, &done);
+    jobSystem.Wait(counter);
+    CHECK(ran);
+}
+
+TEST(JobSystemNestedJobs)
+{
+    JobSystem        jobSystem(3);
+    JobCounter       counter;
+    std::atomic<u32> numLeaves{ 0 };
+    std::atomic<u64> sum{ 0 };
+
+    // Jobs that schedule and wait for jobs of their own, and ParallelFor inside jobs. The waits run
+    // pending jobs, so this finishes even when every worker is blocked in a Wait.
+    for (u32 i = 0; i < 32; ++i)
+    {
+        jobSystem.Schedule([&]() {
+            JobCounter children;
+            for (u32 j = 0; j < 8; ++j)
+            {
+                jobSystem.Schedule([&]() { numLeaves.fetch_add(1); }, &children);
+            }
+
+            jobSystem.ParallelFor(0, 1000, 10, [&](u32 begin, u32 end) {
+                u64 rangeSum = 0;
+                for (u32 k = begin; k < end; ++k)
+                {
+                    rangeSum += k;
+                }
+                sum.fetch_add(rangeSum);
+            });
+
+            jobSystem.Wait(children);
+        }, &counter);
+    }
+
+    jobSystem.Wait(counter);
+    CHECK(numLeaves.load() == 32 * 8);
+    CHECK(sum.load() == 32ull * (999 * 1000 / 2));
+}
+
+BENCHMARK(JobSystemVersusThreads)
+{
+    constexpr u32 NumElements = 1 << 20;
+    constexpr u32 Iterations = 10;
+
+    JobSystem          jobSystem;
+    const u32          numThreads = jobSystem.GetNumWorkers() + 1;
+    std::vector<float> results(NumElements);
+
+    Tests::Report("Serial", Tests::Measure(Iterations, [&]() {
+        for (u32 i = 0; i < NumElements; ++i)
+        {
+            results[i] = Work(i);
+        }
+    }), NumElements);
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "std::thread fan-out (%u threads)", numThreads);
+    Tests::Report(label, Tests::Measure(Iterations, [&]() {
+        std::vector<std::thread> threads;
+        for (u32 t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                u32 end = static_cast<u32>(static_cast<u64>(NumElements) * (t + 1) / numThreads);
+                for (u32 i = static_cast<u32>(static_cast<u64>(NumElements) * t / numThreads); i < end; ++i)
+                {
+                    results[i] = Work(i);
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }), NumElements);
+
+    std::snprintf(label, sizeof(label), "ParallelFor (%u workers)", jobSystem.GetNumWorkers());
+    Tests::Report(label, Tests::Measure(Iterations, [&]() {
+        jobSystem.ParallelFor(0, NumElements, 1024, [&](u32 begin, u32 end) {
+            for (u32 i = begin; i < end; ++i)
+            {
+                results[i] = Work(i);
+            }
+        });
+    }), NumElements);
+
+    // Small jobs, where starting a thread per batch costs more than the work.
+    constexpr u32 NumSmallJobs = 10000;
+    Tests::Report("std::thread per 64 small jobs", Tests::Measure(1, [&]() {
+        for (u32 batch = 0; batch < NumSmallJobs; batch += 64)
+        {
+            std::thread thread([&, batch]() {
+                for (u32 i = batch; i < batch + 64; ++i)
+                {
+                    results[i] = Work(i);
+                }
+            });
+            thread.join();
+        }
+    }), NumSmallJobs);
+
+    Tests::Report("Schedule small jobs", Tests::Measure(Iterations, [&]() {
+        JobCounter counter;
+        for (u32 i = 0; i < NumSmallJobs; ++i)
+        {
+            jobSystem.Schedule([&results, i]() { results[i] = Work(i); }, &counter);
+        }
+        jobSystem.Wait(counter);
+    }), NumSmallJobs);
+
+    Tests::Consume(static_cast<u64>(results[NumElements / 2]));
+}
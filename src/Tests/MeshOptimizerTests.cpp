@@ -0,0 +1,176 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <Engine/Core/MeshOptimizer.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    using Vertex = MeshOptimizer::Vertex;
+
+    // The triangles as sorted keys, each rotated to start at its smallest index so the winding is kept.
+    std::vector<u64> GetTriangleKeys(std::vector<u32>::const_iterator begin, std::vector<u32>::const_iterator end)
+    {
+        std::vector<u64> keys;
+        for (auto it = begin; it != end; it += 3)
+        {
+            u32 triangle[3] = { it[0], it[1], it[2] };
+            std::rotate(triangle, std::min_element(triangle, triangle + 3), triangle + 3);
+            keys.push_back((static_cast<u64>(triangle[0]) << 42) | (static_cast<u64>(triangle[1]) << 21) | triangle[2]);
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+
+    std::vector<u64> GetTriangleKeys(const std::vector<u32>& indices)
+    {
+        return GetTriangleKeys(indices.begin(), indices.end());
+    }
+}
+
+TEST(MeshOptimizerAnalyzeVertexCache)
+{
+    // Two triangles that share an edge transform four vertices.
+    MeshOptimizer::CacheStatistics quad = MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2, 0, 2, 3 }, 4);
+    CHECK(quad.NumTriangles == 2 && quad.NumVertices == 4 && quad.NumTransformed == 4);
+    CHECK_NEAR(quad.GetAcmr(), 2.0f, 1e-6f);
+    CHECK_NEAR(quad.GetAtvr(), 1.0f, 1e-6f);
+
+    // A FIFO of three vertices has evicted the first triangle when it is drawn again.
+    MeshOptimizer::CacheStatistics evicted = MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2, 3, 4, 5, 0, 1, 2 }, 6, 3);
+    CHECK(evicted.NumTriangles == 3 && evicted.NumVertices == 6 && evicted.NumTransformed == 9);
+    CHECK_NEAR(evicted.GetAtvr(), 1.5f, 1e-6f);
+
+    // A larger one still has it.
+    CHECK(MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2, 3, 4, 5, 0, 1, 2 }, 6, 6).NumTransformed == 6);
+}
+
+TEST(MeshOptimizerTipsifyImprovesCacheUse)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    grid;
+    Tests::CreateGrid(100, vertices, grid);
+
+    MeshOptimizer optimizer;
+    for (const std::vector<u32>& indices : { grid, Tests::ShuffleTriangles(grid, 1) })
+    {
+        MeshOptimizer::CacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+        std::vector<u32> optimized = indices;
+        optimizer.OptimizeVertexCache(optimized.data(), optimized.size());
+        MeshOptimizer::CacheStatistics after = MeshOptimizer::AnalyzeVertexCache(optimized, vertices.size());
+
+        // The rows transform every vertex about twice (ACMR 1), a random order almost every vertex of every triangle
+        // (ACMR 3). Tipsify gets close to the 0.5 of a regular grid.
+        CHECK(after.NumTriangles == before.NumTriangles && after.NumVertices == before.NumVertices);
+        CHECK(before.GetAcmr() >= 0.95f);
+        CHECK(after.GetAcmr() < 0.7f);
+        CHECK(after.GetAtvr() < 1.4f);
+        CHECK(after.GetAtvr() < before.GetAtvr());
+
+        // The triangles are the same, with the same winding, only in a different order.
+        CHECK(GetTriangleKeys(optimized) == GetTriangleKeys(indices));
+    }
+}
+
+TEST(MeshOptimizerOptimizesRanges)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    grid;
+    Tests::CreateGrid(50, vertices, grid);
+    std::vector<u32> indices = Tests::ShuffleTriangles(grid, 2);
+
+    // Ranges like the clusters of a primitive are optimized on their own, so no triangle moves to another range.
+    constexpr size_t RangeSize = 124 * 3;
+
+    MeshOptimizer    optimizer;
+    std::vector<u32> optimized = indices;
+    for (size_t begin = 0; begin < optimized.size(); begin += RangeSize)
+    {
+        optimizer.OptimizeVertexCache(optimized.data() + begin, std::min(RangeSize, optimized.size() - begin));
+    }
+
+    for (size_t begin = 0; begin < optimized.size(); begin += RangeSize)
+    {
+        size_t end = std::min(begin + RangeSize, optimized.size());
+        CHECK(GetTriangleKeys(optimized.begin() + begin, optimized.begin() + end) == GetTriangleKeys(indices.begin() + begin, indices.begin() + end));
+    }
+    CHECK(MeshOptimizer::AnalyzeVertexCache(optimized, vertices.size()).GetAcmr() < MeshOptimizer::AnalyzeVertexCache(indices, vertices.size()).GetAcmr());
+}
+
+TEST(MeshOptimizerOptimizeVertexFetch)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    grid;
+    Tests::CreateGrid(20, vertices, grid);
+
+    // Drop the last row of triangles, so the vertices of the last row are unused.
+    grid.resize(grid.size() - 20 * 6);
+    std::vector<u32> indices = Tests::ShuffleTriangles(grid, 3);
+    std::vector<u32> lod(indices.begin(), indices.begin() + indices.size() / 2);
+
+    std::vector<Vertex> optimizedVertices = vertices;
+    std::vector<u32>    optimizedIndices = indices;
+    std::vector<u32>    optimizedLod = lod;
+
+    MeshOptimizer optimizer;
+    size_t        numVertices = optimizer.OptimizeVertexFetch(optimizedVertices, { &optimizedIndices, &optimizedLod });
+    CHECK(numVertices == 20 * 21);
+    CHECK(optimizedVertices.size() == numVertices);
+
+    // Every index refers to the same vertex as before.
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        CHECK(std::memcmp(&optimizedVertices[optimizedIndices[i]], &vertices[indices[i]], sizeof(Vertex)) == 0);
+    }
+    for (size_t i = 0; i < lod.size(); ++i)
+    {
+        CHECK(std::memcmp(&optimizedVertices[optimizedLod[i]], &vertices[lod[i]], sizeof(Vertex)) == 0);
+    }
+
+    // The vertices are in the order the first list uses them.
+    u32 nextVertex = 0;
+    for (u32 index : optimizedIndices)
+    {
+        CHECK(index <= nextVertex);
+        nextVertex = std::max(nextVertex, index + 1);
+    }
+}
+
+BENCHMARK(MeshOptimizerTipsify)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    grid;
+    Tests::CreateGrid(400, vertices, grid);
+    const size_t numTriangles = grid.size() / 3;
+
+    MeshOptimizer optimizer;
+    char          label[64];
+    for (bool shuffled : { false, true })
+    {
+        const std::vector<u32>         indices = shuffled ? Tests::ShuffleTriangles(grid, 1) : grid;
+        MeshOptimizer::CacheStatistics before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+        std::vector<u32> optimized;
+        std::snprintf(label, sizeof(label), "Tipsify %zuK triangles%s", numTriangles / 1000, shuffled ? " (shuffled)" : "");
+        Tests::Report(label, Tests::Measure(3, [&]() {
+            optimized = indices;
+            optimizer.OptimizeVertexCache(optimized.data(), optimized.size());
+        }), numTriangles);
+
+        MeshOptimizer::CacheStatistics after = MeshOptimizer::AnalyzeVertexCache(optimized, vertices.size());
+        std::printf("  %-40s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", "Cache", before.GetAcmr(), after.GetAcmr(), before.GetAtvr(), after.GetAtvr());
+    }
+
+    std::vector<Vertex> optimizedVertices;
+    std::vector<u32>    optimizedIndices;
+    Tests::Report("OptimizeVertexFetch", Tests::Measure(3, [&]() {
+        optimizedVertices = vertices;
+        optimizedIndices = grid;
+        Tests::Consume(optimizer.OptimizeVertexFetch(optimizedVertices, { &optimizedIndices }));
+    }), vertices.size());
+}
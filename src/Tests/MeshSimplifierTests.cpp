@@ -0,0 +1,233 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <Engine/Core/MeshSimplifier.h>
+
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+    using Vertex = MeshSimplifier::Vertex;
+
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    XMFLOAT3 Lerp(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+    {
+        return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t };
+    }
+
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        XMFLOAT3 d = Subtract(a, b);
+        return std::sqrt(Dot(d, d));
+    }
+
+    // The distance of p from the triangle abc (Ericson, Real-Time Collision Detection 5.1.5).
+    float DistanceToTriangle(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+    {
+        XMFLOAT3 ab = Subtract(b, a);
+        XMFLOAT3 ac = Subtract(c, a);
+
+        XMFLOAT3 ap = Subtract(p, a);
+        float    d1 = Dot(ab, ap);
+        float    d2 = Dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            return Distance(p, a);
+        }
+
+        XMFLOAT3 bp = Subtract(p, b);
+        float    d3 = Dot(ab, bp);
+        float    d4 = Dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            return Distance(p, b);
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            return Distance(p, Lerp(a, b, d1 / (d1 - d3)));
+        }
+
+        XMFLOAT3 cp = Subtract(p, c);
+        float    d5 = Dot(ab, cp);
+        float    d6 = Dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+        {
+            return Distance(p, c);
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            return Distance(p, Lerp(a, c, d2 / (d2 - d6)));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            return Distance(p, Lerp(b, c, (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        float v = vb * denominator;
+        float w = vc * denominator;
+        return Distance(p, { a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w });
+    }
+
+    // The largest distance of (a sample of) the original vertices from the simplified surface.
+    float MeasureDistance(const std::vector<Vertex>& vertices, const std::vector<u32>& simplified)
+    {
+        const size_t step = std::max<size_t>(1, vertices.size() / 1000);
+
+        float maxDistance = 0.0f;
+        for (size_t i = 0; i < vertices.size(); i += step)
+        {
+            float distance = FLT_MAX;
+            for (size_t j = 0; j < simplified.size(); j += 3)
+            {
+                distance = std::min(distance, DistanceToTriangle(vertices[i].Position, vertices[simplified[j]].Position,
+                    vertices[simplified[j + 1]].Position, vertices[simplified[j + 2]].Position));
+            }
+            maxDistance = std::max(maxDistance, distance);
+        }
+        return maxDistance;
+    }
+
+    bool HasDegenerateTriangles(const std::vector<u32>& indices)
+    {
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            if (indices[i] == indices[i + 1] || indices[i] == indices[i + 2] || indices[i + 1] == indices[i + 2])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+TEST(MeshSimplifierReachesTargetRatio)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(64, 32, vertices, indices);
+
+    MeshSimplifier simplifier;
+    float          previousError = 0.0f;
+    for (float ratio : { 0.5f, 0.25f, 0.1f })
+    {
+        const size_t targetIndexCount = static_cast<size_t>(indices.size() * ratio) / 3 * 3;
+
+        std::vector<u32> simplified;
+        float            error = simplifier.Simplify(vertices, indices, targetIndexCount, 1.0f, simplified);
+
+        // The sphere is closed and smooth, so the simplifier reaches the target rather than stopping short of it.
+        CHECK(simplified.size() % 3 == 0);
+        CHECK(simplified.size() <= targetIndexCount);
+        CHECK(simplified.size() >= targetIndexCount * 9 / 10);
+        CHECK(!HasDegenerateTriangles(simplified));
+        CHECK(std::all_of(simplified.begin(), simplified.end(), [&](u32 index) { return index < vertices.size(); }));
+
+        // Removing more triangles costs more.
+        CHECK(error >= previousError);
+        previousError = error;
+    }
+}
+
+TEST(MeshSimplifierRespectsErrorBound)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(64, 32, vertices, indices);
+
+    MeshSimplifier simplifier;
+    for (float maxError : { 0.005f, 0.01f, 0.05f })
+    {
+        // No target, so the simplifier stops at the first collapse that exceeds the bound.
+        std::vector<u32> simplified;
+        float            error = simplifier.Simplify(vertices, indices, 0, maxError, simplified);
+
+        CHECK(error <= maxError);
+        CHECK(simplified.size() < indices.size());
+        // The error estimates the distance of the simplified surface from the original, so it is measured as well.
+        CHECK(MeasureDistance(vertices, simplified) <= 2.0f * maxError);
+    }
+}
+
+TEST(MeshSimplifierKeepsBorders)
+{
+    constexpr u32 Size = 100;
+
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateGrid(Size, vertices, indices, 0.05f);
+
+    MeshSimplifier   simplifier;
+    std::vector<u32> simplified;
+    float            error = simplifier.Simplify(vertices, indices, indices.size() / 8 / 3 * 3, 1.0f, simplified);
+    CHECK(simplified.size() <= indices.size() / 8);
+    CHECK(MeasureDistance(vertices, simplified) <= 2.0f * error);
+
+    // The border vertices only collapse along the border, so the square keeps its extent.
+    XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+    XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (u32 index : simplified)
+    {
+        const XMFLOAT3& position = vertices[index].Position;
+        min = { std::min(min.x, position.x), std::min(min.y, position.y), std::min(min.z, position.z) };
+        max = { std::max(max.x, position.x), std::max(max.y, position.y), std::max(max.z, position.z) };
+    }
+    CHECK(min.x == 0.0f && max.x == 1.0f);
+    CHECK(min.z == 0.0f && max.z == 1.0f);
+}
+
+BENCHMARK(MeshSimplifierSponzaScale)
+{
+    // Sponza has about 262K triangles. A single mesh of that size with some noise, so the collapses have different costs.
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(512, 256, vertices, indices, 0.02f);
+    const size_t numTriangles = indices.size() / 3;
+
+    MeshSimplifier   simplifier;
+    std::vector<u32> simplified;
+    float            error = 0.0f;
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "Simplify %zuK triangles to 50%%", numTriangles / 1000);
+    Tests::Report(label, Tests::Measure(3, [&]() {
+        error = simplifier.Simplify(vertices, indices, indices.size() / 2 / 3 * 3, 1.0f, simplified);
+    }), numTriangles);
+    std::printf("  %-40s %10zu triangles %10.4f error\n", "Result", simplified.size() / 3, error);
+
+    // A chain of levels of detail like the importer generates, each half of the one before.
+    constexpr u32    NumLods = 4;
+    std::vector<u32> lods[NumLods];
+    Tests::Report("Level of detail chain", Tests::Measure(3, [&]() {
+        const std::vector<u32>* previous = &indices;
+        for (u32 lod = 1; lod < NumLods; ++lod)
+        {
+            simplifier.Simplify(vertices, *previous, previous->size() / 2 / 3 * 3, 1.0f, lods[lod]);
+            previous = &lods[lod];
+        }
+    }), numTriangles);
+    for (u32 lod = 1; lod < NumLods; ++lod)
+    {
+        std::snprintf(label, sizeof(label), "LOD %u", lod);
+        std::printf("  %-40s %10zu triangles\n", label, lods[lod].size() / 3);
+    }
+}
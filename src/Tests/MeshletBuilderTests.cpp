@@ -0,0 +1,174 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <Engine/Core/MeshletBuilder.h>
+
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    using Vertex = MeshletBuilder::Vertex;
+
+    // The triangles as sorted keys, each rotated to start at its smallest index so the winding is kept.
+    std::vector<u64> GetTriangleKeys(const std::vector<u32>& indices)
+    {
+        std::vector<u64> keys;
+        keys.reserve(indices.size() / 3);
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            u32 triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(triangle, std::min_element(triangle, triangle + 3), triangle + 3);
+            keys.push_back((static_cast<u64>(triangle[0]) << 42) | (static_cast<u64>(triangle[1]) << 21) | triangle[2]);
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+
+    XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+}
+
+TEST(MeshletBuilderPreservesTriangles)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(64, 32, vertices, indices);
+
+    MeshletBuilder builder;
+    for (const std::vector<u32>& input : { indices, Tests::ShuffleTriangles(indices, 1) })
+    {
+        u32 numMeshlets = builder.Build(vertices, input);
+        CHECK(numMeshlets == builder.GetMeshlets().size());
+        CHECK(numMeshlets == builder.GetBounds().size());
+        CHECK(numMeshlets >= input.size() / 3 / MeshletBuilder::MaxTriangles);
+
+        // The meshlets are consecutive and within the limits.
+        u32 vertexOffset = 0;
+        u32 triangleOffset = 0;
+        for (const MeshletBuilder::Meshlet& meshlet : builder.GetMeshlets())
+        {
+            CHECK(meshlet.VertexOffset == vertexOffset && meshlet.TriangleOffset == triangleOffset);
+            CHECK(meshlet.VertexCount > 0 && meshlet.VertexCount <= MeshletBuilder::MaxVertices);
+            CHECK(meshlet.TriangleCount > 0 && meshlet.TriangleCount <= MeshletBuilder::MaxTriangles);
+            vertexOffset += meshlet.VertexCount;
+            triangleOffset += meshlet.TriangleCount;
+
+            for (u32 i = meshlet.TriangleOffset * 3; i < (meshlet.TriangleOffset + meshlet.TriangleCount) * 3; ++i)
+            {
+                CHECK(builder.GetTriangles()[i] < meshlet.VertexCount);
+            }
+        }
+        CHECK(vertexOffset == builder.GetVertices().size());
+        CHECK(triangleOffset * 3 == builder.GetTriangles().size());
+
+        // Every triangle is in exactly one meshlet, with its winding.
+        std::vector<u32> meshletIndices;
+        builder.GetIndices(meshletIndices);
+        CHECK(GetTriangleKeys(meshletIndices) == GetTriangleKeys(input));
+    }
+}
+
+TEST(MeshletBuilderBoundsAreConservative)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(64, 32, vertices, indices);
+
+    MeshletBuilder builder;
+    builder.Build(vertices, indices);
+
+    std::vector<u32> meshletIndices;
+    builder.GetIndices(meshletIndices);
+
+    std::mt19937                          random(1);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+
+    u32 numCones = 0;
+    u32 numCulled = 0;
+    for (size_t i = 0; i < builder.GetMeshlets().size(); ++i)
+    {
+        const MeshletBuilder::Meshlet& meshlet = builder.GetMeshlets()[i];
+        const MeshletBuilder::Bounds&  bounds = builder.GetBounds()[i];
+
+        // The sphere encloses the vertices.
+        for (u32 j = 0; j < meshlet.VertexCount; ++j)
+        {
+            XMFLOAT3 offset = Subtract(vertices[builder.GetVertices()[meshlet.VertexOffset + j]].Position, bounds.Center);
+            CHECK(std::sqrt(Dot(offset, offset)) <= bounds.Radius * 1.0001f + 1e-6f);
+        }
+
+        if (bounds.ConeCutoff >= 1.0f)
+        {
+            continue;
+        }
+        ++numCones;
+
+        // A camera that the cone culls sees none of the triangles of the meshlet from the front.
+        for (u32 j = 0; j < 100; ++j)
+        {
+            XMFLOAT3 eye = { position(random), position(random), position(random) };
+            XMFLOAT3 direction = Subtract(bounds.ConeApex, eye);
+            float    distance = std::sqrt(Dot(direction, direction));
+            if (distance == 0.0f || Dot(direction, bounds.ConeAxis) < bounds.ConeCutoff * distance)
+            {
+                continue;
+            }
+            ++numCulled;
+
+            for (u32 k = meshlet.TriangleOffset * 3; k < (meshlet.TriangleOffset + meshlet.TriangleCount) * 3; k += 3)
+            {
+                const XMFLOAT3& p0 = vertices[meshletIndices[k]].Position;
+                XMFLOAT3        normal = Cross(Subtract(vertices[meshletIndices[k + 1]].Position, p0), Subtract(vertices[meshletIndices[k + 2]].Position, p0));
+                CHECK(Dot(Subtract(eye, p0), normal) <= 1e-6f);
+            }
+        }
+    }
+
+    // The sphere is smooth, so most meshlets have a cone, and a fair part of the cameras cull them.
+    CHECK(numCones * 2 > builder.GetMeshlets().size());
+    CHECK(numCulled > 0);
+}
+
+BENCHMARK(MeshletBuilderThroughput)
+{
+    std::vector<Vertex> vertices;
+    std::vector<u32>    indices;
+    Tests::CreateSphere(720, 360, vertices, indices);
+    const size_t numTriangles = indices.size() / 3;
+
+    MeshletBuilder builder;
+    char           label[64];
+    for (bool shuffled : { false, true })
+    {
+        std::vector<u32> input = shuffled ? Tests::ShuffleTriangles(indices, 1) : indices;
+        u32              numMeshlets = 0;
+
+        std::snprintf(label, sizeof(label), "Build %zuK triangles%s", numTriangles / 1000, shuffled ? " (shuffled)" : "");
+        Tests::Report(label, Tests::Measure(3, [&]() { numMeshlets = builder.Build(vertices, input); }), numTriangles);
+
+        u32 numCones = 0;
+        for (const MeshletBuilder::Bounds& bounds : builder.GetBounds())
+        {
+            numCones += bounds.ConeCutoff < 1.0f ? 1 : 0;
+        }
+        std::printf("  %-40s %10u meshlets %10.1f triangles, %.1f vertices each, %u cones\n", "Meshlets", numMeshlets,
+            static_cast<double>(numTriangles) / numMeshlets, static_cast<double>(builder.GetVertices().size()) / numMeshlets, numCones);
+    }
+}
@@ -0,0 +1,84 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <Engine/Pipeline/PipelineStateCache.h>
+
+#include <cstdio>
+#include <string>
+
+BENCHMARK(PipelineStateCacheColdAndWarmStart)
+{
+    constexpr u32 NumPipelines = 64;
+
+    Device&  device = Tests::GetWarpDevice();
+    fs::path path = fs::temp_directory_path() / "EngineTests" / "PipelineStateCacheBenchmark.bin";
+
+    std::error_code error;
+    fs::remove(path, error);
+
+    // Compute shaders that only differ in a constant, so every pipeline has a key of its own. They share the root
+    // signature of WriteValueState.
+    auto writeValueState = Tests::CreateWriteValueState(device);
+
+    std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> shaders;
+    for (u32 i = 0; i < NumPipelines; ++i)
+    {
+        std::string source = "cbuffer ValueCB : register(b0) { uint Value; };\n"
+                             "RWStructuredBuffer<uint> Result : register(u0);\n"
+                             "[numthreads(1, 1, 1)] void CSMain() { Result[0] = Value + " +
+                             std::to_string(i) + "; }\n";
+        shaders.push_back(Tests::CompileShader(source.c_str(), "CSMain", "cs_5_1"));
+    }
+
+    struct PipelineStateStream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+        CD3DX12_PIPELINE_STATE_STREAM_CS             CS;
+    };
+
+    std::vector<PipelineStateStream> streams(NumPipelines);
+    for (u32 i = 0; i < NumPipelines; ++i)
+    {
+        streams[i].pRootSignature = writeValueState.m_RootSignature->GetD3D12RootSignature().Get();
+        streams[i].CS = CD3DX12_SHADER_BYTECODE(shaders[i].Get());
+    }
+
+    auto createPipelines = [&](const char* label, PipelineStateCache& cache) {
+        Tests::Report(label, Tests::Measure(1, [&]() {
+            for (auto& stream : streams)
+            {
+                D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(PipelineStateStream), &stream };
+                Tests::Consume(cache.GetOrCreate(desc) ? 1 : 0);
+            }
+        }), NumPipelines);
+    };
+
+    // Without a cache file every pipeline is compiled. The library is written when the cache is destroyed.
+    {
+        PipelineStateCache cache(device, path);
+        createPipelines("Cold start (compiled)", cache);
+
+        CHECK(cache.GetStatistics().NumCompiled == NumPipelines);
+    }
+
+    // The next run loads them from the library instead, unless the device doesn't support pipeline libraries.
+    {
+        PipelineStateCache cache(device, path);
+        createPipelines("Warm start (pipeline library)", cache);
+        createPipelines("Warm start (in memory)", cache);
+
+        PipelineStateCache::Statistics statistics = cache.GetStatistics();
+        std::printf("  %-40s %10.3f ms\n", "Loading the cache file", statistics.LoadMilliseconds);
+        if (statistics.NumLibraryHits == 0)
+        {
+            std::printf("  Pipeline libraries are not supported, the warm start compiled the pipelines again.\n");
+        }
+
+        CHECK(statistics.NumLibraryHits + statistics.NumCompiled == NumPipelines);
+        CHECK(statistics.NumMemoryHits == NumPipelines);
+    }
+
+    fs::remove(path, error);
+}
@@ -0,0 +1,257 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Renderer/RenderGraph.h>
+
+#include <string>
+
+namespace
+{
+    constexpr u64 PlacementAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    constexpr size_t NumElements = 1024;
+    constexpr size_t ElementSize = 4;
+
+    // Every resource takes whole 64 KB pages, like the placed resources on the device. Textures have 4 bytes per texel.
+    D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(const D3D12_RESOURCE_DESC& desc)
+    {
+        u64 bytesPerElement = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? 1 : 4;
+        u64 size = desc.Width * desc.Height * desc.DepthOrArraySize * bytesPerElement;
+        return { (size + PlacementAlignment - 1) & ~(PlacementAlignment - 1), PlacementAlignment };
+    }
+
+    void NoCommands(CommandList&, const RenderGraph&) {}
+}
+
+TEST(RenderGraphCullsUnusedPasses)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto unused = graph.CreateBuffer("Unused", NumElements, ElementSize);
+    auto produced = graph.CreateBuffer("Produced", NumElements, ElementSize);
+    auto chainA = graph.CreateBuffer("ChainA", NumElements, ElementSize);
+    auto chainB = graph.CreateBuffer("ChainB", NumElements, ElementSize);
+
+    graph.AddPass("WritesUnused", [&](RenderGraphBuilder& builder) {
+        builder.Write(unused, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("Producer", [&](RenderGraphBuilder& builder) {
+        builder.Write(produced, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ChainFirst", [&](RenderGraphBuilder& builder) {
+        builder.Write(chainA, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ChainSecond", [&](RenderGraphBuilder& builder) {
+        builder.Read(chainA, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(chainB, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("Consumer", [&](RenderGraphBuilder& builder) {
+        builder.Read(produced, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    CHECK(graph.IsPassCulled("WritesUnused"));
+    CHECK(!graph.IsPassCulled("Producer"));
+    // A pass whose outputs are only read by culled passes is culled too.
+    CHECK(graph.IsPassCulled("ChainFirst"));
+    CHECK(graph.IsPassCulled("ChainSecond"));
+    CHECK(!graph.IsPassCulled("Consumer"));
+    CHECK(graph.GetMemoryStatistics().NumPasses == 5);
+    CHECK(graph.GetMemoryStatistics().NumCulledPasses == 3);
+    CHECK(graph.GetMemoryStatistics().NumTransientResources == 1);
+}
+
+TEST(RenderGraphCullsOverwrittenPasses)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto copied = graph.CreateBuffer("Copied", NumElements, ElementSize);
+    auto accumulated = graph.CreateBuffer("Accumulated", NumElements, ElementSize);
+
+    // A full write (COPY_DEST) replaces the contents, a UAV write may be partial.
+    graph.AddPass("FirstCopy", [&](RenderGraphBuilder& builder) {
+        builder.Write(copied, D3D12_RESOURCE_STATE_COPY_DEST);
+    }, NoCommands);
+    graph.AddPass("SecondCopy", [&](RenderGraphBuilder& builder) {
+        builder.Write(copied, D3D12_RESOURCE_STATE_COPY_DEST);
+    }, NoCommands);
+    graph.AddPass("FirstAccumulate", [&](RenderGraphBuilder& builder) {
+        builder.Write(accumulated, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("SecondAccumulate", [&](RenderGraphBuilder& builder) {
+        builder.Write(accumulated, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("Consumer", [&](RenderGraphBuilder& builder) {
+        builder.Read(copied, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        builder.Read(accumulated, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    CHECK(graph.IsPassCulled("FirstCopy"));
+    CHECK(!graph.IsPassCulled("SecondCopy"));
+    CHECK(!graph.IsPassCulled("FirstAccumulate"));
+    CHECK(!graph.IsPassCulled("SecondAccumulate"));
+}
+
+TEST(RenderGraphLifetimes)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto a = graph.CreateBuffer("A", NumElements, ElementSize);
+    auto b = graph.CreateBuffer("B", NumElements, ElementSize);
+    auto c = graph.CreateBuffer("C", NumElements, ElementSize);
+    auto unused = graph.CreateBuffer("Unused", NumElements, ElementSize);
+
+    graph.AddPass("WriteA", [&](RenderGraphBuilder& builder) {
+        builder.Write(a, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadAWriteB", [&](RenderGraphBuilder& builder) {
+        builder.Read(a, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(b, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    // Culled, so it doesn't extend the lifetime of B.
+    graph.AddPass("ReadBWriteUnused", [&](RenderGraphBuilder& builder) {
+        builder.Read(b, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(unused, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadBWriteC", [&](RenderGraphBuilder& builder) {
+        builder.Read(b, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(c, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadC", [&](RenderGraphBuilder& builder) {
+        builder.Read(c, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    CHECK(graph.IsPassCulled("ReadBWriteUnused"));
+    CHECK(graph.GetFirstPass(a) == 0 && graph.GetLastPass(a) == 1);
+    CHECK(graph.GetFirstPass(b) == 1 && graph.GetLastPass(b) == 3);
+    CHECK(graph.GetFirstPass(c) == 3 && graph.GetLastPass(c) == 4);
+    CHECK(graph.GetFirstPass(unused) == ~0u && graph.GetLastPass(unused) == ~0u);
+}
+
+TEST(RenderGraphAliasesDisjointLifetimes)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto a = graph.CreateBuffer("A", NumElements, ElementSize);
+    auto b = graph.CreateBuffer("B", NumElements, ElementSize);
+    auto c = graph.CreateBuffer("C", NumElements, ElementSize);
+
+    graph.AddPass("WriteA", [&](RenderGraphBuilder& builder) {
+        builder.Write(a, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadAWriteB", [&](RenderGraphBuilder& builder) {
+        builder.Read(a, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(b, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadBWriteC", [&](RenderGraphBuilder& builder) {
+        builder.Read(b, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.Write(c, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("ReadC", [&](RenderGraphBuilder& builder) {
+        builder.Read(c, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    // A and C are never alive at the same time, B overlaps both.
+    CHECK(graph.GetHeapOffset(a) == graph.GetHeapOffset(c));
+    CHECK(graph.GetHeapOffset(b) != graph.GetHeapOffset(a));
+    CHECK(graph.IsAliased(a) && graph.IsAliased(c));
+    CHECK(!graph.IsAliased(b));
+
+    const auto& statistics = graph.GetMemoryStatistics();
+    CHECK(statistics.NumTransientResources == 3);
+    CHECK(statistics.NumAliasedResources == 2);
+    CHECK(statistics.TransientBytes == 3 * PlacementAlignment);
+    CHECK(statistics.HeapBytes == 2 * PlacementAlignment);
+    CHECK(statistics.GetSavedBytes() == PlacementAlignment);
+}
+
+TEST(RenderGraphAliasesTheRenderTargetsOfAPostProcessingChain)
+{
+    // Full screen render targets that each live for two passes of a post processing chain.
+    constexpr u32 Width = 1920;
+    constexpr u32 Height = 1080;
+    constexpr u32 NumTargets = 4;
+    auto targetDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, Width, Height, 1, 1, 1, 0,
+        D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+    RenderGraph graph(&GetAllocationInfo);
+    RenderGraphResource targets[NumTargets];
+    for (u32 i = 0; i < NumTargets; ++i)
+    {
+        targets[i] = graph.CreateTexture("Target" + std::to_string(i), targetDesc);
+    }
+
+    graph.AddPass("Scene", [&](RenderGraphBuilder& builder) {
+        builder.Write(targets[0], D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }, NoCommands);
+    for (u32 i = 1; i < NumTargets; ++i)
+    {
+        graph.AddPass("PostProcess" + std::to_string(i), [&, i](RenderGraphBuilder& builder) {
+            builder.Read(targets[i - 1], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            builder.Write(targets[i], D3D12_RESOURCE_STATE_RENDER_TARGET);
+        }, NoCommands);
+    }
+    graph.AddPass("Present", [&](RenderGraphBuilder& builder) {
+        builder.Read(targets[NumTargets - 1], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    // Only two consecutive targets are alive at the same time, so the chain ping-pongs between two of them.
+    u64 targetBytes = GetAllocationInfo(targetDesc).SizeInBytes;
+    CHECK(graph.GetHeapOffset(targets[0]) == graph.GetHeapOffset(targets[2]));
+    CHECK(graph.GetHeapOffset(targets[1]) == graph.GetHeapOffset(targets[3]));
+    CHECK(graph.GetHeapOffset(targets[0]) != graph.GetHeapOffset(targets[1]));
+
+    const auto& statistics = graph.GetMemoryStatistics();
+    CHECK(statistics.NumTransientResources == NumTargets);
+    CHECK(statistics.NumAliasedResources == NumTargets);
+    CHECK(statistics.TransientBytes == NumTargets * targetBytes);
+    CHECK(statistics.HeapBytes == 2 * targetBytes);
+    CHECK(statistics.GetSavedBytes() == (NumTargets - 2) * targetBytes);
+    // Every aliased render target is discarded before its first pass renders to it.
+    CHECK(statistics.NumDiscards == NumTargets);
+}
+
+TEST(RenderGraphSchedulesBarriers)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto a = graph.CreateBuffer("A", NumElements, ElementSize);
+
+    graph.AddPass("FirstWrite", [&](RenderGraphBuilder& builder) {
+        builder.Write(a, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("SecondWrite", [&](RenderGraphBuilder& builder) {
+        builder.Write(a, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }, NoCommands);
+    graph.AddPass("Read", [&](RenderGraphBuilder& builder) {
+        builder.Read(a, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+
+    // COMMON -> UNORDERED_ACCESS, a UAV barrier between the writes, UNORDERED_ACCESS ->
+    // NON_PIXEL_SHADER_RESOURCE and back to COMMON after the last use.
+    CHECK(graph.GetMemoryStatistics().NumBarriers == 4);
+}
+
+TEST(RenderGraphResetClearsPasses)
+{
+    RenderGraph graph(&GetAllocationInfo);
+    auto a = graph.CreateBuffer("A", NumElements, ElementSize);
+    graph.AddPass("Write", [&](RenderGraphBuilder& builder) {
+        builder.Write(a, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        builder.SetSideEffect();
+    }, NoCommands);
+    graph.Compile();
+    CHECK(graph.GetMemoryStatistics().NumTransientResources == 1);
+
+    graph.Reset();
+    graph.Compile();
+    CHECK(graph.GetMemoryStatistics().NumPasses == 0);
+    CHECK(graph.GetMemoryStatistics().NumTransientResources == 0);
+    CHECK(graph.GetMemoryStatistics().HeapBytes == 0);
+}
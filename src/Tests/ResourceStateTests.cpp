@@ -0,0 +1,328 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestResources.h"
+
+#include <Engine/Pipeline/ResourceState.h>
+#include <Engine/Pipeline/ResourceStateTracker.h>
+
+#include <iterator>
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+    // The per-subresource map ResourceState replaced, kept as the reference of the differential test.
+    struct ReferenceResourceState
+    {
+        D3D12_RESOURCE_STATES                 State = D3D12_RESOURCE_STATE_COMMON;
+        std::map<UINT, D3D12_RESOURCE_STATES> SubresourceState;
+
+        void SetSubresourceState(UINT subresource, D3D12_RESOURCE_STATES state)
+        {
+            if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+            {
+                State = state;
+                SubresourceState.clear();
+            }
+            else
+            {
+                SubresourceState[subresource] = state;
+            }
+        }
+
+        D3D12_RESOURCE_STATES GetSubresourceState(UINT subresource) const
+        {
+            const auto iter = SubresourceState.find(subresource);
+            return iter != SubresourceState.end() ? iter->second : State;
+        }
+    };
+
+    // The barrier recording of ResourceStateTracker before ResourceState and ResourceStateMap replaced its maps,
+    // kept as the reference of the differential tracker test.
+    struct ReferenceTracker
+    {
+        std::unordered_map<ID3D12Resource*, ReferenceResourceState> FinalResourceState;
+        std::vector<D3D12_RESOURCE_BARRIER>                         PendingResourceBarriers;
+        std::vector<D3D12_RESOURCE_BARRIER>                         ResourceBarriers;
+
+        void ResourceBarrier(const D3D12_RESOURCE_BARRIER& barrier)
+        {
+            if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+            {
+                ResourceBarriers.push_back(barrier);
+                return;
+            }
+
+            const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
+            const auto iter = FinalResourceState.find(transitionBarrier.pResource);
+            if (iter == FinalResourceState.end())
+            {
+                PendingResourceBarriers.push_back(barrier);
+            }
+            else if (transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+                     !iter->second.SubresourceState.empty())
+            {
+                for (const auto& [subresource, subresourceState] : iter->second.SubresourceState)
+                {
+                    if (transitionBarrier.StateAfter != subresourceState)
+                    {
+                        D3D12_RESOURCE_BARRIER newBarrier = barrier;
+                        newBarrier.Transition.Subresource = subresource;
+                        newBarrier.Transition.StateBefore = subresourceState;
+                        ResourceBarriers.push_back(newBarrier);
+                    }
+                }
+            }
+            else
+            {
+                auto finalState = iter->second.GetSubresourceState(transitionBarrier.Subresource);
+                if (transitionBarrier.StateAfter != finalState)
+                {
+                    D3D12_RESOURCE_BARRIER newBarrier = barrier;
+                    newBarrier.Transition.StateBefore = finalState;
+                    ResourceBarriers.push_back(newBarrier);
+                }
+            }
+
+            FinalResourceState[transitionBarrier.pResource].SetSubresourceState(transitionBarrier.Subresource,
+                transitionBarrier.StateAfter);
+        }
+    };
+
+    constexpr D3D12_RESOURCE_STATES States[] = {
+        D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+    };
+
+    bool Matches(const ResourceState& state, const ReferenceResourceState& reference, UINT numSubresources)
+    {
+        if (state.HasSubresourceStates() != !reference.SubresourceState.empty() ||
+            state.GetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) != reference.State)
+        {
+            return false;
+        }
+
+        for (UINT subresource = 0; subresource < numSubresources; ++subresource)
+        {
+            if (state.GetSubresourceState(subresource) != reference.GetSubresourceState(subresource))
+            {
+                return false;
+            }
+        }
+
+        // The tracker emits one barrier per explicitly set subresource, in this order.
+        std::vector<std::pair<UINT, D3D12_RESOURCE_STATES>> subresourceStates;
+        state.ForEachSubresourceState([&](UINT subresource, D3D12_RESOURCE_STATES subresourceState) {
+            subresourceStates.emplace_back(subresource, subresourceState);
+        });
+        return subresourceStates == std::vector<std::pair<UINT, D3D12_RESOURCE_STATES>>(
+                                        reference.SubresourceState.begin(), reference.SubresourceState.end());
+    }
+}
+
+TEST(ResourceStateMatchesReferenceOnRandomSequences)
+{
+    // More than InlineSubresources, so the overflow storage is exercised too.
+    constexpr UINT   NumSubresources = 40;
+    constexpr size_t NumResources = 300;
+
+    std::mt19937     random(1);
+    ResourceStateMap map(8);
+    std::unordered_map<ID3D12Resource*, ReferenceResourceState> reference;
+
+    for (u32 step = 0; step < 200000; ++step)
+    {
+        ID3D12Resource*       resource = Tests::FakeResource(random() % NumResources);
+        D3D12_RESOURCE_STATES state = States[random() % std::size(States)];
+
+        u32 operation = random() % 100;
+        if (operation < 30)
+        {
+            map[resource].SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+            reference[resource].SetSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+        }
+        else if (operation < 90)
+        {
+            // Mostly mips of the first slices, sometimes the deep end of the array.
+            UINT subresource = random() % 4 == 0 ? random() % NumSubresources : random() % 8;
+            map[resource].SetSubresourceState(subresource, state);
+            reference[resource].SetSubresourceState(subresource, state);
+        }
+        else if (operation < 99)
+        {
+            // Copy the state, like committing the final state to the global state.
+            ID3D12Resource* other = Tests::FakeResource(random() % NumResources);
+            if (const ResourceState* otherState = map.Find(other))
+            {
+                // Copy first, the insertion may move the other state.
+                ResourceState copy = *otherState;
+                map[resource] = copy;
+                reference[resource] = reference[other];
+            }
+        }
+        else
+        {
+            map.Clear();
+            reference.clear();
+        }
+
+        const ResourceState* resourceState = map.Find(resource);
+        auto                 iter = reference.find(resource);
+        CHECK((resourceState != nullptr) == (iter != reference.end()));
+        if (resourceState != nullptr && iter != reference.end())
+        {
+            CHECK(Matches(*resourceState, iter->second, NumSubresources));
+        }
+    }
+
+    CHECK(map.Size() == reference.size());
+
+    size_t numVisited = 0;
+    map.ForEach([&](ID3D12Resource* resource, const ResourceState& state) {
+        auto iter = reference.find(resource);
+        CHECK(iter != reference.end());
+        CHECK(iter != reference.end() && Matches(state, iter->second, NumSubresources));
+        ++numVisited;
+    });
+    CHECK(numVisited == reference.size());
+}
+
+TEST(ResourceStateMapReusesStorageAfterClear)
+{
+    ResourceStateMap map(8);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        map[Tests::FakeResource(i)].SetSubresourceState(3, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+    CHECK(map.Size() == 100);
+
+    map.Clear();
+    CHECK(map.Empty());
+    CHECK(map.Find(Tests::FakeResource(0)) == nullptr);
+
+    // A slot that is reused starts in the COMMON state without subresource states.
+    ResourceState& state = map[Tests::FakeResource(0)];
+    CHECK(!state.HasSubresourceStates());
+    CHECK(state.GetSubresourceState(3) == D3D12_RESOURCE_STATE_COMMON);
+}
+
+TEST(ResourceStateTrackerMatchesReferenceBarriers)
+{
+    constexpr UINT   NumSubresources = 24;
+    constexpr size_t NumResources = 16;
+    constexpr u32    NumCommandLists = 2000;
+    constexpr u32    NumBarriersPerList = 64;
+
+    // Compute lists don't combine read states, which the old tracker didn't do either. Transitions from a
+    // combined read state to one of its states are dropped now, so the combined state isn't requested.
+    constexpr D3D12_RESOURCE_STATES TrackerStates[] = {
+        D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+    };
+
+    std::mt19937 random(2);
+
+    for (u32 commandList = 0; commandList < NumCommandLists; ++commandList)
+    {
+        ResourceStateTracker tracker(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+        ReferenceTracker     reference;
+
+        for (u32 i = 0; i < NumBarriersPerList; ++i)
+        {
+            ID3D12Resource* resource = Tests::FakeResource(random() % NumResources);
+
+            D3D12_RESOURCE_BARRIER barrier;
+            u32                    operation = random() % 10;
+            if (operation == 0)
+            {
+                barrier = CD3DX12_RESOURCE_BARRIER::UAV(random() % 4 == 0 ? nullptr : resource);
+            }
+            else
+            {
+                D3D12_RESOURCE_STATES state = TrackerStates[random() % std::size(TrackerStates)];
+                UINT subresource = operation < 4 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : random() % NumSubresources;
+                barrier = CD3DX12_RESOURCE_BARRIER::Transition(resource, D3D12_RESOURCE_STATE_COMMON, state,
+                    subresource);
+            }
+
+            tracker.ResourceBarrier(barrier);
+            reference.ResourceBarrier(barrier);
+        }
+
+        // The tracker optimizes its batch, so the recorded stream of the reference is optimized the same way.
+        ResourceStateTracker optimizedReference(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+        for (const auto& barrier : reference.ResourceBarriers)
+        {
+            optimizedReference.ExplicitResourceBarrier(barrier);
+        }
+
+        CHECK(Tests::Equal(tracker.GetOptimizedResourceBarriers(), optimizedReference.GetOptimizedResourceBarriers()));
+        CHECK(tracker.HasPendingResourceBarriers() == !reference.PendingResourceBarriers.empty());
+    }
+}
+
+BENCHMARK(ResourceStateBarrierThroughput)
+{
+    // The final states of a command list that transitions the mips of its textures one by one.
+    constexpr size_t NumResources = 512;
+    constexpr UINT   NumMips = 12;
+    constexpr u32    Iterations = 20;
+    constexpr u64    NumTransitions = NumResources * NumMips * 2;
+
+    Tests::Report("std::map states", Tests::Measure(Iterations, [&]() {
+        std::unordered_map<ID3D12Resource*, ReferenceResourceState> states;
+        for (UINT mip = 0; mip < NumMips; ++mip)
+        {
+            for (size_t i = 0; i < NumResources; ++i)
+            {
+                auto& state = states[Tests::FakeResource(i)];
+                state.SetSubresourceState(mip, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                state.SetSubresourceState(mip, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
+        }
+        Tests::Consume(states.size());
+    }), NumTransitions);
+
+    // The map is reused like the map of a command list that is reset every frame.
+    ResourceStateMap map;
+    Tests::Report("ResourceStateMap states", Tests::Measure(Iterations, [&]() {
+        map.Clear();
+        for (UINT mip = 0; mip < NumMips; ++mip)
+        {
+            for (size_t i = 0; i < NumResources; ++i)
+            {
+                auto& state = map[Tests::FakeResource(i)];
+                state.SetSubresourceState(mip, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                state.SetSubresourceState(mip, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
+        }
+        Tests::Consume(map.Size());
+    }), NumTransitions);
+
+    // The whole tracker: the first transition of every resource is pending, the others are recorded.
+    ResourceStateTracker tracker;
+    Tests::Report("ResourceStateTracker transitions", Tests::Measure(Iterations, [&]() {
+        tracker.Reset();
+        for (UINT mip = 0; mip < NumMips; ++mip)
+        {
+            for (size_t i = 0; i < NumResources; ++i)
+            {
+                tracker.TransitionResource(Tests::FakeResource(i), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, mip);
+                tracker.TransitionResource(Tests::FakeResource(i), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mip);
+            }
+        }
+        Tests::Consume(tracker.HasPendingResourceBarriers() ? 1 : 0);
+    }), NumTransitions);
+}
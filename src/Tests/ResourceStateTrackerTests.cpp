@@ -0,0 +1,288 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestResources.h"
+
+#include <Engine/Pipeline/ResourceStateTracker.h>
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    D3D12_RESOURCE_BARRIER Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateBefore,
+        D3D12_RESOURCE_STATES stateAfter, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+        D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE)
+    {
+        return CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, stateAfter, subresource, flags);
+    }
+
+    D3D12_RESOURCE_BARRIER UAV(ID3D12Resource* resource)
+    {
+        return CD3DX12_RESOURCE_BARRIER::UAV(resource);
+    }
+
+    // A recorded barrier stream and the batch the optimizer should turn it into.
+    struct BarrierStreamCase
+    {
+        const char*                         Name;
+        std::vector<D3D12_RESOURCE_BARRIER> Recorded;
+        std::vector<D3D12_RESOURCE_BARRIER> Expected;
+    };
+
+    constexpr D3D12_RESOURCE_STATES UnorderedAccess = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    constexpr D3D12_RESOURCE_STATES NonPixelShaderResource = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    constexpr D3D12_RESOURCE_STATES PixelShaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    constexpr D3D12_RESOURCE_STATES CopySource = D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+    // Stands in for the single lock around the global state that the shards replaced.
+    std::mutex gs_GlobalStateMutex;
+
+    // Record a command list that transitions its resources and commit its final states, like
+    // CommandQueue::ExecuteCommandLists does with the shards of the list locked.
+    void Submit(ResourceStateTracker& tracker, size_t firstResource, size_t numResources, bool globalLock)
+    {
+        for (size_t i = firstResource; i < firstResource + numResources; ++i)
+        {
+            tracker.TransitionResource(Tests::FakeResource(i), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            tracker.TransitionResource(Tests::FakeResource(i), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        }
+
+        std::unique_lock<std::mutex> globalStateLock(gs_GlobalStateMutex, std::defer_lock);
+        if (globalLock)
+        {
+            globalStateLock.lock();
+        }
+
+        u64 shardMask = tracker.GetGlobalStateShardMask();
+        ResourceStateTracker::Lock(shardMask);
+        tracker.CommitFinalResourceStates();
+        ResourceStateTracker::Unlock(shardMask);
+
+        tracker.Reset();
+    }
+}
+
+TEST(ResourceStateTrackerOptimizesRecordedBarrierStreams)
+{
+    ID3D12Resource* a = Tests::FakeResource(0);
+    ID3D12Resource* b = Tests::FakeResource(1);
+
+    const BarrierStreamCase cases[] = {
+        { "No-op transition",
+            { Transition(a, UnorderedAccess, UnorderedAccess) },
+            {} },
+        { "Back-to-back transitions fold",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), Transition(a, NonPixelShaderResource, CopySource) },
+            { Transition(a, UnorderedAccess, CopySource) } },
+        // Dropping both would also drop the wait for the UAV writes before the first barrier.
+        { "Round trip through a write state is kept",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), Transition(a, NonPixelShaderResource, UnorderedAccess) },
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), Transition(a, NonPixelShaderResource, UnorderedAccess) } },
+        { "Other subresources don't block a fold",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource, 0), Transition(a, UnorderedAccess, NonPixelShaderResource, 1),
+                Transition(a, NonPixelShaderResource, CopySource, 0) },
+            { Transition(a, UnorderedAccess, NonPixelShaderResource, 1), Transition(a, UnorderedAccess, CopySource, 0) } },
+        { "Other resources don't block a fold",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), Transition(b, UnorderedAccess, CopySource),
+                Transition(a, NonPixelShaderResource, CopySource) },
+            { Transition(b, UnorderedAccess, CopySource), Transition(a, UnorderedAccess, CopySource) } },
+        { "Aliasing barriers block a fold",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, nullptr),
+                Transition(a, NonPixelShaderResource, CopySource) },
+            { Transition(a, UnorderedAccess, NonPixelShaderResource), CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, nullptr),
+                Transition(a, NonPixelShaderResource, CopySource) } },
+        { "Split barriers are never folded",
+            { Transition(a, UnorderedAccess, NonPixelShaderResource, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY),
+                Transition(a, NonPixelShaderResource, CopySource) },
+            { Transition(a, UnorderedAccess, NonPixelShaderResource, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY),
+                Transition(a, NonPixelShaderResource, CopySource) } },
+        { "Duplicate UAV barriers",
+            { UAV(a), UAV(b), UAV(a) },
+            { UAV(a), UAV(b) } },
+        { "A global UAV barrier covers the others",
+            { UAV(a), UAV(nullptr), UAV(b), UAV(nullptr) },
+            { UAV(nullptr) } },
+        { "A later whole-resource transition covers the UAV barrier",
+            { UAV(a), Transition(a, UnorderedAccess, NonPixelShaderResource) },
+            { Transition(a, UnorderedAccess, NonPixelShaderResource) } },
+        { "A subresource transition doesn't cover the UAV barrier",
+            { UAV(a), Transition(a, UnorderedAccess, NonPixelShaderResource, 0) },
+            { UAV(a), Transition(a, UnorderedAccess, NonPixelShaderResource, 0) } },
+        { "An earlier transition doesn't cover the UAV barrier",
+            { Transition(a, NonPixelShaderResource, UnorderedAccess), UAV(a) },
+            { Transition(a, NonPixelShaderResource, UnorderedAccess), UAV(a) } },
+    };
+
+    for (const BarrierStreamCase& testCase : cases)
+    {
+        ResourceStateTracker tracker;
+        for (const auto& barrier : testCase.Recorded)
+        {
+            tracker.ExplicitResourceBarrier(barrier);
+        }
+
+        bool equal = Tests::Equal(tracker.GetOptimizedResourceBarriers(), testCase.Expected);
+        if (!equal)
+        {
+            std::printf("  %s\n", testCase.Name);
+        }
+        CHECK(equal);
+    }
+}
+
+TEST(ResourceStateTrackerDropsReadRoundTrips)
+{
+    ID3D12Resource* a = Tests::FakeResource(0);
+
+    // On a direct list the second read state is merged into the first, so switching back is free.
+    ResourceStateTracker direct(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    direct.TransitionResource(a, UnorderedAccess);  // Pending, the state before is not known yet.
+    direct.TransitionResource(a, NonPixelShaderResource);
+    direct.TransitionResource(a, PixelShaderResource);
+    direct.TransitionResource(a, NonPixelShaderResource);
+    direct.TransitionResource(a, PixelShaderResource);
+    CHECK(direct.HasPendingResourceBarriers());
+    CHECK(Tests::Equal(direct.GetOptimizedResourceBarriers(),
+        { Transition(a, UnorderedAccess, NonPixelShaderResource | PixelShaderResource) }));
+
+    // Compute lists can't use the combined state, so every transition is recorded. Within one
+    // batch they still fold into a single transition to the last state.
+    ResourceStateTracker compute(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+    compute.TransitionResource(a, UnorderedAccess);
+    compute.TransitionResource(a, NonPixelShaderResource);
+    compute.TransitionResource(a, CopySource);
+    compute.TransitionResource(a, NonPixelShaderResource);
+    CHECK(Tests::Equal(compute.GetOptimizedResourceBarriers(), { Transition(a, UnorderedAccess, NonPixelShaderResource) }));
+
+    // Transitions to the state the resource is already in are dropped before they are batched.
+    ResourceStateTracker repeated;
+    repeated.TransitionResource(a, UnorderedAccess);
+    repeated.TransitionResource(a, UnorderedAccess);
+    repeated.TransitionResource(a, UnorderedAccess);
+    CHECK(repeated.GetOptimizedResourceBarriers().empty());
+}
+
+TEST(ResourceStateTrackerRestrictsMergedReadStates)
+{
+    constexpr D3D12_RESOURCE_STATES DepthWrite = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    constexpr D3D12_RESOURCE_STATES DepthRead = D3D12_RESOURCE_STATE_DEPTH_READ;
+
+    ID3D12Resource* a = Tests::FakeResource(0);
+    ID3D12Resource* b = Tests::FakeResource(1);
+    ID3D12Resource* c = Tests::FakeResource(2);
+    ID3D12Resource* d = Tests::FakeResource(3);
+
+    ResourceStateTracker::EndFrame();
+
+    ResourceStateTracker direct(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    // Combined shader resource states are restricted to the one compute lists support.
+    direct.TransitionResource(a, UnorderedAccess);
+    direct.TransitionResource(a, NonPixelShaderResource);
+    direct.TransitionResource(a, PixelShaderResource);
+    // A depth buffer that is also read by a compute shader.
+    direct.TransitionResource(b, DepthWrite);
+    direct.TransitionResource(b, DepthRead);
+    direct.TransitionResource(b, NonPixelShaderResource);
+    // A depth buffer that is only read by the depth test and pixel shaders has no read state of compute
+    // lists to restrict to, so its combined state is kept.
+    direct.TransitionResource(c, DepthWrite);
+    direct.TransitionResource(c, DepthRead);
+    direct.TransitionResource(c, PixelShaderResource);
+    // Only the merged subresource is restricted.
+    direct.TransitionResource(d, UnorderedAccess);
+    direct.TransitionResource(d, CopySource, 0);
+    direct.TransitionResource(d, PixelShaderResource, 0);
+    direct.TransitionResource(d, NonPixelShaderResource, 1);
+
+    // The restrictions are recorded after the transitions to the combined states, so both fold into one
+    // (in the place of the restriction).
+    direct.RestrictMergedReadStates();
+    CHECK(Tests::Equal(direct.GetOptimizedResourceBarriers(),
+        { Transition(c, DepthWrite, DepthRead | PixelShaderResource), Transition(d, UnorderedAccess, NonPixelShaderResource, 1),
+            Transition(a, UnorderedAccess, NonPixelShaderResource), Transition(b, DepthWrite, NonPixelShaderResource),
+            Transition(d, UnorderedAccess, CopySource, 0) }));
+
+    // The statistics of a command list are committed with its final states.
+    u64 shardMask = direct.GetGlobalStateShardMask();
+    ResourceStateTracker::Lock(shardMask);
+    direct.CommitFinalResourceStates();
+    ResourceStateTracker::Unlock(shardMask);
+    direct.Reset();
+
+    ResourceStateTracker::EndFrame();
+    auto statistics = ResourceStateTracker::GetFrameBarrierStatistics();
+    CHECK(statistics.NumRestricted == 3);
+    CHECK(statistics.NumReadMerged == 4);
+}
+
+TEST(ResourceStateTrackerExplicitBarriersNeedNoPendingList)
+{
+    ID3D12Resource* a = Tests::FakeResource(0);
+    ID3D12Resource* b = Tests::FakeResource(1);
+
+    // CommandQueue::ExecuteCommandLists only submits a pending command list in front of a
+    // list whose tracker has pending barriers.
+    ResourceStateTracker explicitOnly;
+    explicitOnly.ExplicitResourceBarrier(Transition(a, UnorderedAccess, NonPixelShaderResource));
+    explicitOnly.ExplicitResourceBarrier(Transition(b, CopySource, UnorderedAccess));
+    explicitOnly.SetUntrackedResourceState(a, NonPixelShaderResource);
+    explicitOnly.SetUntrackedResourceState(b, UnorderedAccess);
+    CHECK(!explicitOnly.HasPendingResourceBarriers());
+    CHECK(explicitOnly.GetOptimizedResourceBarriers().size() == 2);
+
+    // The states of the untracked resources are still committed, so their shards must be locked.
+    u64 expectedShardMask = 0;
+    for (ID3D12Resource* resource : { a, b })
+    {
+        ResourceStateTracker tracked;
+        tracked.TransitionResource(resource, NonPixelShaderResource);
+        expectedShardMask |= tracked.GetGlobalStateShardMask();
+    }
+    CHECK(explicitOnly.GetGlobalStateShardMask() == expectedShardMask);
+
+    // The first tracked use of a resource has an unknown state before, which needs the pending list.
+    ResourceStateTracker mixed;
+    mixed.ExplicitResourceBarrier(Transition(a, UnorderedAccess, NonPixelShaderResource));
+    mixed.TransitionResource(b, UnorderedAccess);
+    CHECK(mixed.HasPendingResourceBarriers());
+}
+
+BENCHMARK(ResourceStateTrackerConcurrentSubmission)
+{
+    // Every queue submits lists that reference a few resources of its own, so with the sharded
+    // global state only the submissions that hash to the same shard contend.
+    constexpr size_t NumResourcesPerList = 4;
+    constexpr u32    NumListsPerQueue = 20000;
+
+    for (bool globalLock : { true, false })
+    {
+        for (u32 numQueues : { 1u, 2u, 3u, 4u })
+        {
+            double milliseconds = Tests::Measure(1, [&]() {
+                std::vector<std::thread> queues;
+                for (u32 queue = 0; queue < numQueues; ++queue)
+                {
+                    queues.emplace_back([=]() {
+                        ResourceStateTracker tracker;
+                        for (u32 list = 0; list < NumListsPerQueue; ++list)
+                        {
+                            // Rotate over a working set of 64 resources per queue.
+                            size_t first = (queue * 64) + (list % 16) * NumResourcesPerList;
+                            Submit(tracker, first, NumResourcesPerList, globalLock);
+                        }
+                    });
+                }
+                for (auto& queue : queues)
+                {
+                    queue.join();
+                }
+            });
+
+            char label[64];
+            std::snprintf(label, sizeof(label), "%u queue(s), %s", numQueues, globalLock ? "global lock" : "sharded");
+            Tests::Report(label, milliseconds, static_cast<u64>(numQueues) * NumListsPerQueue);
+        }
+    }
+}
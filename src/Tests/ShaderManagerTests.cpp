@@ -0,0 +1,405 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Pipeline/PipelineStateCache.h>
+#include <Engine/Pipeline/ShaderCompiler.h>
+#include <Engine/Pipeline/ShaderManager.h>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    // The calls of a FakeShaderCompiler, shared with the test since the compiler is owned by the manager.
+    struct CompilerLog
+    {
+        std::mutex               Mutex;
+        std::vector<std::string> CompiledShaders;
+        std::vector<std::string> EntryPoints;
+        bool                     Fail = false;
+
+        size_t Count(const std::string& shader)
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            return std::count(CompiledShaders.begin(), CompiledShaders.end(), shader);
+        }
+
+        size_t Size()
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            return CompiledShaders.size();
+        }
+
+        void SetFail(bool fail)
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Fail = fail;
+        }
+    };
+
+    /**
+     * "Compiles" a shader to its source text and a compilation number, so every successful
+     * compilation produces different bytecode.
+     */
+    class FakeShaderCompiler : public ShaderCompiler
+    {
+    public:
+        explicit FakeShaderCompiler(CompilerLog& log)
+            : m_Log(log)
+        {}
+
+        bool Compile(const fs::path& sourceFile, const std::string& entryPoint, const std::string& profile,
+            std::vector<u8>& bytecode, std::string& errors) override
+        {
+            std::lock_guard<std::mutex> lock(m_Log.Mutex);
+            m_Log.CompiledShaders.push_back(sourceFile.stem().string());
+            m_Log.EntryPoints.push_back(entryPoint);
+            if (m_Log.Fail)
+            {
+                errors = "error X3000: syntax error";
+                return false;
+            }
+
+            std::ifstream     file(sourceFile, std::ios::in | std::ios::binary);
+            std::stringstream text;
+            text << file.rdbuf() << " " << profile << " #" << m_Log.CompiledShaders.size();
+            std::string result = text.str();
+            bytecode.assign(result.begin(), result.end());
+            return true;
+        }
+
+    private:
+        CompilerLog& m_Log;
+    };
+
+    // A directory with compiled shader objects and HLSL sources that is removed again by the destructor.
+    class ShaderDirectory
+    {
+    public:
+        explicit ShaderDirectory(const std::string& name)
+            : m_Path(fs::temp_directory_path() / "ShaderManagerTests" / name)
+        {
+            fs::remove_all(m_Path);
+            fs::create_directories(m_Path / "Bytecode");
+            fs::create_directories(m_Path / "Source");
+        }
+
+        ~ShaderDirectory()
+        {
+            std::error_code error;
+            fs::remove_all(m_Path, error);
+        }
+
+        fs::path GetBytecodeDirectory() const
+        {
+            return m_Path / "Bytecode";
+        }
+
+        fs::path GetSourceDirectory() const
+        {
+            return m_Path / "Source";
+        }
+
+        // Add a shader as the build would: its source and its compiled shader object.
+        void AddShader(const std::string& name, const std::string& source)
+        {
+            WriteSource(name + ".hlsl", source);
+            std::ofstream(GetBytecodeDirectory() / (name + ".cso"), std::ios::out | std::ios::binary)
+                << name << " compiled by the build";
+        }
+
+        // Replaces the file in one step, so the compile thread never sees a half written edit.
+        void WriteSource(const std::string& file, const std::string& source)
+        {
+            fs::path path = GetSourceDirectory() / file;
+            fs::path tempPath = m_Path / file;
+
+            std::error_code    error;
+            fs::file_time_type previousWriteTime = fs::last_write_time(path, error);
+            bool               existed = !error;
+
+            std::ofstream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc) << source;
+
+            // The write time may only be stored at a coarse granularity, so make sure the watcher sees the edit.
+            if (existed)
+            {
+                fs::last_write_time(tempPath, previousWriteTime + std::chrono::seconds(1));
+            }
+            fs::rename(tempPath, path);
+        }
+
+    private:
+        fs::path m_Path;
+    };
+
+    std::string GetBytecodeText(const Shader& shader)
+    {
+        D3D12_SHADER_BYTECODE bytecode = shader.GetBytecode();
+        return std::string(static_cast<const char*>(bytecode.pShaderBytecode), bytecode.BytecodeLength);
+    }
+
+    // Call Update until done returns true. The compile thread only checks the sources every
+    // PollInterval, so this gives up after a few seconds.
+    template<typename Func>
+    bool UpdateUntil(ShaderManager& shaderManager, Func&& done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            shaderManager.Update();
+        }
+        return true;
+    }
+
+    // Call Update for a few poll intervals, to give the compile thread the chance to do what it shouldn't.
+    void UpdateForAWhile(ShaderManager& shaderManager)
+    {
+        auto end = std::chrono::steady_clock::now() + ShaderManager::PollInterval * 3;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            shaderManager.Update();
+        }
+    }
+}
+
+TEST(ShaderManagerRecompilesEveryDependentOfAnInclude)
+{
+    ShaderDirectory directory("Dependents");
+    directory.WriteSource("Common.hlsli", "#include \"Detail.hlsli\"\n");
+    directory.WriteSource("Detail.hlsli", "// Detail\n");
+    directory.AddShader("FirstCS", "#include \"Common.hlsli\"\n");
+    directory.AddShader("SecondPS", "  #  include <Common.hlsli>\n");
+    directory.AddShader("ThirdCS", "// No includes\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+    CHECK(shaderManager.IsHotReloadEnabled());
+
+    auto first = shaderManager.Load("FirstCS");
+    auto second = shaderManager.Load("SecondPS");
+    auto third = shaderManager.Load("ThirdCS");
+    CHECK(shaderManager.Load("FirstCS") == first);
+    CHECK(GetBytecodeText(*first) == "FirstCS compiled by the build");
+
+    // A direct include.
+    directory.WriteSource("Common.hlsli", "#include \"Detail.hlsli\"\n// Edited\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return first->GetVersion() == 1 && second->GetVersion() == 1; }));
+    CHECK(GetBytecodeText(*first).find("cs_6_0") != std::string::npos);
+    CHECK(GetBytecodeText(*second).find("ps_6_0") != std::string::npos);
+
+    // An include of an include.
+    directory.WriteSource("Detail.hlsli", "// Detail, edited\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return first->GetVersion() == 2 && second->GetVersion() == 2; }));
+
+    UpdateForAWhile(shaderManager);
+    CHECK(log.Count("FirstCS") == 2);
+    CHECK(log.Count("SecondPS") == 2);
+    CHECK(log.Count("ThirdCS") == 0);
+    CHECK(third->GetVersion() == 0);
+    CHECK(GetBytecodeText(*third) == "ThirdCS compiled by the build");
+}
+
+TEST(ShaderManagerKeepsThePreviousBytecodeWhenCompilationFails)
+{
+    ShaderDirectory directory("CompilationFails");
+    directory.AddShader("BrokenCS", "// Compiles\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+
+    auto shader = shaderManager.Load("BrokenCS");
+    u32  numReloaded = 0;
+    u32  numRetired = 0;
+    shader->Reloaded += [&](EventArgs&) { ++numReloaded; };
+    shaderManager.BytecodeRetired += [&](ShaderBytecodeEventArgs&) { ++numRetired; };
+
+    log.SetFail(true);
+    directory.WriteSource("BrokenCS.hlsl", "// Doesn't compile\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return log.Size() == 1; }));
+
+    UpdateForAWhile(shaderManager);
+    CHECK(shader->GetVersion() == 0);
+    CHECK(GetBytecodeText(*shader) == "BrokenCS compiled by the build");
+    CHECK(numReloaded == 0);
+    CHECK(numRetired == 0);
+
+    // Fixing the shader reloads it.
+    log.SetFail(false);
+    directory.WriteSource("BrokenCS.hlsl", "// Compiles again\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return shader->GetVersion() == 1; }));
+    CHECK(GetBytecodeText(*shader).find("// Compiles again") == 0);
+    CHECK(numReloaded == 1);
+    CHECK(numRetired == 1);
+}
+
+TEST(ShaderManagerRollsBackWhenThePipelinesCantBeCreated)
+{
+    ShaderDirectory directory("RollBack");
+    directory.AddShader("MismatchCS", "// Doesn't match the root signature\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+
+    auto        shader = shaderManager.Load("MismatchCS");
+    std::string previousBytecode = GetBytecodeText(*shader);
+
+    // Like an owner whose pipeline state object can't be created from the new bytecode.
+    std::vector<std::string> reloadedBytecode;
+    shader->Reloaded += [&](EventArgs&) {
+        reloadedBytecode.push_back(GetBytecodeText(*shader));
+        if (GetBytecodeText(*shader) != previousBytecode)
+        {
+            throw std::runtime_error("The shader does not match the root signature.");
+        }
+    };
+
+    std::vector<std::string> retiredBytecode;
+    shaderManager.BytecodeRetired += [&](ShaderBytecodeEventArgs& e) {
+        CHECK(e.ShaderName == "MismatchCS");
+        retiredBytecode.emplace_back(static_cast<const char*>(e.Bytecode.pShaderBytecode), e.Bytecode.BytecodeLength);
+    };
+
+    directory.WriteSource("MismatchCS.hlsl", "// Still doesn't match\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return shader->GetVersion() == 2; }));
+
+    // The owners were told about the new bytecode and then about the previous bytecode again.
+    CHECK(GetBytecodeText(*shader) == previousBytecode);
+    CHECK(reloadedBytecode.size() == 2);
+    CHECK(reloadedBytecode.size() == 2 && reloadedBytecode[0].find("// Still doesn't match") == 0);
+    CHECK(reloadedBytecode.size() == 2 && reloadedBytecode[1] == previousBytecode);
+
+    // The pipelines of the new bytecode are the stale ones.
+    CHECK(retiredBytecode.size() == 1);
+    CHECK(retiredBytecode.size() == 1 && retiredBytecode[0] == reloadedBytecode[0]);
+}
+
+TEST(ShaderManagerUpdateDoesntThrowWhenTheRollBackFails)
+{
+    ShaderDirectory directory("RollBackFails");
+    directory.AddShader("BrokenCS", "// Version 0\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+
+    auto shader = shaderManager.Load("BrokenCS");
+
+    // Like an owner that can't create its pipelines from any bytecode, not even the previous one.
+    u32 numReloaded = 0;
+    shader->Reloaded += [&](EventArgs&) {
+        ++numReloaded;
+        throw std::runtime_error("The device was removed.");
+    };
+
+    directory.WriteSource("BrokenCS.hlsl", "// Version 1\n");
+
+    bool threw = false;
+    try
+    {
+        CHECK(UpdateUntil(shaderManager, [&]() { return shader->GetVersion() == 2; }));
+    }
+    catch (const std::exception&)
+    {
+        threw = true;
+    }
+    CHECK(!threw);
+    CHECK(numReloaded == 2);
+
+    // The shader is recompiled with the entry point the build uses.
+    std::lock_guard<std::mutex> lock(log.Mutex);
+    CHECK(!log.EntryPoints.empty());
+    for (const auto& entryPoint : log.EntryPoints)
+    {
+        CHECK(entryPoint == ShaderManager::EntryPoint);
+    }
+}
+
+TEST(ShaderManagerInvokesReloadedOncePerSwap)
+{
+    ShaderDirectory directory("ReloadedOnce");
+    directory.AddShader("EditedPS", "// Version 0\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+
+    auto             shader = shaderManager.Load("EditedPS");
+    std::vector<u32> reloadedVersions;
+    shader->Reloaded += [&](EventArgs&) { reloadedVersions.push_back(shader->GetVersion()); };
+
+    for (u32 edit = 1; edit <= 3; ++edit)
+    {
+        directory.WriteSource("EditedPS.hlsl", "// Version " + std::to_string(edit) + "\n");
+        CHECK(UpdateUntil(shaderManager, [&]() { return reloadedVersions.size() == edit; }));
+
+        // An edit that was swapped in is not swapped in again.
+        UpdateForAWhile(shaderManager);
+        CHECK(reloadedVersions.size() == edit);
+        CHECK(shader->GetVersion() == edit);
+        CHECK(log.Count("EditedPS") == edit);
+    }
+
+    CHECK((reloadedVersions == std::vector<u32>{ 1, 2, 3 }));
+}
+
+TEST(ShaderManagerRetiresTheBytecodeOfStalePipelines)
+{
+    ShaderDirectory directory("Retire");
+    directory.AddShader("CachedCS", "// Version 0\n");
+
+    CompilerLog   log;
+    ShaderManager shaderManager(directory.GetBytecodeDirectory(), directory.GetSourceDirectory(),
+        MakeUnique<FakeShaderCompiler>(log));
+
+    auto shader = shaderManager.Load("CachedCS");
+
+    // The key and shader hashes that the pipeline state cache stores for a pipeline of the shader.
+    struct PipelineStateStream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_CS CS;
+    } pipelineStateStream;
+    auto hashPipeline = [&](u64& key, std::vector<u64>& shaderHashes) {
+        pipelineStateStream.CS = shader->GetBytecode();
+        D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(PipelineStateStream), &pipelineStateStream };
+
+        std::vector<u8> contents;
+        return PipelineStateCache::HashPipelineStateStream(desc, key, contents, shaderHashes);
+    };
+
+    u64              staleKey = 0;
+    std::vector<u64> staleShaderHashes;
+    CHECK(hashPipeline(staleKey, staleShaderHashes));
+
+    // EvictShader drops the pipelines whose shader hashes contain the hash of the retired bytecode.
+    std::vector<u64> retiredHashes;
+    shaderManager.BytecodeRetired += [&](ShaderBytecodeEventArgs& e) {
+        retiredHashes.push_back(HashBytes(e.Bytecode.pShaderBytecode, e.Bytecode.BytecodeLength));
+    };
+
+    directory.WriteSource("CachedCS.hlsl", "// Version 1\n");
+    CHECK(UpdateUntil(shaderManager, [&]() { return shader->GetVersion() == 1; }));
+
+    u64              key = 0;
+    std::vector<u64> shaderHashes;
+    CHECK(hashPipeline(key, shaderHashes));
+    CHECK(key != staleKey);
+
+    // The stale pipeline is evicted and the pipeline of the new bytecode is kept.
+    CHECK(retiredHashes.size() == 1);
+    CHECK(retiredHashes.size() == 1 && staleShaderHashes == std::vector<u64>{ retiredHashes[0] });
+    CHECK(retiredHashes.size() == 1 && shaderHashes.size() == 1 && shaderHashes[0] != retiredHashes[0]);
+}
@@ -0,0 +1,444 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+#include "TestFrustums.h"
+
+#include <Engine/Renderer/FrustumCulling.h>
+#include <Engine/Renderer/SoftwareOcclusionCuller.h>
+
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr float FarZ = 100.0f;
+
+    // An indexed triangle list in world space.
+    struct Occluder
+    {
+        std::vector<XMFLOAT3> Positions;
+        std::vector<u32>      Indices;
+    };
+
+    void AddQuad(Occluder& occluder, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const XMFLOAT3& d)
+    {
+        u32 first = static_cast<u32>(occluder.Positions.size());
+        occluder.Positions.insert(occluder.Positions.end(), { a, b, c, d });
+        occluder.Indices.insert(occluder.Indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    }
+
+    // A rectangle that faces the camera of Tests::CreateViewProjection.
+    Occluder CreateWall(float x, float y, float z, float halfWidth, float halfHeight)
+    {
+        Occluder wall;
+        AddQuad(wall, { x - halfWidth, y - halfHeight, z }, { x - halfWidth, y + halfHeight, z },
+            { x + halfWidth, y + halfHeight, z }, { x + halfWidth, y - halfHeight, z });
+        return wall;
+    }
+
+    // A box with every face split into subdivisions x subdivisions quads.
+    Occluder CreateBox(const BoundingBox& box, u32 subdivisions = 1)
+    {
+        const float center[3] = { box.Center.x, box.Center.y, box.Center.z };
+        const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+        Occluder occluder;
+        for (u32 face = 0; face < 6; ++face)
+        {
+            const u32 axis = face / 2;
+            const u32 u = (axis + 1) % 3;
+            const u32 v = (axis + 2) % 3;
+
+            auto corner = [&](u32 i, u32 j) -> XMFLOAT3
+            {
+                float p[3];
+                p[axis] = face % 2 ? 1.0f : -1.0f;
+                p[u] = -1.0f + 2.0f * i / subdivisions;
+                p[v] = -1.0f + 2.0f * j / subdivisions;
+                return { center[0] + p[0] * extents[0], center[1] + p[1] * extents[1], center[2] + p[2] * extents[2] };
+            };
+
+            for (u32 j = 0; j < subdivisions; ++j)
+            {
+                for (u32 i = 0; i < subdivisions; ++i)
+                {
+                    AddQuad(occluder, corner(i, j), corner(i + 1, j), corner(i + 1, j + 1), corner(i, j + 1));
+                }
+            }
+        }
+        return occluder;
+    }
+
+    void Render(SoftwareOcclusionCuller& culler, const Occluder& occluder)
+    {
+        culler.RenderOccluder(occluder.Positions.data(), static_cast<u32>(occluder.Positions.size()), sizeof(XMFLOAT3),
+            occluder.Indices.data(), static_cast<u32>(occluder.Indices.size()), XMMatrixIdentity());
+    }
+
+    // The depth of a point at distance z in front of the camera of Tests::CreateViewProjection.
+    float GetExpectedDepth(float z)
+    {
+        return FarZ / (FarZ - 1.0f) * (1.0f - 1.0f / z);
+    }
+
+    /**
+     * A depth buffer drawn one pixel at a time, with the depth interpolated from barycentric
+     * weights. Triangles are not clipped, so every vertex must be in front of the near plane.
+     *
+     * Rounding can put a pixel center that is very close to an edge on either side of it, so
+     * those pixels are marked as ambiguous and not compared.
+     */
+    struct ReferenceDepthBuffer
+    {
+        ReferenceDepthBuffer(u32 width, u32 height)
+            : Width(width)
+            , Height(height)
+            , Depth(static_cast<size_t>(width) * height, 1.0f)
+            , Ambiguous(static_cast<size_t>(width) * height, false)
+        {
+        }
+
+        void Render(const Occluder& occluder, FXMMATRIX viewProjection)
+        {
+            for (size_t i = 0; i + 2 < occluder.Indices.size(); i += 3)
+            {
+                XMFLOAT3 v[3];
+                for (u32 j = 0; j < 3; ++j)
+                {
+                    XMFLOAT4 p;
+                    XMStoreFloat4(&p, XMVector3Transform(XMLoadFloat3(&occluder.Positions[occluder.Indices[i + j]]), viewProjection));
+                    assert(p.z >= 0.0f && "The reference doesn't clip.");
+
+                    float invW = 1.0f / p.w;
+                    v[j] = { (p.x * invW * 0.5f + 0.5f) * Width, (0.5f - p.y * invW * 0.5f) * Height, p.z * invW };
+                }
+                RasterizeTriangle(v);
+            }
+        }
+
+        void RasterizeTriangle(const XMFLOAT3 (&v)[3])
+        {
+            float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+            if (!(std::abs(area) > 1e-6f))
+            {
+                return;
+            }
+
+            int minX = std::max(static_cast<int>(std::ceil(std::min({ v[0].x, v[1].x, v[2].x }) - 0.5f)), 0);
+            int maxX = std::min(static_cast<int>(std::floor(std::max({ v[0].x, v[1].x, v[2].x }) - 0.5f)), static_cast<int>(Width) - 1);
+            int minY = std::max(static_cast<int>(std::ceil(std::min({ v[0].y, v[1].y, v[2].y }) - 0.5f)), 0);
+            int maxY = std::min(static_cast<int>(std::floor(std::max({ v[0].y, v[1].y, v[2].y }) - 0.5f)), static_cast<int>(Height) - 1);
+            if (minX > maxX || minY > maxY)
+            {
+                return;
+            }
+            ++NumTriangles;
+
+            for (int y = minY; y <= maxY; ++y)
+            {
+                for (int x = minX; x <= maxX; ++x)
+                {
+                    const float px = x + 0.5f;
+                    const float py = y + 0.5f;
+
+                    // The weight of a vertex is the signed area of the triangle of the opposite edge and the pixel.
+                    float weights[3];
+                    bool  inside = true;
+                    bool  nearEdge = false;
+                    for (u32 i = 0; i < 3; ++i)
+                    {
+                        const XMFLOAT3& a = v[(i + 1) % 3];
+                        const XMFLOAT3& b = v[(i + 2) % 3];
+                        weights[i] = ((b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x)) / area;
+                        inside &= weights[i] >= 0.0f;
+
+                        // Closer than a hundredth of a pixel.
+                        float edgeLength = std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+                        nearEdge |= std::abs(weights[i] * area) <= 0.01f * edgeLength;
+                    }
+
+                    size_t index = static_cast<size_t>(y) * Width + x;
+                    Ambiguous[index] = Ambiguous[index] || nearEdge;
+                    if (inside)
+                    {
+                        Depth[index] = std::min(Depth[index], weights[0] * v[0].z + weights[1] * v[1].z + weights[2] * v[2].z);
+                    }
+                }
+            }
+        }
+
+        u32                Width;
+        u32                Height;
+        std::vector<float> Depth;
+        std::vector<bool>  Ambiguous;
+        u32                NumTriangles = 0;
+    };
+}
+
+TEST(SoftwareOcclusionCullerMatchesScalarRasterizer)
+{
+    const XMMATRIX viewProjection = Tests::CreateViewProjection(FarZ);
+
+    // A width that is not a multiple of the 4 pixels rasterized at once.
+    SoftwareOcclusionCuller culler;
+    culler.Resize(318, 180);
+    CHECK(culler.GetWidth() == 320);
+    CHECK(culler.GetHeight() == 180);
+
+    for (u32 seed = 0; seed < 4; ++seed)
+    {
+        // Overlapping triangles of both windings, inside the screen so the culler doesn't clip them.
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> depth(2.0f, 90.0f);
+        std::uniform_real_distribution<float> side(-0.95f, 0.95f);
+
+        Occluder triangles;
+        for (u32 i = 0; i < 200; ++i)
+        {
+            for (u32 j = 0; j < 3; ++j)
+            {
+                float z = depth(random);
+                triangles.Positions.push_back({ side(random) * z, side(random) * z, z });
+                triangles.Indices.push_back(i * 3 + j);
+            }
+        }
+
+        culler.Begin(viewProjection);
+        Render(culler, triangles);
+        culler.End();
+
+        ReferenceDepthBuffer reference(culler.GetWidth(), culler.GetHeight());
+        reference.Render(triangles, viewProjection);
+        CHECK(culler.GetNumTriangles() == reference.NumTriangles);
+
+        u32 numCompared = 0;
+        u32 numDifferent = 0;
+        for (u32 y = 0; y < reference.Height; ++y)
+        {
+            for (u32 x = 0; x < reference.Width; ++x)
+            {
+                size_t index = static_cast<size_t>(y) * reference.Width + x;
+                if (!reference.Ambiguous[index])
+                {
+                    ++numCompared;
+                    numDifferent += std::abs(culler.GetDepth(x, y) - reference.Depth[index]) > 1e-4f ? 1 : 0;
+                }
+            }
+        }
+        CHECK(numDifferent == 0);
+        CHECK(numCompared > reference.Width * reference.Height * 9 / 10);
+    }
+}
+
+TEST(SoftwareOcclusionCullerCullsBoxesBehindOccluders)
+{
+    SoftwareOcclusionCuller culler;
+    culler.Resize(320, 180);
+    culler.Begin(Tests::CreateViewProjection(FarZ));
+
+    // Covers the middle half of the screen, x and y in [-0.5, 0.5] after the projection.
+    Render(culler, CreateWall(0.0f, 0.0f, 10.0f, 5.0f, 5.0f));
+    culler.End();
+
+    BoundsArray bounds;
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));   // Behind the wall.
+    bounds.Add(BoundingBox({ 4.0f, -4.0f, 50.0f }, { 2.0f, 2.0f, 2.0f }));  // Far behind the wall.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 5.0f }, { 1.0f, 1.0f, 1.0f }));    // In front of the wall.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 10.0f }, { 1.0f, 1.0f, 1.0f }));   // Through the wall.
+    bounds.Add(BoundingBox({ 12.0f, 0.0f, 20.0f }, { 2.0f, 2.0f, 2.0f }));  // Partly behind the wall.
+    bounds.Add(BoundingBox({ 30.0f, 0.0f, 40.0f }, { 1.0f, 1.0f, 1.0f }));  // Beside the wall.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, 0.5f }, { 1.0f, 1.0f, 1.0f }));    // Crosses the near plane.
+    bounds.Add(BoundingBox({ 0.0f, 0.0f, -20.0f }, { 1.0f, 1.0f, 1.0f }));  // Behind the camera.
+    bounds.Add(BoundingBox({ 0.0f, 50.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));  // Above the screen.
+
+    CHECK(!culler.IsVisible(bounds.Get(0)));
+    CHECK(!culler.IsVisible(bounds.Get(1)));
+
+    std::vector<u32> visible = { 8, 0, 1, 2, 3, 4, 5, 6, 7 };
+    CHECK(culler.Cull(bounds, visible) == 2);
+    CHECK(visible == std::vector<u32>({ 8, 2, 3, 4, 5, 6, 7 }));
+}
+
+TEST(SoftwareOcclusionCullerNeverCullsVisibleBoxes)
+{
+    const XMMATRIX viewProjection = Tests::CreateViewProjection(FarZ);
+
+    std::mt19937                          random(7);
+    std::uniform_real_distribution<float> side(-0.8f, 0.8f);
+    std::uniform_real_distribution<float> wallDepth(10.0f, 40.0f);
+    std::uniform_real_distribution<float> wallSize(1.0f, 8.0f);
+    std::uniform_real_distribution<float> boxDepth(5.0f, 80.0f);
+    std::uniform_real_distribution<float> boxExtent(0.2f, 3.0f);
+
+    SoftwareOcclusionCuller culler;
+    culler.Resize(320, 180);
+    culler.Begin(viewProjection);
+    for (u32 i = 0; i < 20; ++i)
+    {
+        float z = wallDepth(random);
+        Render(culler, CreateWall(side(random) * z, side(random) * z, z, wallSize(random), wallSize(random)));
+    }
+    culler.End();
+
+    // A box is visible if a pixel it covers is nearer than the occluders there.
+    u32 numCulled = 0;
+    u32 numVisibleCulled = 0;
+    for (u32 i = 0; i < 1000; ++i)
+    {
+        float       z = boxDepth(random);
+        BoundingBox box({ side(random) * z, side(random) * z, z }, { boxExtent(random), boxExtent(random), boxExtent(random) });
+        if (culler.IsVisible(box))
+        {
+            continue;
+        }
+        ++numCulled;
+
+        ReferenceDepthBuffer reference(culler.GetWidth(), culler.GetHeight());
+        reference.Render(CreateBox(box), viewProjection);
+
+        bool isVisible = false;
+        for (u32 y = 0; y < reference.Height; ++y)
+        {
+            for (u32 x = 0; x < reference.Width; ++x)
+            {
+                size_t index = static_cast<size_t>(y) * reference.Width + x;
+                isVisible |= !reference.Ambiguous[index] && reference.Depth[index] < culler.GetDepth(x, y) - 1e-5f;
+            }
+        }
+        numVisibleCulled += isVisible ? 1 : 0;
+    }
+
+    CHECK(numVisibleCulled == 0);
+    CHECK(numCulled > 0);
+}
+
+TEST(SoftwareOcclusionCullerClipsTriangles)
+{
+    const XMMATRIX viewProjection = Tests::CreateViewProjection(FarZ);
+
+    SoftwareOcclusionCuller culler;
+    culler.Resize(320, 180);
+
+    // Behind the camera, and outside the guard band.
+    culler.Begin(viewProjection);
+    Render(culler, CreateWall(0.0f, 0.0f, -5.0f, 2.0f, 2.0f));
+    Render(culler, CreateWall(40.0f, 0.0f, 10.0f, 10.0f, 1.0f));
+    culler.End();
+    CHECK(culler.GetNumTriangles() == 0);
+    CHECK(culler.IsVisible(BoundingBox({ 0.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f })));
+
+    // A triangle that covers the screen many times over is clipped to the guard band, without
+    // losing the precision of its depth.
+    culler.Begin(viewProjection);
+    Occluder huge;
+    huge.Positions = { { -1e6f, -1e6f, 10.0f }, { 1e6f, -1e6f, 10.0f }, { 0.0f, 1e6f, 10.0f } };
+    huge.Indices = { 0, 1, 2 };
+    Render(culler, huge);
+    culler.End();
+
+    // The clipped polygon is the guard band square, drawn as (at least) two triangles.
+    CHECK(culler.GetNumTriangles() >= 2);
+    u32 numWrongDepths = 0;
+    for (u32 y = 0; y < culler.GetHeight(); ++y)
+    {
+        for (u32 x = 0; x < culler.GetWidth(); ++x)
+        {
+            numWrongDepths += std::abs(culler.GetDepth(x, y) - GetExpectedDepth(10.0f)) > 1e-5f ? 1 : 0;
+        }
+    }
+    CHECK(numWrongDepths == 0);
+
+    // A floor just below the camera that starts behind it, so it crosses the near plane on screen and
+    // the guard band at the sides.
+    culler.Begin(viewProjection);
+    Occluder floor;
+    AddQuad(floor, { -50.0f, -0.1f, -50.0f }, { -50.0f, -0.1f, 50.0f }, { 50.0f, -0.1f, 50.0f }, { 50.0f, -0.1f, -50.0f });
+    Render(culler, floor);
+    culler.End();
+
+    CHECK(culler.GetNumTriangles() >= 2);
+    numWrongDepths = 0;
+    for (u32 y = 0; y < culler.GetHeight(); ++y)
+    {
+        // The view ray of the row meets the floor at z = -0.1 / ndcY, which is in front of the near
+        // plane below ndcY = -0.1.
+        float ndcY = 1.0f - 2.0f * (y + 0.5f) / culler.GetHeight();
+        for (u32 x = 0; x < culler.GetWidth(); ++x)
+        {
+            if (ndcY > 0.0f || ndcY < -0.105f)
+            {
+                numWrongDepths += culler.GetDepth(x, y) != 1.0f ? 1 : 0;
+            }
+            else if (ndcY < -0.01f && ndcY > -0.095f)
+            {
+                numWrongDepths += std::abs(culler.GetDepth(x, y) - GetExpectedDepth(-0.1f / ndcY)) > 1e-4f ? 1 : 0;
+            }
+        }
+    }
+    CHECK(numWrongDepths == 0);
+
+    // The floor hides what is below it, but not what is above it.
+    CHECK(!culler.IsVisible(BoundingBox({ 0.0f, -0.6f, 12.0f }, { 0.2f, 0.2f, 1.0f })));
+    CHECK(culler.IsVisible(BoundingBox({ 0.0f, 0.0f, 10.0f }, { 0.2f, 0.05f, 1.0f })));
+}
+
+BENCHMARK(SoftwareOcclusionCullerSponzaScale)
+{
+    // About as many triangles as Sponza (262k), in about as many meshes.
+    constexpr u32 NumOccluders = 85;
+    constexpr u32 NumBoxes = 10000;
+    constexpr u32 Iterations = 10;
+
+    std::mt19937                          random(0);
+    std::uniform_real_distribution<float> side(-0.9f, 0.9f);
+    std::uniform_real_distribution<float> depth(5.0f, 90.0f);
+    std::uniform_real_distribution<float> occluderExtent(1.0f, 8.0f);
+    std::uniform_real_distribution<float> boxExtent(0.1f, 2.0f);
+
+    std::vector<Occluder> occluders;
+    u32                   numTriangles = 0;
+    for (u32 i = 0; i < NumOccluders; ++i)
+    {
+        float z = depth(random);
+        occluders.push_back(CreateBox(BoundingBox({ side(random) * z, side(random) * z, z },
+            { occluderExtent(random), occluderExtent(random), occluderExtent(random) }), 16));
+        numTriangles += static_cast<u32>(occluders.back().Indices.size() / 3);
+    }
+
+    BoundsArray      bounds;
+    std::vector<u32> candidates;
+    for (u32 i = 0; i < NumBoxes; ++i)
+    {
+        float z = depth(random);
+        bounds.Add(BoundingBox({ side(random) * z, side(random) * z, z }, { boxExtent(random), boxExtent(random), boxExtent(random) }));
+        candidates.push_back(i);
+    }
+
+    // The resolution of the renderer at 16:9.
+    SoftwareOcclusionCuller culler;
+    culler.Resize(320, 180);
+    const XMMATRIX viewProjection = Tests::CreateViewProjection(FarZ);
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "Rasterize %uK occluder triangles", numTriangles / 1000);
+    Tests::Report(label, Tests::Measure(Iterations, [&]() {
+        culler.Begin(viewProjection);
+        for (const Occluder& occluder : occluders)
+        {
+            Render(culler, occluder);
+        }
+    }), numTriangles);
+
+    Tests::Report("Build the depth pyramid", Tests::Measure(Iterations, [&]() { culler.End(); }));
+
+    u32 numOccluded = 0;
+    Tests::Report("Cull boxes", Tests::Measure(Iterations, [&]() {
+        std::vector<u32> visible = candidates;
+        numOccluded = culler.Cull(bounds, visible);
+    }), NumBoxes);
+
+    std::printf("  %-40s %10u of %u boxes\n", "Occluded", numOccluded, NumBoxes);
+    Tests::Consume(numOccluded);
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <Engine/Buffers/Texture.h>
+#include <Engine/Core/Adapter.h>
+#include <Engine/Core/Device.h>
+#include <Engine/Core/RenderTarget.h>
+#include <Engine/Pipeline/CommandQueue.h>
+#include <Engine/Pipeline/PipelineStateObject.h>
+#include <Engine/Pipeline/RootSignature.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace Tests
+{
+    // A device on the WARP (software) adapter, created on first use and shared by the tests. WARP is part of Windows,
+    // so the tests that need a device also run on machines without a GPU. Its caches are written to the temporary
+    // directory, so the tests don't replace the caches of the engine. Tests flush the queues they submit to.
+    inline Device& GetWarpDevice()
+    {
+        static RefPtr<Device> device = Device::Create(Adapter::Create(DXGI_GPU_PREFERENCE_UNSPECIFIED, true),
+            fs::temp_directory_path() / "EngineTests" / "cache");
+        return *device;
+    }
+
+    // Compile HLSL source at runtime, so the device tests don't depend on the shaders the build compiles.
+    inline Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(const char* source, const char* entryPoint, const char* profile)
+    {
+        Microsoft::WRL::ComPtr<ID3DBlob> bytecode;
+        Microsoft::WRL::ComPtr<ID3DBlob> errors;
+        HRESULT hr = D3DCompile(source, std::strlen(source), nullptr, nullptr, nullptr, entryPoint, profile, 0, 0,
+            &bytecode, &errors);
+        if (errors)
+        {
+            std::printf("%s\n", static_cast<const char*>(errors->GetBufferPointer()));
+        }
+        ThrowIfFailed(hr);
+
+        return bytecode;
+    }
+
+    // Draws a small triangle at the offset of its root constants (b0) in the color of a constant buffer (b1), so
+    // every draw sets root constants and uploads a dynamic constant buffer like the raster pass of the renderer.
+    struct TriangleState
+    {
+        enum RootParameters
+        {
+            OffsetCB,  // ConstantBuffer<Offset> : register(b0);
+            ColorCB,   // ConstantBuffer<Color> : register(b1);
+            NumParameters
+        };
+
+        RefPtr<RootSignature>       m_RootSignature;
+        RefPtr<PipelineStateObject> m_PipelineState;
+    };
+
+    inline TriangleState CreateTriangleState(Device& device, DXGI_FORMAT renderTargetFormat)
+    {
+        const char* source = R"(
+            cbuffer OffsetCB : register(b0) { float2 Offset; };
+            cbuffer ColorCB : register(b1) { float4 Color; };
+
+            float4 VSMain(uint vertexId : SV_VertexID) : SV_Position
+            {
+                float2 position = float2((vertexId << 1) & 2, vertexId & 2) * 0.05f;
+                return float4(position + Offset, 0.0f, 1.0f);
+            }
+
+            float4 PSMain() : SV_Target
+            {
+                return Color;
+            }
+        )";
+
+        auto vertexShader = CompileShader(source, "VSMain", "vs_5_1");
+        auto pixelShader = CompileShader(source, "PSMain", "ps_5_1");
+
+        TriangleState state;
+
+        CD3DX12_ROOT_PARAMETER1 rootParameters[TriangleState::NumParameters];
+        rootParameters[TriangleState::OffsetCB].InitAsConstants(2, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        rootParameters[TriangleState::ColorCB].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+            D3D12_SHADER_VISIBILITY_PIXEL);
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+        rootSignatureDescription.Init_1_1(TriangleState::NumParameters, rootParameters);
+        state.m_RootSignature = device.CreateRootSignature(rootSignatureDescription.Desc_1_1);
+
+        D3D12_RT_FORMAT_ARRAY rtvFormats = {};
+        rtvFormats.NumRenderTargets = 1;
+        rtvFormats.RTFormats[0] = renderTargetFormat;
+
+        CD3DX12_DEPTH_STENCIL_DESC depthStencil(D3D12_DEFAULT);
+        depthStencil.DepthEnable = FALSE;
+
+        struct PipelineStateStream
+        {
+            CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE        pRootSignature;
+            CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY    PrimitiveTopologyType;
+            CD3DX12_PIPELINE_STATE_STREAM_VS                    VS;
+            CD3DX12_PIPELINE_STATE_STREAM_PS                    PS;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL         DepthStencil;
+            CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+        } pipelineStateStream;
+
+        pipelineStateStream.pRootSignature = state.m_RootSignature->GetD3D12RootSignature().Get();
+        pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
+        pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
+        pipelineStateStream.DepthStencil = depthStencil;
+        pipelineStateStream.RTVFormats = rtvFormats;
+
+        state.m_PipelineState = device.CreatePipelineStateObject(pipelineStateStream);
+
+        return state;
+    }
+
+    // A render target with a single color texture.
+    inline RenderTarget CreateRenderTarget(Device& device, u32 width, u32 height, DXGI_FORMAT format)
+    {
+        auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1, 1, 1, 0,
+            D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+        D3D12_CLEAR_VALUE colorClearValue = {};
+        colorClearValue.Format = format;
+
+        RenderTarget renderTarget;
+        renderTarget.AttachTexture(AttachmentPoint::Color0, device.CreateTexture(colorDesc, &colorClearValue));
+        return renderTarget;
+    }
+
+    // Writes the root constant Value (b0) to the first element of a structured buffer (u0).
+    struct WriteValueState
+    {
+        enum RootParameters
+        {
+            ValueCB,    // ConstantBuffer<Value> : register(b0);
+            ResultUAV,  // RWStructuredBuffer<uint> Result : register(u0);
+            NumParameters
+        };
+
+        RefPtr<RootSignature>       m_RootSignature;
+        RefPtr<PipelineStateObject> m_PipelineState;
+    };
+
+    inline WriteValueState CreateWriteValueState(Device& device)
+    {
+        const char* source = R"(
+            cbuffer ValueCB : register(b0) { uint Value; };
+            RWStructuredBuffer<uint> Result : register(u0);
+
+            [numthreads(1, 1, 1)]
+            void CSMain()
+            {
+                Result[0] = Value;
+            }
+        )";
+
+        auto computeShader = CompileShader(source, "CSMain", "cs_5_1");
+
+        WriteValueState state;
+
+        CD3DX12_ROOT_PARAMETER1 rootParameters[WriteValueState::NumParameters];
+        rootParameters[WriteValueState::ValueCB].InitAsConstants(1, 0);
+        rootParameters[WriteValueState::ResultUAV].InitAsUnorderedAccessView(0);
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+        rootSignatureDescription.Init_1_1(WriteValueState::NumParameters, rootParameters);
+        state.m_RootSignature = device.CreateRootSignature(rootSignatureDescription.Desc_1_1);
+
+        struct PipelineStateStream
+        {
+            CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+            CD3DX12_PIPELINE_STATE_STREAM_CS             CS;
+        } pipelineStateStream;
+
+        pipelineStateStream.pRootSignature = state.m_RootSignature->GetD3D12RootSignature().Get();
+        pipelineStateStream.CS = CD3DX12_SHADER_BYTECODE(computeShader.Get());
+
+        state.m_PipelineState = device.CreatePipelineStateObject(pipelineStateStream);
+
+        return state;
+    }
+
+    // A buffer on the readback heap, in the COPY_DEST state it has to stay in.
+    inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateReadbackBuffer(Device& device, size_t size)
+    {
+        auto readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> readbackBuffer;
+        ThrowIfFailed(device.GetD3D12Device()->CreateCommittedResource(ADDR(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK)),
+            D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readbackBuffer)));
+        return readbackBuffer;
+    }
+
+    // Read the first u32 of a readback buffer. Its copy must have completed.
+    inline u32 ReadValue(ID3D12Resource* readbackBuffer)
+    {
+        void* data = nullptr;
+        ThrowIfFailed(readbackBuffer->Map(0, nullptr, &data));
+        u32 value = *static_cast<const u32*>(data);
+        readbackBuffer->Unmap(0, nullptr);
+        return value;
+    }
+
+    // Holds back the GPU work of command queues until it is opened from the CPU, so a test can check what a queue
+    // does while the queues it depends on are still busy, independently of how fast the device is. A gate can be
+    // opened in steps: the work blocked on value n starts once the gate is opened to n.
+    class QueueGate
+    {
+    public:
+        explicit QueueGate(Device& device)
+        {
+            ThrowIfFailed(device.GetD3D12Device()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence)));
+        }
+
+        // No queue is left waiting for the gate.
+        ~QueueGate()
+        {
+            if (m_Fence->GetCompletedValue() < m_BlockedValue)
+            {
+                Open(m_BlockedValue);
+            }
+        }
+
+        QueueGate(const QueueGate&) = delete;
+        QueueGate& operator=(const QueueGate&) = delete;
+
+        // The work that is submitted to the queue after this call doesn't start before the gate is opened to value.
+        void Block(CommandQueue& commandQueue, u64 value = 1)
+        {
+            ThrowIfFailed(commandQueue.GetD3D12CommandQueue()->Wait(m_Fence.Get(), value));
+            m_BlockedValue = std::max(m_BlockedValue.load(), value);
+        }
+
+        void Open(u64 value = 1)
+        {
+            ThrowIfFailed(m_Fence->Signal(value));
+        }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+        // Blocking and opening may happen on different threads.
+        std::atomic<u64>                    m_BlockedValue{ 0 };
+    };
+}
@@ -0,0 +1,129 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    u32 gs_NumFailedChecks = 0;
+    volatile u64 gs_Sink = 0;
+    thread_local u64 gs_NumAllocations = 0;
+
+    void* Allocate(size_t size)
+    {
+        ++gs_NumAllocations;
+        if (void* memory = std::malloc(size > 0 ? size : 1))
+        {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+// Count the allocations of the test executable (see Tests::GetNumAllocations). The aligned
+// overloads are not replaced, so allocations with extended alignment are not counted.
+void* operator new(size_t size)
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return Allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+std::vector<Tests::TestCase>& Tests::GetTestCases()
+{
+    static std::vector<TestCase> testCases;
+    return testCases;
+}
+
+void Tests::Fail(const char* file, int line, const char* expression)
+{
+    std::printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+    ++gs_NumFailedChecks;
+}
+
+void Tests::Consume(u64 value)
+{
+    gs_Sink = gs_Sink + value;
+}
+
+u64 Tests::GetNumAllocations()
+{
+    return gs_NumAllocations;
+}
+
+void Tests::Report(const char* label, double milliseconds, u64 items)
+{
+    if (items > 0)
+    {
+        std::printf("  %-40s %10.3f ms %10.1f M/s\n", label, milliseconds, items / (milliseconds * 1000.0));
+    }
+    else
+    {
+        std::printf("  %-40s %10.3f ms\n", label, milliseconds);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool benchmarks = false;
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            benchmarks = true;
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    u32 numRun = 0;
+    u32 numFailed = 0;
+    for (const auto& testCase : Tests::GetTestCases())
+    {
+        if (testCase.IsBenchmark != benchmarks || (filter && std::strstr(testCase.Name, filter) == nullptr))
+        {
+            continue;
+        }
+
+        std::printf("%s\n", testCase.Name);
+
+        u32 numFailedChecks = gs_NumFailedChecks;
+        testCase.Func();
+
+        ++numRun;
+        numFailed += gs_NumFailedChecks != numFailedChecks ? 1 : 0;
+    }
+
+    std::printf("%u of %u %s passed\n", numRun - numFailed, numRun, benchmarks ? "benchmarks" : "tests");
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+/**
+ * A minimal harness for the tests and benchmarks of the engine modules. Most of them
+ * run without a device (render graph compilation, culling and mesh processing); the
+ * ones that need a device use the WARP device of TestDevice.h.
+ *
+ * TEST(Name) registers a test and BENCHMARK(Name) a benchmark. The Tests executable
+ * runs every test, or every benchmark when it is started with --benchmark. Only the
+ * cases whose name contains the (optional) last argument are run.
+ */
+namespace Tests
+{
+    using TestFunc = void (*)();
+
+    struct TestCase
+    {
+        const char* Name;
+        TestFunc    Func;
+        bool        IsBenchmark;
+    };
+
+    // All registered test cases, in registration order.
+    std::vector<TestCase>& GetTestCases();
+
+    struct TestRegistrar
+    {
+        TestRegistrar(const char* name, TestFunc func, bool isBenchmark)
+        {
+            GetTestCases().push_back({ name, func, isBenchmark });
+        }
+    };
+
+    // Record a failed check of the running test case.
+    void Fail(const char* file, int line, const char* expression);
+
+    // Keep the optimizer from removing the work of a benchmark.
+    void Consume(u64 value);
+
+    // The number of times operator new was called on the calling thread, so a test can check that a code path
+    // doesn't allocate: compare the number before and after it.
+    u64 GetNumAllocations();
+
+    // Print a benchmark result: the average time of one iteration and, if items is not
+    // zero, the throughput in millions of items per second.
+    void Report(const char* label, double milliseconds, u64 items = 0);
+
+    // Run func the given number of times and return the average time of one run in milliseconds.
+    template<typename Func>
+    double Measure(u32 iterations, Func&& func)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (u32 i = 0; i < iterations; ++i)
+        {
+            func();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        return elapsed.count() / std::max(iterations, 1u);
+    }
+}
+
+#define TEST(name)                                                            \
+    static void name();                                                       \
+    static Tests::TestRegistrar name##Registrar(#name, &name, false);          \
+    static void name()
+
+#define BENCHMARK(name)                                                       \
+    static void name();                                                       \
+    static Tests::TestRegistrar name##Registrar(#name, &name, true);           \
+    static void name()
+
+#define CHECK(expression)                                                     \
+    do                                                                        \
+    {                                                                         \
+        if (!(expression))                                                    \
+        {                                                                     \
+            Tests::Fail(__FILE__, __LINE__, #expression);                     \
+        }                                                                     \
+    } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::abs((a) - (b)) <= (tolerance))
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Engine/Renderer/FrustumCulling.h>
+
+namespace Tests
+{
+    // The view * projection matrix of a camera at the origin that looks down +z with a 90 degree
+    // field of view, a square aspect ratio and the near plane at 1.
+    inline DirectX::XMMATRIX CreateViewProjection(float farZ = 100.0f)
+    {
+        using namespace DirectX;
+
+        XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 1.0f, farZ);
+        return XMMatrixMultiply(view, projection);
+    }
+
+    // The frustum of the camera of CreateViewProjection.
+    inline Frustum CreateFrustum(float farZ = 100.0f)
+    {
+        return Frustum::FromViewProjection(CreateViewProjection(farZ));
+    }
+}
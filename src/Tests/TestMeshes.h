@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Engine/Core/VertexTypes.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace Tests
+{
+    using MeshVertex = VertexPositionNormalTangentBitangentTexture;
+
+    constexpr float Pi = 3.14159265f;
+
+    // A unit sphere of rings x segments quads, with a texture seam where u wraps from 1 to 0, and the radius of every
+    // vertex moved by up to noise.
+    inline void CreateSphere(u32 segments, u32 rings, std::vector<MeshVertex>& vertices, std::vector<u32>& indices, float noise = 0.0f)
+    {
+        using namespace DirectX;
+
+        std::mt19937                          random(1);
+        std::uniform_real_distribution<float> offset(-noise, noise);
+
+        std::vector<float> radii((rings + 1) * segments);
+        for (float& radius : radii)
+        {
+            radius = 1.0f + offset(random);
+        }
+
+        for (u32 ring = 0; ring <= rings; ++ring)
+        {
+            for (u32 segment = 0; segment <= segments; ++segment)
+            {
+                float theta = Pi * ring / rings;
+                float phi = 2.0f * Pi * segment / segments;
+                bool  pole = ring == 0 || ring == rings;
+
+                // The vertices at u = 0 and u = 1 share their position.
+                float    radius = pole ? 1.0f : radii[ring * segments + segment % segments];
+                XMFLOAT3 normal = pole ? XMFLOAT3(0.0f, std::cos(theta), 0.0f)
+                                       : XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+                MeshVertex vertex = {};
+                vertex.Position = { normal.x * radius, normal.y * radius, normal.z * radius };
+                vertex.Normal = normal;
+                vertex.TexCoord = { static_cast<float>(segment) / segments, static_cast<float>(ring) / rings, 0.0f };
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (u32 ring = 0; ring < rings; ++ring)
+        {
+            for (u32 segment = 0; segment < segments; ++segment)
+            {
+                u32 a = ring * (segments + 1) + segment;
+                u32 b = a + 1;
+                u32 c = a + segments + 1;
+                u32 d = c + 1;
+                if (ring != 0)
+                {
+                    indices.insert(indices.end(), { a, b, c });
+                }
+                if (ring != rings - 1)
+                {
+                    indices.insert(indices.end(), { b, d, c });
+                }
+            }
+        }
+    }
+
+    // A unit square of size x size quads with an open border, curved by a height of up to bumpiness. The triangles are in
+    // rows, which a vertex cache of 16 can't hold two rows of.
+    inline void CreateGrid(u32 size, std::vector<MeshVertex>& vertices, std::vector<u32>& indices, float bumpiness = 0.0f)
+    {
+        for (u32 y = 0; y <= size; ++y)
+        {
+            for (u32 x = 0; x <= size; ++x)
+            {
+                MeshVertex vertex = {};
+                vertex.Position = { static_cast<float>(x) / size, bumpiness * std::sin(x * 0.3f) * std::cos(y * 0.2f), static_cast<float>(y) / size };
+                vertex.Normal = { 0.0f, 1.0f, 0.0f };
+                vertex.TexCoord = { static_cast<float>(x) / size, static_cast<float>(y) / size, 0.0f };
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (u32 y = 0; y < size; ++y)
+        {
+            for (u32 x = 0; x < size; ++x)
+            {
+                u32 a = y * (size + 1) + x;
+                u32 b = a + 1;
+                u32 c = a + size + 1;
+                u32 d = c + 1;
+                indices.insert(indices.end(), { a, c, b, b, c, d });
+            }
+        }
+    }
+
+    // The same triangles in a random order, like a mesh whose triangles are not sorted by locality. This is the worst
+    // case for the vertex cache.
+    inline std::vector<u32> ShuffleTriangles(const std::vector<u32>& indices, u32 seed)
+    {
+        std::vector<u32> triangles(indices.size() / 3);
+        for (u32 i = 0; i < triangles.size(); ++i)
+        {
+            triangles[i] = i;
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+
+        std::vector<u32> shuffled;
+        shuffled.reserve(indices.size());
+        for (u32 triangle : triangles)
+        {
+            shuffled.insert(shuffled.end(), { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] });
+        }
+        return shuffled;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace Tests
+{
+    // The resource state trackers only compare and hash the resource pointers, so fake (never dereferenced) ones
+    // will do.
+    inline ID3D12Resource* FakeResource(size_t index)
+    {
+        return reinterpret_cast<ID3D12Resource*>(static_cast<uintptr_t>((index + 1) * 256));
+    }
+
+    inline bool Equal(const D3D12_RESOURCE_BARRIER& a, const D3D12_RESOURCE_BARRIER& b)
+    {
+        if (a.Type != b.Type || a.Flags != b.Flags)
+        {
+            return false;
+        }
+
+        switch (a.Type)
+        {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+            return a.Transition.pResource == b.Transition.pResource &&
+                   a.Transition.Subresource == b.Transition.Subresource &&
+                   a.Transition.StateBefore == b.Transition.StateBefore &&
+                   a.Transition.StateAfter == b.Transition.StateAfter;
+        case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+            return a.UAV.pResource == b.UAV.pResource;
+        default:
+            return a.Aliasing.pResourceBefore == b.Aliasing.pResourceBefore &&
+                   a.Aliasing.pResourceAfter == b.Aliasing.pResourceAfter;
+        }
+    }
+
+    inline bool Equal(const std::vector<D3D12_RESOURCE_BARRIER>& a, const std::vector<D3D12_RESOURCE_BARRIER>& b)
+    {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(), [](const auto& x, const auto& y) { return Equal(x, y); });
+    }
+}
@@ -0,0 +1,185 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/ThreadSafeQueue.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace
+{
+    // The mutex-based queue ThreadSafeQueue replaced, kept as the baseline of the benchmark.
+    template<typename T>
+    class MutexQueue
+    {
+    public:
+        void Push(T value)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.push(std::move(value));
+        }
+
+        bool TryPop(T& value)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Queue.empty())
+            {
+                return false;
+            }
+
+            value = m_Queue.front();
+            m_Queue.pop();
+            return true;
+        }
+
+    private:
+        std::queue<T> m_Queue;
+        std::mutex    m_Mutex;
+    };
+
+    // Push numItemsPerProducer distinct items from every producer and pop them on the consumers.
+    // consume(queue, values, consumerIndex) pops up to 16 values and returns how many it popped.
+    template<typename Queue, typename ConsumeFunc>
+    std::vector<u32> RunProducersAndConsumers(Queue& queue, u32 numProducers, u32 numConsumers,
+        u32 numItemsPerProducer, ConsumeFunc&& consume)
+    {
+        const u32        numItems = numProducers * numItemsPerProducer;
+        std::vector<u32> timesPopped(numItems, 0);
+        std::atomic<u32> numPopped{ 0 };
+
+        std::vector<std::thread> threads;
+        for (u32 producer = 0; producer < numProducers; ++producer)
+        {
+            threads.emplace_back([&, producer]() {
+                for (u32 i = 0; i < numItemsPerProducer; ++i)
+                {
+                    queue.Push(producer * numItemsPerProducer + i);
+                }
+            });
+        }
+
+        // Every item is counted by exactly one consumer, so the counts need no synchronization.
+        std::vector<std::vector<u32>> popped(numConsumers);
+        for (u32 consumer = 0; consumer < numConsumers; ++consumer)
+        {
+            threads.emplace_back([&, consumer]() {
+                u32 values[16];
+                while (numPopped.load(std::memory_order_relaxed) < numItems)
+                {
+                    u32 count = consume(queue, values, consumer);
+                    if (count == 0)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    popped[consumer].insert(popped[consumer].end(), values, values + count);
+                    numPopped.fetch_add(count, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto& values : popped)
+        {
+            for (u32 value : values)
+            {
+                ++timesPopped[value];
+            }
+        }
+        return timesPopped;
+    }
+}
+
+TEST(ThreadSafeQueuePopsEveryItemOnce)
+{
+    constexpr u32 NumProducers = 4;
+    constexpr u32 NumConsumers = 4;
+    constexpr u32 NumItemsPerProducer = 50000;
+
+    // A small ring, so the producers keep running into a full queue and wrap many laps.
+    ThreadSafeQueue<u32> queue(64);
+    std::vector<u32>     timesPopped = RunProducersAndConsumers(queue, NumProducers, NumConsumers,
+        NumItemsPerProducer, [](ThreadSafeQueue<u32>& queue, u32* values, u32 consumer) -> u32 {
+            // Half of the consumers pop in batches.
+            if (consumer % 2 == 0)
+            {
+                return queue.TryPop(values[0]) ? 1 : 0;
+            }
+            return static_cast<u32>(queue.TryPopMany(values, 1 + consumer * 3));
+        });
+
+    CHECK(std::all_of(timesPopped.begin(), timesPopped.end(), [](u32 count) { return count == 1; }));
+    CHECK(queue.Empty());
+    CHECK(queue.Size() == 0);
+}
+
+TEST(ThreadSafeQueueMovesValues)
+{
+    ThreadSafeQueue<std::unique_ptr<u32>> queue(4);
+    CHECK(queue.Capacity() == 4);
+
+    for (u32 i = 0; i < 4; ++i)
+    {
+        CHECK(queue.TryPush(MakeUnique<u32>(i)));
+    }
+
+    // A full queue leaves the value with the caller.
+    auto value = MakeUnique<u32>(4);
+    CHECK(!queue.TryPush(std::move(value)));
+    CHECK(value != nullptr);
+    CHECK(queue.Size() == 4);
+
+    std::unique_ptr<u32> values[3];
+    CHECK(queue.TryPopMany(values, 3) == 3);
+    CHECK(*values[0] == 0 && *values[1] == 1 && *values[2] == 2);
+
+    std::unique_ptr<u32> last;
+    CHECK(queue.TryPop(last) && *last == 3);
+    CHECK(!queue.TryPop(last));
+
+    // Values left in the queue are destroyed with it.
+    queue.Push(std::move(value));
+    CHECK(queue.Size() == 1);
+}
+
+BENCHMARK(ThreadSafeQueueContention)
+{
+    constexpr u32 NumItemsPerProducer = 200000;
+
+    for (u32 numThreads : { 1u, 2u, 4u })
+    {
+        const u64 numItems = static_cast<u64>(numThreads) * NumItemsPerProducer;
+        char      label[64];
+
+        MutexQueue<u32> mutexQueue;
+        std::snprintf(label, sizeof(label), "Mutex queue, %u+%u threads", numThreads, numThreads);
+        Tests::Report(label, Tests::Measure(1, [&]() {
+            RunProducersAndConsumers(mutexQueue, numThreads, numThreads, NumItemsPerProducer,
+                [](MutexQueue<u32>& queue, u32* values, u32) -> u32 { return queue.TryPop(values[0]) ? 1 : 0; });
+        }), numItems);
+
+        ThreadSafeQueue<u32> queue;
+        std::snprintf(label, sizeof(label), "Lock-free queue, %u+%u threads", numThreads, numThreads);
+        Tests::Report(label, Tests::Measure(1, [&]() {
+            RunProducersAndConsumers(queue, numThreads, numThreads, NumItemsPerProducer,
+                [](ThreadSafeQueue<u32>& queue, u32* values, u32) -> u32 { return queue.TryPop(values[0]) ? 1 : 0; });
+        }), numItems);
+
+        std::snprintf(label, sizeof(label), "Lock-free queue batched, %u+%u threads", numThreads, numThreads);
+        Tests::Report(label, Tests::Measure(1, [&]() {
+            RunProducersAndConsumers(queue, numThreads, numThreads, NumItemsPerProducer,
+                [](ThreadSafeQueue<u32>& queue, u32* values, u32) -> u32 {
+                    return static_cast<u32>(queue.TryPopMany(values, 16));
+                });
+        }), numItems);
+    }
+}
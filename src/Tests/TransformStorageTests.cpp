@@ -0,0 +1,408 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/JobSystem.h>
+#include <Engine/Core/TransformStorage.h>
+
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    // The transform of a Model before TransformStorage: three matrices in every (heap allocated) model,
+    // multiplied by the renderer every frame, kept as the baseline of the benchmark.
+    struct PerNodeTransform
+    {
+        Matrix Transform;
+        Matrix Rotation;
+        Matrix Scale;
+    };
+
+    // The world matrix computed recursively from the local transforms, as the reference of the tests.
+    Matrix GetReferenceWorldMatrix(const TransformStorage& storage, TransformHandle handle)
+    {
+        Matrix local = Matrix::CreateScale(storage.GetScale(handle)) *
+                       Matrix::CreateFromQuaternion(storage.GetRotation(handle)) *
+                       Matrix::CreateTranslation(storage.GetPosition(handle));
+
+        TransformHandle parent = storage.GetParent(handle);
+        return parent.IsValid() ? local * GetReferenceWorldMatrix(storage, parent) : local;
+    }
+
+    bool MatricesNear(const Matrix& a, const Matrix& b)
+    {
+        for (u32 row = 0; row < 4; ++row)
+        {
+            for (u32 column = 0; column < 4; ++column)
+            {
+                if (std::abs(a.m[row][column] - b.m[row][column]) > 1e-3f * (1.0f + std::abs(b.m[row][column])))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Check the world matrices of the live transforms against the reference and return how many matched.
+    size_t CountMatchingWorldMatrices(const TransformStorage& storage, const std::vector<TransformHandle>& handles)
+    {
+        size_t numMatching = 0;
+        for (TransformHandle handle : handles)
+        {
+            if (storage.IsAlive(handle) &&
+                MatricesNear(storage.GetWorldMatrix(handle), GetReferenceWorldMatrix(storage, handle)))
+            {
+                ++numMatching;
+            }
+        }
+        return numMatching;
+    }
+
+    // A random local transform with a scale close to 1, so the world matrices of deep chains stay in range.
+    TransformHandle CreateRandomTransform(TransformStorage& storage, std::mt19937& random, TransformHandle parent = {})
+    {
+        std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> angle(-0.5f, 0.5f);
+        std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+
+        return storage.Create(Vector3(offset(random), offset(random), offset(random)),
+            Quaternion::CreateFromYawPitchRoll(angle(random), angle(random), angle(random)),
+            Vector3(scale(random), scale(random), scale(random)), parent);
+    }
+
+    std::vector<TransformHandle> GetUpdated(const TransformStorage& storage)
+    {
+        std::vector<TransformHandle> handles;
+        storage.GetUpdated(handles);
+        std::sort(handles.begin(), handles.end(), [](TransformHandle a, TransformHandle b) { return a.Index < b.Index; });
+        return handles;
+    }
+}
+
+TEST(TransformStorageUpdatesADeepChain)
+{
+    constexpr u32 ChainLength = 256;
+
+    std::mt19937                 random(1);
+    TransformStorage             storage;
+    std::vector<TransformHandle> chain;
+    for (u32 i = 0; i < ChainLength; ++i)
+    {
+        chain.push_back(CreateRandomTransform(storage, random, i > 0 ? chain.back() : TransformHandle{}));
+    }
+
+    CHECK(storage.GetDepth(chain.back()) == ChainLength - 1);
+    CHECK(storage.Update() == ChainLength);
+    CHECK(CountMatchingWorldMatrices(storage, chain) == ChainLength);
+
+    // Nothing changed, nothing is recomputed.
+    CHECK(storage.Update() == 0);
+
+    // A changed root moves the whole chain.
+    storage.SetRotation(chain[0], Quaternion::CreateFromYawPitchRoll(0.3f, 0.0f, 0.0f));
+    CHECK(storage.Update() == ChainLength);
+    CHECK(CountMatchingWorldMatrices(storage, chain) == ChainLength);
+
+    // Changing transforms in the middle, in any order, recomputes the rest of the chain once.
+    storage.SetPosition(chain[200], Vector3(1.0f, 2.0f, 3.0f));
+    storage.SetScale(chain[100], Vector3(1.05f));
+    storage.SetPosition(chain[150], Vector3(0.0f, 1.0f, 0.0f));
+    CHECK(storage.Update() == ChainLength - 100);
+    CHECK(CountMatchingWorldMatrices(storage, chain) == ChainLength);
+}
+
+TEST(TransformStorageUpdatesAWideTree)
+{
+    // More transforms per level than the grain size of the parallel update.
+    constexpr u32 NumChildren = 10000;
+    constexpr u32 NumGrandchildren = 2;
+
+    std::mt19937                 random(2);
+    TransformStorage             storage;
+    std::vector<TransformHandle> handles = { CreateRandomTransform(storage, random) };
+    for (u32 i = 0; i < NumChildren; ++i)
+    {
+        TransformHandle child = CreateRandomTransform(storage, random, handles[0]);
+        handles.push_back(child);
+        for (u32 j = 0; j < NumGrandchildren; ++j)
+        {
+            handles.push_back(CreateRandomTransform(storage, random, child));
+        }
+    }
+
+    JobSystem jobSystem(4);
+    CHECK(storage.Update(&jobSystem) == handles.size());
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+
+    storage.SetPosition(handles[0], Vector3(5.0f, 0.0f, 0.0f));
+    CHECK(storage.Update(&jobSystem) == handles.size());
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+
+    // The serial update gives the same result.
+    storage.SetPosition(handles[0], Vector3(0.0f, 5.0f, 0.0f));
+    CHECK(storage.Update() == handles.size());
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+}
+
+TEST(TransformStorageUpdatesOnlyTheDirtySubtree)
+{
+    std::mt19937     random(3);
+    TransformStorage storage;
+
+    // Two roots, each with a three level subtree.
+    std::vector<TransformHandle> handles;
+    std::vector<TransformHandle> middles;
+    for (u32 root = 0; root < 2; ++root)
+    {
+        TransformHandle rootHandle = CreateRandomTransform(storage, random);
+        handles.push_back(rootHandle);
+        for (u32 i = 0; i < 3; ++i)
+        {
+            TransformHandle middle = CreateRandomTransform(storage, random, rootHandle);
+            handles.push_back(middle);
+            middles.push_back(middle);
+            for (u32 j = 0; j < 4; ++j)
+            {
+                handles.push_back(CreateRandomTransform(storage, random, middle));
+            }
+        }
+    }
+    storage.Update();
+
+    std::vector<Matrix> previousWorldMatrices;
+    for (TransformHandle handle : handles)
+    {
+        previousWorldMatrices.push_back(storage.GetWorldMatrix(handle));
+    }
+
+    // Move a middle transform of the second root.
+    TransformHandle middle = middles[4];
+    storage.SetRotation(middle, Quaternion::CreateFromYawPitchRoll(0.0f, 0.4f, 0.0f));
+    CHECK(storage.GetNumDirty() == 1);
+    CHECK(storage.Update() == 5);
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+
+    // Exactly the middle transform and its children were recomputed.
+    std::vector<TransformHandle> expected = { middle };
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        if (storage.GetParent(handles[i]) == middle)
+        {
+            expected.push_back(handles[i]);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](TransformHandle a, TransformHandle b) { return a.Index < b.Index; });
+    CHECK(GetUpdated(storage) == expected);
+
+    // The other world matrices were not touched.
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        bool updated = std::find(expected.begin(), expected.end(), handles[i]) != expected.end();
+        const Matrix& world = storage.GetWorldMatrix(handles[i]);
+        CHECK(updated || memcmp(&world, &previousWorldMatrices[i], sizeof(Matrix)) == 0);
+    }
+}
+
+TEST(TransformStorageUpdatesAfterReparenting)
+{
+    std::mt19937     random(4);
+    TransformStorage storage;
+
+    TransformHandle              first = CreateRandomTransform(storage, random);
+    TransformHandle              second = CreateRandomTransform(storage, random);
+    TransformHandle              child = CreateRandomTransform(storage, random, first);
+    TransformHandle              grandchild = CreateRandomTransform(storage, random, child);
+    std::vector<TransformHandle> handles = { first, second, child, grandchild };
+    storage.Update();
+
+    // Moving a subtree under a deeper parent updates its depths and world matrices.
+    TransformHandle deepParent = CreateRandomTransform(storage, random, second);
+    handles.push_back(deepParent);
+    storage.SetParent(child, deepParent);
+    CHECK(storage.GetParent(child) == deepParent);
+    CHECK(storage.GetDepth(child) == 2);
+    CHECK(storage.GetDepth(grandchild) == 3);
+    CHECK(storage.Update() == 3);
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+
+    // Moving it back to the root keeps the local transform.
+    Vector3 position = storage.GetPosition(child);
+    storage.SetParent(child, {});
+    CHECK(!storage.GetParent(child).IsValid());
+    CHECK(storage.GetDepth(grandchild) == 1);
+    CHECK(storage.GetPosition(child) == position);
+    CHECK(storage.Update() == 2);
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+
+    // A subtree moved below a transform that changed in the same frame sees the new parent.
+    storage.SetParent(child, first);
+    storage.SetPosition(first, Vector3(0.0f, 0.0f, 10.0f));
+    CHECK(storage.Update() == 3);
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size());
+}
+
+TEST(TransformStorageUpdatesAfterDestroying)
+{
+    std::mt19937                 random(5);
+    TransformStorage             storage;
+    std::vector<TransformHandle> handles;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        // A root with a child that has two children.
+        TransformHandle root = CreateRandomTransform(storage, random);
+        TransformHandle child = CreateRandomTransform(storage, random, root);
+        handles.push_back(root);
+        handles.push_back(child);
+        handles.push_back(CreateRandomTransform(storage, random, child));
+        handles.push_back(CreateRandomTransform(storage, random, child));
+    }
+    storage.Update();
+
+    // Destroying a transform turns its children into roots that keep their local transform. The last
+    // transform moves into the hole, and its handle stays valid.
+    TransformHandle destroyed = handles[5];
+    std::vector<TransformHandle> children;
+    for (TransformHandle handle : handles)
+    {
+        if (storage.GetParent(handle) == destroyed)
+        {
+            children.push_back(handle);
+        }
+    }
+    CHECK(!children.empty());
+
+    storage.Destroy(destroyed);
+    CHECK(!storage.IsAlive(destroyed));
+    CHECK(storage.GetSize() == handles.size() - 1);
+    for (TransformHandle child : children)
+    {
+        CHECK(!storage.GetParent(child).IsValid());
+        CHECK(storage.GetDepth(child) == 0);
+    }
+
+    storage.Update();
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size() - 1);
+
+    // Destroying a dirty transform, and a transform whose parent is dirty.
+    storage.SetPosition(handles[1], Vector3(1.0f, 0.0f, 0.0f));
+    storage.SetPosition(handles[8], Vector3(0.0f, 1.0f, 0.0f));
+    storage.Destroy(handles[8]);
+    storage.Destroy(handles[2]);
+    storage.Update();
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size() - 3);
+
+    // A reused slot gets a new handle, and the old handle stays dead.
+    TransformHandle reused = CreateRandomTransform(storage, random, handles[0]);
+    CHECK(reused.Index == handles[2].Index || reused.Index == handles[8].Index);
+    CHECK(!storage.IsAlive(handles[2]) && !storage.IsAlive(handles[8]));
+    handles.push_back(reused);
+    storage.Update();
+    CHECK(CountMatchingWorldMatrices(storage, handles) == handles.size() - 3);
+}
+
+TEST(TransformStorageCountsEveryDirtyTransformOnce)
+{
+    TransformStorage storage;
+    TransformHandle  first = storage.Create();
+    TransformHandle  second = storage.Create();
+    CHECK(storage.GetNumDirty() == 2);
+    storage.Update();
+    CHECK(storage.GetNumDirty() == 0);
+
+    // Changing a transform twice marks it dirty once.
+    storage.SetPosition(first, Vector3(1.0f, 0.0f, 0.0f));
+    storage.SetScale(first, Vector3(2.0f));
+    CHECK(storage.GetNumDirty() == 1);
+
+    // A destroyed dirty transform is not dirty anymore, and its reused slot is only counted once.
+    storage.Destroy(first);
+    CHECK(storage.GetNumDirty() == 0);
+    TransformHandle reused = storage.Create();
+    CHECK(reused.Index == first.Index);
+    CHECK(storage.GetNumDirty() == 1);
+    storage.SetPosition(second, Vector3(0.0f, 1.0f, 0.0f));
+    CHECK(storage.GetNumDirty() == 2);
+
+    CHECK(storage.Update() == 2);
+    CHECK(storage.GetNumDirty() == 0);
+}
+
+BENCHMARK(TransformStorageUpdate)
+{
+    constexpr u32 NumTransforms = 100000;
+    constexpr u32 Iterations = 20;
+
+    // A few rotations to cycle through, so every frame really changes the transforms.
+    Quaternion rotations[4];
+    for (u32 i = 0; i < 4; ++i)
+    {
+        rotations[i] = Quaternion::CreateFromYawPitchRoll(0.1f * static_cast<float>(i + 1), 0.0f, 0.0f);
+    }
+
+    std::vector<RefPtr<PerNodeTransform>> nodes;
+    std::vector<Matrix>                   nodeWorldMatrices(NumTransforms);
+    for (u32 i = 0; i < NumTransforms; ++i)
+    {
+        auto node = MakeRef<PerNodeTransform>();
+        node->Transform = Matrix::CreateTranslation(static_cast<float>(i), 0.0f, 0.0f);
+        node->Scale = Matrix::CreateScale(2.0f);
+        nodes.push_back(node);
+    }
+
+    TransformStorage             storage;
+    std::vector<TransformHandle> handles;
+    for (u32 i = 0; i < NumTransforms; ++i)
+    {
+        handles.push_back(storage.Create(Vector3(static_cast<float>(i), 0.0f, 0.0f), Quaternion::Identity,
+            Vector3(2.0f)));
+    }
+    storage.Update();
+
+    JobSystem jobSystem;
+    char      label[64];
+
+    // The per-node path recomputes every world matrix every frame, however many transforms changed.
+    for (u32 changedPercent : { 100u, 1u })
+    {
+        const u32 numChanged = NumTransforms * changedPercent / 100;
+        const u32 stride = NumTransforms / numChanged;
+        u32       frame = 0;
+
+        std::snprintf(label, sizeof(label), "Per-node matrices, %u%% changed", changedPercent);
+        Tests::Report(label, Tests::Measure(Iterations, [&]() {
+            const Quaternion& rotation = rotations[frame++ % 4];
+            for (u32 i = 0; i < NumTransforms; i += stride)
+            {
+                nodes[i]->Rotation = Matrix::CreateFromQuaternion(rotation);
+            }
+            for (u32 i = 0; i < NumTransforms; ++i)
+            {
+                const PerNodeTransform& node = *nodes[i];
+                nodeWorldMatrices[i] = node.Transform * node.Rotation * node.Scale;
+            }
+            Tests::Consume(static_cast<u64>(nodeWorldMatrices[NumTransforms / 2]._11));
+        }), NumTransforms);
+
+        std::snprintf(label, sizeof(label), "TransformStorage, %u%% changed", changedPercent);
+        Tests::Report(label, Tests::Measure(Iterations, [&]() {
+            const Quaternion& rotation = rotations[frame++ % 4];
+            for (u32 i = 0; i < NumTransforms; i += stride)
+            {
+                storage.SetRotation(handles[i], rotation);
+            }
+            Tests::Consume(storage.Update());
+        }), NumTransforms);
+
+        std::snprintf(label, sizeof(label), "TransformStorage jobs, %u%% changed", changedPercent);
+        Tests::Report(label, Tests::Measure(Iterations, [&]() {
+            const Quaternion& rotation = rotations[frame++ % 4];
+            for (u32 i = 0; i < NumTransforms; i += stride)
+            {
+                storage.SetRotation(handles[i], rotation);
+            }
+            Tests::Consume(storage.Update(&jobSystem));
+        }), NumTransforms);
+    }
+}
@@ -0,0 +1,166 @@
+#include "enginepch.h"
+
+#include "TestFramework.h"
+
+#include <Engine/Core/VertexTypes.h>
+
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    using Vertex = VertexPositionNormalTangentBitangentTexture;
+
+    constexpr float RadiansToDegrees = 57.2957795f;
+
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    XMFLOAT3 Normalize(const XMFLOAT3& v)
+    {
+        float length = std::sqrt(Dot(v, v));
+        return { v.x / length, v.y / length, v.z / length };
+    }
+
+    // The angle between two unit vectors, in degrees.
+    float GetAngle(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return std::acos(std::clamp(Dot(a, b), -1.0f, 1.0f)) * RadiansToDegrees;
+    }
+
+    // Random vertices in the box from offset to offset + scale, with a random orthonormal frame of either handedness.
+    std::vector<Vertex> CreateVertices(size_t count, const XMFLOAT3& positionScale, const XMFLOAT3& positionOffset, u32 seed)
+    {
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::normal_distribution<float>       normal;
+
+        std::vector<Vertex> vertices(count);
+        for (Vertex& vertex : vertices)
+        {
+            vertex.Position = { positionOffset.x + unit(random) * positionScale.x, positionOffset.y + unit(random) * positionScale.y,
+                positionOffset.z + unit(random) * positionScale.z };
+
+            vertex.Normal = Normalize({ normal(random), normal(random), normal(random) });
+            vertex.Tangent = Normalize(Cross(vertex.Normal, { normal(random), normal(random), normal(random) }));
+            vertex.Bitangent = Cross(vertex.Normal, vertex.Tangent);
+            if (random() & 1)
+            {
+                vertex.Bitangent = { -vertex.Bitangent.x, -vertex.Bitangent.y, -vertex.Bitangent.z };
+            }
+
+            vertex.TexCoord = { unit(random) * 4.0f, unit(random) * 4.0f, 0.0f };
+        }
+        return vertices;
+    }
+}
+
+TEST(VertexCompactPositionError)
+{
+    // A box of the size of a large prop, away from the origin.
+    const XMFLOAT3      positionScale = { 40.0f, 8.0f, 25.0f };
+    const XMFLOAT3      positionOffset = { -20.0f, -1.0f, 100.0f };
+    std::vector<Vertex> vertices = CreateVertices(100000, positionScale, positionOffset, 1);
+
+    // The positions are 16 bit unsigned normalized, so a position is at most half a step from its decoded position.
+    // Some rounding of the float math is allowed on top.
+    const XMFLOAT3 maxError = { 0.6f * positionScale.x / 65535.0f, 0.6f * positionScale.y / 65535.0f, 0.6f * positionScale.z / 65535.0f };
+    for (const Vertex& vertex : vertices)
+    {
+        XMFLOAT3 decoded = VertexCompact(vertex, positionScale, positionOffset).Decode(positionScale, positionOffset).Position;
+        CHECK(std::abs(decoded.x - vertex.Position.x) <= maxError.x);
+        CHECK(std::abs(decoded.y - vertex.Position.y) <= maxError.y);
+        CHECK(std::abs(decoded.z - vertex.Position.z) <= maxError.z);
+    }
+
+    // The corners of the box are exact, and an axis the box is flat along decodes to the offset.
+    Vertex corner = vertices[0];
+    corner.Position = { positionOffset.x + positionScale.x, positionOffset.y, positionOffset.z + positionScale.z };
+    XMFLOAT3 decoded = VertexCompact(corner, positionScale, positionOffset).Decode(positionScale, positionOffset).Position;
+    CHECK_NEAR(decoded.x, corner.Position.x, 1e-5f);
+    CHECK_NEAR(decoded.y, corner.Position.y, 1e-5f);
+    CHECK_NEAR(decoded.z, corner.Position.z, 1e-4f);
+
+    const XMFLOAT3 flatScale = { positionScale.x, 0.0f, positionScale.z };
+    decoded = VertexCompact(vertices[1], flatScale, positionOffset).Decode(flatScale, positionOffset).Position;
+    CHECK(decoded.y == positionOffset.y);
+}
+
+TEST(VertexCompactNormalTangentError)
+{
+    // The normals and tangents are octahedral with 16 bits per component, so they are within a few hundredths of a degree.
+    constexpr float MaxAngle = 0.05f;
+
+    const XMFLOAT3      positionScale = { 1.0f, 1.0f, 1.0f };
+    const XMFLOAT3      positionOffset = { 0.0f, 0.0f, 0.0f };
+    std::vector<Vertex> vertices = CreateVertices(100000, positionScale, positionOffset, 2);
+
+    // The axes and the directions where the octahedron folds (z < 0 and its edges) are the corner cases.
+    const XMFLOAT3 directions[] = { { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, Normalize({ 1.0f, 1.0f, -1.0f }), Normalize({ -1.0f, 1.0f, -0.01f }) };
+    for (const XMFLOAT3& direction : directions)
+    {
+        Vertex vertex = vertices[0];
+        vertex.Normal = direction;
+        vertex.Tangent = Normalize(Cross(direction, std::abs(direction.y) < 0.9f ? XMFLOAT3(0.0f, 1.0f, 0.0f) : XMFLOAT3(1.0f, 0.0f, 0.0f)));
+        vertex.Bitangent = Cross(vertex.Normal, vertex.Tangent);
+        vertices.push_back(vertex);
+    }
+
+    float maxNormalAngle = 0.0f;
+    float maxTangentAngle = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        Vertex decoded = VertexCompact(vertex, positionScale, positionOffset).Decode(positionScale, positionOffset);
+        CHECK_NEAR(Dot(decoded.Normal, decoded.Normal), 1.0f, 1e-5f);
+        CHECK_NEAR(Dot(decoded.Tangent, decoded.Tangent), 1.0f, 1e-5f);
+
+        maxNormalAngle = std::max(maxNormalAngle, GetAngle(decoded.Normal, vertex.Normal));
+        maxTangentAngle = std::max(maxTangentAngle, GetAngle(decoded.Tangent, vertex.Tangent));
+    }
+    CHECK(maxNormalAngle <= MaxAngle);
+    CHECK(maxTangentAngle <= MaxAngle);
+}
+
+TEST(VertexCompactBitangentSign)
+{
+    const XMFLOAT3      positionScale = { 1.0f, 1.0f, 1.0f };
+    const XMFLOAT3      positionOffset = { 0.0f, 0.0f, 0.0f };
+    std::vector<Vertex> vertices = CreateVertices(100000, positionScale, positionOffset, 3);
+
+    // The bitangent is the cross product of the decoded normal and tangent times the stored handedness, so it
+    // points the same way as the original one for both handednesses.
+    u32 numMirrored = 0;
+    for (const Vertex& vertex : vertices)
+    {
+        Vertex decoded = VertexCompact(vertex, positionScale, positionOffset).Decode(positionScale, positionOffset);
+        CHECK(Dot(decoded.Bitangent, vertex.Bitangent) > 0.999f);
+
+        numMirrored += Dot(Cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? 1 : 0;
+    }
+    CHECK(numMirrored > vertices.size() / 4 && numMirrored < vertices.size() * 3 / 4);
+}
+
+TEST(VertexCompactTexCoordError)
+{
+    const XMFLOAT3      positionScale = { 1.0f, 1.0f, 1.0f };
+    const XMFLOAT3      positionOffset = { 0.0f, 0.0f, 0.0f };
+    std::vector<Vertex> vertices = CreateVertices(100000, positionScale, positionOffset, 4);
+
+    // Half floats keep 11 significant bits, so the error is relative to the coordinate (and 1 / 4096 at 1).
+    for (const Vertex& vertex : vertices)
+    {
+        Vertex decoded = VertexCompact(vertex, positionScale, positionOffset).Decode(positionScale, positionOffset);
+        CHECK(std::abs(decoded.TexCoord.x - vertex.TexCoord.x) <= std::max(vertex.TexCoord.x, 1.0f) / 2048.0f);
+        CHECK(std::abs(decoded.TexCoord.y - vertex.TexCoord.y) <= std::max(vertex.TexCoord.y, 1.0f) / 2048.0f);
+        CHECK(decoded.TexCoord.z == 0.0f);
+    }
+}
@@ -263,4 +263,78 @@ project "Game"
             "_CRT_SECURE_NO_WARNINGS",
 			"_LIB",
 			"SYSTEM_WINDOWS"
-		}
\ No newline at end of file
+		}
+
+-- Tests and benchmarks of the engine modules.
+-- Run "Tests" for the tests and "Tests --benchmark" for the benchmarks (optionally followed by a name filter).
+-- The tested modules use the D3D12 types and DirectXMath (through enginepch.h), so the project is built
+-- with the Windows SDK like the engine. The tests that need a device create it on the WARP adapter, so
+-- they also run on CI machines without a GPU.
+project "Tests"
+    location "%{wks.location}/src/"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+
+    pchheader "enginepch.h"
+    pchsource "enginepch.cpp"
+
+    targetdir("../bin/")
+    debugdir("../bin/")
+    targetname("%{prj.name}_%{cfg.buildcfg}")
+    objdir("../temp/%{prj.name}/%{cfg.buildcfg}")
+
+    files {
+        "enginepch.h",
+        "enginepch.cpp",
+
+        "Tests/**.h",
+        "Tests/**.cpp",
+    }
+
+    vpaths {
+        ["Precompiled Headers"] = {"**pch.h", "**pch.cpp"}
+    }
+
+    includedirs {
+        ".",
+        "Engine/",
+        "Engine/Core",
+        "$(WindowsSDK_IncludePath)",
+        -- External includes
+        table.unpack(shared_includes)
+    }
+
+    links {
+        "Engine",
+    }
+    disablewarnings {"4201", "4702"}
+    libdirs {
+        "../lib/",
+        "$(WindowsSDK_LibraryPath_x64)"
+    }
+    filter "configurations:Debug"
+        defines {"_DEBUG", "%{wks.name}_DEBUG"}
+        runtime "Debug"
+        symbols "on"
+    filter "configurations:Release"
+        defines {"_RELEASE", "%{wks.name}_RELEASE"}
+        runtime "Release"
+        optimize "on"
+    filter "configurations:Retail"
+        defines {"_RETAIL", "%{wks.name}_RETAIL"}
+        runtime "Release"
+        optimize "on"
+
+    filter "system:windows"
+        symbols "on"
+        systemversion "latest"
+        flags {
+            "MultiProcessorCompile"
+        }
+
+        defines {
+            "WIN32",
+            "_CRT_SECURE_NO_WARNINGS",
+            "SYSTEM_WINDOWS"
+        }